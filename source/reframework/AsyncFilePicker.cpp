@@ -0,0 +1,65 @@
+#include "AsyncFilePicker.hpp"
+
+#include <nfd.hpp>
+
+void AsyncFilePicker::dialog_thread_main() {
+    // The dialog is COM based, each thread showing one has to initialize it
+    if (NFD::Init() != NFD_OKAY) {
+        result_path.clear();
+        state.store(State::ResultReady, std::memory_order_release);
+
+        return;
+    }
+
+    nfdu8char_t *out_path;
+    nfdu8filteritem_t filters[2] = { { "WebP image", "webp" }, { "All files", "*" } };
+
+    auto result = pick_folder ? NFD::PickFolder(out_path) : NFD::OpenDialog(out_path, filters, 2);
+
+    if (result == NFD_OKAY) {
+        result_path = out_path;
+        NFD::FreePath(out_path);
+    } else {
+        result_path.clear();
+    }
+
+    NFD::Quit();
+
+    state.store(State::ResultReady, std::memory_order_release);
+}
+
+bool AsyncFilePicker::open(const std::string &key, bool folder) {
+    if (state.load(std::memory_order_acquire) != State::Idle) {
+        return false;
+    }
+
+    // The previous dialog thread has published its result, it is only returning
+    if (dialog_thread.joinable()) {
+        dialog_thread.join();
+    }
+
+    pending_key = key;
+    pick_folder = folder;
+    state.store(State::Open, std::memory_order_release);
+
+    dialog_thread = std::jthread([this]() {
+        dialog_thread_main();
+    });
+
+    return true;
+}
+
+std::optional<AsyncFilePicker::Result> AsyncFilePicker::take_result(const std::string &key) {
+    if (state.load(std::memory_order_acquire) != State::ResultReady || pending_key != key) {
+        return std::nullopt;
+    }
+
+    Result result{ std::move(pending_key), std::move(result_path) };
+
+    pending_key.clear();
+    result_path.clear();
+
+    state.store(State::Idle, std::memory_order_release);
+
+    return result;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <optional>
+#include <string>
+#include <thread>
+
+// Runs the native open file (or pick folder) dialog on its own thread, so the game keeps rendering while it's open.
+// One dialog at a time. The result is handed back through a single slot guarded by an atomic state:
+// the dialog thread owns the slot until it publishes, the UI thread owns it after.
+// The picker owns the dialog thread, destroying it (plugin unload) waits for a dialog still open to be closed.
+class AsyncFilePicker {
+public:
+    struct Result {
+        // Key given to open(), to route the result back to the widget that asked
+        std::string key;
+
+        // Empty if the dialog was cancelled or failed
+        std::string path;
+    };
+
+private:
+    enum class State {
+        Idle,
+        Open,
+        ResultReady
+    };
+
+    std::atomic<State> state = State::Idle;
+
+    std::string pending_key;
+    std::string result_path;
+    bool pick_folder = false;
+
+    // Declared last, joined before the slot above is destroyed
+    std::jthread dialog_thread;
+
+    void dialog_thread_main();
+
+public:
+    ~AsyncFilePicker() = default;
+
+    // Returns false if a dialog is already open
+    bool open(const std::string &key, bool folder = false);
+
+    bool is_open() const {
+        return state.load(std::memory_order_acquire) == State::Open;
+    }
+
+    // Key of the dialog currently open, only meaningful when is_open()
+    const std::string &get_open_key() const {
+        return pending_key;
+    }
+
+    // Takes the result if the dialog opened with this key has closed
+    std::optional<Result> take_result(const std::string &key);
+};
@@ -0,0 +1,313 @@
+#define NOMINMAX
+
+#include "CaptureArchiver.hpp"
+
+#include <webp/encode.h>
+
+// A private copy, so the PNG settings below don't change the debug dumps of the rest of the plugin
+#define STB_IMAGE_WRITE_STATIC
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+
+#include <cstring>
+#include <ctime>
+#include <format>
+#include <fstream>
+
+#include <Windows.h>
+
+std::unique_ptr<CaptureArchiver> capture_archiver_instance = nullptr;
+
+namespace {
+    // stb clamps anything lower to its fastest setting
+    constexpr int ARCHIVE_PNG_COMPRESSION_LEVEL = 1;
+
+    // Paeth on every row, stb otherwise filters each row five times to pick the best filter
+    constexpr int ARCHIVE_PNG_FILTER = 4;
+
+    // Fastest lossless preset, the file is a bit larger than with the default one
+    constexpr int ARCHIVE_WEBP_LOSSLESS_LEVEL = 1;
+
+    // More captures in the same second than that is not something the game can do
+    constexpr int MAX_NAME_ATTEMPTS = 100;
+
+    void stream_write(void *context, void *data, int size) {
+        static_cast<std::ofstream*>(context)->write(static_cast<const char*>(data), size);
+    }
+
+    int webp_stream_write(const std::uint8_t *data, std::size_t data_size, const WebPPicture *picture) {
+        auto stream = static_cast<std::ofstream*>(picture->custom_ptr);
+        stream->write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(data_size));
+
+        return stream->good() ? 1 : 0;
+    }
+
+    // Alpha is always opaque in a capture, the archive drops it. Done in place, each pixel only moves to a lower offset
+    void pack_rgb_in_place(std::uint8_t *pixels, int width, int height) {
+        std::size_t pixel_count = static_cast<std::size_t>(width) * height;
+
+        for (std::size_t i = 0; i < pixel_count; i++) {
+            pixels[i * 3 + 0] = pixels[i * 4 + 0];
+            pixels[i * 3 + 1] = pixels[i * 4 + 1];
+            pixels[i * 3 + 2] = pixels[i * 4 + 2];
+        }
+    }
+
+    bool write_png(std::ofstream &stream, std::uint8_t *pixels, int width, int height) {
+        pack_rgb_in_place(pixels, width, height);
+
+        stbi_write_png_compression_level = ARCHIVE_PNG_COMPRESSION_LEVEL;
+        stbi_write_force_png_filter = ARCHIVE_PNG_FILTER;
+
+        return stbi_write_png_to_func(stream_write, &stream, width, height, 3, pixels, width * 3) != 0 && stream.good();
+    }
+
+    bool write_lossless_webp(std::ofstream &stream, const std::uint8_t *pixels, int width, int height) {
+        WebPConfig config;
+
+        if (!WebPConfigInit(&config) || !WebPConfigLosslessPreset(&config, ARCHIVE_WEBP_LOSSLESS_LEVEL)) {
+            return false;
+        }
+
+        WebPPicture picture;
+
+        if (!WebPPictureInit(&picture)) {
+            return false;
+        }
+
+        picture.width = width;
+        picture.height = height;
+        picture.use_argb = 1;
+
+        if (!WebPPictureImportRGBX(&picture, pixels, width * 4)) {
+            WebPPictureFree(&picture);
+            return false;
+        }
+
+        picture.writer = webp_stream_write;
+        picture.custom_ptr = &stream;
+
+        bool success = WebPEncode(&config, &picture) != 0;
+        WebPPictureFree(&picture);
+
+        return success && stream.good();
+    }
+}
+
+CaptureArchiver::CaptureArchiver(reframework::API *api)
+    : api(api) {
+    worker_thread = std::jthread([this](std::stop_token stop_token) {
+        worker_thread_main(stop_token);
+    });
+}
+
+CaptureArchiver::~CaptureArchiver() {
+    worker_thread.request_stop();
+    jobs_cv.notify_all();
+}
+
+bool CaptureArchiver::submit(const std::uint8_t *rgba, int width, int height, CaptureArchiveFormat format, const std::string &directory,
+    std::chrono::system_clock::time_point captured_at) {
+    if (rgba == nullptr || width <= 0 || height <= 0 || directory.empty()) {
+        return false;
+    }
+
+    std::size_t frame_size = static_cast<std::size_t>(width) * height * 4;
+
+    {
+        std::scoped_lock lock(jobs_mutex);
+
+        // Checked before copying, a full queue costs nothing to the capture
+        if (pending_bytes + frame_size > MAX_PENDING_BYTES) {
+            std::scoped_lock stats_lock(stats_mutex);
+            stats.dropped_count++;
+
+            api->log_info("Capture archive queue is full, skipping this %dx%d capture", width, height);
+            return false;
+        }
+
+        pending_bytes += frame_size;
+    }
+
+    Job job;
+    job.pixels = PixelBufferArena::get().acquire(frame_size);
+
+    if (job.pixels.empty()) {
+        {
+            std::scoped_lock lock(jobs_mutex);
+            pending_bytes -= frame_size;
+        }
+
+        std::scoped_lock stats_lock(stats_mutex);
+        stats.dropped_count++;
+
+        api->log_info("Not enough pixel buffer budget to archive this %dx%d capture, skipping it", width, height);
+        return false;
+    }
+
+    std::memcpy(job.pixels.data(), rgba, frame_size);
+    job.width = width;
+    job.height = height;
+    job.format = format;
+    job.directory = std::filesystem::path(reinterpret_cast<const char8_t*>(directory.c_str()));
+    job.captured_at = captured_at;
+
+    {
+        std::scoped_lock lock(jobs_mutex);
+        jobs.push_back(std::move(job));
+    }
+
+    jobs_cv.notify_one();
+    return true;
+}
+
+void CaptureArchiver::worker_thread_main(std::stop_token stop_token) {
+    // Lowers the I/O priority along with the CPU one, the game may be streaming assets at the same time
+    SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+
+    while (!stop_token.stop_requested()) {
+        Job job;
+
+        {
+            std::unique_lock lock(jobs_mutex);
+
+            if (!jobs_cv.wait(lock, stop_token, [this]() { return !jobs.empty(); })) {
+                return;
+            }
+
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+
+        std::size_t frame_size = job.pixels.size();
+
+        write_job(job);
+
+        // Only given back once the pixels are back in the arena, so the bound holds for the memory actually used
+        job.pixels.reset();
+
+        std::scoped_lock lock(jobs_mutex);
+        pending_bytes -= frame_size;
+    }
+}
+
+void CaptureArchiver::write_job(Job &job) {
+    auto start = std::chrono::steady_clock::now();
+
+    const char *extension = (job.format == CaptureArchiveFormat_LosslessWebP) ? "webp" : "png";
+    auto path = make_unique_path(job.directory, job.captured_at, extension);
+
+    bool success = !path.empty();
+
+    if (success) {
+        // Written aside then renamed, a crash mid-write must not leave a truncated capture under a valid name
+        auto temp_path = path;
+        temp_path += ".tmp";
+
+        {
+            std::ofstream stream(temp_path, std::ios::binary | std::ios::trunc);
+
+            if (!stream.is_open()) {
+                success = false;
+            } else if (job.format == CaptureArchiveFormat_LosslessWebP) {
+                success = write_lossless_webp(stream, job.pixels.data(), job.width, job.height);
+            } else {
+                success = write_png(stream, job.pixels.data(), job.width, job.height);
+            }
+        }
+
+        std::error_code ec;
+
+        if (success) {
+            std::filesystem::rename(temp_path, path, ec);
+            success = !ec;
+        }
+
+        if (!success) {
+            std::filesystem::remove(temp_path, ec);
+        }
+    }
+
+    double write_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::scoped_lock lock(stats_mutex);
+
+    if (!success) {
+        stats.failed_count++;
+        api->log_error("Failed to archive the %dx%d capture to %s", job.width, job.height, job.directory.string().c_str());
+
+        return;
+    }
+
+    std::error_code ec;
+
+    stats.archived_count++;
+    stats.last_path = path.string();
+    stats.last_write_ms = write_ms;
+    stats.last_file_size = std::filesystem::file_size(path, ec);
+
+    api->log_info("Archived the %dx%d capture to %s in %.0f ms", job.width, job.height, stats.last_path.c_str(), write_ms);
+}
+
+std::filesystem::path CaptureArchiver::make_unique_path(const std::filesystem::path &directory, std::chrono::system_clock::time_point captured_at,
+    const char *extension) {
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+
+    // localtime_s rather than the chrono time zones, those throw when the time zone database can't be loaded
+    std::time_t captured_time = std::chrono::system_clock::to_time_t(captured_at);
+    std::tm local_time{};
+    localtime_s(&local_time, &captured_time);
+
+    auto stem = std::format("MHWilds_QuestResult_{:04}{:02}{:02}_{:02}{:02}{:02}", local_time.tm_year + 1900, local_time.tm_mon + 1,
+        local_time.tm_mday, local_time.tm_hour, local_time.tm_min, local_time.tm_sec);
+
+    for (int attempt = 1; attempt <= MAX_NAME_ATTEMPTS; attempt++) {
+        auto name = (attempt == 1) ? std::format("{}.{}", stem, extension) : std::format("{}_{}.{}", stem, attempt, extension);
+        auto path = directory / name;
+
+        if (!std::filesystem::exists(path, ec)) {
+            return path;
+        }
+    }
+
+    return {};
+}
+
+CaptureArchiver::Stats CaptureArchiver::get_stats() const {
+    Stats result;
+
+    {
+        std::scoped_lock lock(stats_mutex);
+        result = stats;
+    }
+
+    std::scoped_lock lock(jobs_mutex);
+    result.pending_count = jobs.size();
+    result.pending_bytes = pending_bytes;
+
+    return result;
+}
+
+const char *CaptureArchiver::get_format_name(CaptureArchiveFormat format) {
+    switch (format) {
+    case CaptureArchiveFormat_PNG:
+        return "PNG (fast)";
+    case CaptureArchiveFormat_LosslessWebP:
+        return "Lossless WebP";
+    case CaptureArchiveFormat_HDRPNG:
+        return "PNG, 16-bit PNG for HDR";
+    default:
+        return "Unknown";
+    }
+}
+
+CaptureArchiver *CaptureArchiver::get_instance() {
+    return capture_archiver_instance ? capture_archiver_instance.get() : nullptr;
+}
+
+void CaptureArchiver::initialize(reframework::API *api) {
+    if (capture_archiver_instance == nullptr) {
+        capture_archiver_instance = std::unique_ptr<CaptureArchiver>(new CaptureArchiver(api));
+    }
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <reframework/API.hpp>
+
+#include "ModSettings.hpp"
+#include "../reshade/PixelBufferArena.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Keeps quest result captures at their native resolution, before the crop and resize, in a folder of the user's choice.
+// Frames are copied into pixel arena buffers in a bounded queue and written by a single worker running at background priority (CPU and disk),
+// so archiving never takes time from the encode of the in-game image. A frame that doesn't fit the queue is dropped.
+class CaptureArchiver {
+public:
+    // Two 4K frames
+    static constexpr std::size_t MAX_PENDING_BYTES = 2ull * 3840 * 2160 * 4;
+
+    struct Stats {
+        std::uint64_t archived_count = 0;
+        std::uint64_t dropped_count = 0;
+        std::uint64_t failed_count = 0;
+
+        std::size_t pending_count = 0;
+        std::size_t pending_bytes = 0;
+
+        std::string last_path;
+        double last_write_ms = 0.0;
+        std::uintmax_t last_file_size = 0;
+    };
+
+private:
+    struct Job {
+        // Given back to the arena once written
+        PixelBufferArena::Buffer pixels;
+        int width = 0;
+        int height = 0;
+        CaptureArchiveFormat format = CaptureArchiveFormat_PNG;
+        std::filesystem::path directory;
+        std::chrono::system_clock::time_point captured_at;
+    };
+
+    reframework::API *api = nullptr;
+
+    mutable std::mutex jobs_mutex;
+    std::deque<Job> jobs;
+    std::size_t pending_bytes = 0;
+    std::condition_variable_any jobs_cv;
+    std::jthread worker_thread;
+
+    mutable std::mutex stats_mutex;
+    Stats stats;
+
+    explicit CaptureArchiver(reframework::API *api);
+
+    void worker_thread_main(std::stop_token stop_token);
+    void write_job(Job &job);
+
+    static std::filesystem::path make_unique_path(const std::filesystem::path &directory, std::chrono::system_clock::time_point captured_at,
+        const char *extension);
+
+public:
+    ~CaptureArchiver();
+
+    // Copies the RGBA frame, returns false if it was dropped because the queue or the pixel buffer budget is full.
+    // captured_at names the file
+    bool submit(const std::uint8_t *rgba, int width, int height, CaptureArchiveFormat format, const std::string &directory,
+        std::chrono::system_clock::time_point captured_at);
+
+    Stats get_stats() const;
+
+    static const char *get_format_name(CaptureArchiveFormat format);
+
+    static CaptureArchiver *get_instance();
+    static void initialize(reframework::API *api);
+};
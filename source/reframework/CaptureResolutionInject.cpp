@@ -1,16 +1,17 @@
 #include "CaptureResolutionInject.hpp"
 #include "REFrameworkBorrowedAPI.hpp"
+#include <fstream>
 #include <numeric>
 
 static const char *HIGH_RESOLUTION_CAPTURE_PACK_AVAILABLE_FILE = "reframework/data/MHWildsHQQuestResult_HighResolutionCapturePackAvailable";
 
-static std::map<std::pair<int, int>, std::string> paths_to_capture_render_target_16x9 = {
+static CaptureResolutionInject::RenderTargetPathMap paths_to_capture_render_target_16x9 = {
     {{1920, 1080}, "RenderTexture/16x9/Quest_Background_16x9_1080p.rtex"},
     {{2560, 1440}, "RenderTexture/16x9/Quest_Background_16x9_2K.rtex"},
     {{3840, 2160}, "RenderTexture/16x9/Quest_Background_16x9_4K.rtex"},
 };
 
-static std::map<std::pair<int, int>, std::string> paths_to_capture_render_target_21x9 = {
+static CaptureResolutionInject::RenderTargetPathMap paths_to_capture_render_target_21x9 = {
     {{2560, 1080}, "RenderTexture/21x9/Quest_Background_21x9_1080p.rtex"},
     {{3440, 1440}, "RenderTexture/21x9/Quest_Background_21x9_3440x1440.rtex"},
     {{5120, 2160}, "RenderTexture/21x9/Quest_Background_21x9_4K.rtex"},
@@ -26,6 +27,55 @@ static bool is_high_res_capture_pack_available() {
     return std::filesystem::exists(path_enable);
 }
 
+// Render target files go to the loose file folder next to the game, where an unpacked HD capture pack lives too
+class GameRenderTargetResourceLoader : public RenderTargetResourceLoader {
+private:
+    reframework::API *api = nullptr;
+    std::filesystem::path natives_dir;
+
+    std::filesystem::path get_file_path(const std::string &path) const {
+        return natives_dir / (path + ExactRenderTarget::RTEX_FILE_VERSION_SUFFIX);
+    }
+
+public:
+    explicit GameRenderTargetResourceLoader(reframework::API *api_instance)
+        : api(api_instance)
+        , natives_dir(REFramework::get_persistent_dir() / "natives" / "STM") {
+    }
+
+    bool read_file(const std::string &path, std::vector<std::uint8_t> &data) override {
+        std::ifstream file(get_file_path(path), std::ios::binary);
+
+        if (!file) {
+            return false;
+        }
+
+        data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        return true;
+    }
+
+    bool write_file(const std::string &path, const std::vector<std::uint8_t> &data) override {
+        auto file_path = get_file_path(path);
+
+        std::error_code ec;
+        std::filesystem::create_directories(file_path.parent_path(), ec);
+
+        std::ofstream file(file_path, std::ios::binary | std::ios::trunc);
+
+        if (!file) {
+            api->log_error("Failed to write render target file %s", file_path.string().c_str());
+            return false;
+        }
+
+        file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+        return file.good();
+    }
+
+    reframework::API::Resource *create_resource(const std::string &path) override {
+        return api->resource_manager()->create_resource(RENDER_TARGET_TEXTURE_TYPE_NAME, path);
+    }
+};
+
 std::unique_ptr<CaptureResolutionInject> capture_resolution_inject_instance = nullptr;
 
 CaptureResolutionInject::Resolution DEFAULT_RESOLUTION_16x9 = {1920, 1080};
@@ -61,47 +111,8 @@ CaptureResolutionInject::CaptureResolutionInject(reframework::API* api_instance)
         api->log_info("Quest result background: HD capture pack is available");
     }
 
-    auto resource_manager = api->resource_manager();
-
-    for (const auto& [resolution, path] : paths_to_capture_render_target_16x9) {
-        auto resource = resource_manager->create_resource(RENDER_TARGET_TEXTURE_TYPE_NAME, path);
-        if (resource) {
-            api->log_error("Loaded render target with resolution %dx%d for 16:9 monitor", resolution.first, resolution.second);
-
-            resource->add_ref();
-
-            ResourceInfo resource_info;
-            resource_info.resource = resource;
-            resource_info.holder = create_render_target_texture_resource_holder(api, resource);
-            resource_info.is_plugin_managed = true;
-
-            resource_info.holder->add_ref();
-
-            capture_render_targets_by_resolution_16x9[resolution] = resource_info;
-        } else {
-            api->log_error("Failed to load render target for resolution %dx%d", resolution.first, resolution.second);
-        }
-    }
-
-    for (const auto& [resolution, path] : paths_to_capture_render_target_21x9) {
-        auto resource = resource_manager->create_resource(RENDER_TARGET_TEXTURE_TYPE_NAME, path);
-        if (resource) {
-            api->log_error("Loaded render target with resolution %dx%d for 21:9 monitor", resolution.first, resolution.second);
-
-            resource->add_ref();
-
-            ResourceInfo resource_info;
-            resource_info.resource = resource;
-            resource_info.holder = create_render_target_texture_resource_holder(api, resource);
-            resource_info.is_plugin_managed = true;
-
-            resource_info.holder->add_ref();
-
-            capture_render_targets_by_resolution_21x9[resolution] = resource_info;
-        } else {
-            api->log_error("Failed to load render target for resolution %dx%d", resolution.first, resolution.second);
-        }
-    }
+    // Render targets are created on demand by update_resolution/prefetch, only the one matching the screen is ever loaded
+    resource_loader = std::make_unique<GameRenderTargetResourceLoader>(api);
 
     auto tdb = api->tdb();
     get_main_view_method = tdb->find_method("via.SceneManager", "get_MainView");
@@ -198,6 +209,7 @@ int CaptureResolutionInject::pre_gui070002_on_close(int argc, void** argv, REFra
 void CaptureResolutionInject::post_gui070002_on_close(void** ret_val, REFrameworkTypeDefinitionHandle ret_ty, unsigned long long ret_addr) {
     if (capture_resolution_inject_instance && capture_resolution_inject_instance->is_gui_quest_closed) {
         capture_resolution_inject_instance->revert();
+        capture_resolution_inject_instance->release_render_targets();
         capture_resolution_inject_instance->is_gui_quest_closed = false;
         capture_resolution_inject_instance->gui_quest_instance = nullptr;
     }
@@ -245,78 +257,99 @@ bool CaptureResolutionInject::get_screen_size(float& width, float& height) {
     return true;
 }
 
-reframework::API::ManagedObject *CaptureResolutionInject::find_nearest_render_target_texture_holder(float current_width, float current_height, RenderTargetMap& render_target_map,
-    Resolution *output_resolution) const {
-    float epsilon = std::numeric_limits<float>::epsilon();
+reframework::API::ManagedObject *CaptureResolutionInject::acquire_render_target_texture_holder(const Resolution &resolution,
+    const ExactRenderTarget::Choice &target, bool exact, RenderTargetMap& render_target_map) {
+    auto resident = render_target_map.find(resolution);
+    if (resident != render_target_map.end()) {
+        return resident->second.holder;
+    }
 
-    float best_difference = std::numeric_limits<float>::max();
-    bool found_one = false;
+    reframework::API::Resource *resource = nullptr;
 
-    reframework::API::ManagedObject *best_render_target_holder = nullptr;
-    std::pair<int, int> best_resolution = {0, 0};
+    if (exact) {
+        resource = ExactRenderTarget::create(*resource_loader, target.template_paths, resolution);
+    } else {
+        resource = resource_loader->create_resource(target.nearest_path);
+    }
 
-    for (const auto& [resolution, resource] : render_target_map) {
-        float width = static_cast<float>(resolution.first);
-        float height = static_cast<float>(resolution.second);
+    if (!resource) {
+        api->log_error("Failed to load render target for resolution %dx%d", resolution.first, resolution.second);
+        return nullptr;
+    }
 
-        if (current_width < width && current_height < height) {
-            // Pick this immediately
-            best_render_target_holder = resource.holder;
-            best_resolution = resolution;
+    resource->add_ref();
 
-            found_one = true;
+    ResourceInfo resource_info;
+    resource_info.resource = resource;
+    resource_info.holder = create_render_target_texture_resource_holder(api, resource);
+    resource_info.is_plugin_managed = true;
 
-            break;
-        }
+    if (!resource_info.holder) {
+        resource->release();
+        return nullptr;
+    }
 
-        if (std::abs(current_width - width) < epsilon && std::abs(current_height - height) < epsilon) {
-            best_render_target_holder = resource.holder;
-            best_resolution = resolution;
+    resource_info.holder->add_ref();
 
-            found_one = true;
+    api->log_info("Loaded %srender target with resolution %dx%d", exact ? "exact " : "", resolution.first, resolution.second);
 
-            break;
-        }
+    render_target_map[resolution] = resource_info;
 
-        float current_difference = std::abs(current_width - width) + std::abs(current_height - height);
-        if (current_difference < best_difference) {
-            best_difference = current_difference;
-            best_render_target_holder = resource.holder;
-            best_resolution = resolution;
+    return resource_info.holder;
+}
 
-            found_one = true;
-        }
-    }
+reframework::API::ManagedObject *CaptureResolutionInject::acquire_render_target_texture_holder(const RenderTargetChoice &choice,
+    Resolution &acquired_resolution) {
+    auto &render_target_map = choice.is_widescreen ? capture_render_targets_by_resolution_21x9 : capture_render_targets_by_resolution_16x9;
+
+    const auto &target = choice.target;
+
+    if (use_exact_resolution && target.exact_resolution != target.nearest_resolution) {
+        auto holder = acquire_render_target_texture_holder(target.exact_resolution, target, true, render_target_map);
 
-    if (found_one) {
-        api->log_info("Best render target found for resolution %dx%d", best_resolution.first, best_resolution.second);
-        
-        if (output_resolution) {
-            *output_resolution = best_resolution;
+        if (holder) {
+            acquired_resolution = target.exact_resolution;
+            return holder;
         }
 
-        return best_render_target_holder;
-    } else {
-        api->log_error("No suitable render target found for resolution %dx%d", static_cast<int>(current_width), static_cast<int>(current_height));
-    
-        return nullptr;
+        api->log_error("Failed to create exact render target (is the HD capture pack unpacked?), use nearest one");
     }
+
+    acquired_resolution = target.nearest_resolution;
+    return acquire_render_target_texture_holder(target.nearest_resolution, target, false, render_target_map);
 }
 
-void CaptureResolutionInject::update_resolution() {
-    if (!enabled) {
-        return;
-    }
+void CaptureResolutionInject::release_render_targets(RenderTargetMap& render_target_map) {
+    for (auto it = render_target_map.begin(); it != render_target_map.end();) {
+        auto &resource = it->second;
 
-    if (!ensure_album_manager_and_fields()) {
-        return;
+        if (resource.holder) {
+            resource.holder->release();
+        }
+
+        if (resource.is_plugin_managed && resource.resource) {
+            resource.resource->release();
+        }
+
+        api->log_info("Released render target with resolution %dx%d", it->first.first, it->first.second);
+
+        it = render_target_map.erase(it);
     }
+}
 
+void CaptureResolutionInject::release_render_targets() {
     if (capture_render_targets_by_resolution_16x9.empty() && capture_render_targets_by_resolution_21x9.empty()) {
-        api->log_error("No extra render targets, assuming render target PAK is not installed!");
         return;
     }
 
+    // The album manager must not keep pointing at a holder that is about to go away
+    revert();
+
+    release_render_targets(capture_render_targets_by_resolution_16x9);
+    release_render_targets(capture_render_targets_by_resolution_21x9);
+}
+
+bool CaptureResolutionInject::find_render_target_for_screen(RenderTargetChoice &choice) {
     float width = 0.0f;
     float height = 0.0f;
 
@@ -347,53 +380,86 @@ void CaptureResolutionInject::update_resolution() {
 
     api->log_info("Game resolution: %dx%d; is widescreen: %d", (int)width, (int)height, (int)is_widescreen);
 
-    reframework::API::ManagedObject *best_resource_holder = nullptr;
+    auto &render_target_paths = is_widescreen ? paths_to_capture_render_target_21x9 : paths_to_capture_render_target_16x9;
+    Resolution screen_resolution = { static_cast<int>(width), static_cast<int>(height) };
+
+    choice.is_widescreen = is_widescreen;
+
+    // The slot's aspect ratio decides the exact size, not the raw screen: 21:9 on a 16:9 screen is letterboxed
+    if (!ExactRenderTarget::choose(screen_resolution, render_target_paths, choice.target)) {
+        api->log_error("No suitable render target found for resolution %dx%d", screen_resolution.first, screen_resolution.second);
+        return false;
+    }
+
+    api->log_info("Best render target found for resolution %dx%d: %dx%d, exact size %dx%d", screen_resolution.first, screen_resolution.second,
+        choice.target.nearest_resolution.first, choice.target.nearest_resolution.second, choice.target.exact_resolution.first,
+        choice.target.exact_resolution.second);
+
+    return true;
+}
+
+void CaptureResolutionInject::prefetch() {
+    if (!enabled) {
+        return;
+    }
+
+    if (!ensure_album_manager_and_fields()) {
+        return;
+    }
+
+    RenderTargetChoice choice;
+
+    if (!find_render_target_for_screen(choice)) {
+        return;
+    }
+
+    Resolution acquired_resolution;
+    acquire_render_target_texture_holder(choice, acquired_resolution);
+}
+
+void CaptureResolutionInject::update_resolution() {
+    if (!enabled) {
+        return;
+    }
+
+    if (!ensure_album_manager_and_fields()) {
+        return;
+    }
 
-    if (is_widescreen) {
-        auto best_21x9_render_target = find_nearest_render_target_texture_holder(width, height, capture_render_targets_by_resolution_21x9,
-            &current_resolution_21x9);
+    RenderTargetChoice choice;
+    reframework::API::ManagedObject *best_render_target = nullptr;
+    Resolution best_resolution;
 
-        if (!best_21x9_render_target) {
+    if (find_render_target_for_screen(choice)) {
+        best_render_target = acquire_render_target_texture_holder(choice, best_resolution);
+    }
+
+    if (choice.is_widescreen) {
+        if (best_render_target) {
+            current_resolution_21x9 = best_resolution;
+        } else {
             api->log_error("Failed to find suitable render target for 21x9 resolution, use default");
-            best_21x9_render_target = default_21x9_render_target_texture_holder;
+            best_render_target = default_21x9_render_target_texture_holder;
             current_resolution_21x9 = DEFAULT_RESOLUTION_21x9;
         }
 
-        best_resource_holder = best_21x9_render_target;
-
-        *render_target_texture_holder_field_21x9 = best_resource_holder;
+        *render_target_texture_holder_field_21x9 = best_render_target;
     } else {
-        auto best_16x9_render_target = find_nearest_render_target_texture_holder(width, height, capture_render_targets_by_resolution_16x9,
-            &current_resolution_16x9);
-
-        if (!best_16x9_render_target) {
+        if (best_render_target) {
+            current_resolution_16x9 = best_resolution;
+        } else {
             api->log_error("Failed to find suitable render target for 16x9 resolution, use default");
-            best_16x9_render_target = default_16x9_render_target_texture_holder;
+            best_render_target = default_16x9_render_target_texture_holder;
             current_resolution_16x9 = DEFAULT_RESOLUTION_16x9;
         }
 
-        best_resource_holder = best_16x9_render_target;
-        
-        *render_target_texture_holder_field_16x9 = best_resource_holder;
+        *render_target_texture_holder_field_16x9 = best_render_target;
     }
 }
 
 void CaptureResolutionInject::cleanup() {
-    for (auto& [resolution, resource] : capture_render_targets_by_resolution_16x9) {
-        resource.holder->release();
-        
-        if (resource.is_plugin_managed) {
-            resource.resource->release();
-        }
-    }
-
-    for (auto& [resolution, resource] : capture_render_targets_by_resolution_21x9) {
-        resource.holder->release();
-
-        if (resource.is_plugin_managed) {
-            resource.resource->release();
-        }
-    }
+    release_render_targets(capture_render_targets_by_resolution_16x9);
+    release_render_targets(capture_render_targets_by_resolution_21x9);
 }
 
 void CaptureResolutionInject::update_gui_texture() {
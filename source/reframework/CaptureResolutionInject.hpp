@@ -1,12 +1,17 @@
 #pragma once
 
 #include <reframework/API.hpp>
+#include "ExactRenderTarget.hpp"
+
 #include <map>
+#include <memory>
+#include <string>
 #include <tuple>
 
 class CaptureResolutionInject {
 public:
     using Resolution = std::pair<int, int>;
+    using RenderTargetPathMap = ExactRenderTarget::TemplatePathMap;
 
 private:
     struct ResourceInfo {
@@ -17,6 +22,13 @@ private:
 
     using RenderTargetMap = std::map<Resolution, ResourceInfo>;
 
+    struct RenderTargetChoice {
+        bool is_widescreen = false;
+
+        // Among the render targets shipped in the HD capture pack for the slot, which are also the templates of the exact one
+        ExactRenderTarget::Choice target;
+    };
+
     RenderTargetMap capture_render_targets_by_resolution_16x9;
     RenderTargetMap capture_render_targets_by_resolution_21x9;
 
@@ -41,9 +53,22 @@ private:
     Resolution current_resolution_21x9;
 
     bool enabled = false;
+    bool use_exact_resolution = false;
+
+    std::unique_ptr<RenderTargetResourceLoader> resource_loader;
+
+    // Creates the render target of this resolution if it is not resident yet. An exact one is cloned from the nearest installed
+    // template, otherwise the nearest template itself is loaded
+    reframework::API::ManagedObject *acquire_render_target_texture_holder(const Resolution &resolution, const ExactRenderTarget::Choice &target,
+        bool exact, RenderTargetMap& render_target_map);
 
-    reframework::API::ManagedObject *find_nearest_render_target_texture_holder(float current_width, float current_height, RenderTargetMap& render_target_map,
-        Resolution *output_resolution) const;
+    // Acquires the exact resolution render target if enabled, falls back to the nearest shipped one.
+    // Returns the holder and the resolution it was acquired for
+    reframework::API::ManagedObject *acquire_render_target_texture_holder(const RenderTargetChoice &choice, Resolution &acquired_resolution);
+
+    void release_render_targets(RenderTargetMap& render_target_map);
+
+    bool find_render_target_for_screen(RenderTargetChoice &choice);
 
     void update_gui_texture();
 
@@ -67,6 +92,18 @@ public:
     void revert();
     void cleanup();
 
+    // Creates the render target update_resolution is going to pick, without swapping it in yet
+    void prefetch();
+
+    // Creates render targets of exactly the screen resolution instead of using the nearest shipped one, so the capture
+    // does not need to be resampled
+    void set_use_exact_resolution(bool value) {
+        use_exact_resolution = value;
+    }
+
+    // Releases the render targets the plugin created, the game's own ones are put back first
+    void release_render_targets();
+
     static void initialize(reframework::API* api_instance);
     static CaptureResolutionInject* get_instance();
 
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+
+#include "MHWildsTypes.h"
+
+// Frame by frame decisions of the capture, kept free of REFramework so a recorded trace can be replayed outside of the game
+// (see CaptureTrace and tools/CaptureReplay). The clients feed them what they read from the game and act on the result.
+
+// Freeze and UI hide before a ReShade capture. Started when a capture is requested, then stepped once per game update
+// until the capture launches. The timescale hold is counted down by end_rendering and outlasts the launch by the frames
+// still to be captured
+class CapturePrepareSequencer {
+public:
+    enum class State : int {
+        None,
+        FreezeScene,
+        WaitingHideUI,
+        Complete
+    };
+
+    // Frames the game stays frozen after capturing early, so the captured frame is not already unfrozen
+    static constexpr int FREEZE_FRAMES_AFTER_SETTLE = 2;
+
+    static constexpr float START_CAPTURE_AFTER_HIDE_REACHED_PROGRESS = 0.5f;
+
+    void start(int freeze_frames, int capture_frames) {
+        // The merged frames are the last ones of the freeze, it isn't made longer for them. At least one frame
+        // is still frozen before the first of them
+        capture_frame_count = std::clamp(capture_frames, 1, std::max(1, freeze_frames - 1));
+
+        frame_total = freeze_frames;
+        frame_left = frame_total;
+        state = State::FreezeScene;
+    }
+
+    void reset() {
+        state = State::None;
+        frame_left = -1;
+    }
+
+    // Returns true on the update the capture has to be launched, the sequencer is then back to None.
+    // is_scene_settled(frames_frozen) is only asked while the freeze is not done, get_hide_progress() only after it
+    template <typename SettledFunc, typename HideProgressFunc>
+    bool update(SettledFunc &&is_scene_settled, HideProgressFunc &&get_hide_progress) {
+        if (state == State::FreezeScene) {
+            int frames_frozen = get_frames_frozen();
+
+            if (frames_frozen >= frame_total - capture_frame_count) {
+                state = State::WaitingHideUI;
+            } else if (is_scene_settled(frames_frozen)) {
+                // The UI fade is part of what settled, no need to wait for the hide progress either
+                state = State::Complete;
+
+                int frame_left_after_settle = FREEZE_FRAMES_AFTER_SETTLE + capture_frame_count - 1;
+
+                if (frame_left > frame_left_after_settle) {
+                    frame_left = frame_left_after_settle;
+                }
+            }
+        }
+
+        if (state == State::WaitingHideUI && get_hide_progress() >= START_CAPTURE_AFTER_HIDE_REACHED_PROGRESS) {
+            state = State::Complete;
+        }
+
+        if (state == State::Complete) {
+            state = State::None;
+            return true;
+        }
+
+        return false;
+    }
+
+    // Returns false if no frame was being counted
+    bool end_rendering() {
+        if (frame_left < 0) {
+            return false;
+        }
+
+        frame_left--;
+        return true;
+    }
+
+    // The timescale is held from the start until the last frozen frame was rendered
+    bool is_holding_timescale() const {
+        return frame_left >= 0;
+    }
+
+    // Last frame of the hold, the timescale goes back to what it was before
+    bool is_releasing_timescale() const {
+        return frame_left == 0;
+    }
+
+    bool is_preparing() const {
+        return state != State::None;
+    }
+
+    State get_state() const {
+        return state;
+    }
+
+    int get_frame_left() const {
+        return frame_left;
+    }
+
+    int get_frame_total() const {
+        return frame_total;
+    }
+
+    int get_frames_frozen() const {
+        return frame_total - frame_left;
+    }
+
+    int get_capture_frame_count() const {
+        return capture_frame_count;
+    }
+
+private:
+    State state = State::None;
+    int frame_left = -1;
+    int frame_total = 0;
+
+    // Frames merged into the capture, taken in the last frames of the freeze
+    int capture_frame_count = 1;
+};
+
+// Holds the game's own save capture in COPY_TO_STAGING for a few updates, so the UI is hidden on the copied frame
+class SaveCaptureDelay {
+public:
+    // Returns true while the original updateSaveCapture has to be skipped
+    bool update(SaveCaptureState state, int delay_frames) {
+        if (state <= SAVECAPTURESTATE_START) {
+            frames_left = delay_frames;
+        }
+
+        if (state != SAVECAPTURESTATE_COPY_TO_STAGING) {
+            return false;
+        }
+
+        frames_left--;
+        return frames_left > 0;
+    }
+
+    int get_frames_left() const {
+        return frames_left;
+    }
+
+private:
+    int frames_left = 0;
+};
+
+// What the injector does with its request queue after each updateSaveCapture, in this order: start the next pending request,
+// finish the capturing one, drop it, disarm the hooks
+class SaveCaptureRouting {
+public:
+    enum Action : int {
+        Action_StartPending = 1 << 0,
+        Action_Finish = 1 << 1,
+        Action_Drop = 1 << 2,
+        Action_Disarm = 1 << 3
+    };
+
+    // A new save capture only takes the next request until it reaches serialization, the states after that belong to the
+    // request injected last
+    static bool should_start_pending(SaveCaptureState state, bool has_capturing_request) {
+        return !has_capturing_request && state >= SAVECAPTURESTATE_START && state <= SAVECAPTURESTATE_WAIT_SERIALIZE;
+    }
+
+    static bool should_finish(SaveCaptureState state, bool has_capturing_request, bool is_capture_done) {
+        return has_capturing_request && state == SAVECAPTURESTATE_SAVE_CAPTURE && is_capture_done;
+    }
+
+    // The game went back to idle before the capture was injected
+    static bool should_drop(SaveCaptureState state, bool has_capturing_request) {
+        return has_capturing_request && state == SAVECAPTURESTATE_IDLE;
+    }
+
+    static bool should_disarm(SaveCaptureState state, std::size_t request_count) {
+        return state == SAVECAPTURESTATE_IDLE && request_count == 0;
+    }
+};
@@ -0,0 +1,194 @@
+#include "CaptureTrace.hpp"
+
+#include <charconv>
+#include <cstdio>
+#include <fstream>
+#include <string_view>
+
+std::unique_ptr<CaptureTraceRecorder> capture_trace_recorder_instance = nullptr;
+
+namespace {
+    const char *KIND_NAMES[] = {
+        "prepare_start",
+        "prepare_update",
+        "prepare_result",
+        "timescale",
+        "end_rendering",
+        "save_capture_delay",
+        "save_capture_route"
+    };
+
+    static_assert(std::size(KIND_NAMES) == static_cast<std::size_t>(CaptureTraceEventKind::Count), "Every event kind needs a name");
+
+    const char *HEADER_PREFIX = "# MHWilds capture trace v";
+    const char *COLUMNS_LINE = "frame,time_us,kind,v0,v1,v2,v3,v4,v5,progress";
+
+    template <typename T>
+    bool parse_field(std::string_view &line, T &value) {
+        auto separator = line.find(',');
+        auto field = line.substr(0, separator);
+
+        auto [end, ec] = std::from_chars(field.data(), field.data() + field.size(), value);
+
+        if (ec != std::errc() || end != field.data() + field.size()) {
+            return false;
+        }
+
+        line = (separator == std::string_view::npos) ? std::string_view{} : line.substr(separator + 1);
+        return true;
+    }
+}
+
+void CaptureTraceRecorder::push(CaptureTraceEventKind kind, const std::array<std::int32_t, 6> &values, float progress) {
+    auto now = std::chrono::steady_clock::now();
+
+    std::scoped_lock lock(events_mutex);
+
+    if (events.size() >= MAX_EVENT_COUNT) {
+        dropped_count++;
+        return;
+    }
+
+    CaptureTraceEvent event;
+    event.frame = frame.load(std::memory_order_relaxed);
+    event.time_us = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(now - recording_start).count());
+    event.kind = kind;
+    event.values = values;
+    event.progress = progress;
+
+    events.push_back(event);
+}
+
+void CaptureTraceRecorder::set_recording(bool recording) {
+    if (recording == is_recording.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    if (recording) {
+        std::scoped_lock lock(events_mutex);
+
+        events.clear();
+        dropped_count = 0;
+        recording_start = std::chrono::steady_clock::now();
+        frame.store(0, std::memory_order_relaxed);
+    }
+
+    is_recording.store(recording, std::memory_order_relaxed);
+}
+
+CaptureTraceRecorder::Stats CaptureTraceRecorder::get_stats() const {
+    Stats stats;
+    stats.frame_count = frame.load(std::memory_order_relaxed);
+
+    std::scoped_lock lock(events_mutex);
+    stats.event_count = events.size();
+    stats.dropped_count = dropped_count;
+
+    return stats;
+}
+
+bool CaptureTraceRecorder::save(const std::filesystem::path &path) const {
+    std::ofstream file(path, std::ios::trunc);
+
+    if (!file) {
+        return false;
+    }
+
+    file << HEADER_PREFIX << FORMAT_VERSION << '\n' << COLUMNS_LINE << '\n';
+
+    std::scoped_lock lock(events_mutex);
+
+    // %.9g, hide progress is compared to a threshold and has to read back exactly
+    char line[256];
+
+    for (const auto &event : events) {
+        std::snprintf(line, sizeof(line), "%llu,%llu,%s,%d,%d,%d,%d,%d,%d,%.9g\n", static_cast<unsigned long long>(event.frame),
+            static_cast<unsigned long long>(event.time_us), get_kind_name(event.kind), event.values[0], event.values[1], event.values[2],
+            event.values[3], event.values[4], event.values[5], static_cast<double>(event.progress));
+
+        file << line;
+    }
+
+    return static_cast<bool>(file);
+}
+
+bool CaptureTraceRecorder::load(const std::filesystem::path &path, std::vector<CaptureTraceEvent> &loaded_events, std::string &error) {
+    std::ifstream file(path);
+
+    if (!file) {
+        error = "Can't open the file";
+        return false;
+    }
+
+    std::string line;
+
+    if (!std::getline(file, line) || line != HEADER_PREFIX + std::to_string(FORMAT_VERSION)) {
+        error = "Not a capture trace of version " + std::to_string(FORMAT_VERSION);
+        return false;
+    }
+
+    std::size_t line_number = 1;
+
+    while (std::getline(file, line)) {
+        line_number++;
+
+        if (line.empty() || line == COLUMNS_LINE) {
+            continue;
+        }
+
+        // Saved on Windows, read back anywhere
+        if (line.back() == '\r') {
+            line.pop_back();
+        }
+
+        std::string_view rest = line;
+        CaptureTraceEvent event;
+
+        bool parsed = parse_field(rest, event.frame) && parse_field(rest, event.time_us);
+
+        if (parsed) {
+            auto kind_name = rest.substr(0, rest.find(','));
+            parsed = false;
+
+            for (std::size_t i = 0; i < std::size(KIND_NAMES); i++) {
+                if (kind_name == KIND_NAMES[i]) {
+                    event.kind = static_cast<CaptureTraceEventKind>(i);
+                    parsed = true;
+                    break;
+                }
+            }
+
+            rest = rest.substr(kind_name.size() < rest.size() ? kind_name.size() + 1 : rest.size());
+        }
+
+        for (auto &value : event.values) {
+            parsed = parsed && parse_field(rest, value);
+        }
+
+        parsed = parsed && parse_field(rest, event.progress) && rest.empty();
+
+        if (!parsed) {
+            error = "Malformed event on line " + std::to_string(line_number);
+            return false;
+        }
+
+        loaded_events.push_back(event);
+    }
+
+    return true;
+}
+
+const char *CaptureTraceRecorder::get_kind_name(CaptureTraceEventKind kind) {
+    auto index = static_cast<std::size_t>(kind);
+    return index < std::size(KIND_NAMES) ? KIND_NAMES[index] : "unknown";
+}
+
+CaptureTraceRecorder *CaptureTraceRecorder::get_instance() {
+    return capture_trace_recorder_instance ? capture_trace_recorder_instance.get() : nullptr;
+}
+
+void CaptureTraceRecorder::initialize() {
+    if (capture_trace_recorder_instance == nullptr) {
+        capture_trace_recorder_instance = std::unique_ptr<CaptureTraceRecorder>(new CaptureTraceRecorder());
+    }
+}
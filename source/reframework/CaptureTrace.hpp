@@ -0,0 +1,116 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// What the capture state machines were fed and what they decided, see CaptureSequencing.hpp
+enum class CaptureTraceEventKind : std::uint8_t {
+    // freeze frames, capture frames
+    PrepareStart,
+
+    // state, frame left, scene settled (-1 when not asked), progress: hide progress (-1 when not asked)
+    PrepareUpdate,
+
+    // state, frame left, launched
+    PrepareResult,
+
+    // frame left, releasing
+    Timescale,
+
+    // frame left after the frame was counted
+    EndRendering,
+
+    // save capture state, delay frames, skipped original
+    SaveCaptureDelay,
+
+    // save capture state, had a capturing request, had a pending request, request count before, capture done
+    // (-1 when no request was left to check), SaveCaptureRouting actions taken
+    SaveCaptureRoute,
+
+    Count
+};
+
+struct CaptureTraceEvent {
+    // Game updates since the recording started, the events of one update share it
+    std::uint64_t frame = 0;
+    std::uint64_t time_us = 0;
+
+    CaptureTraceEventKind kind = CaptureTraceEventKind::PrepareStart;
+    std::array<std::int32_t, 6> values{};
+    float progress = 0.0f;
+};
+
+// Records the capture state machine events while enabled from the debug menu, saved as CSV (one event per line) to be replayed
+// with MHWildsCaptureReplay. A recording is capped at MAX_EVENT_COUNT events, later ones are counted as dropped.
+// Turned off, recording costs a load and a compare per event.
+class CaptureTraceRecorder {
+public:
+    static constexpr std::size_t MAX_EVENT_COUNT = 1 << 20;
+
+    // Bumped when a column changes meaning, the replay refuses other versions
+    static constexpr int FORMAT_VERSION = 1;
+
+    struct Stats {
+        std::size_t event_count = 0;
+        std::size_t dropped_count = 0;
+        std::uint64_t frame_count = 0;
+    };
+
+private:
+    std::atomic_bool is_recording = false;
+    std::atomic<std::uint64_t> frame = 0;
+
+    mutable std::mutex events_mutex;
+    std::vector<CaptureTraceEvent> events;
+    std::size_t dropped_count = 0;
+    std::chrono::steady_clock::time_point recording_start;
+
+    CaptureTraceRecorder() = default;
+
+    void push(CaptureTraceEventKind kind, const std::array<std::int32_t, 6> &values, float progress);
+
+public:
+    static void record(CaptureTraceEventKind kind, std::array<std::int32_t, 6> values = {}, float progress = 0.0f) {
+        auto recorder = get_instance();
+
+        if (recorder == nullptr || !recorder->is_recording.load(std::memory_order_relaxed)) {
+            return;
+        }
+
+        recorder->push(kind, values, progress);
+    }
+
+    // Starting a recording clears the previous one, stopping keeps it until saved or restarted
+    void set_recording(bool recording);
+
+    bool get_is_recording() const {
+        return is_recording.load(std::memory_order_relaxed);
+    }
+
+    // Called at the start of every game update
+    void advance_frame() {
+        if (is_recording.load(std::memory_order_relaxed)) {
+            frame.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    Stats get_stats() const;
+
+    bool save(const std::filesystem::path &path) const;
+
+    // Returns false with a message if the file is not a trace of this version
+    static bool load(const std::filesystem::path &path, std::vector<CaptureTraceEvent> &loaded_events, std::string &error);
+
+    static const char *get_kind_name(CaptureTraceEventKind kind);
+
+    static CaptureTraceRecorder *get_instance();
+    static void initialize();
+};
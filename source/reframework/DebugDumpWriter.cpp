@@ -0,0 +1,451 @@
+#define NOMINMAX
+
+#include "DebugDumpWriter.hpp"
+#include "ImageTranscoder.hpp"
+
+#include <stb_image_write.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <format>
+#include <fstream>
+#include <vector>
+
+#include <Windows.h>
+
+std::unique_ptr<DebugDumpWriter> debug_dump_writer_instance = nullptr;
+
+namespace {
+    constexpr std::uint8_t PNG_SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+    // zlib header for a deflate stream with a 32K window and no compression level hint
+    constexpr std::uint8_t ZLIB_HEADER[2] = { 0x78, 0x01 };
+
+    constexpr std::size_t STORED_BLOCK_MAX_SIZE = 65535;
+    constexpr std::size_t IDAT_CHUNK_SIZE = 1 << 20;
+
+    constexpr std::uint32_t ADLER_MOD = 65521;
+
+    // Largest byte count the Adler-32 sums can take before they have to be reduced, see zlib
+    constexpr std::size_t ADLER_NMAX = 5552;
+
+    constexpr std::array<std::uint32_t, 256> make_crc32_table() {
+        std::array<std::uint32_t, 256> table{};
+
+        for (std::uint32_t i = 0; i < 256; i++) {
+            std::uint32_t crc = i;
+
+            for (int bit = 0; bit < 8; bit++) {
+                crc = (crc & 1) ? (0xEDB88320u ^ (crc >> 1)) : (crc >> 1);
+            }
+
+            table[i] = crc;
+        }
+
+        return table;
+    }
+
+    constexpr auto CRC32_TABLE = make_crc32_table();
+
+    std::uint32_t crc32_update(std::uint32_t crc, const std::uint8_t *data, std::size_t size) {
+        for (std::size_t i = 0; i < size; i++) {
+            crc = CRC32_TABLE[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        }
+
+        return crc;
+    }
+
+    void write_be32(std::ofstream &stream, std::uint32_t value) {
+        const std::uint8_t bytes[4] = { static_cast<std::uint8_t>(value >> 24), static_cast<std::uint8_t>(value >> 16),
+            static_cast<std::uint8_t>(value >> 8), static_cast<std::uint8_t>(value) };
+
+        stream.write(reinterpret_cast<const char*>(bytes), sizeof(bytes));
+    }
+
+    void write_png_chunk(std::ofstream &stream, const char *type, const std::uint8_t *data, std::size_t size) {
+        std::uint32_t crc = crc32_update(0xFFFFFFFFu, reinterpret_cast<const std::uint8_t*>(type), 4);
+        crc = crc32_update(crc, data, size);
+
+        write_be32(stream, static_cast<std::uint32_t>(size));
+        stream.write(type, 4);
+        stream.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+        write_be32(stream, ~crc);
+    }
+
+    // Cuts the zlib stream into IDAT chunks as it is produced
+    class IdatStream {
+    private:
+        std::ofstream &stream;
+        std::vector<std::uint8_t> chunk;
+
+    public:
+        explicit IdatStream(std::ofstream &stream)
+            : stream(stream) {
+            chunk.reserve(IDAT_CHUNK_SIZE);
+        }
+
+        void put(const std::uint8_t *data, std::size_t size) {
+            while (size > 0) {
+                std::size_t count = std::min(size, IDAT_CHUNK_SIZE - chunk.size());
+                chunk.insert(chunk.end(), data, data + count);
+
+                data += count;
+                size -= count;
+
+                if (chunk.size() == IDAT_CHUNK_SIZE) {
+                    flush();
+                }
+            }
+        }
+
+        void flush() {
+            if (!chunk.empty()) {
+                write_png_chunk(stream, "IDAT", chunk.data(), chunk.size());
+                chunk.clear();
+            }
+        }
+    };
+
+    // Deflate stream of stored blocks only, the bytes go through as they are. The total size has to be known upfront to mark the last block
+    class StoredDeflateStream {
+    private:
+        IdatStream &idat;
+        std::size_t remaining;
+
+        std::vector<std::uint8_t> block;
+
+        std::uint32_t adler_a = 1;
+        std::uint32_t adler_b = 0;
+
+        void update_adler(const std::uint8_t *data, std::size_t size) {
+            while (size > 0) {
+                std::size_t count = std::min(size, ADLER_NMAX);
+
+                for (std::size_t i = 0; i < count; i++) {
+                    adler_a += data[i];
+                    adler_b += adler_a;
+                }
+
+                adler_a %= ADLER_MOD;
+                adler_b %= ADLER_MOD;
+
+                data += count;
+                size -= count;
+            }
+        }
+
+        void emit_block(bool is_final) {
+            auto size = static_cast<std::uint16_t>(block.size());
+            auto inverted_size = static_cast<std::uint16_t>(~size);
+
+            const std::uint8_t header[5] = { static_cast<std::uint8_t>(is_final ? 1 : 0), static_cast<std::uint8_t>(size & 0xFF),
+                static_cast<std::uint8_t>(size >> 8), static_cast<std::uint8_t>(inverted_size & 0xFF), static_cast<std::uint8_t>(inverted_size >> 8) };
+
+            idat.put(header, sizeof(header));
+            idat.put(block.data(), block.size());
+
+            block.clear();
+        }
+
+    public:
+        StoredDeflateStream(IdatStream &idat, std::size_t total_size)
+            : idat(idat)
+            , remaining(total_size) {
+            block.reserve(STORED_BLOCK_MAX_SIZE);
+        }
+
+        void put(const std::uint8_t *data, std::size_t size) {
+            update_adler(data, size);
+
+            while (size > 0) {
+                std::size_t count = std::min(size, STORED_BLOCK_MAX_SIZE - block.size());
+                block.insert(block.end(), data, data + count);
+
+                data += count;
+                size -= count;
+                remaining -= count;
+
+                if (remaining == 0 || block.size() == STORED_BLOCK_MAX_SIZE) {
+                    emit_block(remaining == 0);
+                }
+            }
+        }
+
+        void finish() {
+            const std::uint32_t adler = (adler_b << 16) | adler_a;
+            const std::uint8_t trailer[4] = { static_cast<std::uint8_t>(adler >> 24), static_cast<std::uint8_t>(adler >> 16),
+                static_cast<std::uint8_t>(adler >> 8), static_cast<std::uint8_t>(adler) };
+
+            idat.put(trailer, sizeof(trailer));
+        }
+    };
+
+    bool write_stored_png(std::ofstream &stream, const std::uint8_t *rgba, int width, int height, int stride) {
+        stream.write(reinterpret_cast<const char*>(PNG_SIGNATURE), sizeof(PNG_SIGNATURE));
+
+        // 8-bit RGBA, no interlacing
+        const std::uint8_t ihdr[13] = {
+            static_cast<std::uint8_t>(width >> 24), static_cast<std::uint8_t>(width >> 16), static_cast<std::uint8_t>(width >> 8), static_cast<std::uint8_t>(width),
+            static_cast<std::uint8_t>(height >> 24), static_cast<std::uint8_t>(height >> 16), static_cast<std::uint8_t>(height >> 8), static_cast<std::uint8_t>(height),
+            8, 6, 0, 0, 0
+        };
+
+        write_png_chunk(stream, "IHDR", ihdr, sizeof(ihdr));
+
+        std::size_t row_size = static_cast<std::size_t>(width) * 4;
+
+        IdatStream idat(stream);
+        idat.put(ZLIB_HEADER, sizeof(ZLIB_HEADER));
+
+        // Every row is prefixed by its filter type, none here
+        StoredDeflateStream deflate(idat, static_cast<std::size_t>(height) * (row_size + 1));
+        const std::uint8_t filter_none = 0;
+
+        for (int y = 0; y < height; y++) {
+            deflate.put(&filter_none, 1);
+            deflate.put(rgba + static_cast<std::size_t>(y) * stride, row_size);
+        }
+
+        deflate.finish();
+        idat.flush();
+
+        write_png_chunk(stream, "IEND", nullptr, 0);
+
+        return stream.good();
+    }
+
+    bool write_pam(std::ofstream &stream, const std::uint8_t *rgba, int width, int height, int stride) {
+        auto header = std::format("P7\nWIDTH {}\nHEIGHT {}\nDEPTH 4\nMAXVAL 255\nTUPLTYPE RGB_ALPHA\nENDHDR\n", width, height);
+        stream.write(header.data(), static_cast<std::streamsize>(header.size()));
+
+        std::size_t row_size = static_cast<std::size_t>(width) * 4;
+
+        if (static_cast<std::size_t>(stride) == row_size) {
+            stream.write(reinterpret_cast<const char*>(rgba), static_cast<std::streamsize>(row_size * height));
+        } else {
+            for (int y = 0; y < height; y++) {
+                stream.write(reinterpret_cast<const char*>(rgba + static_cast<std::size_t>(y) * stride), static_cast<std::streamsize>(row_size));
+            }
+        }
+
+        return stream.good();
+    }
+
+    bool read_whole_file(const std::filesystem::path &path, std::vector<std::uint8_t> &data) {
+        std::error_code ec;
+        auto file_size = std::filesystem::file_size(path, ec);
+
+        if (ec) {
+            return false;
+        }
+
+        std::ifstream file(path, std::ios::binary);
+
+        if (!file) {
+            return false;
+        }
+
+        data.resize(static_cast<std::size_t>(file_size));
+        return static_cast<bool>(file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size())));
+    }
+
+    double elapsed_ms(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+DebugDumpWriter::DebugDumpWriter(reframework::API *api)
+    : api(api) {
+    recompress_thread = std::jthread([this](std::stop_token stop_token) {
+        recompress_thread_main(stop_token);
+    });
+}
+
+DebugDumpWriter::~DebugDumpWriter() {
+    recompress_thread.request_stop();
+    recompress_cv.notify_all();
+}
+
+std::filesystem::path DebugDumpWriter::write(std::filesystem::path path, const std::uint8_t *rgba, int width, int height, int stride,
+    DebugDumpFormat format, bool recompress_when_idle) {
+    if (rgba == nullptr || width <= 0 || height <= 0) {
+        return {};
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    path.replace_extension(format == DebugDumpFormat_PAM ? ".pam" : ".png");
+
+    std::error_code ec;
+    std::filesystem::create_directories(path.parent_path(), ec);
+
+    bool success = false;
+
+    if (format == DebugDumpFormat_CompressedPNG) {
+        success = stbi_write_png(path.string().c_str(), width, height, 4, rgba, stride) != 0;
+    } else {
+        std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+
+        if (stream.is_open()) {
+            success = (format == DebugDumpFormat_PAM) ? write_pam(stream, rgba, width, height, stride)
+                : write_stored_png(stream, rgba, width, height, stride);
+        }
+    }
+
+    if (!success) {
+        api->log_error("Failed to write debug dump %s", path.string().c_str());
+        return {};
+    }
+
+    {
+        std::scoped_lock lock(stats_mutex);
+        stats.last_path = path.string();
+        stats.last_write_ms = elapsed_ms(start);
+    }
+
+    if (recompress_when_idle && format == DebugDumpFormat_StoredPNG) {
+        RecompressJob job{ path, std::filesystem::file_size(path, ec), std::filesystem::last_write_time(path, ec) };
+
+        if (!ec) {
+            std::scoped_lock lock(recompress_mutex);
+
+            // Dumps are overwritten on each capture, only the newest version of a file is worth recompressing
+            std::erase_if(recompress_jobs, [&path](const RecompressJob &queued) { return queued.path == path; });
+            recompress_jobs.push_back(std::move(job));
+        }
+
+        recompress_cv.notify_one();
+    }
+
+    return path;
+}
+
+void DebugDumpWriter::set_idle(bool idle) {
+    bool was_idle = is_idle.exchange(idle, std::memory_order_acq_rel);
+
+    if (idle && !was_idle) {
+        // The wait predicate reads the flag under the lock, this makes sure the worker sees the change
+        std::scoped_lock lock(recompress_mutex);
+        recompress_cv.notify_one();
+    }
+}
+
+void DebugDumpWriter::recompress_thread_main(std::stop_token stop_token) {
+    SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+
+    while (!stop_token.stop_requested()) {
+        RecompressJob job;
+
+        {
+            std::unique_lock lock(recompress_mutex);
+
+            if (!recompress_cv.wait(lock, stop_token, [this]() { return is_idle.load(std::memory_order_acquire) && !recompress_jobs.empty(); })) {
+                return;
+            }
+
+            job = std::move(recompress_jobs.front());
+            recompress_jobs.pop_front();
+        }
+
+        auto start = std::chrono::steady_clock::now();
+
+        if (recompress(job)) {
+            std::scoped_lock lock(stats_mutex);
+            stats.recompressed_count++;
+            stats.last_recompress_ms = elapsed_ms(start);
+        }
+    }
+}
+
+bool DebugDumpWriter::recompress(const RecompressJob &job) {
+    auto is_unchanged = [&job]() {
+        std::error_code ec;
+        bool same_size = std::filesystem::file_size(job.path, ec) == job.file_size && !ec;
+        bool same_time = std::filesystem::last_write_time(job.path, ec) == job.last_write_time && !ec;
+
+        return same_size && same_time;
+    };
+
+    if (!is_unchanged()) {
+        return false;
+    }
+
+    std::vector<std::uint8_t> file_data;
+    std::vector<std::uint8_t> rgba;
+    int width = 0;
+    int height = 0;
+    std::string error;
+
+    if (!read_whole_file(job.path, file_data) || !ImageTranscoder::decode_rgba(file_data.data(), file_data.size(), rgba, width, height, error)) {
+        api->log_error("Failed to read debug dump %s for recompression %s", job.path.string().c_str(), error.c_str());
+        return false;
+    }
+
+    file_data = {};
+
+    auto temp_path = job.path;
+    temp_path += ".tmp";
+
+    std::error_code ec;
+
+    if (stbi_write_png(temp_path.string().c_str(), width, height, 4, rgba.data(), width * 4) == 0) {
+        std::filesystem::remove(temp_path, ec);
+        return false;
+    }
+
+    // A capture dumped again while this was compressing wins
+    if (!is_unchanged()) {
+        std::filesystem::remove(temp_path, ec);
+        return false;
+    }
+
+    std::filesystem::rename(temp_path, job.path, ec);
+
+    if (ec) {
+        std::filesystem::remove(temp_path, ec);
+        return false;
+    }
+
+    api->log_info("Recompressed debug dump %s, %llu KB", job.path.string().c_str(),
+        static_cast<unsigned long long>(std::filesystem::file_size(job.path, ec) / 1024));
+
+    return true;
+}
+
+DebugDumpWriter::Stats DebugDumpWriter::get_stats() const {
+    Stats result;
+
+    {
+        std::scoped_lock lock(stats_mutex);
+        result = stats;
+    }
+
+    std::scoped_lock lock(recompress_mutex);
+    result.pending_recompress_count = recompress_jobs.size();
+
+    return result;
+}
+
+const char *DebugDumpWriter::get_format_name(DebugDumpFormat format) {
+    switch (format) {
+    case DebugDumpFormat_StoredPNG:
+        return "PNG (uncompressed)";
+    case DebugDumpFormat_PAM:
+        return "PAM (raw)";
+    case DebugDumpFormat_CompressedPNG:
+        return "PNG (compressed, slow)";
+    default:
+        return "Unknown";
+    }
+}
+
+DebugDumpWriter *DebugDumpWriter::get_instance() {
+    return debug_dump_writer_instance ? debug_dump_writer_instance.get() : nullptr;
+}
+
+void DebugDumpWriter::initialize(reframework::API *api) {
+    if (debug_dump_writer_instance == nullptr) {
+        debug_dump_writer_instance = std::unique_ptr<DebugDumpWriter>(new DebugDumpWriter(api));
+    }
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <reframework/API.hpp>
+
+#include "ModSettings.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Writes the debug dumps of captured frames. They are written while the capture is encoded, so the default formats
+// cost about as much as copying the frame to disk, otherwise turning dumps on changes the timing being debugged:
+// - Stored PNG: a regular PNG whose deflate stream is made of stored (uncompressed) blocks, opens in any viewer
+// - PAM: the raw pixels behind a text header, no checksum at all
+// Stored PNGs can be recompressed later on a background thread, only while no capture is in flight.
+class DebugDumpWriter {
+public:
+    struct Stats {
+        std::string last_path;
+        double last_write_ms = 0.0;
+
+        std::size_t pending_recompress_count = 0;
+        std::uint64_t recompressed_count = 0;
+        double last_recompress_ms = 0.0;
+    };
+
+private:
+    struct RecompressJob {
+        std::filesystem::path path;
+
+        // The dump is overwritten by the next capture, a job for an older version of the file is dropped
+        std::uintmax_t file_size = 0;
+        std::filesystem::file_time_type last_write_time;
+    };
+
+    reframework::API *api = nullptr;
+
+    std::atomic_bool is_idle = false;
+
+    mutable std::mutex recompress_mutex;
+    std::deque<RecompressJob> recompress_jobs;
+    std::condition_variable_any recompress_cv;
+    std::jthread recompress_thread;
+
+    mutable std::mutex stats_mutex;
+    Stats stats;
+
+    explicit DebugDumpWriter(reframework::API *api);
+
+    void recompress_thread_main(std::stop_token stop_token);
+    bool recompress(const RecompressJob &job);
+
+public:
+    ~DebugDumpWriter();
+
+    // Writes the frame to path, its extension replaced by the one of the format. Returns the path written, empty on failure.
+    // stride is in bytes. With recompress_when_idle, a stored PNG is queued to be recompressed once the capture is done
+    std::filesystem::path write(std::filesystem::path path, const std::uint8_t *rgba, int width, int height, int stride,
+        DebugDumpFormat format, bool recompress_when_idle);
+
+    // Call once per frame, the recompression only runs while this is true
+    void set_idle(bool idle);
+
+    Stats get_stats() const;
+
+    static const char *get_format_name(DebugDumpFormat format);
+
+    static DebugDumpWriter *get_instance();
+    static void initialize(reframework::API *api);
+};
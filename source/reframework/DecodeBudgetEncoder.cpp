@@ -0,0 +1,210 @@
+#include "DecodeBudgetEncoder.hpp"
+
+#include <webp/decode.h>
+#include <webp/encode.h>
+
+#include <algorithm>
+#include <chrono>
+#include <utility>
+#include <vector>
+
+namespace {
+    // Owns one WebPEncode output, freed with WebPFree unless handed over
+    struct EncodedCandidate {
+        WebPMemoryWriter writer;
+
+        EncodedCandidate() {
+            WebPMemoryWriterInit(&writer);
+        }
+
+        ~EncodedCandidate() {
+            WebPMemoryWriterClear(&writer);
+        }
+
+        EncodedCandidate(const EncodedCandidate &) = delete;
+        EncodedCandidate &operator=(const EncodedCandidate &) = delete;
+
+        void swap(EncodedCandidate &other) {
+            std::swap(writer, other.writer);
+        }
+
+        void clear() {
+            WebPMemoryWriterClear(&writer);
+            WebPMemoryWriterInit(&writer);
+        }
+
+        WebPDataBuffer release() {
+            auto buffer = WebPDataBuffer::adopt(writer.mem, writer.size, WebPFree);
+            WebPMemoryWriterInit(&writer);
+
+            return buffer;
+        }
+    };
+
+    double elapsed_ms(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    bool encode_candidate(const DecodeBudgetEncoder::Candidate &candidate, const std::uint8_t *rgba, int width, int height,
+        EncodedCandidate &out) {
+        WebPConfig config;
+
+        if (!WebPConfigInit(&config)) {
+            return false;
+        }
+
+        if (candidate.lossless) {
+            WebPConfigLosslessPreset(&config, candidate.lossless_level);
+            config.near_lossless = candidate.near_lossless;
+        } else {
+            config.quality = candidate.quality;
+        }
+
+        WebPPicture picture;
+
+        if (!WebPPictureInit(&picture)) {
+            return false;
+        }
+
+        picture.width = width;
+        picture.height = height;
+        picture.use_argb = candidate.lossless ? 1 : 0;
+
+        // Alpha is forced opaque before encoding, dropping it saves the alpha plane on both ends
+        if (!WebPPictureImportRGBX(&picture, rgba, width * 4)) {
+            WebPPictureFree(&picture);
+            return false;
+        }
+
+        out.clear();
+
+        picture.writer = WebPMemoryWrite;
+        picture.custom_ptr = &out.writer;
+
+        bool success = WebPEncode(&config, &picture) != 0;
+        WebPPictureFree(&picture);
+
+        return success && out.writer.size > 0;
+    }
+
+    double measure_decode_ms(const EncodedCandidate &encoded, std::vector<std::uint8_t> &decode_buffer, int width) {
+        double runs[DecodeBudgetEncoder::DECODE_BENCHMARK_RUNS];
+
+        for (auto &run : runs) {
+            auto start = std::chrono::steady_clock::now();
+
+            if (!WebPDecodeRGBAInto(encoded.writer.mem, encoded.writer.size, decode_buffer.data(), decode_buffer.size(), width * 4)) {
+                return -1.0;
+            }
+
+            run = elapsed_ms(start);
+        }
+
+        std::sort(std::begin(runs), std::end(runs));
+        return runs[DecodeBudgetEncoder::DECODE_BENCHMARK_RUNS / 2];
+    }
+}
+
+WebPDataBuffer DecodeBudgetEncoder::encode(const std::uint8_t *rgba, int width, int height, float budget_ms) {
+    Report report;
+    report.valid = true;
+    report.width = width;
+    report.height = height;
+    report.budget_ms = budget_ms;
+
+    EncodedCandidate selected_encoded;
+
+    if (budget_ms <= 0.0f) {
+        auto start = std::chrono::steady_clock::now();
+
+        if (encode_candidate(CANDIDATES[0], rgba, width, height, selected_encoded)) {
+            report.selected = 0;
+            report.measures[0] = CandidateMeasure{ true, selected_encoded.writer.size, elapsed_ms(start), 0.0 };
+        }
+    } else {
+        std::size_t first = 0;
+
+        {
+            std::scoped_lock lock(report_mutex);
+
+            // A changed resolution or budget measures every candidate again
+            if (start_candidate_width == width && start_candidate_height == height && start_candidate_budget_ms == budget_ms) {
+                first = static_cast<std::size_t>(start_candidate);
+
+                if (CANDIDATES[first].rank != CANDIDATES[0].rank && ++captures_since_reprobe >= REPROBE_INTERVAL_CAPTURES) {
+                    captures_since_reprobe = 0;
+
+                    // Step back to the last candidate of the next better rank, the loop below moves to the first one
+                    while (first > 0 && CANDIDATES[first].rank == CANDIDATES[start_candidate].rank) {
+                        first--;
+                    }
+                }
+            } else {
+                captures_since_reprobe = 0;
+            }
+        }
+
+        // Start from the first candidate of the remembered rank, so candidates that look the same still compete
+        while (first > 0 && CANDIDATES[first - 1].rank == CANDIDATES[first].rank) {
+            first--;
+        }
+
+        std::vector<std::uint8_t> decode_buffer(static_cast<std::size_t>(width) * height * 4);
+
+        // In case nothing fits the budget, the fastest one to decode is used
+        EncodedCandidate fastest_encoded;
+        int fastest = -1;
+
+        EncodedCandidate current;
+
+        for (std::size_t i = first; i < CANDIDATES.size(); i++) {
+            if (report.selected >= 0 && CANDIDATES[i].rank != CANDIDATES[report.selected].rank) {
+                break;
+            }
+
+            auto &measure = report.measures[i];
+            auto start = std::chrono::steady_clock::now();
+
+            if (!encode_candidate(CANDIDATES[i], rgba, width, height, current)) {
+                continue;
+            }
+
+            measure.encoded = true;
+            measure.size = current.writer.size;
+            measure.encode_ms = elapsed_ms(start);
+            measure.decode_ms = measure_decode_ms(current, decode_buffer, width);
+
+            if (measure.decode_ms < 0.0) {
+                measure.encoded = false;
+                continue;
+            }
+
+            bool fits = measure.decode_ms <= budget_ms;
+
+            if (fits && (report.selected < 0 || measure.decode_ms < report.measures[report.selected].decode_ms)) {
+                report.selected = static_cast<int>(i);
+                selected_encoded.swap(current);
+            } else if (!fits && (fastest < 0 || measure.decode_ms < report.measures[fastest].decode_ms)) {
+                fastest = static_cast<int>(i);
+                fastest_encoded.swap(current);
+            }
+        }
+
+        if (report.selected < 0 && fastest >= 0) {
+            report.selected = fastest;
+            selected_encoded.swap(fastest_encoded);
+        }
+    }
+
+    std::scoped_lock lock(report_mutex);
+    last_report = report;
+
+    if (report.selected >= 0 && budget_ms > 0.0f) {
+        start_candidate = report.selected;
+        start_candidate_width = width;
+        start_candidate_height = height;
+        start_candidate_budget_ms = budget_ms;
+    }
+
+    return report.selected >= 0 ? selected_encoded.release() : WebPDataBuffer{};
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "WebPCaptureInjectClient.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+// Encodes the quest result background with the best looking candidate the game can still decode within a time budget.
+// The game decodes the background synchronously on its main thread, so a heavy image (eg. 4K lossless) is a visible stutter.
+// Candidates go from best to worst, each encoded one has its libwebp decode time measured on this machine, the first one
+// under the budget wins. The candidate picked for a resolution is remembered, the next capture starts from it.
+class DecodeBudgetEncoder {
+public:
+    struct Candidate {
+        const char *name;
+
+        // Candidates of the same rank look the same, the fastest to decode of them is picked
+        int rank;
+
+        bool lossless;
+
+        // Lossless preset level, 0 (fast) to 9 (smallest)
+        int lossless_level;
+
+        // 100 is off, lower keeps fewer bits of the pixels that are hard to compress
+        int near_lossless;
+
+        float quality;
+    };
+
+    static constexpr std::array<Candidate, 5> CANDIDATES = { {
+        { "Lossless (fast effort)", 0, true, 1, 100, 0.0f },
+        { "Lossless (max effort)", 0, true, 6, 100, 0.0f },
+        { "Near-lossless", 1, true, 6, 60, 0.0f },
+        { "Lossy 95", 2, false, 0, 100, 95.0f },
+        { "Lossy 90", 3, false, 0, 100, 90.0f },
+    } };
+
+    // Decodes per candidate, the median is kept so a single preempted run does not disqualify it
+    static constexpr int DECODE_BENCHMARK_RUNS = 3;
+
+    // Once a lower rank is remembered, every this many captures the search starts one rank better again,
+    // so a budget missed by a slow frame (or a busy machine) does not stick for the whole session
+    static constexpr int REPROBE_INTERVAL_CAPTURES = 8;
+
+    struct CandidateMeasure {
+        bool encoded = false;
+        std::size_t size = 0;
+        double encode_ms = 0.0;
+        double decode_ms = 0.0;
+    };
+
+    struct Report {
+        bool valid = false;
+
+        int width = 0;
+        int height = 0;
+        float budget_ms = 0.0f;
+
+        // Index in CANDIDATES
+        int selected = -1;
+
+        std::array<CandidateMeasure, CANDIDATES.size()> measures{};
+    };
+
+private:
+    mutable std::mutex report_mutex;
+    Report last_report;
+
+    // Where the search starts for the next capture, valid for the resolution and budget it was found with
+    int start_candidate = 0;
+    int start_candidate_width = 0;
+    int start_candidate_height = 0;
+    float start_candidate_budget_ms = 0.0f;
+    int captures_since_reprobe = 0;
+
+public:
+    // A budget of 0 or less skips the measurement and encodes the first candidate (lossless).
+    // Returns an empty buffer if nothing could be encoded.
+    WebPDataBuffer encode(const std::uint8_t *rgba, int width, int height, float budget_ms);
+
+    Report get_last_report() const {
+        std::scoped_lock lock(report_mutex);
+        return last_report;
+    }
+
+    // Next capture measures every candidate again
+    void reset_calibration() {
+        std::scoped_lock lock(report_mutex);
+        start_candidate = 0;
+        captures_since_reprobe = 0;
+    }
+};
@@ -0,0 +1,187 @@
+#include "DeferredStartup.hpp"
+
+#include <reframework/API.hpp>
+
+std::unique_ptr<DeferredStartup> deferred_startup_instance = nullptr;
+
+DeferredStartup::DeferredStartup()
+    : start_time(std::chrono::steady_clock::now()) {
+}
+
+double DeferredStartup::get_elapsed_ms() const {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+}
+
+std::size_t DeferredStartup::add_report(std::string name, StartupStage stage) {
+    std::scoped_lock lock(report_mutex);
+
+    auto &entry = report.emplace_back();
+    entry.name = std::move(name);
+    entry.stage = stage;
+
+    return report.size() - 1;
+}
+
+void DeferredStartup::run_step(const Step &step, std::uint64_t update_index) {
+    double step_start_ms = get_elapsed_ms();
+    step.run();
+    double step_end_ms = get_elapsed_ms();
+
+    std::scoped_lock lock(report_mutex);
+
+    auto &entry = report[step.report_index];
+    entry.start_ms = step_start_ms;
+    entry.duration_ms = step_end_ms - step_start_ms;
+    entry.update_index = update_index;
+    entry.done = true;
+}
+
+void DeferredStartup::run_synchronous(std::string name, const std::function<void()> &func) {
+    auto report_index = add_report(std::move(name), StartupStage::Synchronous);
+    run_step(Step{ func, report_index }, 0);
+}
+
+void DeferredStartup::add_worker_step(std::string name, std::function<void()> func) {
+    if (is_started) {
+        return;
+    }
+
+    auto report_index = add_report(std::move(name), StartupStage::Worker);
+    worker_steps.push_back(Step{ std::move(func), report_index });
+}
+
+void DeferredStartup::add_game_step(std::string name, std::function<void()> func) {
+    if (is_started) {
+        return;
+    }
+
+    auto report_index = add_report(std::move(name), StartupStage::GameThread);
+    game_steps.push_back(Step{ std::move(func), report_index });
+}
+
+void DeferredStartup::start() {
+    if (is_started) {
+        return;
+    }
+
+    is_started = true;
+
+    // Only read by the worker from here on, the game thread never touches worker_steps again
+    worker_thread = std::jthread([this](std::stop_token stop_token) {
+        for (const auto &step : worker_steps) {
+            if (stop_token.stop_requested()) {
+                break;
+            }
+
+            run_step(step, 0);
+        }
+
+        is_worker_done.store(true, std::memory_order_release);
+    });
+}
+
+void DeferredStartup::update() {
+    if (!is_started || is_complete()) {
+        return;
+    }
+
+    update_count++;
+
+    if (next_game_step < game_steps.size()) {
+        if (next_game_step == 0) {
+            std::scoped_lock lock(report_mutex);
+            first_game_step_update = update_count;
+        }
+
+        auto budget_end = std::chrono::steady_clock::now() + STEP_BUDGET;
+
+        do {
+            run_step(game_steps[next_game_step++], update_count);
+        } while (next_game_step < game_steps.size() && std::chrono::steady_clock::now() < budget_end);
+    }
+
+    if (next_game_step < game_steps.size() || !is_worker_done.load(std::memory_order_acquire)) {
+        return;
+    }
+
+    {
+        std::scoped_lock lock(report_mutex);
+        complete_ms = get_elapsed_ms();
+    }
+
+    is_complete_flag.store(true, std::memory_order_release);
+    log_report();
+}
+
+void DeferredStartup::log_report() const {
+    auto &api = reframework::API::get();
+    auto totals = get_totals();
+
+    api->log_info("Startup complete after %.1f ms: %.2f ms synchronous, %.2f ms on the game thread over %llu updates, %.2f ms on the worker",
+        totals.complete_ms, totals.synchronous_ms, totals.game_thread_ms, static_cast<unsigned long long>(totals.game_thread_updates), totals.worker_ms);
+
+    for (const auto &entry : get_report()) {
+        api->log_info("Startup step %s (%s): %.2f ms at %.1f ms", entry.name.c_str(), get_stage_name(entry.stage), entry.duration_ms, entry.start_ms);
+    }
+}
+
+std::vector<StartupStepReport> DeferredStartup::get_report() const {
+    std::scoped_lock lock(report_mutex);
+    return report;
+}
+
+DeferredStartup::Totals DeferredStartup::get_totals() const {
+    std::scoped_lock lock(report_mutex);
+
+    Totals totals;
+    std::uint64_t last_game_step_update = 0;
+
+    for (const auto &entry : report) {
+        switch (entry.stage) {
+            case StartupStage::Synchronous:
+                totals.synchronous_ms += entry.duration_ms;
+                break;
+            case StartupStage::Worker:
+                totals.worker_ms += entry.duration_ms;
+                break;
+            case StartupStage::GameThread:
+                totals.game_thread_ms += entry.duration_ms;
+
+                if (entry.done && entry.update_index > last_game_step_update) {
+                    last_game_step_update = entry.update_index;
+                }
+                break;
+        }
+    }
+
+    if (last_game_step_update != 0) {
+        totals.game_thread_updates = last_game_step_update - first_game_step_update + 1;
+    }
+
+    totals.complete_ms = complete_ms;
+
+    return totals;
+}
+
+const char *DeferredStartup::get_stage_name(StartupStage stage) {
+    switch (stage) {
+        case StartupStage::Synchronous:
+            return "Synchronous";
+        case StartupStage::Worker:
+            return "Worker";
+        case StartupStage::GameThread:
+            return "Game Thread";
+        default:
+            return "Unknown";
+    }
+}
+
+DeferredStartup *DeferredStartup::get_instance() {
+    return deferred_startup_instance ? deferred_startup_instance.get() : nullptr;
+}
+
+void DeferredStartup::initialize() {
+    if (deferred_startup_instance == nullptr) {
+        deferred_startup_instance = std::unique_ptr<DeferredStartup>(new DeferredStartup());
+    }
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class StartupStage : std::uint8_t {
+    // Run inside reframework_plugin_initialize, on the game's launch path
+    Synchronous,
+
+    // Run in order on the startup worker, for work that doesn't touch the game (disk reads, image conversion)
+    Worker,
+
+    // Run in order from the first UpdateBehavior pre-entries, for type lookups, hooks and game resources
+    GameThread
+};
+
+struct StartupStepReport {
+    std::string name;
+    StartupStage stage = StartupStage::Synchronous;
+
+    // Since the plugin started initializing
+    double start_ms = 0.0;
+    double duration_ms = 0.0;
+
+    // Game updates seen before the step ran, only counted for game thread steps
+    std::uint64_t update_index = 0;
+    bool done = false;
+};
+
+/**
+ * Splits the plugin initialization so the game launch only pays for registering callbacks. Everything that resolves types,
+ * installs hooks or loads resources is queued and run later: game thread steps from UpdateBehavior (a safe point for hooks,
+ * see HookManager), a few per update within STEP_BUDGET, worker steps on their own thread meanwhile.
+ * Every step is timed for the startup report in the debug menu. The plugin skips its updates and UI until is_complete.
+ */
+class DeferredStartup {
+public:
+    // Game thread steps keep running within an update until this is spent, at least one runs per update
+    static constexpr std::chrono::milliseconds STEP_BUDGET{ 2 };
+
+    struct Totals {
+        double synchronous_ms = 0.0;
+        double game_thread_ms = 0.0;
+        double worker_ms = 0.0;
+
+        // Updates from the first deferred step to the last one
+        std::uint64_t game_thread_updates = 0;
+
+        // Since the plugin started initializing, zero until complete
+        double complete_ms = 0.0;
+    };
+
+private:
+    struct Step {
+        std::function<void()> run;
+        std::size_t report_index;
+    };
+
+    std::chrono::steady_clock::time_point start_time;
+
+    mutable std::mutex report_mutex;
+    std::vector<StartupStepReport> report;
+
+    std::vector<Step> worker_steps;
+    std::vector<Step> game_steps;
+    std::size_t next_game_step = 0;
+
+    std::uint64_t update_count = 0;
+    std::uint64_t first_game_step_update = 0;
+
+    std::atomic_bool is_worker_done = false;
+    std::atomic_bool is_complete_flag = false;
+    bool is_started = false;
+    double complete_ms = 0.0;
+
+    std::jthread worker_thread;
+
+    DeferredStartup();
+
+    double get_elapsed_ms() const;
+    std::size_t add_report(std::string name, StartupStage stage);
+    void run_step(const Step &step, std::uint64_t update_index);
+    void log_report() const;
+
+public:
+    // Runs func now as part of the synchronous startup
+    void run_synchronous(std::string name, const std::function<void()> &func);
+
+    void add_worker_step(std::string name, std::function<void()> func);
+    void add_game_step(std::string name, std::function<void()> func);
+
+    // Starts the worker, steps can't be added afterwards
+    void start();
+
+    // Called from every UpdateBehavior pre-entry
+    void update();
+
+    // Both the game thread and worker steps are done
+    bool is_complete() const {
+        return is_complete_flag.load(std::memory_order_acquire);
+    }
+
+    std::vector<StartupStepReport> get_report() const;
+    Totals get_totals() const;
+
+    static const char *get_stage_name(StartupStage stage);
+
+    static DeferredStartup *get_instance();
+    static void initialize();
+};
@@ -0,0 +1,144 @@
+#include "ExactRenderTarget.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <format>
+#include <limits>
+
+namespace {
+    constexpr std::uint8_t RTEX_MAGIC[] = { 'R', 'T', 'E', 'X' };
+
+    void write_u32(std::vector<std::uint8_t> &data, std::size_t offset, std::uint32_t value) {
+        std::memcpy(data.data() + offset, &value, sizeof(value));
+    }
+
+    int get_distance(const ExactRenderTarget::Resolution &a, const ExactRenderTarget::Resolution &b) {
+        return std::abs(a.first - b.first) + std::abs(a.second - b.second);
+    }
+}
+
+namespace ExactRenderTarget {
+    Resolution fit_to_aspect(const Resolution &screen, const Resolution &aspect) {
+        if (screen.first <= 0 || screen.second <= 0 || aspect.first <= 0 || aspect.second <= 0) {
+            return screen;
+        }
+
+        float screen_ratio = static_cast<float>(screen.first) / screen.second;
+        float aspect_ratio = static_cast<float>(aspect.first) / aspect.second;
+
+        if (std::abs(screen_ratio / aspect_ratio - 1.0f) <= ASPECT_RATIO_TOLERANCE) {
+            return screen;
+        }
+
+        std::int64_t width = screen.first;
+        std::int64_t height = screen.second;
+
+        if (width * aspect.second > height * aspect.first) {
+            width = height * aspect.first / aspect.second;
+        } else {
+            height = width * aspect.second / aspect.first;
+        }
+
+        return { static_cast<int>(width & ~1), static_cast<int>(height & ~1) };
+    }
+
+    bool find_nearest_template(const Resolution &resolution, const TemplatePathMap &templates, Resolution &nearest) {
+        int best_distance = std::numeric_limits<int>::max();
+        bool found_one = false;
+
+        for (const auto &[template_resolution, path] : templates) {
+            if ((resolution.first < template_resolution.first && resolution.second < template_resolution.second) ||
+                resolution == template_resolution) {
+                nearest = template_resolution;
+                return true;
+            }
+
+            int distance = get_distance(resolution, template_resolution);
+
+            if (distance < best_distance) {
+                best_distance = distance;
+                nearest = template_resolution;
+                found_one = true;
+            }
+        }
+
+        return found_one;
+    }
+
+    bool choose(const Resolution &screen, const TemplatePathMap &templates, Choice &choice) {
+        if (templates.empty()) {
+            return false;
+        }
+
+        // The templates of a slot only differ in size, 3440x1440 aside which is still within the tolerance
+        choice.exact_resolution = fit_to_aspect(screen, templates.begin()->first);
+
+        if (!find_nearest_template(choice.exact_resolution, templates, choice.nearest_resolution)) {
+            return false;
+        }
+
+        choice.nearest_path = templates.at(choice.nearest_resolution);
+
+        std::vector<std::pair<int, const std::string *>> by_distance;
+
+        for (const auto &[template_resolution, path] : templates) {
+            int distance = (template_resolution == choice.nearest_resolution) ? -1 : get_distance(choice.exact_resolution, template_resolution);
+            by_distance.emplace_back(distance, &path);
+        }
+
+        std::stable_sort(by_distance.begin(), by_distance.end(), [](const auto &a, const auto &b) { return a.first < b.first; });
+
+        choice.template_paths.clear();
+
+        for (const auto &[distance, path] : by_distance) {
+            choice.template_paths.push_back(*path);
+        }
+
+        return true;
+    }
+
+    std::string get_resource_path(const Resolution &resolution) {
+        return std::format("RenderTexture/Exact/Quest_Background_{}x{}.rtex", resolution.first, resolution.second);
+    }
+
+    bool patch_template(std::vector<std::uint8_t> &data, const Resolution &resolution) {
+        if (data.size() < RTEX_HEIGHT_OFFSET + sizeof(std::uint32_t) || std::memcmp(data.data(), RTEX_MAGIC, sizeof(RTEX_MAGIC)) != 0) {
+            return false;
+        }
+
+        write_u32(data, RTEX_WIDTH_OFFSET, static_cast<std::uint32_t>(resolution.first));
+        write_u32(data, RTEX_HEIGHT_OFFSET, static_cast<std::uint32_t>(resolution.second));
+
+        return true;
+    }
+
+    reframework::API::Resource *create(RenderTargetResourceLoader &loader, const std::vector<std::string> &template_paths,
+        const Resolution &resolution) {
+        if (resolution.first <= 0 || resolution.second <= 0 || resolution.first > MAX_DIMENSION || resolution.second > MAX_DIMENSION) {
+            return nullptr;
+        }
+
+        std::vector<std::uint8_t> data;
+
+        auto installed = std::find_if(template_paths.begin(), template_paths.end(), [&loader, &data, &resolution](const std::string &path) {
+            return loader.read_file(path, data) && patch_template(data, resolution);
+        });
+
+        if (installed == template_paths.end()) {
+            return nullptr;
+        }
+
+        auto path = get_resource_path(resolution);
+
+        // Written once per resolution, the game may already hold the file open from an earlier quest
+        std::vector<std::uint8_t> existing;
+
+        if ((!loader.read_file(path, existing) || existing != data) && !loader.write_file(path, data)) {
+            return nullptr;
+        }
+
+        return loader.create_resource(path);
+    }
+}
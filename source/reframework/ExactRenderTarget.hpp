@@ -0,0 +1,75 @@
+#pragma once
+
+#include <reframework/API.hpp>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Where render target files come from and how they become resources. The game one goes through the loose file folder
+// and the REFramework resource manager, a stand-in can keep the files in memory and hand out fake resources.
+class RenderTargetResourceLoader {
+public:
+    virtual ~RenderTargetResourceLoader() = default;
+
+    // Paths are resource paths (eg. "RenderTexture/16x9/Quest_Background_16x9_4K.rtex"), without the file version suffix
+    virtual bool read_file(const std::string &path, std::vector<std::uint8_t> &data) = 0;
+    virtual bool write_file(const std::string &path, const std::vector<std::uint8_t> &data) = 0;
+
+    virtual reframework::API::Resource *create_resource(const std::string &path) = 0;
+};
+
+// Creates a render target of any size by cloning the nearest .rtex template and patching its width and height.
+// A render target that matches the screen exactly means the captured frame is injected without resampling.
+namespace ExactRenderTarget {
+    using Resolution = std::pair<int, int>;
+    using TemplatePathMap = std::map<Resolution, std::string>;
+
+    // All fields are u32, see the README of the HD capture pack
+    constexpr std::size_t RTEX_WIDTH_OFFSET = 0x10;
+    constexpr std::size_t RTEX_HEIGHT_OFFSET = 0x14;
+
+    // Version suffix of .rtex files on disk, resource paths do not have it
+    constexpr const char *RTEX_FILE_VERSION_SUFFIX = ".6";
+
+    // Width and height of a render target can not go over the D3D12 texture limit
+    constexpr int MAX_DIMENSION = 16384;
+
+    // A screen this close to the aspect ratio of a slot fills it, eg. 3440x1440 in the 21:9 one
+    constexpr float ASPECT_RATIO_TOLERANCE = 0.02f;
+
+    // The render target picked for one slot (16:9 or 21:9) of the album manager
+    struct Choice {
+        // The picture the game draws for this slot: the screen, or the largest size of the slot's aspect ratio that fits in it
+        Resolution exact_resolution;
+
+        // Nearest of the templates, loaded as is when no exact render target can be made
+        Resolution nearest_resolution;
+        std::string nearest_path;
+
+        // Templates to clone for the exact render target, the nearest first
+        std::vector<std::string> template_paths;
+    };
+
+    // Largest size of the aspect ratio that fits inside the screen, even sized. The screen itself when its ratio is close enough
+    Resolution fit_to_aspect(const Resolution &screen, const Resolution &aspect);
+
+    // The first template bigger in both dimensions, an exact match, or else the closest one
+    bool find_nearest_template(const Resolution &resolution, const TemplatePathMap &templates, Resolution &nearest);
+
+    // Picks the render target of a slot for the screen. The slot's aspect ratio is the one of its smallest template
+    bool choose(const Resolution &screen, const TemplatePathMap &templates, Choice &choice);
+
+    std::string get_resource_path(const Resolution &resolution);
+
+    // Overwrites width and height of a .rtex file. Returns false if data is not a .rtex file
+    bool patch_template(std::vector<std::uint8_t> &data, const Resolution &resolution);
+
+    // Clones the first template installed as a loose file into a render target of exactly the given resolution and loads it.
+    // Returns nullptr if none is installed (eg. the HD capture pack is packed) or the render target could not be written or loaded,
+    // the caller then loads the nearest template itself
+    reframework::API::Resource *create(RenderTargetResourceLoader &loader, const std::vector<std::string> &template_paths,
+        const Resolution &resolution);
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Small flat set of GUI element pointers -> draw verdict, filled the first time an element is seen after an invalidation.
+// The element -> GameObject lookup is a VM call, so it's done once per element instead of once per element per frame.
+// Lookups, inserts and the deferred clear all happen on the thread that draws the GUI. Invalidation can be requested from anywhere.
+class GUIDrawFilter {
+public:
+    static constexpr std::size_t CAPACITY = 1024;
+
+    enum class Verdict : std::uint8_t {
+        Unknown,
+        Draw,
+        Suppress
+    };
+
+private:
+    // Stop inserting at 3/4 load, keep the probe sequences short. Elements past that are evaluated every time.
+    static constexpr std::size_t MAX_LOAD = CAPACITY / 4 * 3;
+
+    static_assert((CAPACITY & (CAPACITY - 1)) == 0, "Capacity must be a power of two");
+
+    struct Entry {
+        const void *element;
+        Verdict verdict;
+    };
+
+    std::array<Entry, CAPACITY> entries{};
+    std::size_t entry_count = 0;
+
+    std::atomic_bool invalidate_requested = false;
+
+    // Current frame counters, and the ones of the last finished frame for display
+    std::atomic<std::uint32_t> evaluated_count = 0;
+    std::atomic<std::uint32_t> suppressed_count = 0;
+    std::atomic<std::uint32_t> resolved_count = 0;
+
+    std::uint32_t last_evaluated_count = 0;
+    std::uint32_t last_suppressed_count = 0;
+    std::uint32_t last_resolved_count = 0;
+
+    static std::size_t hash_element(const void *element) {
+        // Objects are at least 16 bytes aligned, drop the low bits before the Fibonacci hashing
+        auto value = static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(element)) >> 4;
+        return static_cast<std::size_t>((value * 11400714819323198485ull) >> 54) & (CAPACITY - 1);
+    }
+
+    void clear_if_requested() {
+        if (!invalidate_requested.exchange(false, std::memory_order_acquire)) {
+            return;
+        }
+
+        entries.fill(Entry{ nullptr, Verdict::Unknown });
+        entry_count = 0;
+    }
+
+public:
+    // Call whenever the set of elements that should be suppressed may have changed
+    void invalidate() {
+        invalidate_requested.store(true, std::memory_order_release);
+    }
+
+    // Returns true if the element should be drawn. Evaluator is only called for elements not seen since the last invalidation.
+    template <typename Evaluator>
+    bool should_draw(const void *element, Evaluator &&evaluate_suppress) {
+        clear_if_requested();
+
+        evaluated_count.fetch_add(1, std::memory_order_relaxed);
+
+        auto index = hash_element(element);
+
+        while (entries[index].element != nullptr) {
+            if (entries[index].element == element) {
+                if (entries[index].verdict == Verdict::Suppress) {
+                    suppressed_count.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+
+                return true;
+            }
+
+            index = (index + 1) & (CAPACITY - 1);
+        }
+
+        bool suppress = evaluate_suppress();
+        resolved_count.fetch_add(1, std::memory_order_relaxed);
+
+        if (entry_count < MAX_LOAD) {
+            entries[index] = Entry{ element, suppress ? Verdict::Suppress : Verdict::Draw };
+            entry_count++;
+        }
+
+        if (suppress) {
+            suppressed_count.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        return !suppress;
+    }
+
+    // Called once per frame to publish the counters
+    void end_frame() {
+        last_evaluated_count = evaluated_count.exchange(0, std::memory_order_relaxed);
+        last_suppressed_count = suppressed_count.exchange(0, std::memory_order_relaxed);
+        last_resolved_count = resolved_count.exchange(0, std::memory_order_relaxed);
+    }
+
+    std::uint32_t get_last_evaluated_count() const {
+        return last_evaluated_count;
+    }
+
+    std::uint32_t get_last_suppressed_count() const {
+        return last_suppressed_count;
+    }
+
+    // Elements that missed the set last frame and needed the VM lookup
+    std::uint32_t get_last_resolved_count() const {
+        return last_resolved_count;
+    }
+
+    std::size_t get_cached_count() const {
+        return entry_count;
+    }
+};
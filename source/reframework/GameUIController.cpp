@@ -21,12 +21,14 @@ bool game_ui_controller_on_pre_gui_draw_element(void *obj_void, void* context) {
 
     // Check for our lovely notification icon
     if (game_ui_controller_instance->get_is_in_quest_result() && settings->hide_chat_notification) {
-        auto obj = reinterpret_cast<reframework::API::ManagedObject*>(obj_void);
-        auto game_obj = obj->call("get_GameObject", context, obj);
+        auto notification_GO = game_ui_controller_instance->get_notification_gameobject();
 
-        if (game_obj == game_ui_controller_instance->get_notification_gameobject()) {
-            return false;
-        }
+        return game_ui_controller_instance->get_draw_filter().should_draw(obj_void, [obj_void, context, notification_GO]() {
+            auto obj = reinterpret_cast<reframework::API::ManagedObject*>(obj_void);
+            auto game_obj = obj->call("get_GameObject", context, obj);
+
+            return game_obj == notification_GO;
+        });
     }
 
     return true;
@@ -159,6 +161,9 @@ int GameUIController::pre_gui000020_on_gui_awake(int argc, void** argv, REFramew
         auto game_object = gui_comp->call<reframework::API::ManagedObject*>("get_GameObject", argv[0], gui_comp);
 
         game_ui_controller_instance->notification_GO = game_object;
+
+        // The chat GUI was (re)created, elements and their game objects may not be the same anymore
+        game_ui_controller_instance->draw_filter.invalidate();
     }
 
     return REFRAMEWORK_HOOK_CALL_ORIGINAL;
@@ -293,6 +298,9 @@ void GameUIController::set_is_in_quest_result(bool should) {
 
     is_in_quest_result = should;
 
+    // GUI elements may have been destroyed and their memory reused since the last quest result
+    draw_filter.invalidate();
+
     auto mod_settings = ModSettings::get_instance();
 
     if (mod_settings == nullptr) {
@@ -319,6 +327,8 @@ void GameUIController::set_is_in_quest_result(bool should) {
 }
 
 void GameUIController::end_rendering() {
+    draw_filter.end_frame();
+
     if (is_in_hide()) {
         if (!is_hiding_until_notice()) {
             hide_frames_passed++;
@@ -3,6 +3,8 @@
 #include <reframework/API.h>
 #include <reframework/API.hpp>
 
+#include "GUIDrawFilter.hpp"
+
 class GameUIController {
 private:
     static constexpr const int BRIGHTNESS_HDR_HIGHLIGHT_OPTION_ID = 256;
@@ -35,6 +37,8 @@ private:
     bool is_in_quest_result = false;
 
     reframework::API::ManagedObject *notification_GO = nullptr;
+
+    GUIDrawFilter draw_filter;
     reframework::API::ManagedObject *display_settings = nullptr;
     reframework::API::ManagedObject *gui_system_module_option = nullptr;
 
@@ -114,6 +118,10 @@ public:
         return notification_GO;
     }
 
+    GUIDrawFilter &get_draw_filter() {
+        return draw_filter;
+    }
+
     static GameUIController *get_instance();
     static void initialize(const REFrameworkPluginInitializeParam *initialize_params);
 };
\ No newline at end of file
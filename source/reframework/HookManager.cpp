@@ -0,0 +1,164 @@
+#include "HookManager.hpp"
+
+#include <memory>
+
+std::unique_ptr<HookManager> hook_manager_instance = nullptr;
+
+HookManager::HookManager(reframework::API *api)
+    : api(api) {
+}
+
+HookCallStats *HookManager::get_stats_slot(const std::string &stats_name) {
+    for (auto &existing : stats) {
+        if (existing.name == stats_name) {
+            return &existing;
+        }
+    }
+
+    return &stats.emplace_back(stats_name);
+}
+
+HookCallStats *HookManager::register_hook(HookGroup group, const std::string &stats_name, reframework::API::Method *method,
+    REFPreHookFn pre_fn, REFPostHookFn post_fn, bool ignore_jmp) {
+    auto stats_slot = get_stats_slot(stats_name);
+
+    if (method == nullptr) {
+        api->log_error("Can't register hook %s, method is null", stats_name.c_str());
+        return stats_slot;
+    }
+
+    entries.push_back(HookEntry{ group, method, pre_fn, post_fn, ignore_jmp, 0, false });
+
+    // Registering into an already armed group installs right away, the same as if it was there when armed
+    if (is_armed(group)) {
+        auto &entry = entries.back();
+
+        entry.hook_id = entry.method->add_hook(entry.pre_fn, entry.post_fn, entry.ignore_jmp);
+        entry.installed = true;
+    }
+
+    return stats_slot;
+}
+
+void HookManager::request_arm(HookGroup group) {
+    std::scoped_lock lock(pending_mutex);
+
+    pending_requests[static_cast<std::size_t>(group)] = PendingRequest::Arm;
+    has_pending_request = true;
+}
+
+void HookManager::request_disarm(HookGroup group) {
+    std::scoped_lock lock(pending_mutex);
+
+    pending_requests[static_cast<std::size_t>(group)] = PendingRequest::Disarm;
+    has_pending_request = true;
+}
+
+void HookManager::apply_pending() {
+    if (!has_pending_request) {
+        return;
+    }
+
+    std::array<PendingRequest, GROUP_COUNT> requests{};
+
+    {
+        std::scoped_lock lock(pending_mutex);
+
+        requests = pending_requests;
+        pending_requests.fill(PendingRequest::None);
+        has_pending_request = false;
+    }
+
+    for (std::size_t i = 0; i < GROUP_COUNT; i++) {
+        if (requests[i] == PendingRequest::Arm) {
+            arm_now(static_cast<HookGroup>(i));
+        } else if (requests[i] == PendingRequest::Disarm) {
+            disarm_now(static_cast<HookGroup>(i));
+        }
+    }
+}
+
+void HookManager::arm_now(HookGroup group) {
+    auto group_index = static_cast<std::size_t>(group);
+
+    if (armed_groups[group_index]) {
+        return;
+    }
+
+    std::size_t installed_count = 0;
+
+    for (auto &entry : entries) {
+        if (entry.group != group || entry.installed) {
+            continue;
+        }
+
+        entry.hook_id = entry.method->add_hook(entry.pre_fn, entry.post_fn, entry.ignore_jmp);
+        entry.installed = true;
+
+        installed_count++;
+    }
+
+    armed_groups[group_index] = true;
+    api->log_info("Armed hook group %s (%zu hooks)", get_group_name(group), installed_count);
+}
+
+void HookManager::disarm_now(HookGroup group) {
+    auto group_index = static_cast<std::size_t>(group);
+
+    if (!armed_groups[group_index]) {
+        return;
+    }
+
+    std::size_t removed_count = 0;
+
+    for (auto &entry : entries) {
+        if (entry.group != group || !entry.installed) {
+            continue;
+        }
+
+        entry.method->remove_hook(entry.hook_id);
+        entry.installed = false;
+
+        removed_count++;
+    }
+
+    armed_groups[group_index] = false;
+    api->log_info("Disarmed hook group %s (%zu hooks)", get_group_name(group), removed_count);
+}
+
+std::size_t HookManager::get_installed_hook_count() const {
+    std::size_t count = 0;
+
+    for (const auto &entry : entries) {
+        if (entry.installed) {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+const char *HookManager::get_group_name(HookGroup group) {
+    switch (group) {
+        case HookGroup::CaptureCamera:
+            return "Capture Camera";
+        case HookGroup::CaptureStance:
+            return "Capture Stance";
+        case HookGroup::SaveCaptureInject:
+            return "Save Capture (Inject)";
+        case HookGroup::SaveCaptureGameProduced:
+            return "Save Capture (Game Produced)";
+        default:
+            return "Unknown";
+    }
+}
+
+HookManager *HookManager::get_instance() {
+    return hook_manager_instance ? hook_manager_instance.get() : nullptr;
+}
+
+void HookManager::initialize(reframework::API *api) {
+    if (hook_manager_instance == nullptr) {
+        hook_manager_instance = std::unique_ptr<HookManager>(new HookManager(api));
+    }
+}
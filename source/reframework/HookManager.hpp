@@ -0,0 +1,132 @@
+#pragma once
+
+#include <reframework/API.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Hooks that only matter around a capture. They are registered disarmed and only installed while armed.
+enum class HookGroup : std::uint32_t {
+    // app.PlayerCameraController.updateAction*, skipped while the scene is frozen for capture
+    CaptureCamera,
+    // app.HunterCharacter.cMotionSupporter.setHunterMotGroup_Stance, cached while waiting for capture
+    CaptureStance,
+    // app.AlbumManager.updateSaveCapture, for the injector
+    SaveCaptureInject,
+    // app.AlbumManager.updateSaveCapture, for the game produced max quality client
+    SaveCaptureGameProduced,
+    Count
+};
+
+struct HookCallStats {
+    std::string name;
+    std::atomic<std::uint64_t> call_count = 0;
+    std::atomic<std::uint64_t> total_nanoseconds = 0;
+
+    explicit HookCallStats(std::string name)
+        : name(std::move(name)) {
+    }
+};
+
+// Put at the top of a hook callback to account its call and the time spent in it
+class ScopedHookTimer {
+private:
+    HookCallStats *stats;
+    std::chrono::steady_clock::time_point start;
+
+public:
+    explicit ScopedHookTimer(HookCallStats *stats)
+        : stats(stats)
+        , start(std::chrono::steady_clock::now()) {
+    }
+
+    ~ScopedHookTimer() {
+        if (!stats) {
+            return;
+        }
+
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+
+        stats->call_count.fetch_add(1, std::memory_order_relaxed);
+        stats->total_nanoseconds.fetch_add(static_cast<std::uint64_t>(elapsed.count()), std::memory_order_relaxed);
+    }
+
+    ScopedHookTimer(const ScopedHookTimer&) = delete;
+    ScopedHookTimer &operator=(const ScopedHookTimer&) = delete;
+};
+
+// Installs and removes method hooks by group at safe points.
+// Arm/disarm can be requested from anywhere (including other hooks or the render thread), the request is applied
+// on the next UpdateBehavior/LateUpdateBehavior/EndRendering pre-entry, where no hook of ours is on the call stack.
+class HookManager {
+private:
+    static constexpr std::size_t GROUP_COUNT = static_cast<std::size_t>(HookGroup::Count);
+
+    enum class PendingRequest {
+        None,
+        Arm,
+        Disarm
+    };
+
+    struct HookEntry {
+        HookGroup group;
+        reframework::API::Method *method;
+        REFPreHookFn pre_fn;
+        REFPostHookFn post_fn;
+        bool ignore_jmp;
+        unsigned int hook_id;
+        bool installed;
+    };
+
+    reframework::API *api = nullptr;
+
+    std::vector<HookEntry> entries;
+    std::deque<HookCallStats> stats;
+
+    std::mutex pending_mutex;
+    std::array<PendingRequest, GROUP_COUNT> pending_requests{};
+    std::array<bool, GROUP_COUNT> armed_groups{};
+    std::atomic_bool has_pending_request = false;
+
+    explicit HookManager(reframework::API *api);
+
+    void arm_now(HookGroup group);
+    void disarm_now(HookGroup group);
+
+public:
+    ~HookManager() = default;
+
+    // Stats slot by name, created on first use. Stable for the lifetime of the manager
+    HookCallStats *get_stats_slot(const std::string &stats_name);
+
+    // Registers a disarmed hook. Returns the stats slot for the given name, shared by every hook registered under it.
+    HookCallStats *register_hook(HookGroup group, const std::string &stats_name, reframework::API::Method *method,
+        REFPreHookFn pre_fn, REFPostHookFn post_fn, bool ignore_jmp = false);
+
+    void request_arm(HookGroup group);
+    void request_disarm(HookGroup group);
+
+    // Called at safe points
+    void apply_pending();
+
+    bool is_armed(HookGroup group) const {
+        return armed_groups[static_cast<std::size_t>(group)];
+    }
+
+    std::size_t get_installed_hook_count() const;
+
+    const std::deque<HookCallStats> &get_stats() const {
+        return stats;
+    }
+
+    static const char *get_group_name(HookGroup group);
+
+    static HookManager *get_instance();
+    static void initialize(reframework::API *api);
+};
@@ -0,0 +1,275 @@
+#include "ImageTranscoder.hpp"
+
+#include <webp/decode.h>
+#include <webp/encode.h>
+
+#include <avir.h>
+#include <avir_float4_sse.h>
+
+#define STB_IMAGE_IMPLEMENTATION
+#define STBI_ONLY_PNG
+#define STBI_ONLY_JPEG
+#include <stb_image.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace {
+    // Owns one WebPEncode output, freed with WebPFree
+    struct EncodedWebP {
+        std::uint8_t *data = nullptr;
+        std::size_t size = 0;
+
+        ~EncodedWebP() {
+            reset();
+        }
+
+        void reset() {
+            if (data) {
+                WebPFree(data);
+            }
+
+            data = nullptr;
+            size = 0;
+        }
+    };
+
+    bool encode_at_quality(const std::uint8_t *rgba, int width, int height, int quality, EncodedWebP &out) {
+        out.reset();
+        out.size = WebPEncodeRGBA(rgba, width, height, width * 4, static_cast<float>(quality), &out.data);
+
+        return out.size > 0;
+    }
+
+    std::uint64_t fnv1a_64(std::uint64_t hash, const void *data, std::size_t size) {
+        auto bytes = static_cast<const std::uint8_t*>(data);
+
+        for (std::size_t i = 0; i < size; i++) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+
+        return hash;
+    }
+}
+
+namespace ImageTranscoder {
+    ImageSourceFormat detect_format(const std::uint8_t *data, std::size_t size) {
+        static constexpr std::uint8_t PNG_SIGNATURE[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+        if (size >= 12 && std::memcmp(data, "RIFF", 4) == 0 && std::memcmp(data + 8, "WEBP", 4) == 0) {
+            return ImageSourceFormat::WebP;
+        }
+
+        if (size >= sizeof(PNG_SIGNATURE) && std::memcmp(data, PNG_SIGNATURE, sizeof(PNG_SIGNATURE)) == 0) {
+            return ImageSourceFormat::PNG;
+        }
+
+        if (size >= 3 && data[0] == 0xFF && data[1] == 0xD8 && data[2] == 0xFF) {
+            return ImageSourceFormat::JPEG;
+        }
+
+        return ImageSourceFormat::Unknown;
+    }
+
+    bool get_dimensions(const std::uint8_t *data, std::size_t size, int &width, int &height) {
+        switch (detect_format(data, size)) {
+            case ImageSourceFormat::WebP:
+                return WebPGetInfo(data, size, &width, &height) != 0;
+
+            case ImageSourceFormat::PNG:
+            case ImageSourceFormat::JPEG: {
+                if (size > static_cast<std::size_t>(std::numeric_limits<int>::max())) {
+                    return false;
+                }
+
+                int channels = 0;
+                return stbi_info_from_memory(data, static_cast<int>(size), &width, &height, &channels) != 0;
+            }
+
+            default:
+                return false;
+        }
+    }
+
+    bool decode_rgba(const std::uint8_t *data, std::size_t size, std::vector<std::uint8_t> &rgba, int &width, int &height,
+        std::string &error) {
+        switch (detect_format(data, size)) {
+            case ImageSourceFormat::WebP: {
+                auto decoded = WebPDecodeRGBA(data, size, &width, &height);
+
+                if (!decoded) {
+                    error = "Failed to decode WebP (animated WebP is not supported)";
+                    return false;
+                }
+
+                rgba.assign(decoded, decoded + static_cast<std::size_t>(width) * height * 4);
+                WebPFree(decoded);
+
+                return true;
+            }
+
+            case ImageSourceFormat::PNG:
+            case ImageSourceFormat::JPEG: {
+                if (size > static_cast<std::size_t>(std::numeric_limits<int>::max())) {
+                    error = "Image file is too big";
+                    return false;
+                }
+
+                int channels = 0;
+                auto decoded = stbi_load_from_memory(data, static_cast<int>(size), &width, &height, &channels, 4);
+
+                if (!decoded) {
+                    error = std::string("Failed to decode image: ") + stbi_failure_reason();
+                    return false;
+                }
+
+                rgba.assign(decoded, decoded + static_cast<std::size_t>(width) * height * 4);
+                stbi_image_free(decoded);
+
+                return true;
+            }
+
+            default:
+                error = "Unsupported image format, only WebP, PNG and JPEG can be used";
+                return false;
+        }
+    }
+
+    void resize_cover(const std::uint8_t *rgba, int width, int height, std::vector<std::uint8_t> &out, int target_width,
+        int target_height, avir::CImageResizerThreadPool *thread_pool) {
+        double scale = std::max(static_cast<double>(target_width) / width, static_cast<double>(target_height) / height);
+
+        // Source region that ends up covering the target once scaled
+        int crop_width = std::clamp(static_cast<int>(std::lround(target_width / scale)), 1, width);
+        int crop_height = std::clamp(static_cast<int>(std::lround(target_height / scale)), 1, height);
+        int crop_left = (width - crop_width) / 2;
+        int crop_top = (height - crop_height) / 2;
+
+        std::vector<std::uint8_t> cropped;
+        const std::uint8_t *source = rgba;
+
+        if (crop_width != width || crop_height != height) {
+            cropped.resize(static_cast<std::size_t>(crop_width) * crop_height * 4);
+
+            for (int y = 0; y < crop_height; y++) {
+                std::memcpy(cropped.data() + static_cast<std::size_t>(y) * crop_width * 4,
+                    rgba + (static_cast<std::size_t>(crop_top + y) * width + crop_left) * 4, static_cast<std::size_t>(crop_width) * 4);
+            }
+
+            source = cropped.data();
+        }
+
+        out.resize(static_cast<std::size_t>(target_width) * target_height * 4);
+
+        if (crop_width == target_width && crop_height == target_height) {
+            std::memcpy(out.data(), source, out.size());
+            return;
+        }
+
+        avir::CImageResizer<avir::fpclass_float4> image_resizer(8);
+
+        avir::CImageResizerVars params;
+        std::memset(&params, 0, sizeof(params));
+
+        params.ThreadPool = thread_pool;
+
+        image_resizer.resizeImage(source, crop_width, crop_height, 0, out.data(), target_width, target_height, 4, 0, &params);
+    }
+
+    bool encode_webp_fitting(const std::uint8_t *rgba, int width, int height, std::size_t max_bytes, int max_quality,
+        int min_quality, TranscodeResult &result) {
+        EncodedWebP encoded;
+
+        result.encode_attempts = 1;
+
+        if (!encode_at_quality(rgba, width, height, max_quality, encoded)) {
+            result.error = "WebP encoding failed";
+            return false;
+        }
+
+        if (encoded.size < max_bytes) {
+            result.webp.assign(encoded.data, encoded.data + encoded.size);
+            result.quality = max_quality;
+
+            return true;
+        }
+
+        // Size grows with quality, look for the last one that still fits
+        int low = min_quality;
+        int high = max_quality - 1;
+        int best_quality = -1;
+
+        while (low <= high) {
+            int mid = low + (high - low) / 2;
+
+            result.encode_attempts++;
+
+            if (!encode_at_quality(rgba, width, height, mid, encoded)) {
+                result.error = "WebP encoding failed";
+                return false;
+            }
+
+            if (encoded.size < max_bytes) {
+                best_quality = mid;
+                result.webp.assign(encoded.data, encoded.data + encoded.size);
+
+                low = mid + 1;
+            } else {
+                high = mid - 1;
+            }
+        }
+
+        if (best_quality < 0) {
+            result.webp.clear();
+            result.error = "Image does not fit the size limit even at the lowest quality";
+
+            return false;
+        }
+
+        result.quality = best_quality;
+        return true;
+    }
+
+    TranscodeResult transcode(const std::uint8_t *data, std::size_t size, const TranscodeTarget &target,
+        avir::CImageResizerThreadPool *thread_pool) {
+        TranscodeResult result;
+
+        std::vector<std::uint8_t> rgba;
+
+        if (!decode_rgba(data, size, rgba, result.source_width, result.source_height, result.error)) {
+            return result;
+        }
+
+        std::vector<std::uint8_t> resized;
+        const std::uint8_t *pixels = rgba.data();
+
+        if (result.source_width != target.width || result.source_height != target.height) {
+            resize_cover(rgba.data(), result.source_width, result.source_height, resized, target.width, target.height, thread_pool);
+            pixels = resized.data();
+        }
+
+        result.success = encode_webp_fitting(pixels, target.width, target.height, target.max_bytes, target.max_quality,
+            target.min_quality, result);
+
+        return result;
+    }
+
+    std::uint64_t content_hash(const std::uint8_t *data, std::size_t size, const TranscodeTarget &target) {
+        std::uint64_t hash = 14695981039346656037ull;
+
+        hash = fnv1a_64(hash, data, size);
+
+        const std::uint64_t params[] = {
+            static_cast<std::uint64_t>(target.width),
+            static_cast<std::uint64_t>(target.height),
+            static_cast<std::uint64_t>(target.max_bytes),
+            static_cast<std::uint64_t>(target.max_quality),
+            static_cast<std::uint64_t>(target.min_quality),
+        };
+
+        return fnv1a_64(hash, params, sizeof(params));
+    }
+}
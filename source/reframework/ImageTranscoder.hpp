@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace avir {
+    class CImageResizerThreadPool;
+}
+
+enum class ImageSourceFormat {
+    Unknown,
+    WebP,
+    PNG,
+    JPEG
+};
+
+struct TranscodeTarget {
+    int width = 1920;
+    int height = 1080;
+
+    // Encoded size must stay strictly below this
+    std::size_t max_bytes = 0;
+
+    int max_quality = 100;
+    int min_quality = 10;
+};
+
+struct TranscodeResult {
+    bool success = false;
+    std::vector<std::uint8_t> webp;
+
+    int quality = 0;
+    int encode_attempts = 0;
+
+    int source_width = 0;
+    int source_height = 0;
+
+    std::string error;
+};
+
+// Decode, resize and WebP quality search for images that don't come from the game.
+// Has no REFramework dependency, so it can be used from worker threads and outside of the plugin.
+namespace ImageTranscoder {
+    ImageSourceFormat detect_format(const std::uint8_t *data, std::size_t size);
+
+    // From the header only, no decoding
+    bool get_dimensions(const std::uint8_t *data, std::size_t size, int &width, int &height);
+
+    // Still WebP, PNG and JPEG, always to 4 channels RGBA
+    bool decode_rgba(const std::uint8_t *data, std::size_t size, std::vector<std::uint8_t> &rgba, int &width, int &height,
+        std::string &error);
+
+    // Scales to cover the target then crops the overflow around the center, so nothing is stretched
+    void resize_cover(const std::uint8_t *rgba, int width, int height, std::vector<std::uint8_t> &out, int target_width,
+        int target_height, avir::CImageResizerThreadPool *thread_pool = nullptr);
+
+    // Highest integer quality in [min_quality, max_quality] whose output is below max_bytes, found by binary search.
+    // Tries max_quality first, since most images fit right away
+    bool encode_webp_fitting(const std::uint8_t *rgba, int width, int height, std::size_t max_bytes, int max_quality,
+        int min_quality, TranscodeResult &result);
+
+    TranscodeResult transcode(const std::uint8_t *data, std::size_t size, const TranscodeTarget &target,
+        avir::CImageResizerThreadPool *thread_pool = nullptr);
+
+    // Identifies a (source content, target) pair, used to name transcoded files
+    std::uint64_t content_hash(const std::uint8_t *data, std::size_t size, const TranscodeTarget &target);
+}
@@ -1,44 +1,29 @@
 #include "FileInjectClient.hpp"
-#include "../MHWildsTypes.h"
-
-#include <filesystem>
-#include <fstream>
+#include "../OverrideImageCache.hpp"
 
 #include <reframework/API.hpp>
 
 bool FileInjectClient::provide_webp_data(bool is16x9, ProvideFinishedDataCallback provide_data_finish_callback) {
-    if (file_path.empty() || !is_requested) {
+    if (file_path.empty() || requested_count <= 0) {
         return false;
     }
 
-    is_requested = false;
+    requested_count--;
 
     auto& api = reframework::API::get();
+    auto image_cache = OverrideImageCache::get_instance();
 
-    std::filesystem::path path(file_path);
-    if (!std::filesystem::exists(path)) {
-        api->log_info("File does not exist: %s", file_path.c_str());
-        return false;
-    }
+    // Read and validated by the cache's poll worker when the path was configured, this is only a memory lookup
+    auto data = image_cache->acquire(file_path, limit_size);
 
-    if (limit_size) {
-        if (std::filesystem::file_size(file_path) > MaxSerializePhotoSizeOriginal) {
-            api->log_info("File size exceeds maximum limit: %s of %d bytes", file_path.c_str(), MaxSerializePhotoSizeOriginal);
-            return false;
-        }
-    }
+    if (data.empty()) {
+        auto info = image_cache->lookup(file_path, limit_size);
 
-    // Open the file and read the data into a vector
-    std::ifstream file(file_path, std::ios::binary);
-    if (!file) {
-        api->log_info("Failed to open file: %s", file_path.c_str());
+        api->log_info("Can't use override image %s: %s", file_path.c_str(), OverrideImageCache::get_status_message(info.status));
         return false;
     }
 
-    std::vector<std::uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-    file.close();
-
     // Call the callback with the data
-    provide_data_finish_callback(true, &data);
+    provide_data_finish_callback(true, std::move(data));
     return true;
 }
@@ -8,17 +8,19 @@ class FileInjectClient : public WebPCaptureInjectClient {
 private:
     std::string file_path;
     bool limit_size = false;
-    bool is_requested = false;
+    // One per queued capture request, each provide_webp_data serves one
+    int requested_count = 0;
 
 public:
     bool provide_webp_data(bool is16x9, ProvideFinishedDataCallback provide_data_finish_callback) override;
 
-    void set_requested() {
-        is_requested = true;
+    // Set once per capture request. Quest results replace the previous request, photo mode saves queue another one
+    void set_requested(bool queue = false) {
+        requested_count = queue ? requested_count + 1 : 1;
     }
 
     bool get_is_requested() const {
-        return is_requested;
+        return requested_count > 0;
     }
 
     void set_file_path(const std::string& path) {
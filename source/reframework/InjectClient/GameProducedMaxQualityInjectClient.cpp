@@ -1,6 +1,10 @@
 #include "GameProducedMaxQualityInjectClient.hpp"
+#include "../CaptureTrace.hpp"
 #include "../ModSettings.hpp"
 #include "../MHWildsTypes.h"
+#include "../ManagedArray.hpp"
+#include "../ReflectionBindings.hpp"
+#include "../HookManager.hpp"
 #include "../REFrameworkBorrowedAPI.hpp"
 
 #include <fstream>
@@ -23,18 +27,32 @@ GameProducedMaxQualityInjectClient::GameProducedMaxQualityInjectClient(reframewo
     : api(api_instance)
     , is_capture_done(false)
     , provide_data_finish_callback(nullptr) {
-    auto tdb = api->tdb();
+    auto bindings = ReflectionBindings::get_instance();
     
-    auto update_save_capture_method = tdb->find_method("app.AlbumManager", "updateSaveCapture");
+    auto update_save_capture_method = bindings->get_method(MethodBinding::AlbumManager_updateSaveCapture);
     if (!update_save_capture_method) {
         api->log_info("Can't find updateSaveCapture method");
         return;
     }
 
-    get_serialized_field_content_method = tdb->find_method("via.render.SerializedResult", "get_Content");
-    get_completed_method = tdb->find_method("via.render.SerializedResult", "get_Completed");
+    get_serialized_field_content_method = bindings->get_method(MethodBinding::SerializedResult_get_Content);
+    get_completed_method = bindings->get_method(MethodBinding::SerializedResult_get_Completed);
 
-    update_save_capture_method->add_hook(pre_start_update_save_capture, post_start_update_save_capture, false);
+    update_save_capture_stats = HookManager::get_instance()->register_hook(HookGroup::SaveCaptureGameProduced,
+        "AlbumManager.updateSaveCapture (Game Produced)", update_save_capture_method,
+        pre_start_update_save_capture, post_start_update_save_capture, false);
+}
+
+void GameProducedMaxQualityInjectClient::set_enable(bool is_enable) {
+    this->is_enabled = is_enable;
+
+    auto hook_manager = HookManager::get_instance();
+
+    if (is_enable) {
+        hook_manager->request_arm(HookGroup::SaveCaptureGameProduced);
+    } else {
+        hook_manager->request_disarm(HookGroup::SaveCaptureGameProduced);
+    }
 }
 
 void GameProducedMaxQualityInjectClient::initialize(reframework::API *api_instance) {
@@ -72,7 +90,7 @@ void GameProducedMaxQualityInjectClient::try_dump_webp() {
         auto debug_path = persistent_dir / DEBUG_FILE_NAME;
 
         std::ofstream original(debug_path.string(), std::istream::out | std::istream::binary);
-        original.write(reinterpret_cast<const char*>(result_buffer.data()), result_buffer.size());
+        original.write(reinterpret_cast<const char*>(result_data.data()), result_data.size());
         original.flush();
         original.close();
     }
@@ -83,6 +101,8 @@ int GameProducedMaxQualityInjectClient::pre_start_update_save_capture(int argc,
         return REFRAMEWORK_HOOK_CALL_ORIGINAL;
     }
 
+    ScopedHookTimer timer(game_max_quality_inject_client->update_save_capture_stats);
+
     if (!game_max_quality_inject_client->is_enable()) {
         return REFRAMEWORK_HOOK_CALL_ORIGINAL;
     }
@@ -93,7 +113,8 @@ int GameProducedMaxQualityInjectClient::pre_start_update_save_capture(int argc,
         return REFRAMEWORK_HOOK_CALL_ORIGINAL;
     }
 
-    auto capture_state_ptr = album_manager->get_field<int>("_SaveCaptureState");
+    auto bindings = ReflectionBindings::get_instance();
+    auto capture_state_ptr = bindings->get_field<int>(album_manager, FieldBinding::AlbumManager_SaveCaptureState);
     auto api = game_max_quality_inject_client->api;
 
     const int MAX_QUALITY = 100;
@@ -105,29 +126,36 @@ int GameProducedMaxQualityInjectClient::pre_start_update_save_capture(int argc,
 
         if (capture_state <= SAVECAPTURESTATE_START) {
             game_max_quality_inject_client->is_capture_done = false;
-            game_max_quality_inject_client->wait_frames_left = mod_settings->hide_ui_before_capture_frame_count;
         }
 
         if (capture_state == SAVECAPTURESTATE_COPY_TO_STAGING) {
             // Reset quality to our standard
-            auto quality_ptr = album_manager->get_field<std::uint32_t>("_Quality");
+            auto quality_ptr = bindings->get_field<std::uint32_t>(album_manager, FieldBinding::AlbumManager_Quality);
             if (quality_ptr && *quality_ptr < MAX_QUALITY) {
                 api->log_info("Original capture quality: %d, updating to 100%", *quality_ptr);
                 *quality_ptr = MAX_QUALITY;
             }
+        }
 
-            game_max_quality_inject_client->wait_frames_left--;
+        auto delay_frames = mod_settings->hide_ui_before_capture_frame_count;
+        bool should_delay = game_max_quality_inject_client->save_capture_delay.update(capture_state, delay_frames);
 
-            if (game_max_quality_inject_client->wait_frames_left > 0) {
-                return REFRAMEWORK_HOOK_SKIP_ORIGINAL;
-            } else {
-                api->log_info("Done delaying frames, proceeding with the original call");
-            }
+        // Idle is every frame outside of a save capture, the delay is set again on the way to COPY_TO_STAGING anyway
+        if (capture_state != SAVECAPTURESTATE_IDLE) {
+            CaptureTraceRecorder::record(CaptureTraceEventKind::SaveCaptureDelay, { static_cast<int>(capture_state), delay_frames, should_delay ? 1 : 0 });
+        }
+
+        if (should_delay) {
+            return REFRAMEWORK_HOOK_SKIP_ORIGINAL;
+        }
+
+        if (capture_state == SAVECAPTURESTATE_COPY_TO_STAGING) {
+            api->log_info("Done delaying frames, proceeding with the original call");
         }
 
         if (!game_max_quality_inject_client->is_capture_done && capture_state == SAVECAPTURESTATE_WAIT_SERIALIZE) {
             // Reset quality to our standard
-            auto quality_ptr = album_manager->get_field<std::uint32_t>("_Quality");
+            auto quality_ptr = bindings->get_field<std::uint32_t>(album_manager, FieldBinding::AlbumManager_Quality);
             
             if (quality_ptr && *quality_ptr < MAX_QUALITY) {
                 api->log_info("Capture quality: %d, skip dumping", *quality_ptr);
@@ -137,7 +165,8 @@ int GameProducedMaxQualityInjectClient::pre_start_update_save_capture(int argc,
                 api->log_info("Capture quality: %d, dumping", *quality_ptr);
             }
 
-            auto serialized_result = album_manager->get_field<reframework::API::ManagedObject*>("_SerializedResult");
+            auto serialized_result = bindings->get_field<reframework::API::ManagedObject*>(album_manager,
+                FieldBinding::AlbumManager_SerializedResult);
             if (!serialized_result) {
                 api->log_info("Can't find SerializedResult field");
                 return REFRAMEWORK_HOOK_CALL_ORIGINAL;
@@ -156,20 +185,22 @@ int GameProducedMaxQualityInjectClient::pre_start_update_save_capture(int argc,
                 else {
                     game_max_quality_inject_client->is_capture_done = true;
 
-                    auto length = serialize_content->call<int>("GetLength", vm_context, serialize_content);
-                    game_max_quality_inject_client->result_buffer.resize(length);
-    
-                    for (int i = 0; i < length; i++) {
-                        game_max_quality_inject_client->result_buffer[i] = serialize_content->call<std::uint8_t>("Get", vm_context, serialize_content, i);
-                    }
+                    ManagedArrayView<std::uint8_t> serialize_content_view(serialize_content, vm_context);
+                    std::vector<std::uint8_t> result_buffer(serialize_content_view.size());
+                    serialize_content_view.copy_to(result_buffer);
+
+                    game_max_quality_inject_client->result_data = WebPDataBuffer::from_vector(std::move(result_buffer));
 
                     if (game_max_quality_inject_client->is_capture_done) {
                         game_max_quality_inject_client->try_dump_webp();
                     }
 
                     if (game_max_quality_inject_client->provide_data_finish_callback != nullptr) {
-                        game_max_quality_inject_client->provide_data_finish_callback(true, &game_max_quality_inject_client->result_buffer);
+                        game_max_quality_inject_client->provide_data_finish_callback(true, std::move(game_max_quality_inject_client->result_data));
                         game_max_quality_inject_client->is_capture_done = false;
+
+                        // Delivered, nothing left to do until the next quest end enables it again
+                        HookManager::get_instance()->request_disarm(HookGroup::SaveCaptureGameProduced);
                     }
                 }
             }
@@ -189,9 +220,11 @@ bool GameProducedMaxQualityInjectClient::provide_webp_data(bool is16x9, ProvideF
     }
 
     if (is_capture_done) {
-        provide_data_finish_callback(true, &result_buffer);
+        provide_data_finish_callback(true, std::move(result_data));
         is_capture_done = false;
 
+        HookManager::get_instance()->request_disarm(HookGroup::SaveCaptureGameProduced);
+
         return true;
     }
 
@@ -1,8 +1,11 @@
 #pragma once
 
+#include "../CaptureSequencing.hpp"
 #include "../WebPCaptureInjectClient.hpp"
 #include <reframework/API.hpp>
 
+struct HookCallStats;
+
 class GameProducedMaxQualityInjectClient : public WebPCaptureInjectClient {
 private:
     static int pre_start_update_save_capture(int argc, void** argv, REFrameworkTypeDefinitionHandle* arg_tys, unsigned long long ret_addr);
@@ -13,10 +16,11 @@ private:
     reframework::API::Method *get_serialized_field_content_method = nullptr;
     reframework::API::Method *get_completed_method = nullptr;
 
-    std::vector<std::uint8_t> result_buffer;
+    WebPDataBuffer result_data;
     bool is_capture_done = false;
-    int wait_frames_left = 0;
+    SaveCaptureDelay save_capture_delay;
     ProvideFinishedDataCallback provide_data_finish_callback;
+    HookCallStats *update_save_capture_stats = nullptr;
 
     void try_dump_webp();
 
@@ -33,9 +37,8 @@ public:
     static void initialize(reframework::API *api_instance);
     static GameProducedMaxQualityInjectClient *get_instance();
 
-    void set_enable(bool is_enable) {
-        this->is_enabled = is_enable;
-    }
+    // The updateSaveCapture hook is only armed while enabled
+    void set_enable(bool is_enable);
 
     bool is_enable() const {
         return this->is_enabled;
@@ -4,6 +4,13 @@
 #include "../ModSettings.hpp"
 #include "../GameUIController.hpp"
 #include "../CaptureResolutionInject.hpp"
+#include "../ReflectionBindings.hpp"
+#include "../HookManager.hpp"
+#include "../CaptureArchiver.hpp"
+#include "../CaptureTrace.hpp"
+#include "../DebugDumpWriter.hpp"
+#include "../ImageTranscoder.hpp"
+#include "../RingLogger.hpp"
 
 #include <reframework/API.hpp>
 #include <webp/encode.h>
@@ -180,12 +187,23 @@ static const char *RESHADE_ADDON_NAME = "MHWildsHighQualityPhoto_Reshade.addon";
 //static const char *END_SLOWMO_PLUGIN_NAME = "end_slowmo.dll";
 static const char *GET_SCREEN_CAPTURE_SYMBOL_NAME = "request_screen_capture";
 static const char *SET_RESHADE_FILTERS_ENABLE = "set_reshade_filters_enable";
+static const char *GET_SCREEN_CAPTURE_MULTI_FRAME_SYMBOL_NAME = "request_screen_capture_multi_frame";
+static const char *SET_SCENE_SETTLE_WATCH_SYMBOL_NAME = "set_scene_settle_watch";
+static const char *GET_SCENE_SETTLE_STATUS_SYMBOL_NAME = "get_scene_settle_status";
+static const char *SET_HDR_CAPTURE_ARCHIVE_DIRECTORY_SYMBOL_NAME = "set_hdr_capture_archive_directory";
+static const char *SET_PIXEL_BUFFER_ARENA_CONFIG_SYMBOL_NAME = "set_pixel_buffer_arena_config";
+static const char *GET_PIXEL_BUFFER_ARENA_STATS_SYMBOL_NAME = "get_pixel_buffer_arena_stats";
 
-const float QUALITY_REDUCE_STEP = 10.0f;
-const float MIN_QUALITY_PHOTO = 10.0f;
+const int MIN_QUALITY_PHOTO = 10;
 
 const int HIDE_UI_FRAMES_COUNT_MIN = 6;
-const float START_CAPTURE_AFTER_HIDE_REACHED_PROGRESS = 0.5f;
+
+// A frame counts as settled when its brightness thumbnail moved less than this many 8-bit levels on average
+const float SCENE_SETTLE_MEAN_DIFF_THRESHOLD = 0.75f;
+const int SCENE_SETTLE_CONSECUTIVE_FRAMES = 2;
+
+// The timescale and UI hide need a couple of frames to show up on screen before any stillness means anything
+const int MIN_FROZEN_FRAMES_BEFORE_SETTLE = 2;
 
 // NOTE: Change depends on monitor if needed
 const int FORCE_SIZE_WIDTH_16x9 = 1920;
@@ -267,17 +285,77 @@ void ReShadeAddOnInjectClient::do_prepare_capture() {
     auto mod_settings = ModSettings::get_instance();
     auto game_ui_controller = GameUIController::get_instance();
 
-    this->prepare_state = CapturePrepareState::FreezeScene;
+    auto freeze_frames = std::max<int>(MIN_FREEZE_TIMESCALE_FRAME_COUNT, mod_settings->freeze_game_frames);
+    auto capture_frames = get_capture_frame_count_to_use();
 
-    freeze_timescale_frame_total = std::max<int>(MIN_FREEZE_TIMESCALE_FRAME_COUNT, mod_settings->freeze_game_frames);
-    freeze_timescale_frame_left = freeze_timescale_frame_total;
+    prepare_sequencer.start(freeze_frames, capture_frames);
     should_skip_camera_update = true;
 
-    game_ui_controller->hide_for(freeze_timescale_frame_total);
+    CaptureTraceRecorder::record(CaptureTraceEventKind::PrepareStart, { freeze_frames, capture_frames });
+
+    game_ui_controller->hide_for(prepare_sequencer.get_frame_total());
+
+    is_watching_scene_settle = mod_settings->capture_when_scene_settled && set_scene_settle_watch != nullptr &&
+        get_scene_settle_status != nullptr;
+
+    if (is_watching_scene_settle) {
+        set_scene_settle_watch(true, is_screenshot_before_reshade(), SCENE_SETTLE_MEAN_DIFF_THRESHOLD);
+    }
+}
+
+bool ReShadeAddOnInjectClient::is_scene_settled(int frame_freezed) {
+    if (!is_watching_scene_settle || frame_freezed < MIN_FROZEN_FRAMES_BEFORE_SETTLE) {
+        return false;
+    }
+
+    SceneSettleStatus status{};
+    get_scene_settle_status(&status);
+
+    if (!status.supported) {
+        stop_scene_settle_watch();
+        reframework::API::get()->log_info("Scene settle watch is not supported on this back buffer format, waiting the full freeze");
+
+        return false;
+    }
+
+    if (status.consecutive_settled_frames < SCENE_SETTLE_CONSECUTIVE_FRAMES) {
+        return false;
+    }
+
+    reframework::API::get()->log_info("Scene settled after %d frozen frames out of %d (last mean diff %.2f)", frame_freezed,
+        prepare_sequencer.get_frame_total(), status.last_mean_abs_diff);
+
+    return true;
+}
+
+int ReShadeAddOnInjectClient::get_capture_frame_count_to_use() const {
+    auto mod_settings = ModSettings::get_instance();
+
+    if (mod_settings == nullptr || request_reshade_screen_capture_multi_frame == nullptr) {
+        return 1;
+    }
+
+    switch (mod_settings->capture_frame_merge_mode) {
+        case CaptureFrameMergeMode_Mean:
+            return std::clamp(mod_settings->capture_frame_merge_count, MIN_CAPTURE_FRAME_MERGE_COUNT, MAX_CAPTURE_FRAME_MERGE_COUNT);
+
+        case CaptureFrameMergeMode_MedianOf3:
+            return 3;
+
+        default:
+            return 1;
+    }
+}
+
+void ReShadeAddOnInjectClient::stop_scene_settle_watch() {
+    if (is_watching_scene_settle) {
+        set_scene_settle_watch(false, false, 0.0f);
+        is_watching_scene_settle = false;
+    }
 }
 
 int ReShadeAddOnInjectClient::pre_player_camera_controller_update_action(int argc, void** argv, REFrameworkTypeDefinitionHandle* arg_tys, unsigned long long ret_addr) {
-    auto game_ui_controller = GameUIController::get_instance();
+    ScopedHookTimer timer(reshade_addon_client_instance->camera_update_action_stats);
 
     if (reshade_addon_client_instance->should_skip_camera_update) {
         return REFRAMEWORK_HOOK_SKIP_ORIGINAL;
@@ -290,51 +368,115 @@ void ReShadeAddOnInjectClient::post_player_camera_controller_update_action(void*
 
 }
 
+void ReShadeAddOnInjectClient::set_requested() {
+    is_requested = true;
+
+    HookManager::get_instance()->request_arm(HookGroup::CaptureCamera);
+}
+
+static bool is_task_done(const std::future<void> &task) {
+    return !task.valid() || task.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+bool ReShadeAddOnInjectClient::is_capture_window_idle() const {
+    return !is_requested && done_capture && !prepare_sequencer.is_preparing() &&
+        !should_skip_camera_update && !prepare_sequencer.is_holding_timescale() &&
+        !is_mot_group_stance_caching && !previous_frame_is_stance_caching && hunter_set_mot_group_stance_params_cache.empty();
+}
+
+void ReShadeAddOnInjectClient::disarm_capture_window_hooks_if_idle() {
+    auto hook_manager = HookManager::get_instance();
+
+    if (hook_manager == nullptr) {
+        return;
+    }
+
+    if (!hook_manager->is_armed(HookGroup::CaptureCamera) && !hook_manager->is_armed(HookGroup::CaptureStance)) {
+        return;
+    }
+
+    if (!is_capture_window_idle()) {
+        return;
+    }
+
+    hook_manager->request_disarm(HookGroup::CaptureCamera);
+    hook_manager->request_disarm(HookGroup::CaptureStance);
+}
+
 void ReShadeAddOnInjectClient::update() {
+    // Done before the enable check, a client disabled mid-session must not leave its hooks behind
+    disarm_capture_window_hooks_if_idle();
+
+    if (auto debug_dump_writer = DebugDumpWriter::get_instance()) {
+        debug_dump_writer->set_idle(is_capture_window_idle());
+    }
+
+    // The copy of the screenshot goes back to the arena between captures, it is freed after the idle timeout unless
+    // the next capture takes it first
+    if (!screenshot_data_cache.empty() && is_capture_window_idle() && is_task_done(webp_promise) && is_task_done(dump_promise)) {
+        screenshot_data_cache.reset();
+    }
+
+    PixelBufferArena::get().trim();
+
     if (!is_enabled) {
         return;
     }
 
     auto game_ui_controller = GameUIController::get_instance();
     auto mod_settings = ModSettings::get_instance();
-    auto &api = reframework::API::get();
 
     if (game_ui_controller == nullptr || mod_settings == nullptr) {
         return;
     }
 
-    if (!request_launched) {
-        if (prepare_state == CapturePrepareState::FreezeScene) {
-            auto frame_freezed = freeze_timescale_frame_total - freeze_timescale_frame_left;
+    if (!request_launched && prepare_sequencer.is_preparing()) {
+        update_prepare_capture();
+    }
+}
 
-            if (frame_freezed >= freeze_timescale_frame_total - 1) {
-                prepare_state = CapturePrepareState::WaitingHideUI;
+void ReShadeAddOnInjectClient::update_prepare_capture() {
+    auto game_ui_controller = GameUIController::get_instance();
 
-#if LOG_DEBUG_STEP
-                api->log_info("Freeze game complete, move to start screenshotting");
-#endif
-            }
-            else {
-                api->log_info("Still waiting for timescale freeze");
-            }
-        }
+    auto state_before = prepare_sequencer.get_state();
+    auto frame_left_before = prepare_sequencer.get_frame_left();
 
-        if (prepare_state == CapturePrepareState::WaitingHideUI) {
-            float hide_progress = game_ui_controller->get_hiding_progress();
+    // What the sequencer asked for, so the trace can feed it back the same answers
+    int settled_input = -1;
+    float hide_progress_input = -1.0f;
 
-            if (hide_progress >= START_CAPTURE_AFTER_HIDE_REACHED_PROGRESS) {
-                prepare_state = CapturePrepareState::Complete;
-            }
-        }
+    bool should_launch = prepare_sequencer.update([this, &settled_input](int frames_frozen) {
+        bool settled = is_scene_settled(frames_frozen);
+        settled_input = settled ? 1 : 0;
+
+        return settled;
+    }, [game_ui_controller, &hide_progress_input]() {
+        hide_progress_input = game_ui_controller->get_hiding_progress();
+        return hide_progress_input;
+    });
+
+    CaptureTraceRecorder::record(CaptureTraceEventKind::PrepareUpdate, { static_cast<int>(state_before), frame_left_before, settled_input },
+        hide_progress_input);
+    CaptureTraceRecorder::record(CaptureTraceEventKind::PrepareResult, { static_cast<int>(prepare_sequencer.get_state()),
+        prepare_sequencer.get_frame_left(), should_launch ? 1 : 0 });
+
+    if (prepare_sequencer.get_state() == CapturePrepareSequencer::State::FreezeScene) {
+        RingLogger::info("Still waiting for timescale freeze");
+    }
 
-        if (prepare_state == CapturePrepareState::Complete) {
 #if LOG_DEBUG_STEP
-            api->log_info("Starting screenshot process");
+    if (state_before == CapturePrepareSequencer::State::FreezeScene && settled_input != 1 &&
+        prepare_sequencer.get_state() != CapturePrepareSequencer::State::FreezeScene) {
+        RingLogger::info("Freeze game complete, move to start screenshotting");
+    }
 #endif
-            // Start the capture process
-            launch_capture_implement();
-            prepare_state = CapturePrepareState::None;
-        }
+
+    if (should_launch) {
+#if LOG_DEBUG_STEP
+        RingLogger::info("Starting screenshot process");
+#endif
+        // Start the capture process
+        launch_capture_implement();
     }
 }
 
@@ -351,7 +493,9 @@ void ReShadeAddOnInjectClient::late_update() {
 
     auto vm_context = api->get_vm_context();
 
-    if (freeze_timescale_frame_left >= 0) {
+    if (prepare_sequencer.is_holding_timescale()) {
+        bool is_releasing = prepare_sequencer.is_releasing_timescale();
+
         if (!time_scale_cached) {
             previous_timescale = get_timescale_method->call<float>(vm_context);
 
@@ -362,12 +506,15 @@ void ReShadeAddOnInjectClient::late_update() {
         // Let it have some leeway
         float target_timescale = 0.000001f;
 
-        if (freeze_timescale_frame_left == 0) {
+        if (is_releasing) {
             target_timescale = previous_timescale;
             time_scale_cached = false;
         }
 
-        api->log_info("Freezing timescale, frame left: %d, total: %d, target frame scale: %f", freeze_timescale_frame_left, freeze_timescale_frame_total, target_timescale);
+        CaptureTraceRecorder::record(CaptureTraceEventKind::Timescale, { prepare_sequencer.get_frame_left(), is_releasing ? 1 : 0 });
+
+        RingLogger::info("Freezing timescale, frame left: %d, total: %d, target frame scale: %f", prepare_sequencer.get_frame_left(),
+            prepare_sequencer.get_frame_total(), target_timescale);
         set_timescale_method->call<void>(vm_context, target_timescale);
     }
 
@@ -383,12 +530,10 @@ void ReShadeAddOnInjectClient::end_rendering() {
         return;
     }
 
-    if (freeze_timescale_frame_left >= 0) {
-        freeze_timescale_frame_left--;
-
-        auto& api = reframework::API::get();
+    if (prepare_sequencer.end_rendering()) {
+        CaptureTraceRecorder::record(CaptureTraceEventKind::EndRendering, { prepare_sequencer.get_frame_left() });
 
-        api->log_info("End rendering, timescale freeze frame left: %d", freeze_timescale_frame_left);
+        RingLogger::info("End rendering, timescale freeze frame left: %d", prepare_sequencer.get_frame_left());
     }
 }
 
@@ -401,11 +546,21 @@ void ReShadeAddOnInjectClient::launch_capture_implement() {
         return;
     }
 
+    stop_scene_settle_watch();
+
     if (is_reshade_present()) {
-        bool screenshot_before_reshade = quest_result_hq_background_mode == QuestResultHQBackgroundMode::NoReshade ||
-            quest_result_hq_background_mode == QuestResultHQBackgroundMode::ReshadeApplyLater;
+        int request_capture = RESULT_SCREEN_RESHADE_CAPTURE_FAILURE;
+
+        int capture_frame_count = prepare_sequencer.get_capture_frame_count();
+
+        if (capture_frame_count > 1) {
+            int merge_mode = (mod_settings->capture_frame_merge_mode == CaptureFrameMergeMode_MedianOf3) ? SCREEN_CAPTURE_MERGE_MEDIAN_OF_3 : SCREEN_CAPTURE_MERGE_MEAN;
 
-        auto request_capture = request_reshade_screen_capture(capture_screenshot_callback, mod_settings->hdr_bits, screenshot_before_reshade);
+            request_capture = request_reshade_screen_capture_multi_frame(capture_screenshot_callback, mod_settings->hdr_bits, is_screenshot_before_reshade(),
+                capture_frame_count, merge_mode);
+        } else {
+            request_capture = request_reshade_screen_capture(capture_screenshot_callback, mod_settings->hdr_bits, is_screenshot_before_reshade());
+        }
         if (request_capture != RESULT_SCREEN_CAPTURE_SUBMITTED) {
             api->log_error("Request capture failed %d", request_capture);
             // The capture never started, so there's nothing more to cache.
@@ -448,6 +603,27 @@ bool ReShadeAddOnInjectClient::try_load_reshade() {
         set_reshade_filters_enable = reinterpret_cast<set_reshade_filters_enable_func>(GetProcAddress(reshade_module, SET_RESHADE_FILTERS_ENABLE));
     }
 
+    if (request_reshade_screen_capture_multi_frame == nullptr) {
+        request_reshade_screen_capture_multi_frame = reinterpret_cast<request_screen_capture_multi_frame_func>(GetProcAddress(reshade_module, GET_SCREEN_CAPTURE_MULTI_FRAME_SYMBOL_NAME));
+    }
+
+    if (set_scene_settle_watch == nullptr) {
+        set_scene_settle_watch = reinterpret_cast<set_scene_settle_watch_func>(GetProcAddress(reshade_module, SET_SCENE_SETTLE_WATCH_SYMBOL_NAME));
+        get_scene_settle_status = reinterpret_cast<get_scene_settle_status_func>(GetProcAddress(reshade_module, GET_SCENE_SETTLE_STATUS_SYMBOL_NAME));
+    }
+
+    if (set_hdr_capture_archive_directory_impl == nullptr) {
+        set_hdr_capture_archive_directory_impl = reinterpret_cast<set_hdr_capture_archive_directory_func>(GetProcAddress(reshade_module,
+            SET_HDR_CAPTURE_ARCHIVE_DIRECTORY_SYMBOL_NAME));
+    }
+
+    if (set_pixel_buffer_arena_config == nullptr) {
+        set_pixel_buffer_arena_config = reinterpret_cast<set_pixel_buffer_arena_config_func>(GetProcAddress(reshade_module,
+            SET_PIXEL_BUFFER_ARENA_CONFIG_SYMBOL_NAME));
+        get_pixel_buffer_arena_stats = reinterpret_cast<get_pixel_buffer_arena_stats_func>(GetProcAddress(reshade_module,
+            GET_PIXEL_BUFFER_ARENA_STATS_SYMBOL_NAME));
+    }
+
     return request_reshade_screen_capture != nullptr;
 }
 
@@ -468,8 +644,7 @@ void ReShadeAddOnInjectClient::compress_webp_thread(std::uint8_t *data, int widt
 
     auto mod_settings = ModSettings::get_instance();
 
-    std::vector<std::uint8_t> new_buffer_if_have;
-    std::vector<std::uint8_t> cropped_buffer_if_have;
+    PixelBufferArena::Buffer cropped_buffer_if_have;
 
     int force_size_width = FORCE_SIZE_WIDTH_16x9;
     int force_size_height = FORCE_SIZE_HEIGHT_16x9;
@@ -511,27 +686,42 @@ void ReShadeAddOnInjectClient::compress_webp_thread(std::uint8_t *data, int widt
                 height = crop_height;
             } else {
                 // Pillarboxing (bars on left/right): rows are not contiguous, copy into a tight buffer.
-                cropped_buffer_if_have.resize(static_cast<std::size_t>(crop_width) * crop_height * 4);
+                cropped_buffer_if_have = PixelBufferArena::get().acquire(static_cast<std::size_t>(crop_width) * crop_height * 4);
+
+                if (cropped_buffer_if_have.empty()) {
+                    api->log_error("Not enough pixel buffer budget to crop the black bars, keeping them");
+                } else {
+                    for (int y = 0; y < crop_height; ++y) {
+                        std::memcpy(
+                            cropped_buffer_if_have.data() + static_cast<std::size_t>(y) * crop_width * 4,
+                            data + static_cast<std::size_t>(crop_rect.top + y) * width * 4 + crop_rect.left * 4,
+                            static_cast<std::size_t>(crop_width) * 4);
+                    }
 
-                for (int y = 0; y < crop_height; ++y) {
-                    std::memcpy(
-                        cropped_buffer_if_have.data() + static_cast<std::size_t>(y) * crop_width * 4,
-                        data + static_cast<std::size_t>(crop_rect.top + y) * width * 4 + crop_rect.left * 4,
-                        static_cast<std::size_t>(crop_width) * 4);
+                    data = cropped_buffer_if_have.data();
+                    width = crop_width;
+                    height = crop_height;
                 }
-
-                data = cropped_buffer_if_have.data();
-                width = crop_width;
-                height = crop_height;
             }
         }
     }
 
+    PixelBufferArena::Buffer resized_buffer_if_have;
+
     if (force_size_width != width || force_size_height != height) {
         // Need resize
         api->log_info("Resizing image from %dx%d to %dx%d (GAME REQUIRES IT)", width, height, force_size_width, force_size_height);
 
-        new_buffer_if_have.resize(force_size_width * force_size_height * 4);
+        resized_buffer_if_have = PixelBufferArena::get().acquire(static_cast<std::size_t>(force_size_width) * force_size_height * 4);
+
+        if (resized_buffer_if_have.empty()) {
+            api->log_error("Not enough pixel buffer budget to resize the image");
+            reshade_addon_client_instance->finish_capture(false);
+            reshade_addon_client_instance->done_capture = true;
+
+            return;
+        }
+
         avir::CImageResizer<avir::fpclass_float4> image_resizer( 8 );
 
         avir::CImageResizerVars params;
@@ -539,52 +729,48 @@ void ReShadeAddOnInjectClient::compress_webp_thread(std::uint8_t *data, int widt
 
         params.ThreadPool = avir_thread_pool_instance.get();
 
-        image_resizer.resizeImage(data, width, height, 0, new_buffer_if_have.data(), force_size_width,
+        image_resizer.resizeImage(data, width, height, 0, resized_buffer_if_have.data(), force_size_width,
             force_size_height, 4, 0, &params);
 
-        data = new_buffer_if_have.data();
+        data = resized_buffer_if_have.data();
         width = force_size_width;
         height = force_size_height;
     }
 
     // Set alpha all to 1, for some reasons alpha on some machine is not 1
     for (int i = 0; i < width * height; i++) {
-        std::uint8_t alpha = data[i * 4 + 3];
         data[i * 4 + 3] = 255;
     }
-    
+
     bool is_lossless = reshade_addon_client_instance->is_lossless();
+    std::size_t max_size = reshade_addon_client_instance->use_old_limit_size ? MaxSerializePhotoSizeOriginal : MaxSerializePhotoSize;
 
-    std::uint8_t* result_temp = nullptr;
-    std::size_t result_size = 0;
+    WebPDataBuffer encoded_buffer;
 
-    std::size_t max_size = reshade_addon_client_instance->use_old_limit_size ? MaxSerializePhotoSizeOriginal : MaxSerializePhotoSize;
-    
     if (is_lossless) {
-        result_size = WebPEncodeLosslessRGBA(data, width, height, width * 4, &result_temp);
-    } else {
-        float min_quality = MIN_QUALITY_PHOTO;
-        float current_quality = std::max<float>(MIN_QUALITY_PHOTO, static_cast<float>(ModSettings::get_instance()->max_album_image_quality));
-
-        do {
-            result_size = WebPEncodeRGBA(data, width, height, width * 4, current_quality, &result_temp);
-            if (result_size == 0) {
-                api->log_info("Failed to encode image data to WebP format.");
-                break;
-            }
+        auto &decode_budget_encoder = reshade_addon_client_instance->decode_budget_encoder;
+        encoded_buffer = decode_budget_encoder.encode(data, width, height,
+            reshade_addon_client_instance->decode_budget_ms.load(std::memory_order_relaxed));
 
-            if (result_size >= max_size) {
-                current_quality -= QUALITY_REDUCE_STEP;
-                api->log_info("Image size too large, reducing quality to %f", current_quality);
+        auto report = decode_budget_encoder.get_last_report();
 
-                result_size = 0;
+        if (report.selected >= 0) {
+            const auto &measure = report.measures[report.selected];
 
-                WebPFree(result_temp);
-                result_temp = nullptr;
-            } else {
-                break;
-            }
-        } while (current_quality >= min_quality);
+            api->log_info("Picked %s encoding for the quest result, decode %.2f ms (budget %.2f ms), %zu bytes",
+                DecodeBudgetEncoder::CANDIDATES[report.selected].name, measure.decode_ms, report.budget_ms, measure.size);
+        }
+    } else {
+        // Same quality search as the override images, so one size budget gets the same quality on both paths
+        TranscodeResult transcode_result;
+
+        if (ImageTranscoder::encode_webp_fitting(data, width, height, max_size,
+            std::max(MIN_QUALITY_PHOTO, ModSettings::get_instance()->max_album_image_quality), MIN_QUALITY_PHOTO, transcode_result)) {
+            api->log_info("Encoded the quest result at quality %d in %d attempts", transcode_result.quality, transcode_result.encode_attempts);
+            encoded_buffer = WebPDataBuffer::from_vector(std::move(transcode_result.webp));
+        } else {
+            api->log_info("Failed to encode the quest result: %s", transcode_result.error.c_str());
+        }
     }
 
     if (mod_settings->debug_capture_delay) {
@@ -592,19 +778,16 @@ void ReShadeAddOnInjectClient::compress_webp_thread(std::uint8_t *data, int widt
         std::this_thread::sleep_for(std::chrono::duration<float>(mod_settings->simulate_capture_delay_seconds));
     }
 
-    if (result_size > 0) {
-        std::vector<std::uint8_t> temp_buffer(result_temp, result_temp + result_size);
-        api->log_info("Screenshot image encoded successfully, size: %zu bytes", result_size);
+    if (!encoded_buffer.empty()) {
+        api->log_info("Screenshot image encoded successfully, size: %zu bytes", encoded_buffer.size());
 
 #if 0
         std::ofstream test_result("E:\\test_result.webp");
-        test_result.write(reinterpret_cast<const char*>(temp_buffer.data()), temp_buffer.size());
+        test_result.write(reinterpret_cast<const char*>(encoded_buffer.data()), encoded_buffer.size());
         test_result.flush();
         test_result.close();
 #endif
-        reshade_addon_client_instance->finish_capture(true, &temp_buffer);
-
-        WebPFree(result_temp);
+        reshade_addon_client_instance->finish_capture(true, std::move(encoded_buffer));
     } else {
         // Handle error
         api->log_info("Failed to encode image data to WebP format.");
@@ -614,6 +797,29 @@ void ReShadeAddOnInjectClient::compress_webp_thread(std::uint8_t *data, int widt
     reshade_addon_client_instance->done_capture = true;
 }
 
+void ReShadeAddOnInjectClient::set_hdr_capture_archive_directory(const std::string &directory) {
+    if (set_hdr_capture_archive_directory_impl != nullptr) {
+        set_hdr_capture_archive_directory_impl(directory.c_str());
+    }
+}
+
+void ReShadeAddOnInjectClient::set_pixel_buffer_limits(std::size_t budget_bytes, std::chrono::milliseconds idle_timeout, bool use_large_pages) {
+    PixelBufferArena::get().configure(budget_bytes, idle_timeout, use_large_pages);
+
+    if (set_pixel_buffer_arena_config != nullptr) {
+        set_pixel_buffer_arena_config(budget_bytes, static_cast<int>(idle_timeout.count()), use_large_pages);
+    }
+}
+
+bool ReShadeAddOnInjectClient::get_addon_pixel_buffer_stats(PixelBufferArenaStats &stats) const {
+    if (get_pixel_buffer_arena_stats == nullptr) {
+        return false;
+    }
+
+    get_pixel_buffer_arena_stats(&stats);
+    return true;
+}
+
 void ReShadeAddOnInjectClient::capture_screenshot_callback(int result, int width, int height, void* data) {
     auto& api = reframework::API::get();
     auto mod_settings = ModSettings::get_instance();
@@ -655,8 +861,13 @@ void ReShadeAddOnInjectClient::capture_screenshot_callback(int result, int width
         auto &data_cache = reshade_addon_client_instance->screenshot_data_cache;
         auto size_buffer_needed = static_cast<std::size_t>(width * height * 4);
 
-        if (data_cache.size() < size_buffer_needed) {
-            data_cache.resize(size_buffer_needed);
+        if (!PixelBufferArena::get().ensure(data_cache, size_buffer_needed)) {
+            api->log_error("Not enough pixel buffer budget to copy the %dx%d screenshot", width, height);
+            reshade_addon_client_instance->finish_capture(false);
+            reshade_addon_client_instance->done_capture = true;
+            reshade_addon_client_instance->is_mot_group_stance_caching = false;
+
+            return;
         }
 
         std::memcpy(data_cache.data(), data, size_buffer_needed);
@@ -667,25 +878,28 @@ void ReShadeAddOnInjectClient::capture_screenshot_callback(int result, int width
         api->log_info("Calling WebP compress thread");
 #endif
 
-        reshade_addon_client_instance->dump_promise = random_task_thread_pool.submit_task([data_ptr, width, height, dump_debug_png = mod_settings->dump_mod_png]() {
+        reshade_addon_client_instance->dump_promise = random_task_thread_pool.submit_task([data_ptr, width, height, dump_debug_png = mod_settings->dump_mod_png,
+            dump_format = mod_settings->debug_dump_format, recompress_dump = mod_settings->recompress_debug_dumps_when_idle]() {
             if (dump_debug_png) {
+                auto debug_dump_writer = DebugDumpWriter::get_instance();
+
+                if (debug_dump_writer == nullptr) {
+                    return;
+                }
+
                 auto persistent_dir = REFramework::get_persistent_dir();
 
+                // The extension follows the dump format
                 static constexpr const char *DEBUG_FILE_NAME= "reframework/data/MHWilds_HighQualityPhotoMod_HighQuality_QuestResult.png";
 
-                if (!std::filesystem::exists(persistent_dir)) {
-                    std::filesystem::create_directories(persistent_dir);
-                }
-
                 auto debug_path = persistent_dir / DEBUG_FILE_NAME;
-                auto debug_path_str = debug_path.string();
 
                 // Dump the actual cropped content (without black bars) when the crop setting
                 // is enabled, so the debug image matches the content that gets resized/encoded.
                 const std::uint8_t* dump_data = data_ptr;
                 int dump_width = width;
                 int dump_height = height;
-                std::vector<std::uint8_t> cropped_dump_buffer;
+                PixelBufferArena::Buffer cropped_dump_buffer;
 
                 auto mod_settings = ModSettings::get_instance();
                 if (mod_settings != nullptr && mod_settings->crop_black_bars) {
@@ -702,26 +916,42 @@ void ReShadeAddOnInjectClient::capture_screenshot_callback(int result, int width
                             dump_height = crop_height;
                         } else {
                             // Pillarboxing present: rows are not contiguous, copy into a tight buffer.
-                            cropped_dump_buffer.resize(static_cast<std::size_t>(crop_width) * crop_height * 4);
-                            for (int y = 0; y < crop_height; ++y) {
-                                std::memcpy(
-                                    cropped_dump_buffer.data() + static_cast<std::size_t>(y) * crop_width * 4,
-                                    data_ptr + static_cast<std::size_t>(crop_rect.top + y) * width * 4 + crop_rect.left * 4,
-                                    static_cast<std::size_t>(crop_width) * 4);
+                            // Without the budget for it, the full frame is dumped
+                            cropped_dump_buffer = PixelBufferArena::get().acquire(static_cast<std::size_t>(crop_width) * crop_height * 4);
+
+                            if (!cropped_dump_buffer.empty()) {
+                                for (int y = 0; y < crop_height; ++y) {
+                                    std::memcpy(
+                                        cropped_dump_buffer.data() + static_cast<std::size_t>(y) * crop_width * 4,
+                                        data_ptr + static_cast<std::size_t>(crop_rect.top + y) * width * 4 + crop_rect.left * 4,
+                                        static_cast<std::size_t>(crop_width) * 4);
+                                }
+                                dump_data = cropped_dump_buffer.data();
+                                dump_width = crop_width;
+                                dump_height = crop_height;
                             }
-                            dump_data = cropped_dump_buffer.data();
-                            dump_width = crop_width;
-                            dump_height = crop_height;
                         }
                     }
                 }
 
-                stbi_write_png(debug_path_str.c_str(), dump_width, dump_height, 4, dump_data, dump_width * 4);
+                debug_dump_writer->write(debug_path, dump_data, dump_width, dump_height, dump_width * 4, dump_format, recompress_dump);
             }
         });
 
-        reshade_addon_client_instance->webp_promise = random_task_thread_pool.submit_task([data_ptr, width, height, dump_debug_png = mod_settings->dump_mod_png]() {
+        std::string archive_directory = mod_settings->archive_captures ? mod_settings->capture_archive_directory : std::string{};
+
+        reshade_addon_client_instance->webp_promise = random_task_thread_pool.submit_task([data_ptr, width, height, dump_debug_png = mod_settings->dump_mod_png,
+            archive_format = mod_settings->capture_archive_format, archive_directory = std::move(archive_directory),
+            captured_at = std::chrono::system_clock::now()]() {
             ReShadeAddOnInjectClient::compress_webp_thread(data_ptr, width, height);
+
+            // Copied from the screenshot cache once the in-game image is sent, the next capture waits for this task before
+            // reusing the cache. The file is written on the archiver's own background thread
+            auto capture_archiver = CaptureArchiver::get_instance();
+
+            if (capture_archiver != nullptr && !archive_directory.empty()) {
+                capture_archiver->submit(data_ptr, width, height, archive_format, archive_directory, captured_at);
+            }
         });
     } else {
         // Handle error
@@ -735,13 +965,13 @@ void ReShadeAddOnInjectClient::capture_screenshot_callback(int result, int width
     }
 }
 
-void ReShadeAddOnInjectClient::finish_capture(bool success, std::vector<std::uint8_t>* provided_data) {
+void ReShadeAddOnInjectClient::finish_capture(bool success, WebPDataBuffer provided_data) {
     auto& api = reframework::API::get();
 
-    if (success && provided_data) {
-        provide_data_finish_callback(success, provided_data);
+    if (success && !provided_data.empty()) {
+        provide_data_finish_callback(success, std::move(provided_data));
     } else {
-        provide_data_finish_callback(false, nullptr);
+        provide_data_finish_callback(false, {});
     }
 }
 
@@ -749,6 +979,11 @@ void ReShadeAddOnInjectClient::null_post(void** ret_val, REFrameworkTypeDefiniti
     // No operation
 }
 
+bool ReShadeAddOnInjectClient::is_screenshot_before_reshade() const {
+    return quest_result_hq_background_mode == QuestResultHQBackgroundMode::NoReshade ||
+        quest_result_hq_background_mode == QuestResultHQBackgroundMode::ReshadeApplyLater;
+}
+
 bool ReShadeAddOnInjectClient::should_reshade_filters_disable_when_show_quest_result_ui() const {
     return quest_result_hq_background_mode == QuestResultHQBackgroundMode::NoReshade ||
            quest_result_hq_background_mode == QuestResultHQBackgroundMode::ReshadePreapplied;
@@ -987,11 +1222,13 @@ void ReShadeAddOnInjectClient::manual_update_save_capture_until_complete() {
     int try_count = MAX_TRY_COUNT;
     auto vm_context = api->get_vm_context();
 
+    auto bindings = ReflectionBindings::get_instance();
+
     while (try_count-- > 0) {
-        auto capture_state_ptr = album_manager_instance->get_field<int>("_SaveCaptureState");
+        auto capture_state_ptr = bindings->get_field<int>(album_manager_instance, FieldBinding::AlbumManager_SaveCaptureState);
 
         if (capture_state_ptr == nullptr) {
-            api->log_info("Capture state is null to manually update save capture");
+            RingLogger::info("Capture state is null to manually update save capture");
             return;
         }
 
@@ -999,17 +1236,16 @@ void ReShadeAddOnInjectClient::manual_update_save_capture_until_complete() {
 
         // We are finished
         if (capture_state == SAVECAPTURESTATE_IDLE || capture_state >= SAVECAPTURESTATE_WAIT_SAVE_CAPTURE) {
-            api->log_info("Manual update save capture finished");
+            RingLogger::info("Manual update save capture finished");
             return;
         } else {
-            auto msg = "Manual update save capture in progress, current state: " + std::to_string(static_cast<int>(capture_state));
-            api->log_info(msg.c_str());
+            RingLogger::info("Manual update save capture in progress, current state: %d", static_cast<int>(capture_state));
         }
 
         update_save_capture_method->call<void>(vm_context, album_manager_instance);
     }
 
-    api->log_info("Manual update save capture reached max try count, basically failed");
+    RingLogger::error("Manual update save capture reached max try count, basically failed");
     return;
 }
 
@@ -1023,13 +1259,17 @@ ReShadeAddOnInjectClient::ReShadeAddOnInjectClient() {
         return;
     }
 
-    // Iterate all methods and hook method that starts with updateAction
+    auto hook_manager = HookManager::get_instance();
+
+    // Iterate all methods and hook method that starts with updateAction. These run every frame,
+    // so they are only armed between quest end and capture completion
     auto player_camera_controller_methods = player_camera_controller_type->get_methods();
     for (auto& method : player_camera_controller_methods) {
         auto method_name = std::string_view(method->get_name());
 
         if (method_name.starts_with("updateAction") || method_name.starts_with("<updateAction>")) {
-            method->add_hook(pre_player_camera_controller_update_action, post_player_camera_controller_update_action, false);
+            camera_update_action_stats = hook_manager->register_hook(HookGroup::CaptureCamera, "PlayerCameraController.updateAction*",
+                method, pre_player_camera_controller_update_action, post_player_camera_controller_update_action, false);
         }
     }
 
@@ -1073,7 +1313,8 @@ ReShadeAddOnInjectClient::ReShadeAddOnInjectClient() {
         api->log_error("Can't find HunterCharacter.cMotionSupporter.setHunterMotGroup_Stance method!");
     }
 
-    set_mot_group_stance_method->add_hook(pre_motion_supporter_set_hunter_mot_group_stance_proxy, null_post, false);
+    mot_group_stance_stats = hook_manager->register_hook(HookGroup::CaptureStance, "cMotionSupporter.setHunterMotGroup_Stance",
+        set_mot_group_stance_method, pre_motion_supporter_set_hunter_mot_group_stance_proxy, null_post, false);
 
     // Start caching the mot group stance calls when the quest failed/cancel state is entered.
     // Caching stays active until the screenshot capture is done.
@@ -1091,8 +1332,7 @@ ReShadeAddOnInjectClient::ReShadeAddOnInjectClient() {
         quest_cancel_state_enter->add_hook(pre_quest_failed_or_cancel_enter_proxy, null_post, false);
     }
 
-    prepare_state = CapturePrepareState::None;
-    freeze_timescale_frame_left = -1;
+    prepare_sequencer.reset();
     should_skip_camera_update = false;
     done_capture = true;
 }
@@ -1120,6 +1360,10 @@ int ReShadeAddOnInjectClient::pre_quest_failed_or_cancel_enter_impl(int argc, vo
 
     hunter_set_mot_group_stance_params_cache.clear();
 
+    // The quest end is the only time the stance hook is needed, it stays disarmed while hunting. The arm is applied at
+    // the next update, calls left in this frame run as usual
+    HookManager::get_instance()->request_arm(HookGroup::CaptureStance);
+
     auto& api = reframework::API::get();
     api->log_info("Quest failed/cancel state entered, starting to cache setHunterMotGroup_Stance calls");
 
@@ -1141,13 +1385,14 @@ int ReShadeAddOnInjectClient::pre_motion_supporter_set_hunter_mot_group_stance_i
 
     hunter_set_mot_group_stance_params_cache.push_back(params);
 
-    auto& api = reframework::API::get();
-    api->log_info("Caching setHunterMotGroup_Stance call, total pending calls: %zu", hunter_set_mot_group_stance_params_cache.size());
+    RingLogger::info("Caching setHunterMotGroup_Stance call, total pending calls: %zu", hunter_set_mot_group_stance_params_cache.size());
 
     return REFRAMEWORK_HOOK_SKIP_ORIGINAL;
 }
 
 int ReShadeAddOnInjectClient::pre_motion_supporter_set_hunter_mot_group_stance_proxy(int argc, void** argv, REFrameworkTypeDefinitionHandle* arg_tys, unsigned long long ret_addr) {
+    ScopedHookTimer timer(reshade_addon_client_instance->mot_group_stance_stats);
+
     if (!reshade_addon_client_instance->get_is_enabled()) {
         return REFRAMEWORK_HOOK_CALL_ORIGINAL;
     }
@@ -1167,7 +1412,7 @@ void ReShadeAddOnInjectClient::execute_pending_mot_group_stance() {
     auto& api = reframework::API::get();
     auto vm_context = api->get_vm_context();
 
-    api->log_info("Executing pending setHunterMotGroup_Stance calls, total pending calls: %zu", hunter_set_mot_group_stance_params_cache.size());
+    RingLogger::info("Executing pending setHunterMotGroup_Stance calls, total pending calls: %zu", hunter_set_mot_group_stance_params_cache.size());
 
     for (auto& params : hunter_set_mot_group_stance_params_cache) {
         set_mot_group_stance_method->call<void>(vm_context, params[0], params[1], params[2], params[3], params[4]);
@@ -2,6 +2,8 @@
 
 #define NOMINMAX
 
+#include "../CaptureSequencing.hpp"
+#include "../DecodeBudgetEncoder.hpp"
 #include "../WebPCaptureInjectClient.hpp"
 #include "../QuestResultHQBackgroundMode.hpp"
 #include "../../reshade/Plugin.h"
@@ -18,19 +20,16 @@
 
 #include <Windows.h>
 
+struct HookCallStats;
+
 class ReShadeAddOnInjectClient : public WebPCaptureInjectClient {
 public:
     static constexpr int MIN_FREEZE_TIMESCALE_FRAME_COUNT = 4;
     static constexpr int MAX_FREEZE_TIMESCALE_FRAME_COUNT = 16;
+    static constexpr int MIN_CAPTURE_FRAME_MERGE_COUNT = 2;
+    static constexpr int MAX_CAPTURE_FRAME_MERGE_COUNT = 8;
 
 private:
-    enum class CapturePrepareState {
-        None,
-        FreezeScene,
-        WaitingHideUI,
-        Complete
-    };
-
     using HunterSetMotGroupStanceParams = std::array<uint64_t, 5>;
 
     ProvideFinishedDataCallback provide_data_finish_callback;
@@ -38,11 +37,32 @@ private:
     HMODULE reshade_module = nullptr;
 
     typedef int (*request_screen_capture_func)(ScreenCaptureFinishFunc finish_callback, int hdr_bit_depths, bool screenshot_before_reshade);
+    typedef int (*request_screen_capture_multi_frame_func)(ScreenCaptureFinishFunc finish_callback, int hdr_bit_depths, bool screenshot_before_reshade,
+        int frame_count, int merge_mode);
     typedef void (*set_reshade_filters_enable_func)(bool should_enable);
+    typedef void (*set_scene_settle_watch_func)(bool enable, bool screenshot_before_reshade, float settled_threshold);
+    typedef void (*get_scene_settle_status_func)(SceneSettleStatus *status);
+    typedef void (*set_hdr_capture_archive_directory_func)(const char *directory);
+    typedef void (*set_pixel_buffer_arena_config_func)(std::uint64_t budget_bytes, int idle_timeout_ms, bool use_large_pages);
+    typedef void (*get_pixel_buffer_arena_stats_func)(PixelBufferArenaStats *stats);
 
     request_screen_capture_func request_reshade_screen_capture = nullptr;
     set_reshade_filters_enable_func set_reshade_filters_enable = nullptr;
 
+    // Missing on older add-on builds, a single frame is captured then
+    request_screen_capture_multi_frame_func request_reshade_screen_capture_multi_frame = nullptr;
+
+    // Missing on older add-on builds, the freeze then always lasts the full frame count
+    set_scene_settle_watch_func set_scene_settle_watch = nullptr;
+    get_scene_settle_status_func get_scene_settle_status = nullptr;
+
+    // Missing on older add-on builds, HDR captures are then only archived as their SDR version
+    set_hdr_capture_archive_directory_func set_hdr_capture_archive_directory_impl = nullptr;
+
+    // Missing on older add-on builds, their capture buffers are then not limited
+    set_pixel_buffer_arena_config_func set_pixel_buffer_arena_config = nullptr;
+    get_pixel_buffer_arena_stats_func get_pixel_buffer_arena_stats = nullptr;
+
     std::future<void> webp_promise;
     std::future<void> dump_promise;
 
@@ -50,6 +70,8 @@ private:
 
     bool is_enabled = true;
     bool should_lossless = false;
+    // Set from the game thread, read by the encode worker
+    std::atomic<float> decode_budget_ms = 0.0f;
     bool use_old_limit_size = false;
     bool is_16x9 = false;
     bool is_photo_mode = false;
@@ -62,9 +84,9 @@ private:
     */
     bool is_requested = false;
 
-    CapturePrepareState prepare_state = CapturePrepareState::None;
-    int freeze_timescale_frame_left = 0;
-    int freeze_timescale_frame_total = 0;
+    CapturePrepareSequencer prepare_sequencer;
+
+    bool is_watching_scene_settle = false;
 
     reframework::API::Method *set_timescale_method = nullptr;
     reframework::API::Method *get_timescale_method = nullptr;
@@ -81,7 +103,10 @@ private:
     reframework::API::ManagedObject *album_manager_instance = nullptr;
 
     std::uint64_t player_camera_global_request_flags_backup = 0;
-    std::vector<std::uint8_t> screenshot_data_cache;
+    // Given back to the arena between captures, see update
+    PixelBufferArena::Buffer screenshot_data_cache;
+
+    DecodeBudgetEncoder decode_budget_encoder;
 
     std::vector<HunterSetMotGroupStanceParams> hunter_set_mot_group_stance_params_cache;
     // While true, setHunterMotGroup_Stance calls are cached (skipped) instead of executed.
@@ -93,15 +118,19 @@ private:
 
     bool done_capture = false;
 
+    HookCallStats *camera_update_action_stats = nullptr;
+    HookCallStats *mot_group_stance_stats = nullptr;
+
 private:
     bool try_load_reshade();
     // Deprecated
     /*
     bool end_slowmo_present();
     */
-    void finish_capture(bool success, std::vector<std::uint8_t>* provided_data = nullptr);
+    void finish_capture(bool success, WebPDataBuffer provided_data = {});
 
     static void compress_webp_thread(std::uint8_t *data, int width, int height);
+
     static void capture_screenshot_callback(int result, int width, int height, void* data);
 
     // Deprecated
@@ -128,12 +157,21 @@ private:
     static int pre_quest_result_load_quest_result_photograph(int argc, void** argv, REFrameworkTypeDefinitionHandle* arg_tys, unsigned long long ret_addr);
 
     bool should_reshade_filters_disable_when_show_quest_result_ui() const;
+    bool is_screenshot_before_reshade() const;
+    int get_capture_frame_count_to_use() const;
+    bool is_scene_settled(int frame_freezed);
+    void stop_scene_settle_watch();
+    void update_prepare_capture();
     void launch_capture_implement();
     void restore_back_hunt_complete_camera_request();
     void do_prepare_capture();
     void manual_update_save_capture_until_complete();
     void execute_pending_mot_group_stance();
 
+    // True when no capture is requested, in flight, or waiting to replay cached calls
+    bool is_capture_window_idle() const;
+    void disarm_capture_window_hooks_if_idle();
+
 public:
     ~ReShadeAddOnInjectClient();
 
@@ -161,6 +199,15 @@ public:
         return should_lossless;
     }
 
+    // Only used when lossless, how long the game may take to decode the background (see DecodeBudgetEncoder)
+    void set_decode_budget_ms(float budget_ms) {
+        decode_budget_ms.store(budget_ms, std::memory_order_relaxed);
+    }
+
+    DecodeBudgetEncoder &get_decode_budget_encoder() {
+        return decode_budget_encoder;
+    }
+
     void set_is_photo_mode(bool force) {
         is_photo_mode = force;
     }
@@ -177,6 +224,15 @@ public:
         return use_old_limit_size;
     }
 
+    // Where the add-on keeps the 16-bit PNG of HDR captures, empty turns it off
+    void set_hdr_capture_archive_directory(const std::string &directory);
+
+    // Applies to the capture buffers of this plugin and of the add-on
+    void set_pixel_buffer_limits(std::size_t budget_bytes, std::chrono::milliseconds idle_timeout, bool use_large_pages);
+
+    // False if the add-on is missing or too old to report them
+    bool get_addon_pixel_buffer_stats(PixelBufferArenaStats &stats) const;
+
     bool is_reshade_present() {
         return reshade_module != nullptr && request_reshade_screen_capture != nullptr;
     }
@@ -185,9 +241,8 @@ public:
         quest_result_hq_background_mode = mode;
     }
 
-    void set_requested() {
-        is_requested = true;
-    }
+    // Arms the capture window hooks (camera), they are disarmed again once the capture is done
+    void set_requested();
 
     bool get_requested() const {
         return is_requested;
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "MHWildsTypes.h"
+#include "ReflectionBindings.hpp"
+
+#include <reframework/API.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+template <typename T>
+T *get_array_ptr(reframework::API::ManagedObject *array_obj) {
+    if (!array_obj) {
+        return nullptr;
+    }
+
+    return reinterpret_cast<T*>(reinterpret_cast<std::uint8_t*>(array_obj) + ArrayPtrOffset);
+}
+
+// Typed view over a managed System.Array whose elements are stored inline after the array header
+// (value types such as System.Byte, or object references as ManagedObject*).
+// The length is queried from the VM once when the view is made (through the bound GetLength), every element access after that
+// goes straight to memory, so copying a 1 MB WebP in or out is a memcpy instead of a VM call per byte.
+// The view does not own a reference to the array.
+template <typename T>
+class ManagedArrayView {
+private:
+    reframework::API::ManagedObject *array_obj = nullptr;
+    std::size_t length = 0;
+
+public:
+    ManagedArrayView() = default;
+
+    explicit ManagedArrayView(reframework::API::ManagedObject *array_obj, void *vm_context = nullptr)
+        : array_obj(array_obj) {
+        if (!array_obj) {
+            return;
+        }
+
+        if (!vm_context) {
+            vm_context = reframework::API::get()->get_vm_context();
+        }
+
+        auto bindings = ReflectionBindings::get_instance();
+        auto get_length_method = bindings ? bindings->get_method(MethodBinding::Array_GetLength) : nullptr;
+
+        auto array_length = get_length_method ? get_length_method->call<int>(vm_context, array_obj)
+            : array_obj->call<int>("GetLength", vm_context, array_obj);
+        length = array_length > 0 ? static_cast<std::size_t>(array_length) : 0;
+    }
+
+    // Creates a new managed array of element_type. The caller is responsible for add_ref if the array must outlive the frame.
+    static ManagedArrayView create(reframework::API *api, reframework::API::TypeDefinition *element_type, std::size_t count) {
+        ManagedArrayView view;
+
+        if (!api || !element_type) {
+            return view;
+        }
+
+        view.array_obj = api->create_managed_array(element_type, static_cast<std::uint32_t>(count));
+        view.length = view.array_obj ? count : 0;
+
+        return view;
+    }
+
+    bool valid() const {
+        return array_obj != nullptr;
+    }
+
+    reframework::API::ManagedObject *object() const {
+        return array_obj;
+    }
+
+    std::size_t size() const {
+        return length;
+    }
+
+    T *data() const {
+        return get_array_ptr<T>(array_obj);
+    }
+
+    std::span<T> span() const {
+        if (!array_obj) {
+            return {};
+        }
+
+        return std::span<T>(data(), length);
+    }
+
+    // Empty span when the range does not fit inside the array
+    std::span<T> subspan(std::size_t offset, std::size_t count) const {
+        if (offset > length || count > length - offset) {
+            return {};
+        }
+
+        return span().subspan(offset, count);
+    }
+
+    // Null when index is out of range
+    T *at(std::size_t index) const {
+        if (index >= length) {
+            return nullptr;
+        }
+
+        return data() + index;
+    }
+
+    // Copies the whole array into destination, which must be at least size() elements
+    bool copy_to(std::span<T> destination) const {
+        if (!array_obj || destination.size() < length) {
+            return false;
+        }
+
+        std::memcpy(destination.data(), data(), length * sizeof(T));
+        return true;
+    }
+
+    // Copies source into the array starting at offset, fails if it does not fit
+    bool copy_from(std::span<const T> source, std::size_t offset = 0) const {
+        auto destination = subspan(offset, source.size());
+
+        if (destination.size() != source.size()) {
+            return false;
+        }
+
+        std::memcpy(destination.data(), source.data(), source.size() * sizeof(T));
+        return true;
+    }
+};
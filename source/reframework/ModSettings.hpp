@@ -1,6 +1,8 @@
 #pragma once
 
 #include "QuestResultHQBackgroundMode.hpp"
+#include <chrono>
+#include <cstddef>
 #include <string>
 
 enum PhotoModeImageQuality {
@@ -14,6 +16,38 @@ enum PhotoModeImageQuality {
     PhotoModeImageQuality_HighQualityApplyFilters = 2,
 };
 
+enum CaptureFrameMergeMode {
+    // Capture a single frame
+    CaptureFrameMergeMode_Off = 0,
+
+    // Average capture_frame_merge_count consecutive frames
+    CaptureFrameMergeMode_Mean = 1,
+
+    // Per pixel median of 3 consecutive frames, drops what only one frame has
+    CaptureFrameMergeMode_MedianOf3 = 2,
+};
+
+enum CaptureArchiveFormat {
+    // Fast zlib settings, a bit larger than a regular PNG
+    CaptureArchiveFormat_PNG = 0,
+
+    CaptureArchiveFormat_LosslessWebP = 1,
+
+    // PNG, and HDR captures also keep the 16-bit PNG the ReShade add-on saved
+    CaptureArchiveFormat_HDRPNG = 2,
+};
+
+enum DebugDumpFormat {
+    // PNG without compression, about as fast as copying the frame to disk
+    DebugDumpFormat_StoredPNG = 0,
+
+    // Raw pixels behind a text header, the fastest but fewer viewers open it
+    DebugDumpFormat_PAM = 1,
+
+    // Regular PNG, slow enough to change the capture timing
+    DebugDumpFormat_CompressedPNG = 2,
+};
+
 struct ModSettings {
     bool enable_override_album_image = false;
 
@@ -36,6 +70,11 @@ struct ModSettings {
     // synchronously perform (we cant blame them, the image they produced is usually very light and small-size)
     bool use_lossless_image_for_quest_result = true;
 
+    // How long the game may spend decoding the quest result background. The mod measures the decode time of lossless,
+    // near-lossless and high quality lossy encodings on this machine and uses the best looking one that fits.
+    // 0 always uses lossless, whatever the decode time
+    float quest_result_decode_budget_ms = 8.0f;
+
     // For album image, the image size must not exceed 1MB. The quality can be adjusted
     // so that the image size is less than 1MB. Normally the mod will try to do 100% lossy compression, then
     // go 10% lower when the image size does not fit the requirements, but by setting this to, for example 50%,
@@ -56,6 +95,11 @@ struct ModSettings {
 
     bool dump_mod_png = false;
 
+    DebugDumpFormat debug_dump_format = DebugDumpFormat_StoredPNG;
+
+    // Compresses the uncompressed PNG dump once the capture is done, in the background
+    bool recompress_debug_dumps_when_idle = false;
+
     bool disable_mod = false;
 
     bool hide_chat_notification = true;
@@ -73,12 +117,50 @@ struct ModSettings {
 
     int freeze_game_frames = 5;
 
+    // Capture as soon as consecutive frames stop changing during the freeze, freeze_game_frames becomes the upper bound
+    bool capture_when_scene_settled = true;
+
+    // Merges consecutive frozen frames into the quest result image, so frame generation or TAA noise of a single frame
+    // is not baked into it. They are the last frames of the freeze. SDR only, HDR captures a single frame
+    CaptureFrameMergeMode capture_frame_merge_mode = CaptureFrameMergeMode_Off;
+
+    int capture_frame_merge_count = 4;
+
+    // Creates the high resolution capture render target for this screen as soon as a quest ends. When off, it is only created
+    // once the capture swaps it in. Either way it is released when the quest result screen closes
+    bool prefetch_capture_render_target = true;
+
+    // Creates a capture render target of exactly the picture the game draws, cloned from the nearest installed one of the HD
+    // capture pack. The capture is then injected as is instead of being resampled. Needs the pack unpacked as loose files,
+    // falls back to the nearest one otherwise. Off until it is tried on more setups
+    bool exact_resolution_capture_render_target = false;
+
+    // Keeps every quest result capture at the native resolution, before any crop or resize, in capture_archive_directory.
+    // Written in the background at the lowest priority, a capture is skipped rather than delaying the quest result image
+    bool archive_captures = false;
+
+    std::string capture_archive_directory;
+
+    CaptureArchiveFormat capture_archive_format = CaptureArchiveFormat_PNG;
+
+    // Limits the pixel buffers of the capture (copy, crop, resize, merge). This plugin and the ReShade add-on each get this budget.
+    // They are kept between captures and freed once unused for the idle time. Large pages need the "Lock pages in memory" privilege
+    int pixel_buffer_budget_mb = 512;
+
+    int pixel_buffer_idle_release_seconds = 30;
+
+    bool pixel_buffer_large_pages = false;
+
     bool debug_capture_delay = false;
 
     float simulate_capture_delay_seconds = 17.0f;
 
     bool heavy_debug_logging = false;
 
+    // Records what the capture state machines see and decide every frame, to be saved from the debug menu and replayed
+    // with MHWildsCaptureReplay
+    bool record_capture_trace = false;
+
     // When enabled, black bars (letterboxing/pillarboxing) are cropped out of the captured
     // screenshot before it is resized to the target resolution. Useful when the game renders
     // a wider aspect ratio (eg 21:9) on a monitor that doesn't support it (eg 16:9), which
@@ -95,6 +177,7 @@ struct ModSettings {
             enable_override_quest_cancel != clone.enable_override_quest_cancel ||
             override_quest_headback_background_path != clone.override_quest_headback_background_path ||
             use_lossless_image_for_quest_result != clone.use_lossless_image_for_quest_result ||
+            quest_result_decode_budget_ms != clone.quest_result_decode_budget_ms ||
             max_album_image_quality != clone.max_album_image_quality ||
             hdr_bits != clone.hdr_bits ||
             disable_high_quality_screen_capture != clone.disable_high_quality_screen_capture ||
@@ -104,16 +187,38 @@ struct ModSettings {
             quest_result_hq_background_mode != clone.quest_result_hq_background_mode ||
             hide_ui_before_capture_frame_count != clone.hide_ui_before_capture_frame_count ||
             dump_mod_png != clone.dump_mod_png ||
+            debug_dump_format != clone.debug_dump_format ||
+            recompress_debug_dumps_when_idle != clone.recompress_debug_dumps_when_idle ||
             hide_chat_notification != clone.hide_chat_notification ||
             auto_fix_quest_result_brightness != clone.auto_fix_quest_result_brightness ||
             fix_framegen_artifacts != clone.fix_framegen_artifacts ||
             freeze_game_frames != clone.freeze_game_frames ||
+            capture_when_scene_settled != clone.capture_when_scene_settled ||
+            capture_frame_merge_mode != clone.capture_frame_merge_mode ||
+            capture_frame_merge_count != clone.capture_frame_merge_count ||
+            prefetch_capture_render_target != clone.prefetch_capture_render_target ||
+            exact_resolution_capture_render_target != clone.exact_resolution_capture_render_target ||
+            archive_captures != clone.archive_captures ||
+            capture_archive_directory != clone.capture_archive_directory ||
+            capture_archive_format != clone.capture_archive_format ||
+            pixel_buffer_budget_mb != clone.pixel_buffer_budget_mb ||
+            pixel_buffer_idle_release_seconds != clone.pixel_buffer_idle_release_seconds ||
+            pixel_buffer_large_pages != clone.pixel_buffer_large_pages ||
             simulate_capture_delay_seconds != clone.simulate_capture_delay_seconds ||
             debug_capture_delay != clone.debug_capture_delay ||
             heavy_debug_logging != clone.heavy_debug_logging ||
+            record_capture_trace != clone.record_capture_trace ||
             crop_black_bars != clone.crop_black_bars;
     }
 
+    std::size_t get_pixel_buffer_budget_bytes() const {
+        return static_cast<std::size_t>(pixel_buffer_budget_mb) * 1024 * 1024;
+    }
+
+    std::chrono::milliseconds get_pixel_buffer_idle_timeout() const {
+        return std::chrono::seconds(pixel_buffer_idle_release_seconds);
+    }
+
     bool is_high_quality_photo_mode_enabled() const {
         return !is_disable_high_quality_screen_capture() && (photo_mode_image_quality == PhotoModeImageQuality_DoNotModify);
     }
@@ -126,10 +231,15 @@ struct ModSettings {
 #endif
     }
 
+    // The quest result always goes through the decode budgeted encoder, it picks between lossless and lossy itself
     bool get_use_lossless_image_for_quest_result() const {
         return true;
     }
 
+    float get_quest_result_decode_budget_ms() const {
+        return quest_result_decode_budget_ms;
+    }
+
     PhotoModeImageQuality get_photo_mode_image_quality() const {
 #ifdef ENABLE_HIGH_QUALITY_PHOTO_MODE
         return photo_mode_image_quality;
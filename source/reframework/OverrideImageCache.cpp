@@ -0,0 +1,726 @@
+#include "OverrideImageCache.hpp"
+#include "MHWildsTypes.h"
+
+#include <webp/decode.h>
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <format>
+#include <fstream>
+
+std::unique_ptr<OverrideImageCache> override_image_cache_instance = nullptr;
+
+namespace {
+    bool read_whole_file(const std::filesystem::path &path, std::vector<std::uint8_t> &data) {
+        std::error_code ec;
+        auto file_size = std::filesystem::file_size(path, ec);
+
+        if (ec) {
+            return false;
+        }
+
+        std::ifstream file(path, std::ios::binary);
+
+        if (!file) {
+            return false;
+        }
+
+        data.resize(static_cast<std::size_t>(file_size));
+        return static_cast<bool>(file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size())));
+    }
+}
+
+OverrideImageCache::OverrideImageCache(reframework::API *api, std::filesystem::path transcode_cache_dir)
+    : api(api)
+    , transcode_cache_dir(std::move(transcode_cache_dir)) {
+    poll_thread = std::jthread([this](std::stop_token stop_token) {
+        poll_thread_main(stop_token);
+    });
+
+    transcode_thread = std::jthread([this](std::stop_token stop_token) {
+        transcode_thread_main(stop_token);
+    });
+}
+
+OverrideImageCache::~OverrideImageCache() {
+    poll_thread.request_stop();
+    poll_cv.notify_all();
+
+    transcode_thread.request_stop();
+    transcode_cv.notify_all();
+}
+
+void OverrideImageCache::poll_thread_main(std::stop_token stop_token) {
+    while (!stop_token.stop_requested()) {
+        std::vector<std::pair<std::string, bool>> paths_to_poll;
+
+        {
+            std::unique_lock lock(watched_mutex);
+
+            poll_cv.wait_for(lock, stop_token, POLL_INTERVAL, [this]() { return poll_requested; });
+            poll_requested = false;
+
+            auto now = std::chrono::steady_clock::now();
+
+            for (const auto &watched_path : watched) {
+                if (now - watched_path.last_viewed < WATCH_EXPIRE) {
+                    paths_to_poll.emplace_back(watched_path.path, watched_path.limit_size);
+                }
+            }
+
+            for (const auto &configured_path : configured) {
+                if (std::find(paths_to_poll.begin(), paths_to_poll.end(), configured_path) == paths_to_poll.end()) {
+                    paths_to_poll.push_back(configured_path);
+                }
+            }
+        }
+
+        for (const auto &[path, limit_size] : paths_to_poll) {
+            if (stop_token.stop_requested()) {
+                return;
+            }
+
+            auto info = refresh(path, limit_size);
+
+            {
+                std::scoped_lock lock(watched_mutex);
+
+                for (auto &watched_path : watched) {
+                    if (watched_path.path == path) {
+                        watched_path.info = info;
+                        break;
+                    }
+                }
+            }
+
+            update_watched_thumbnail(path, limit_size, info);
+        }
+    }
+}
+
+void OverrideImageCache::update_watched_thumbnail(const std::string &path, bool limit_size, const OverrideImageInfo &info) {
+    bool need_decode = false;
+
+    {
+        std::scoped_lock lock(watched_mutex);
+
+        for (auto &watched_path : watched) {
+            if (watched_path.path != path) {
+                continue;
+            }
+
+            if (info.status != OverrideImageStatus::Ready) {
+                watched_path.thumbnail = nullptr;
+            } else {
+                need_decode = (watched_path.thumbnail == nullptr) || (watched_path.thumbnail->source_file_size != info.file_size) ||
+                    (watched_path.thumbnail->source_last_write_time != info.last_write_time);
+            }
+
+            break;
+        }
+    }
+
+    if (!need_decode) {
+        return;
+    }
+
+    // Decoded without holding the lock, the UI keeps showing the previous thumbnail meanwhile
+    auto thumbnail = decode_thumbnail(path, limit_size, info);
+
+    std::scoped_lock lock(watched_mutex);
+
+    for (auto &watched_path : watched) {
+        if (watched_path.path == path) {
+            watched_path.thumbnail = std::move(thumbnail);
+            break;
+        }
+    }
+}
+
+void OverrideImageCache::transcode_thread_main(std::stop_token stop_token) {
+    while (!stop_token.stop_requested()) {
+        TranscodeJob job;
+
+        {
+            std::unique_lock lock(transcode_mutex);
+
+            if (!transcode_cv.wait(lock, stop_token, [this]() { return !transcode_jobs.empty(); })) {
+                return;
+            }
+
+            job = std::move(transcode_jobs.front());
+            transcode_jobs.pop_front();
+        }
+
+        run_transcode_job(job);
+    }
+}
+
+void OverrideImageCache::request_transcode_if_needed(const std::string &path, Entry &entry, bool limit_size) {
+    if (!entry.transcodable || get_source_status(entry, limit_size) == OverrideImageStatus::Ready) {
+        return;
+    }
+
+    auto budget_index = get_budget_index(limit_size);
+    auto &variant = entry.transcoded[budget_index];
+
+    if (variant.state != TranscodeState::None) {
+        return;
+    }
+
+    variant.state = TranscodeState::Pending;
+
+    {
+        std::scoped_lock lock(transcode_mutex);
+        transcode_jobs.push_back(TranscodeJob{ path, entry.file_size, entry.last_write_time, budget_index });
+    }
+
+    transcode_cv.notify_one();
+}
+
+void OverrideImageCache::run_transcode_job(const TranscodeJob &job) {
+    std::shared_ptr<const std::vector<std::uint8_t>> source;
+    TranscodeTarget target;
+
+    {
+        std::scoped_lock lock(entries_mutex);
+        auto it = entries.find(job.path);
+
+        // Changed or evicted since the job was queued, the new version queues its own
+        if (it == entries.end() || it->second.file_size != job.file_size || it->second.last_write_time != job.last_write_time) {
+            return;
+        }
+
+        source = it->second.data;
+        target = get_transcode_target(it->second, job.budget_index);
+    }
+
+    auto hash = ImageTranscoder::content_hash(source->data(), source->size(), target);
+    auto cached_path = transcode_cache_dir / std::format("{:016x}.webp", hash);
+
+    std::vector<std::uint8_t> result;
+    std::error_code ec;
+
+    if (std::filesystem::exists(cached_path, ec) && read_whole_file(cached_path, result)) {
+        // Keep recently used conversions away from pruning
+        std::filesystem::last_write_time(cached_path, std::filesystem::file_time_type::clock::now(), ec);
+
+        api->log_info("Using converted override image %s for %s", cached_path.string().c_str(), job.path.c_str());
+    } else {
+        auto transcode_result = ImageTranscoder::transcode(source->data(), source->size(), target);
+
+        if (!transcode_result.success) {
+            api->log_error("Failed to convert override image %s: %s", job.path.c_str(), transcode_result.error.c_str());
+            result.clear();
+        } else {
+            api->log_info("Converted override image %s from %dx%d to %dx%d, quality %d, %zu bytes (%d encodes)", job.path.c_str(),
+                transcode_result.source_width, transcode_result.source_height, target.width, target.height, transcode_result.quality,
+                transcode_result.webp.size(), transcode_result.encode_attempts);
+
+            result = std::move(transcode_result.webp);
+
+            // Written aside then renamed, a crash mid-write must not leave a truncated file under a valid name
+            std::filesystem::create_directories(transcode_cache_dir, ec);
+
+            auto temp_path = cached_path;
+            temp_path += ".tmp";
+
+            std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+
+            if (file.write(reinterpret_cast<const char*>(result.data()), static_cast<std::streamsize>(result.size()))) {
+                file.close();
+                std::filesystem::rename(temp_path, cached_path, ec);
+
+                prune_transcode_cache_dir();
+            } else {
+                file.close();
+                std::filesystem::remove(temp_path, ec);
+            }
+        }
+    }
+
+    {
+        std::scoped_lock lock(entries_mutex);
+        auto it = entries.find(job.path);
+
+        if (it == entries.end() || it->second.file_size != job.file_size || it->second.last_write_time != job.last_write_time) {
+            return;
+        }
+
+        auto &variant = it->second.transcoded[job.budget_index];
+
+        if (result.empty()) {
+            variant.state = TranscodeState::Failed;
+        } else {
+            variant.state = TranscodeState::Ready;
+            variant.width = target.width;
+            variant.height = target.height;
+            variant.data = std::make_shared<const std::vector<std::uint8_t>>(std::move(result));
+        }
+    }
+
+    // Let the UI pick up the new status without waiting for the next poll
+    {
+        std::scoped_lock lock(watched_mutex);
+        poll_requested = true;
+    }
+
+    poll_cv.notify_one();
+}
+
+void OverrideImageCache::prune_transcode_cache_dir() {
+    std::error_code ec;
+    std::vector<std::pair<std::filesystem::file_time_type, std::filesystem::path>> files;
+
+    for (const auto &dir_entry : std::filesystem::directory_iterator(transcode_cache_dir, ec)) {
+        if (dir_entry.is_regular_file(ec) && dir_entry.path().extension() == ".webp") {
+            files.emplace_back(dir_entry.last_write_time(ec), dir_entry.path());
+        }
+    }
+
+    if (files.size() <= MAX_TRANSCODED_FILES) {
+        return;
+    }
+
+    std::sort(files.begin(), files.end());
+
+    for (std::size_t i = 0; i < files.size() - MAX_TRANSCODED_FILES; i++) {
+        std::filesystem::remove(files[i].second, ec);
+    }
+}
+
+std::shared_ptr<const OverrideImageThumbnail> OverrideImageCache::decode_thumbnail(const std::string &path, bool limit_size, const OverrideImageInfo &info) {
+    // The same image that would be injected, converted or not
+    auto data = acquire(path, limit_size);
+
+    if (data.empty() || info.width <= 0 || info.height <= 0) {
+        return nullptr;
+    }
+
+    // Fit in the thumbnail box, keeping the aspect ratio
+    float scale = std::min(static_cast<float>(THUMBNAIL_MAX_WIDTH) / static_cast<float>(info.width),
+        static_cast<float>(THUMBNAIL_MAX_HEIGHT) / static_cast<float>(info.height));
+
+    scale = std::min(scale, 1.0f);
+
+    WebPDecoderConfig config;
+
+    if (!WebPInitDecoderConfig(&config)) {
+        return nullptr;
+    }
+
+    // Scaling is done inside the decoder, the full size image is never produced
+    config.options.use_scaling = 1;
+    config.options.scaled_width = std::max(1, static_cast<int>(static_cast<float>(info.width) * scale));
+    config.options.scaled_height = std::max(1, static_cast<int>(static_cast<float>(info.height) * scale));
+    config.options.no_fancy_upsampling = 1;
+    config.output.colorspace = MODE_RGBA;
+
+    if (WebPDecode(data.data(), data.size(), &config) != VP8_STATUS_OK) {
+        api->log_info("Failed to decode thumbnail of override image: %s", path.c_str());
+        return nullptr;
+    }
+
+    auto thumbnail = std::make_shared<OverrideImageThumbnail>();
+
+    thumbnail->width = config.output.width;
+    thumbnail->height = config.output.height;
+    thumbnail->source_file_size = info.file_size;
+    thumbnail->source_last_write_time = info.last_write_time;
+    thumbnail->pixels.resize(static_cast<std::size_t>(thumbnail->width) * static_cast<std::size_t>(thumbnail->height));
+
+    const auto &rgba = config.output.u.RGBA;
+
+    for (int y = 0; y < thumbnail->height; y++) {
+        auto row = rgba.rgba + static_cast<std::size_t>(y) * static_cast<std::size_t>(rgba.stride);
+
+        for (int x = 0; x < thumbnail->width; x++) {
+            auto pixel = row + x * 4;
+
+            thumbnail->pixels[static_cast<std::size_t>(y) * thumbnail->width + x] = static_cast<std::uint32_t>(pixel[0]) |
+                (static_cast<std::uint32_t>(pixel[1]) << 8) | (static_cast<std::uint32_t>(pixel[2]) << 16) | (static_cast<std::uint32_t>(pixel[3]) << 24);
+        }
+    }
+
+    WebPFreeDecBuffer(&config.output);
+
+    return thumbnail;
+}
+
+void OverrideImageCache::load_entry(const std::string &path, Entry &entry) {
+    std::ifstream file(std::filesystem::path(path), std::ios::binary);
+
+    if (!file) {
+        api->log_info("Failed to open override image: %s", path.c_str());
+        entry.load_status = OverrideImageStatus::ReadFailed;
+        return;
+    }
+
+    // One read of the whole file instead of going through it char by char
+    std::vector<std::uint8_t> data(static_cast<std::size_t>(entry.file_size));
+
+    if (!file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size()))) {
+        api->log_info("Failed to read override image: %s", path.c_str());
+        entry.load_status = OverrideImageStatus::ReadFailed;
+        return;
+    }
+
+    ImageTranscoder::get_dimensions(data.data(), data.size(), entry.width, entry.height);
+
+    auto source_format = ImageTranscoder::detect_format(data.data(), data.size());
+
+    entry.transcodable = (source_format != ImageSourceFormat::Unknown);
+    entry.data = std::make_shared<const std::vector<std::uint8_t>>(std::move(data));
+
+    if (source_format != ImageSourceFormat::WebP) {
+        entry.load_status = OverrideImageStatus::NotWebP;
+
+        if (entry.transcodable) {
+            api->log_info("Override image is not a WebP, it will be converted: %s (%dx%d)", path.c_str(), entry.width, entry.height);
+        } else {
+            api->log_info("Override image is not a WebP, PNG or JPEG: %s", path.c_str());
+        }
+
+        return;
+    }
+
+    WebPBitstreamFeatures features;
+
+    if (WebPGetFeatures(entry.data->data(), entry.data->size(), &features) != VP8_STATUS_OK) {
+        api->log_info("Override image is not a valid WebP: %s", path.c_str());
+
+        entry.load_status = OverrideImageStatus::NotWebP;
+        entry.transcodable = false;
+
+        return;
+    }
+
+    if (features.has_animation) {
+        api->log_info("Override image is an animated WebP, which the game can't show: %s", path.c_str());
+
+        entry.load_status = OverrideImageStatus::Animated;
+        entry.transcodable = false;
+
+        return;
+    }
+
+    entry.encoding = (features.format == 2) ? OverrideImageEncoding::Lossless
+        : (features.format == 1) ? OverrideImageEncoding::Lossy : OverrideImageEncoding::Unknown;
+    entry.load_status = OverrideImageStatus::Ready;
+
+    api->log_info("Cached override image %s (%dx%d, %zu bytes)", path.c_str(), entry.width, entry.height, entry.data->size());
+}
+
+void OverrideImageCache::evict_if_full() {
+    while (entries.size() >= MAX_ENTRIES) {
+        auto oldest = entries.begin();
+
+        for (auto it = entries.begin(); it != entries.end(); it++) {
+            if (it->second.last_use < oldest->second.last_use) {
+                oldest = it;
+            }
+        }
+
+        entries.erase(oldest);
+    }
+}
+
+OverrideImageStatus OverrideImageCache::get_source_status(const Entry &entry, bool limit_size) {
+    if (entry.load_status != OverrideImageStatus::Ready) {
+        return entry.load_status;
+    }
+
+    if (limit_size && entry.file_size > MaxSerializePhotoSizeOriginal) {
+        return OverrideImageStatus::TooLarge;
+    }
+
+    auto is_aspect = [&entry](float target_aspect) {
+        float aspect = static_cast<float>(entry.width) / static_cast<float>(std::max(entry.height, 1));
+        return std::abs(aspect - target_aspect) <= ASPECT_TOLERANCE * target_aspect;
+    };
+
+    if (!is_aspect(16.0f / 9.0f) && !is_aspect(64.0f / 27.0f)) {
+        return OverrideImageStatus::WrongDimensions;
+    }
+
+    return OverrideImageStatus::Ready;
+}
+
+TranscodeTarget OverrideImageCache::get_transcode_target(const Entry &entry, std::size_t budget_index) {
+    TranscodeTarget target;
+
+    // Whichever of 16:9 and 21:9 is closer to the source, so the crop loses the least
+    float aspect = static_cast<float>(entry.width) / static_cast<float>(std::max(entry.height, 1));
+    bool is_wide = aspect > (16.0f / 9.0f + 64.0f / 27.0f) * 0.5f;
+
+    target.width = is_wide ? 2560 : 1920;
+    target.height = 1080;
+    target.max_bytes = (budget_index == get_budget_index(true)) ? MaxSerializePhotoSizeOriginal : MaxSerializePhotoSize;
+
+    return target;
+}
+
+OverrideImageInfo OverrideImageCache::make_info(const Entry &entry, bool limit_size) {
+    OverrideImageInfo info;
+
+    info.status = get_source_status(entry, limit_size);
+    info.width = entry.width;
+    info.height = entry.height;
+    info.file_size = entry.file_size;
+    info.last_write_time = entry.last_write_time;
+    info.encoding = entry.encoding;
+
+    if (info.status == OverrideImageStatus::Ready || !entry.transcodable) {
+        return info;
+    }
+
+    const auto &variant = entry.transcoded[get_budget_index(limit_size)];
+
+    switch (variant.state) {
+        case TranscodeState::Ready:
+            info.status = OverrideImageStatus::Ready;
+            info.transcoded = true;
+            info.width = variant.width;
+            info.height = variant.height;
+            info.file_size = variant.data->size();
+            info.encoding = OverrideImageEncoding::Lossy;
+            break;
+        case TranscodeState::Pending:
+            info.status = OverrideImageStatus::Transcoding;
+            break;
+        case TranscodeState::Failed:
+            info.status = OverrideImageStatus::TranscodeFailed;
+            break;
+        default:
+            break;
+    }
+
+    return info;
+}
+
+OverrideImageInfo OverrideImageCache::refresh(const std::string &path, bool limit_size) {
+    if (path.empty()) {
+        return OverrideImageInfo{};
+    }
+
+    std::error_code ec;
+    std::filesystem::path fs_path(path);
+
+    auto file_size = std::filesystem::file_size(fs_path, ec);
+
+    if (ec) {
+        std::scoped_lock lock(entries_mutex);
+        entries.erase(path);
+
+        return OverrideImageInfo{ OverrideImageStatus::NotFound };
+    }
+
+    auto last_write_time = std::filesystem::last_write_time(fs_path, ec).time_since_epoch().count();
+
+    {
+        std::scoped_lock lock(entries_mutex);
+        auto it = entries.find(path);
+
+        if (it != entries.end() && it->second.file_size == file_size && it->second.last_write_time == last_write_time) {
+            it->second.last_use = ++use_counter;
+            request_transcode_if_needed(path, it->second, limit_size);
+
+            return make_info(it->second, limit_size);
+        }
+    }
+
+    // Read outside the lock, injection of other paths should not wait on the disk
+    Entry entry;
+    entry.file_size = file_size;
+    entry.last_write_time = static_cast<std::int64_t>(last_write_time);
+
+    load_entry(path, entry);
+
+    std::scoped_lock lock(entries_mutex);
+
+    if (entries.find(path) == entries.end()) {
+        evict_if_full();
+    }
+
+    entry.last_use = ++use_counter;
+    auto &stored = entries[path] = std::move(entry);
+
+    request_transcode_if_needed(path, stored, limit_size);
+
+    return make_info(stored, limit_size);
+}
+
+OverrideImageInfo OverrideImageCache::lookup(const std::string &path, bool limit_size) {
+    if (path.empty()) {
+        return OverrideImageInfo{};
+    }
+
+    std::scoped_lock lock(entries_mutex);
+    auto it = entries.find(path);
+
+    if (it == entries.end()) {
+        return OverrideImageInfo{ OverrideImageStatus::NotFound };
+    }
+
+    it->second.last_use = ++use_counter;
+
+    return make_info(it->second, limit_size);
+}
+
+void OverrideImageCache::set_configured_paths(std::vector<std::pair<std::string, bool>> paths) {
+    std::erase_if(paths, [](const std::pair<std::string, bool> &path) { return path.first.empty(); });
+
+    {
+        std::scoped_lock lock(watched_mutex);
+
+        configured = std::move(paths);
+        poll_requested = true;
+    }
+
+    poll_cv.notify_one();
+}
+
+OverrideImageInfo OverrideImageCache::get_watched_info(const std::string &path, bool limit_size) {
+    if (path.empty()) {
+        return OverrideImageInfo{};
+    }
+
+    std::scoped_lock lock(watched_mutex);
+    auto now = std::chrono::steady_clock::now();
+
+    for (auto &watched_path : watched) {
+        if (watched_path.path == path) {
+            watched_path.last_viewed = now;
+
+            if (watched_path.limit_size != limit_size) {
+                watched_path.limit_size = limit_size;
+                poll_requested = true;
+                poll_cv.notify_one();
+            }
+
+            return watched_path.info;
+        }
+    }
+
+    // Drop the path shown the longest time ago, the UI only shows a handful at once
+    if (watched.size() >= MAX_ENTRIES) {
+        auto oldest = std::min_element(watched.begin(), watched.end(), [](const WatchedPath &a, const WatchedPath &b) {
+            return a.last_viewed < b.last_viewed;
+        });
+
+        watched.erase(oldest);
+    }
+
+    watched.push_back(WatchedPath{ path, limit_size, OverrideImageInfo{ OverrideImageStatus::Checking }, nullptr, now });
+
+    // Don't make the user wait a full interval for a newly picked file
+    poll_requested = true;
+    poll_cv.notify_one();
+
+    return watched.back().info;
+}
+
+std::shared_ptr<const OverrideImageThumbnail> OverrideImageCache::get_watched_thumbnail(const std::string &path) {
+    std::scoped_lock lock(watched_mutex);
+
+    for (const auto &watched_path : watched) {
+        if (watched_path.path == path) {
+            return watched_path.thumbnail;
+        }
+    }
+
+    return nullptr;
+}
+
+WebPDataBuffer OverrideImageCache::acquire(const std::string &path, bool limit_size) {
+    std::scoped_lock lock(entries_mutex);
+    auto it = entries.find(path);
+
+    if (it == entries.end()) {
+        return WebPDataBuffer{};
+    }
+
+    it->second.last_use = ++use_counter;
+
+    if (get_source_status(it->second, limit_size) == OverrideImageStatus::Ready) {
+        return WebPDataBuffer::share(it->second.data);
+    }
+
+    const auto &variant = it->second.transcoded[get_budget_index(limit_size)];
+
+    if (variant.state == TranscodeState::Ready) {
+        return WebPDataBuffer::share(variant.data);
+    }
+
+    return WebPDataBuffer{};
+}
+
+std::size_t OverrideImageCache::get_cached_bytes() {
+    std::scoped_lock lock(entries_mutex);
+    std::size_t total = 0;
+
+    for (const auto &[path, entry] : entries) {
+        if (entry.data) {
+            total += entry.data->size();
+        }
+
+        for (const auto &variant : entry.transcoded) {
+            if (variant.data) {
+                total += variant.data->size();
+            }
+        }
+    }
+
+    return total;
+}
+
+const char *OverrideImageCache::get_status_message(OverrideImageStatus status) {
+    switch (status) {
+        case OverrideImageStatus::Ready:
+            return "OK";
+        case OverrideImageStatus::Checking:
+            return "Checking the image...";
+        case OverrideImageStatus::Transcoding:
+            return "Converting the image in the background...";
+        case OverrideImageStatus::NoPath:
+            return "No image selected";
+        case OverrideImageStatus::NotFound:
+            return "The image does not exist anymore";
+        case OverrideImageStatus::TooLarge:
+            return "The image is too big";
+        case OverrideImageStatus::ReadFailed:
+            return "The image can't be read";
+        case OverrideImageStatus::NotWebP:
+            return "The image is not a valid WebP, PNG or JPEG";
+        case OverrideImageStatus::Animated:
+            return "Animated WebP is not supported";
+        case OverrideImageStatus::WrongDimensions:
+            return "The image is not 16:9 or 21:9";
+        case OverrideImageStatus::TranscodeFailed:
+            return "The image could not be converted to fit the game's limits";
+        default:
+            return "Unknown";
+    }
+}
+
+const char *OverrideImageCache::get_encoding_name(OverrideImageEncoding encoding) {
+    switch (encoding) {
+        case OverrideImageEncoding::Lossy:
+            return "Lossy";
+        case OverrideImageEncoding::Lossless:
+            return "Lossless";
+        default:
+            return "Mixed/Unknown";
+    }
+}
+
+OverrideImageCache *OverrideImageCache::get_instance() {
+    return override_image_cache_instance ? override_image_cache_instance.get() : nullptr;
+}
+
+void OverrideImageCache::initialize(reframework::API *api, const std::filesystem::path &transcode_cache_dir) {
+    if (override_image_cache_instance == nullptr) {
+        override_image_cache_instance = std::unique_ptr<OverrideImageCache>(new OverrideImageCache(api, transcode_cache_dir));
+    }
+}
@@ -0,0 +1,219 @@
+#pragma once
+
+#include <reframework/API.hpp>
+
+#include "WebPCaptureInjectClient.hpp"
+#include "ImageTranscoder.hpp"
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+enum class OverrideImageStatus {
+    Ready,
+    Checking,
+    Transcoding,
+    NoPath,
+    NotFound,
+    TooLarge,
+    ReadFailed,
+    NotWebP,
+    Animated,
+    WrongDimensions,
+    TranscodeFailed
+};
+
+enum class OverrideImageEncoding {
+    Unknown,
+    Lossy,
+    Lossless
+};
+
+struct OverrideImageInfo {
+    OverrideImageStatus status = OverrideImageStatus::NoPath;
+    int width = 0;
+    int height = 0;
+    std::uintmax_t file_size = 0;
+    std::int64_t last_write_time = 0;
+    OverrideImageEncoding encoding = OverrideImageEncoding::Unknown;
+
+    // Served from a converted copy, the source file could not be used as is
+    bool transcoded = false;
+};
+
+// Small preview decoded with libwebp's scaled decode, pixels packed as ImU32 (ABGR) ready to be drawn
+struct OverrideImageThumbnail {
+    int width = 0;
+    int height = 0;
+    std::vector<std::uint32_t> pixels;
+
+    // The file version this was decoded from
+    std::uintmax_t source_file_size = 0;
+    std::int64_t source_last_write_time = 0;
+};
+
+// Override images (custom quest result/album photos), read and validated once per (path, size, last write time).
+// Injection is then served from memory, the file is only touched again when it changes on disk.
+// Paths shown in the settings UI are watched by a low-rate poll on a worker thread, the UI only reads the last result.
+// Images that can't be used as is (PNG/JPEG, too big for the size limit, not 16:9 or 21:9) are converted on another
+// worker, and the result is kept in a content-addressed directory so it's only ever done once per source and target.
+class OverrideImageCache {
+private:
+    // A handful of paths are configurable, anything above that is a stale path the user browsed away from
+    static constexpr std::size_t MAX_ENTRIES = 8;
+
+    static constexpr std::chrono::milliseconds POLL_INTERVAL{ 1000 };
+
+    // Paths not shown by the UI for this long are not polled anymore, until they are shown again
+    static constexpr std::chrono::seconds WATCH_EXPIRE{ 5 };
+
+    // Drawn as one rect per pixel by the settings UI, kept coarse so it stays cheap to draw every frame
+    static constexpr int THUMBNAIL_MAX_WIDTH = 24;
+    static constexpr int THUMBNAIL_MAX_HEIGHT = 14;
+
+    // Transcoded files kept on disk, the least recently written are deleted past that
+    static constexpr std::size_t MAX_TRANSCODED_FILES = 64;
+
+    // Tolerance on the aspect ratio of the source images, relative
+    static constexpr float ASPECT_TOLERANCE = 0.02f;
+
+    enum class TranscodeState {
+        None,
+        Pending,
+        Ready,
+        Failed
+    };
+
+    // One per byte budget: limited (album, photo mode) and extended (quest result)
+    static constexpr std::size_t BUDGET_COUNT = 2;
+
+    struct TranscodedVariant {
+        TranscodeState state = TranscodeState::None;
+        int width = 0;
+        int height = 0;
+        std::shared_ptr<const std::vector<std::uint8_t>> data;
+    };
+
+    struct TranscodeJob {
+        std::string path;
+        std::uintmax_t file_size;
+        std::int64_t last_write_time;
+        std::size_t budget_index;
+    };
+
+    struct Entry {
+        std::uintmax_t file_size = 0;
+        std::int64_t last_write_time = 0;
+        std::uint64_t last_use = 0;
+
+        OverrideImageStatus load_status = OverrideImageStatus::ReadFailed;
+        int width = 0;
+        int height = 0;
+        OverrideImageEncoding encoding = OverrideImageEncoding::Unknown;
+
+        // The file content, kept even if it can't be injected as is, it's the transcoder's source
+        std::shared_ptr<const std::vector<std::uint8_t>> data;
+
+        // Decodable by ImageTranscoder
+        bool transcodable = false;
+        std::array<TranscodedVariant, BUDGET_COUNT> transcoded{};
+    };
+
+    reframework::API *api = nullptr;
+    std::filesystem::path transcode_cache_dir;
+
+    std::mutex entries_mutex;
+    std::unordered_map<std::string, Entry> entries;
+    std::uint64_t use_counter = 0;
+
+    struct WatchedPath {
+        std::string path;
+        bool limit_size;
+        OverrideImageInfo info;
+        std::shared_ptr<const OverrideImageThumbnail> thumbnail;
+        std::chrono::steady_clock::time_point last_viewed;
+    };
+
+    std::mutex watched_mutex;
+    std::vector<WatchedPath> watched;
+
+    // Paths the game may inject, polled like the watched ones but never expiring
+    std::vector<std::pair<std::string, bool>> configured;
+    bool poll_requested = false;
+
+    std::condition_variable_any poll_cv;
+    std::jthread poll_thread;
+
+    std::mutex transcode_mutex;
+    std::deque<TranscodeJob> transcode_jobs;
+    std::condition_variable_any transcode_cv;
+    std::jthread transcode_thread;
+
+    explicit OverrideImageCache(reframework::API *api, std::filesystem::path transcode_cache_dir);
+
+    void load_entry(const std::string &path, Entry &entry);
+    void evict_if_full();
+    void poll_thread_main(std::stop_token stop_token);
+    void transcode_thread_main(std::stop_token stop_token);
+
+    // Called with entries_mutex held
+    void request_transcode_if_needed(const std::string &path, Entry &entry, bool limit_size);
+
+    void run_transcode_job(const TranscodeJob &job);
+    void prune_transcode_cache_dir();
+    void update_watched_thumbnail(const std::string &path, bool limit_size, const OverrideImageInfo &info);
+
+    std::shared_ptr<const OverrideImageThumbnail> decode_thumbnail(const std::string &path, bool limit_size, const OverrideImageInfo &info);
+
+    static OverrideImageInfo make_info(const Entry &entry, bool limit_size);
+
+    // Status of the source file itself, before any transcoding
+    static OverrideImageStatus get_source_status(const Entry &entry, bool limit_size);
+
+    static std::size_t get_budget_index(bool limit_size) {
+        return limit_size ? 0 : 1;
+    }
+
+    static TranscodeTarget get_transcode_target(const Entry &entry, std::size_t budget_index);
+
+public:
+    ~OverrideImageCache();
+
+    // Checks the file on disk and reloads it if the size or the last write time changed. Not for the game thread
+    OverrideImageInfo refresh(const std::string &path, bool limit_size);
+
+    // Memory only, for the game thread. The configured paths are kept up to date by the poll worker,
+    // a path it never went through reports NotFound
+    OverrideImageInfo lookup(const std::string &path, bool limit_size);
+
+    // The enabled override images. The poll worker goes through them right away, then at every interval
+    void set_configured_paths(std::vector<std::pair<std::string, bool>> paths);
+
+    // Last polled result, never touches the disk. Starts watching the path if it's not already,
+    // reporting Checking until the worker went through it once. Also starts the conversion if the image needs one
+    OverrideImageInfo get_watched_info(const std::string &path, bool limit_size);
+
+    // Null until the worker decoded it, or if the image is not usable
+    std::shared_ptr<const OverrideImageThumbnail> get_watched_thumbnail(const std::string &path);
+
+    // Memory only. Returns an empty buffer if the path was never refreshed or is not usable
+    WebPDataBuffer acquire(const std::string &path, bool limit_size);
+
+    std::size_t get_cached_bytes();
+
+    static const char *get_status_message(OverrideImageStatus status);
+    static const char *get_encoding_name(OverrideImageEncoding encoding);
+
+    static OverrideImageCache *get_instance();
+    static void initialize(reframework::API *api, const std::filesystem::path &transcode_cache_dir);
+};
@@ -6,46 +6,93 @@
 #include <mutex>
 #include <cimgui.h>
 #include <filesystem>
+#include <tuple>
+#include <utility>
+#include <vector>
 
 #undef API
 
 #include "PluginBase.hpp"
 #include "MHWildsTypes.h"
 #include "ModSettings.hpp"
+#include "ReflectionBindings.hpp"
+#include "HookManager.hpp"
+#include "CaptureTrace.hpp"
+#include "DeferredStartup.hpp"
+#include "OverrideImageCache.hpp"
 #include "WebPCaptureInjector.hpp"
 #include "REFrameworkBorrowedAPI.hpp"
-
-#include <nfd.hpp>
+#include "RingLogger.hpp"
 
 PluginBase *get_plugin_base_instance();
 
 bool PluginBase::is_override_image_path_valid(const std::string& path, bool limit_size) {
-    if (path.empty()) {
-        return false;
-    }
+    auto image_cache = OverrideImageCache::get_instance();
 
-    if (!std::filesystem::exists(path)) {
+    if (path.empty() || image_cache == nullptr) {
         return false;
     }
 
-    if (limit_size && std::filesystem::file_size(path) > MaxSerializePhotoSizeOriginal) {
+    // Memory only, the poll worker of the cache checks the file on disk
+    auto info = image_cache->lookup(path, limit_size);
+
+    if (info.status != OverrideImageStatus::Ready) {
+        reframework::API::get()->log_info("Not using override image %s: %s", path.c_str(), OverrideImageCache::get_status_message(info.status));
         return false;
     }
 
-    // No idea if this file is WebP or not, either way, the game will let us know (by corrupt cat icon)
     return true;
 }
 
-void PluginBase::open_blocking_webp_pick_file_dialog(std::string &file_path) {
-    nfdu8char_t *out_path;
-    nfdu8filteritem_t filters[2] = { { "WebP image", "webp" }, { "All files", "*" } };
+std::vector<std::pair<std::string, bool>> PluginBase::get_configured_override_images(const ModSettings &mod_settings) {
+    // Album photos are size limited, quest results are not
+    const std::tuple<bool, const std::string*, bool> override_images[] = {
+        { mod_settings.enable_override_album_image, &mod_settings.override_album_image_path, true },
+        { mod_settings.enable_override_quest_success, &mod_settings.override_quest_complete_background_path, false },
+        { mod_settings.enable_override_quest_failure, &mod_settings.override_quest_failure_background_path, false },
+        { mod_settings.enable_override_quest_cancel, &mod_settings.override_quest_headback_background_path, false },
+    };
+
+    std::vector<std::pair<std::string, bool>> paths;
+
+    for (const auto &[enabled, path, limit_size] : override_images) {
+        if (enabled && !path->empty()) {
+            paths.emplace_back(*path, limit_size);
+        }
+    }
+
+    return paths;
+}
+
+void PluginBase::update_configured_override_images() {
+    auto mod_settings = ModSettings::get_instance();
+    auto image_cache = OverrideImageCache::get_instance();
+
+    if (mod_settings != nullptr && image_cache != nullptr) {
+        image_cache->set_configured_paths(get_configured_override_images(*mod_settings));
+    }
+}
+
+void PluginBase::draw_override_image_thumbnail(const OverrideImageThumbnail &thumbnail) {
+    // A plugin can't register a texture with REFramework's ImGui backend. The thumbnail is decoded to a coarse grid of cells
+    // (see OverrideImageCache::THUMBNAIL_MAX_WIDTH), a few hundred rects at most, drawn through the window draw list
+    ImVec2 origin;
+    igGetCursorScreenPos(&origin);
+
+    auto draw_list = igGetWindowDrawList();
 
-    if (NFD::OpenDialog(out_path, filters, 2) == NFD_OKAY) {
-        file_path = out_path;
-        NFD::FreePath(out_path);
-    } else {
-        file_path.clear();
+    for (int y = 0; y < thumbnail.height; y++) {
+        float top = origin.y + static_cast<float>(y) * THUMBNAIL_CELL_SIZE;
+
+        for (int x = 0; x < thumbnail.width; x++) {
+            float left = origin.x + static_cast<float>(x) * THUMBNAIL_CELL_SIZE;
+
+            ImDrawList_AddRectFilled(draw_list, ImVec2(left, top), ImVec2(left + THUMBNAIL_CELL_SIZE, top + THUMBNAIL_CELL_SIZE),
+                thumbnail.pixels[static_cast<std::size_t>(y) * thumbnail.width + x], 0.0f, 0);
+        }
     }
+
+    igDummy(ImVec2(static_cast<float>(thumbnail.width) * THUMBNAIL_CELL_SIZE, static_cast<float>(thumbnail.height) * THUMBNAIL_CELL_SIZE));
 }
 
 void PluginBase::draw_user_interface_path(const std::string &label, std::string &target_path, bool limit_size) {
@@ -60,14 +107,40 @@ void PluginBase::draw_user_interface_path(const std::string &label, std::string
 
     igSameLine(0.0f, 5.0f);
 
-    if (igButton(name_button.c_str(), ImVec2(0, 0))) {
-        open_blocking_webp_pick_file_dialog(target_path);
+    // The dialog runs on its own thread, its result comes back here on a later frame
+    if (auto result = file_picker.take_result(label)) {
+        target_path = std::move(result->path);
+    }
+
+    if (file_picker.is_open()) {
+        if (file_picker.get_open_key() == label) {
+            igTextDisabled("Waiting for the file dialog...");
+        } else {
+            igTextDisabled("Another file dialog is open");
+        }
+    } else if (igButton(name_button.c_str(), ImVec2(0, 0))) {
+        file_picker.open(label);
     }
 
-    if (!target_path.empty()) {
-        if (!is_override_image_path_valid(target_path, limit_size)) {
-            std::string error_message = std::format("Your WebP image is either too big (size > {} KB), or corrupted or not exist anymore. Please recheck",
-                MaxSerializePhotoSizeOriginal / 1024);
+    auto image_cache = OverrideImageCache::get_instance();
+
+    if (!target_path.empty() && image_cache != nullptr) {
+        // Polled on the cache's worker thread, nothing here touches the disk
+        auto info = image_cache->get_watched_info(target_path, limit_size);
+
+        if (info.status == OverrideImageStatus::Ready) {
+            igTextDisabled("%dx%d, %llu KB, %s%s", info.width, info.height, static_cast<unsigned long long>(info.file_size / 1024),
+                OverrideImageCache::get_encoding_name(info.encoding), info.transcoded ? " (converted)" : "");
+
+            if (auto thumbnail = image_cache->get_watched_thumbnail(target_path)) {
+                draw_override_image_thumbnail(*thumbnail);
+            }
+        } else if (info.status == OverrideImageStatus::Checking || info.status == OverrideImageStatus::Transcoding) {
+            igTextDisabled("%s", OverrideImageCache::get_status_message(info.status));
+        } else {
+            std::string error_message = (info.status == OverrideImageStatus::TooLarge)
+                ? std::format("Your WebP image is too big (size > {} KB). Please recheck", MaxSerializePhotoSizeOriginal / 1024)
+                : std::format("{}. Please recheck", OverrideImageCache::get_status_message(info.status));
 
             igPushStyleColor_Vec4(ImGuiCol_Text, ImVec4(1.0f, 0.0f, 0.0f, 1.0f));
             igText(error_message.c_str());
@@ -76,6 +149,106 @@ void PluginBase::draw_user_interface_path(const std::string &label, std::string
     }
 }
 
+void PluginBase::draw_user_interface_folder(const std::string &label, std::string &target_folder) {
+    igText(label.c_str());
+    igSameLine(0.0f, 5.0f);
+
+    std::string id_input = std::format("##{}", label);
+    std::string name_button = std::format("Browse##{}", label);
+
+    igInputText(id_input.c_str(), const_cast<char*>(target_folder.c_str()), target_folder.size() + 1,
+        ImGuiInputTextFlags_ReadOnly, nullptr, nullptr);
+
+    igSameLine(0.0f, 5.0f);
+
+    // A cancelled dialog keeps the current folder
+    if (auto result = file_picker.take_result(label); result && !result->path.empty()) {
+        target_folder = std::move(result->path);
+    }
+
+    if (file_picker.is_open()) {
+        if (file_picker.get_open_key() == label) {
+            igTextDisabled("Waiting for the folder dialog...");
+        } else {
+            igTextDisabled("Another file dialog is open");
+        }
+    } else if (igButton(name_button.c_str(), ImVec2(0, 0))) {
+        file_picker.open(label, true);
+    }
+}
+
+void PluginBase::draw_startup_debug_user_interface() {
+    auto startup = DeferredStartup::get_instance();
+
+    if (startup == nullptr || !igTreeNode_Str("Startup")) {
+        return;
+    }
+
+    auto totals = startup->get_totals();
+
+    // Only the synchronous part is added to the game launch, the rest is spread over the first updates
+    igText("Game launch: %.2f ms", totals.synchronous_ms);
+    igText("Deferred: %.2f ms on the game thread over %llu updates, %.2f ms on the worker", totals.game_thread_ms,
+        static_cast<unsigned long long>(totals.game_thread_updates), totals.worker_ms);
+    igText("Ready %.1f ms after initialization", totals.complete_ms);
+
+    igSeparator();
+
+    for (const auto &entry : startup->get_report()) {
+        if (entry.stage == StartupStage::GameThread) {
+            igText("%s (%s, update %llu): %.2f ms", entry.name.c_str(), DeferredStartup::get_stage_name(entry.stage),
+                static_cast<unsigned long long>(entry.update_index), entry.duration_ms);
+        } else {
+            igText("%s (%s): %.2f ms", entry.name.c_str(), DeferredStartup::get_stage_name(entry.stage), entry.duration_ms);
+        }
+    }
+
+    igTreePop();
+}
+
+void PluginBase::draw_hook_debug_user_interface() {
+    draw_startup_debug_user_interface();
+
+    auto hook_manager = HookManager::get_instance();
+
+    if (hook_manager == nullptr) {
+        return;
+    }
+
+    if (igTreeNode_Str("Hooks")) {
+        igText("Installed hooks: %zu", hook_manager->get_installed_hook_count());
+
+        for (std::uint32_t i = 0; i < static_cast<std::uint32_t>(HookGroup::Count); i++) {
+            auto group = static_cast<HookGroup>(i);
+            igText("%s: %s", HookManager::get_group_name(group), hook_manager->is_armed(group) ? "Armed" : "Disarmed");
+        }
+
+        igSeparator();
+
+        for (const auto &stats : hook_manager->get_stats()) {
+            auto call_count = stats.call_count.load(std::memory_order_relaxed);
+            auto total_milliseconds = static_cast<double>(stats.total_nanoseconds.load(std::memory_order_relaxed)) / 1000000.0;
+
+            igText("%s: %llu calls, %.3f ms total", stats.name.c_str(), static_cast<unsigned long long>(call_count), total_milliseconds);
+        }
+
+        igTreePop();
+    }
+
+    auto ring_logger = RingLogger::get_instance();
+
+    if (ring_logger != nullptr && igTreeNode_Str("Deferred Log")) {
+        auto stats = ring_logger->get_stats();
+
+        igText("Minimum level: %s", RingLogger::get_level_name(ring_logger->get_min_level()));
+        igText("Threads: %zu", stats.thread_count);
+        igText("Recorded: %llu, dropped: %llu", static_cast<unsigned long long>(stats.recorded_count),
+            static_cast<unsigned long long>(stats.dropped_count));
+
+        igTreePop();
+    }
+}
+
 void PluginBase::base_initialize(PluginBase *plugin, const REFrameworkPluginInitializeParam *params, std::string_view settings_name,
     std::string_view debug_file_postfix) {
     auto persistent_dir = REFramework::get_persistent_dir();
@@ -84,28 +257,94 @@ void PluginBase::base_initialize(PluginBase *plugin, const REFrameworkPluginInit
         std::filesystem::create_directories(persistent_dir);
     }
 
-    auto& api = reframework::API::get();
+    auto api_instance = reframework::API::get().get();
+    auto startup = DeferredStartup::get_instance();
 
     /// THIS BELOW MUST BE FIRST
-    ModSettings::initialize(settings_name);
+    startup->run_synchronous("Settings", [settings_name]() {
+        ModSettings::initialize(settings_name);
+    });
     /// THIS ABOVE MUST BE FIRST
 
-    WebPCaptureInjector::initialize(api.get());
+    startup->run_synchronous("Logging and hook manager", [api_instance]() {
+        RingLogger::initialize(api_instance);
+        CaptureTraceRecorder::initialize();
+        HookManager::initialize(api_instance);
+    });
+
+    // Resolved before anything that hooks, the hooks read fields through it
+    startup->add_game_step("Reflection bindings", [api_instance]() {
+        ReflectionBindings::initialize(api_instance);
+    });
+
+    startup->add_game_step("WebP capture injector", [api_instance]() {
+        WebPCaptureInjector::initialize(api_instance);
+    });
+
+    startup->run_synchronous("Override image cache", [api_instance, &persistent_dir]() {
+        OverrideImageCache::initialize(api_instance, persistent_dir / "reframework/data/MHWilds_HighQualityPhotoMod_ConvertedImages");
+    });
 
     auto mod_settings = ModSettings::get_instance();
     if (mod_settings != nullptr) {
         mod_settings->debug_file_postfix = debug_file_postfix;
+
+        // Read the configured override images before the first quest end, so it does not have to. The cache is thread safe.
+        // Also starts converting the ones that can't be used as is
+        startup->add_worker_step("Override image warm-up", [warm_up_images = get_configured_override_images(*mod_settings)]() {
+            auto image_cache = OverrideImageCache::get_instance();
+
+            for (const auto &[path, limit_size] : warm_up_images) {
+                image_cache->refresh(path, limit_size);
+            }
+
+            // Kept up to date by the poll worker from now on
+            image_cache->set_configured_paths(warm_up_images);
+        });
     }
 
+    startup->run_synchronous("Callbacks", [params]() {
+        register_callbacks(params);
+    });
+}
+
+void PluginBase::register_callbacks(const REFrameworkPluginInitializeParam *params) {
     params->functions->on_imgui_draw_ui([](REFImGuiFrameCbData* data) {
         auto plugin = get_plugin_base_instance();
+        auto startup = DeferredStartup::get_instance();
+
+        // The hooks and clients the UI reads are still being set up on the game thread
+        if (startup != nullptr && !startup->is_complete()) {
+            igTextDisabled("High Quality Photo Mod is starting up...");
+            return;
+        }
 
         if (plugin != nullptr) {
             plugin->draw_user_interface();
         }
     });
 
+    // Every pre-entry is a safe point to arm/disarm hooks: none of ours is on the call stack
     params->functions->on_pre_application_entry("UpdateBehavior", []() {
+        HookManager::get_instance()->apply_pending();
+
+        auto startup = DeferredStartup::get_instance();
+        startup->update();
+
+        auto settings = ModSettings::get_instance();
+        auto trace_recorder = CaptureTraceRecorder::get_instance();
+
+        if (settings != nullptr) {
+            RingLogger::get_instance()->set_min_level(settings->heavy_debug_logging ? LogLevel::Debug : LogLevel::Info);
+            trace_recorder->set_recording(settings->record_capture_trace);
+        }
+
+        trace_recorder->advance_frame();
+
+        if (!startup->is_complete()) {
+            return;
+        }
+
         auto plugin = get_plugin_base_instance();
 
         if (plugin != nullptr) {
@@ -114,17 +353,21 @@ void PluginBase::base_initialize(PluginBase *plugin, const REFrameworkPluginInit
     });
 
     params->functions->on_pre_application_entry("LateUpdateBehavior", []() {
+        HookManager::get_instance()->apply_pending();
+
         auto plugin = get_plugin_base_instance();
 
-        if (plugin != nullptr) {
+        if (plugin != nullptr && DeferredStartup::get_instance()->is_complete()) {
             plugin->late_update();
         }
     });
 
     params->functions->on_pre_application_entry("EndRendering", []() {
+        HookManager::get_instance()->apply_pending();
+
         auto plugin = get_plugin_base_instance();
 
-        if (plugin != nullptr) {
+        if (plugin != nullptr && DeferredStartup::get_instance()->is_complete()) {
             plugin->end_rendering();
         }
     });
@@ -2,11 +2,26 @@
 
 #include <reframework/API.hpp>
 
+#include "AsyncFilePicker.hpp"
+
+#include <string>
+#include <utility>
+#include <vector>
+
 struct ModSettings;
+struct OverrideImageThumbnail;
 
 class PluginBase {
 private:
-    void open_blocking_webp_pick_file_dialog(std::string &file_path);
+    // Size of one thumbnail cell in the settings UI
+    static constexpr float THUMBNAIL_CELL_SIZE = 4.0f;
+
+    AsyncFilePicker file_picker;
+
+    void draw_override_image_thumbnail(const OverrideImageThumbnail &thumbnail);
+    void draw_startup_debug_user_interface();
+
+    static void register_callbacks(const REFrameworkPluginInitializeParam *params);
 
 protected:
     virtual void draw_user_interface() = 0;
@@ -15,12 +30,23 @@ protected:
     virtual void end_rendering() = 0;
 
     void draw_user_interface_path(const std::string &label, std::string &target_path, bool limit_size);
+    void draw_user_interface_folder(const std::string &label, std::string &target_folder);
+    void draw_hook_debug_user_interface();
 
+    // Runs the shared synchronous startup and queues the shared deferred steps, see DeferredStartup.
+    // The plugin adds its own steps afterwards, then starts the startup
     static void base_initialize(PluginBase *plugin, const REFrameworkPluginInitializeParam *params,
         std::string_view settings_name, std::string_view debug_file_postfix);
 
+    // Memory only, safe to call from the game thread
     static bool is_override_image_path_valid(const std::string& path, bool limit_size);
 
+    // The enabled override images and whether they are size limited
+    static std::vector<std::pair<std::string, bool>> get_configured_override_images(const ModSettings &mod_settings);
+
+    // Hands the enabled override images to the cache's poll worker, call after the settings changed
+    static void update_configured_override_images();
+
 public:
     explicit PluginBase() = default;
     ~PluginBase() = default;
@@ -14,8 +14,7 @@
 #include "ModSettings.hpp"
 #include "WebPCaptureInjector.hpp"
 #include "REFrameworkBorrowedAPI.hpp"
-
-#include <nfd.hpp>
+#include "DeferredStartup.hpp"
 
 std::unique_ptr<Plugin_AlbumPhoto> plugin_instance = nullptr;
 
@@ -37,12 +36,13 @@ void Plugin_AlbumPhoto::set_capture_again() {
         return;
     }
 
-    album_photo_force_client->set_requested();
+    // Saves fired back to back are queued, each one gets the image
+    album_photo_force_client->set_requested(true);
     album_photo_force_client->set_limit_size(true);
     album_photo_force_client->set_file_path(mod_settings->override_album_image_path);
 
     injector->set_inject_client(album_photo_force_client.get());
-    injector->set_inject_pending();
+    injector->set_inject_pending(true);
 }
 
 int Plugin_AlbumPhoto::pre_save_capture_photo_hook(int argc, void** argv, REFrameworkTypeDefinitionHandle* arg_tys, unsigned long long ret_addr) {
@@ -120,6 +120,15 @@ void Plugin_AlbumPhoto::draw_user_interface() {
             }
 
             igText("Path to WebP: <GameDir>/reframework/data/MHWilds_HighQualityPhotoMod_OriginalImage_PhotoMode.webp");
+
+            auto injector = WebPCaptureInjector::get_instance();
+
+            if (injector != nullptr) {
+                igText("Queued capture requests: %zu", injector->get_capture_request_count());
+            }
+
+            draw_hook_debug_user_interface();
+
             igTreePop();
         }
 
@@ -128,29 +137,44 @@ void Plugin_AlbumPhoto::draw_user_interface() {
 
         if (mod_settings->data_changed(mod_settings_copy)) {
             mod_settings->save();
+            update_configured_override_images();
         }
     }
 }
 
 Plugin_AlbumPhoto::Plugin_AlbumPhoto(const REFrameworkPluginInitializeParam *params) {
+    album_photo_force_client = std::make_unique<FileInjectClient>();
+    null_capture_client = std::make_unique<NullCaptureInjectClient>();
+
+    album_photo_force_client->set_limit_size(true);
+}
+
+void Plugin_AlbumPhoto::install_hooks() {
     auto& api = reframework::API::get();
     auto tdb = api->tdb();
 
     auto save_capture_method = tdb->find_method("app.AlbumManager", "saveCapturePhoto");
     save_capture_method->add_hook(pre_save_capture_photo_hook, post_save_capture_photo_hook, false);
-
-    album_photo_force_client = std::make_unique<FileInjectClient>();
-    null_capture_client = std::make_unique<NullCaptureInjectClient>();
-
-    album_photo_force_client->set_limit_size(true);
 }
 
 void Plugin_AlbumPhoto::initialize(const REFrameworkPluginInitializeParam *params) {
     static const char *SETTINGS_NAME = "mhwilds_custom_album_photo";
     static const char *DEBUG_FILE_POSTFIX = "PhotoMode";
 
-    plugin_instance = std::make_unique<Plugin_AlbumPhoto>(params);
+    DeferredStartup::initialize();
+    auto startup = DeferredStartup::get_instance();
+
+    startup->run_synchronous("Plugin", [params]() {
+        plugin_instance = std::make_unique<Plugin_AlbumPhoto>(params);
+    });
+
     PluginBase::base_initialize(plugin_instance.get(), params, SETTINGS_NAME, DEBUG_FILE_POSTFIX);
+
+    startup->add_game_step("Album hooks", []() {
+        plugin_instance->install_hooks();
+    });
+
+    startup->start();
 }
 
 Plugin_AlbumPhoto *Plugin_AlbumPhoto::get_instance() {
@@ -18,6 +18,9 @@ private:
 
     void set_capture_again();
 
+    // Deferred to the first game updates, see DeferredStartup
+    void install_hooks();
+
 private:
     // Hooks
     static int pre_save_capture_photo_hook(int argc, void** argv, REFrameworkTypeDefinitionHandle* arg_tys, unsigned long long ret_addr);
@@ -18,13 +18,51 @@
 #include "WebPCaptureInjector.hpp"
 #include "REFrameworkBorrowedAPI.hpp"
 #include "CaptureResolutionInject.hpp"
+#include "CaptureArchiver.hpp"
+#include "CaptureTrace.hpp"
+#include "DebugDumpWriter.hpp"
+#include "DeferredStartup.hpp"
 
 #include "GameUIController.hpp"
 
-#include <nfd.hpp>
-
 std::unique_ptr<Plugin_QuestResult> plugin_instance = nullptr;
 
+static constexpr const char *CAPTURE_TRACE_FILE_NAME = "reframework/data/MHWilds_HighQualityPhotoMod_CaptureTrace.csv";
+
+static void save_capture_trace(const CaptureTraceRecorder &recorder) {
+    auto& api = reframework::API::get();
+    auto path = REFramework::get_persistent_dir() / CAPTURE_TRACE_FILE_NAME;
+
+    std::error_code ec;
+    std::filesystem::create_directories(path.parent_path(), ec);
+
+    if (!recorder.save(path)) {
+        api->log_error("Failed to save the capture trace to %s", path.string().c_str());
+        return;
+    }
+
+    api->log_info("Saved the capture trace to %s, %zu events", path.string().c_str(), recorder.get_stats().event_count);
+}
+
+static void apply_pixel_buffer_limits(const ModSettings *mod_settings) {
+    auto reshade_addon_client = ReShadeAddOnInjectClient::get_instance();
+
+    if (reshade_addon_client != nullptr) {
+        reshade_addon_client->set_pixel_buffer_limits(mod_settings->get_pixel_buffer_budget_bytes(), mod_settings->get_pixel_buffer_idle_timeout(),
+            mod_settings->pixel_buffer_large_pages);
+    }
+}
+
+static void draw_pixel_buffer_stats(const char *owner, const PixelBufferArenaStats &stats) {
+    constexpr std::size_t MB = 1024 * 1024;
+
+    igText("%s: %zu MB in use, %zu MB kept, peak %zu / %zu MB", owner, stats.in_use_bytes / MB, stats.cached_bytes / MB, stats.peak_bytes / MB,
+        stats.budget_bytes / MB);
+    igText("    %u slabs (%u large pages), %llu allocated, %llu reused, %llu freed, %llu over budget", stats.slab_count, stats.large_page_slab_count,
+        static_cast<unsigned long long>(stats.allocation_count), static_cast<unsigned long long>(stats.reuse_count),
+        static_cast<unsigned long long>(stats.released_count), static_cast<unsigned long long>(stats.rejected_count));
+}
+
 PluginBase *get_plugin_base_instance() {
     return reinterpret_cast<PluginBase*>(plugin_instance.get());
 }
@@ -52,8 +90,12 @@ void Plugin_QuestResult::decide_and_set_screen_cap_or_override_inject(std::uniqu
 
     reshade_addon_client->set_enable(!mod_settings->is_disable_high_quality_screen_capture());
     reshade_addon_client->set_lossless(should_lossless);
+    reshade_addon_client->set_decode_budget_ms(mod_settings->get_quest_result_decode_budget_ms());
     reshade_addon_client->set_use_old_limit_size(false);
+    reshade_addon_client->set_hdr_capture_archive_directory((mod_settings->archive_captures && mod_settings->capture_archive_format == CaptureArchiveFormat_HDRPNG)
+        ? mod_settings->capture_archive_directory : std::string{});
     reshade_addon_client->set_hq_background_mode(mod_settings->quest_result_hq_background_mode);
+    apply_pixel_buffer_limits(mod_settings);
 
     if (is_photo_mode) {
         reshade_addon_client->set_is_photo_mode(true);
@@ -107,6 +149,7 @@ void Plugin_QuestResult::decide_and_set_screen_cap_or_override_inject(std::uniqu
         if (mod_settings->quest_result_hq_background_mode != QuestResultHQBackgroundMode::REEngineFrame) {
             reshade_addon_client->set_requested();
         }
+        resolution_inject->set_use_exact_resolution(mod_settings->exact_resolution_capture_render_target);
         resolution_inject->update_resolution();
     } else {
         resolution_inject->revert();
@@ -115,6 +158,18 @@ void Plugin_QuestResult::decide_and_set_screen_cap_or_override_inject(std::uniqu
     injector->set_inject_pending();
 }
 
+void Plugin_QuestResult::prefetch_capture_render_target(bool is_overriden) {
+    auto mod_settings = ModSettings::get_instance();
+    auto resolution_inject = CaptureResolutionInject::get_instance();
+
+    if (is_overriden || mod_settings->disable_mod || !mod_settings->prefetch_capture_render_target || resolution_inject == nullptr) {
+        return;
+    }
+
+    resolution_inject->set_use_exact_resolution(mod_settings->exact_resolution_capture_render_target);
+    resolution_inject->prefetch();
+}
+
 int Plugin_QuestResult::pre_quest_failure_hook(int argc, void** argv, REFrameworkTypeDefinitionHandle* arg_tys, unsigned long long ret_addr) {
     auto mod_settings = ModSettings::get_instance();
 
@@ -122,6 +177,8 @@ int Plugin_QuestResult::pre_quest_failure_hook(int argc, void** argv, REFramewor
         return REFRAMEWORK_HOOK_CALL_ORIGINAL;
     }
 
+    plugin_instance->prefetch_capture_render_target(mod_settings->enable_override_quest_failure);
+
     plugin_instance->decide_and_set_screen_cap_or_override_inject(plugin_instance->quest_failure_force_client,
         mod_settings->enable_override_quest_failure,
         mod_settings->override_quest_failure_background_path,
@@ -142,6 +199,8 @@ int Plugin_QuestResult::pre_quest_success_hook(int argc, void** argv, REFramewor
         return REFRAMEWORK_HOOK_CALL_ORIGINAL;
     }
 
+    plugin_instance->prefetch_capture_render_target(mod_settings->enable_override_quest_success);
+
     if (!mod_settings->enable_override_quest_success) {
         // If Akuma end-screen, dont bother, the game does its things
         auto &api = reframework::API::get();
@@ -191,6 +250,8 @@ int Plugin_QuestResult::pre_quest_cancel_hook(int argc, void** argv, REFramework
         return REFRAMEWORK_HOOK_CALL_ORIGINAL;
     }
 
+    plugin_instance->prefetch_capture_render_target(mod_settings->enable_override_quest_cancel);
+
     plugin_instance->decide_and_set_screen_cap_or_override_inject(plugin_instance->quest_cancel_force_client,
         mod_settings->enable_override_quest_cancel,
         mod_settings->override_quest_headback_background_path,
@@ -403,6 +464,16 @@ void Plugin_QuestResult::draw_user_interface() {
 
             igSeparator();
 
+            igText("Max Background Decode Time (ms)");
+            if (igIsItemHovered(ImGuiHoveredFlags_AllowWhenDisabled)) {
+                igSetTooltip("The game decodes the quest result background while the screen opens, a heavy image shows up as a stutter. The mod measures how long each encoding takes to decode on your PC and uses the best looking one under this time. Set to 0 to always use lossless.");
+            }
+
+            igSameLine(0.0f, 5.0f);
+            igInputFloat("##QuestResultDecodeBudgetMs", &mod_settings->quest_result_decode_budget_ms, 1.0f, 4.0f, "%.1f", ImGuiInputTextFlags_None);
+
+            igSeparator();
+
             /*
             igText("Frames hide UI before capture");
             igSameLine(0.0f, 5.0f);
@@ -415,11 +486,120 @@ void Plugin_QuestResult::draw_user_interface() {
 
             igTextWrapped("The mod needs to freeze your game for a few frames before taking the screenshot, to hide the UI and stablise frame generation output.");
 
+            igCheckbox("Capture Once Scene Settles", &mod_settings->capture_when_scene_settled);
+            if (igIsItemHovered(ImGuiHoveredFlags_AllowWhenDisabled)) {
+                igSetTooltip("Takes the screenshot as soon as the frozen frames stop changing, instead of always waiting the full freeze frame count. The freeze frame count stays the upper bound.");
+            }
+
+            igCheckbox("Load Capture Render Target When Quest Ends", &mod_settings->prefetch_capture_render_target);
+            if (igIsItemHovered(ImGuiHoveredFlags_AllowWhenDisabled)) {
+                igSetTooltip("Creates the high resolution render target the capture is drawn to as soon as the quest ends, so it is ready when the quest result screen needs it. When off, it is only created at that point. It is released when the quest result screen closes.");
+            }
+
+            igCheckbox("Capture At Exact Screen Resolution", &mod_settings->exact_resolution_capture_render_target);
+            if (igIsItemHovered(ImGuiHoveredFlags_AllowWhenDisabled)) {
+                igSetTooltip("Creates a render target of exactly the size the game draws the quest result at (your screen, or the letterboxed picture when 21:9 is enabled on a 16:9 screen), so the capture is not resized. Needs the HD capture pack unpacked as loose files, the nearest of its render targets is used otherwise.");
+            }
+
+            static const char *FRAME_MERGE_MODE_NAMES[] = { "Off", "Average", "Median of 3" };
+
+            igText("Merge Captured Frames");
+            if (igIsItemHovered(ImGuiHoveredFlags_AllowWhenDisabled)) {
+                igSetTooltip("Captures several frozen frames and merges them, so frame generation or TAA noise of a single frame does not end up in the quest result image. They are the last frames of the freeze, it does not last longer. SDR only.");
+            }
+
+            igSameLine(0.0f, 5.0f);
+
+            auto frame_merge_mode_index = std::clamp<std::size_t>(mod_settings->capture_frame_merge_mode, 0, std::size(FRAME_MERGE_MODE_NAMES) - 1);
+
+            if (igBeginCombo("##CaptureFrameMergeMode", FRAME_MERGE_MODE_NAMES[frame_merge_mode_index], ImGuiComboFlags_None)) {
+                for (std::size_t i = 0; i < std::size(FRAME_MERGE_MODE_NAMES); i++) {
+                    bool selected = frame_merge_mode_index == i;
+
+                    if (igSelectable_BoolPtr(FRAME_MERGE_MODE_NAMES[i], &selected, ImGuiSelectableFlags_None, ImVec2(0, 0))) {
+                        mod_settings->capture_frame_merge_mode = static_cast<CaptureFrameMergeMode>(i);
+                    }
+                }
+
+                igEndCombo();
+            }
+
+            if (mod_settings->capture_frame_merge_mode == CaptureFrameMergeMode_Mean) {
+                igText("Frames To Average");
+                igSameLine(0.0f, 5.0f);
+                igInputInt("##CaptureFrameMergeCount", &mod_settings->capture_frame_merge_count, 1, 1, ImGuiInputTextFlags_None);
+            }
+
             igCheckbox("Crop Black Bars", &mod_settings->crop_black_bars);
             if (igIsItemHovered(ImGuiHoveredFlags_AllowWhenDisabled)) {
                 igSetTooltip("Crops the black bars (letterboxing/pillarboxing) out of the captured screenshot before resizing it. Enable this if you play in 21:9 mode on a 16:9 screen, so the quest result image doesn't keep the black bars.");
             }
 
+            if (igTreeNode_Str("Archive Captures")) {
+                igCheckbox("Enable##ArchiveCaptures", &mod_settings->archive_captures);
+                if (igIsItemHovered(ImGuiHoveredFlags_AllowWhenDisabled)) {
+                    igSetTooltip("Saves every capture at your screen resolution to the folder below, before it is resized for the game. Written in the background, a capture is skipped rather than delaying the quest result.");
+                }
+
+                draw_user_interface_folder("Archive Folder", mod_settings->capture_archive_directory);
+
+                igText("Archive Format");
+                igSameLine(0.0f, 5.0f);
+
+                static const CaptureArchiveFormat ARCHIVE_FORMATS[] = { CaptureArchiveFormat_PNG, CaptureArchiveFormat_LosslessWebP, CaptureArchiveFormat_HDRPNG };
+
+                if (igBeginCombo("##CaptureArchiveFormat", CaptureArchiver::get_format_name(mod_settings->capture_archive_format), ImGuiComboFlags_None)) {
+                    for (auto format : ARCHIVE_FORMATS) {
+                        bool selected = mod_settings->capture_archive_format == format;
+
+                        if (igSelectable_BoolPtr(CaptureArchiver::get_format_name(format), &selected, ImGuiSelectableFlags_None, ImVec2(0, 0))) {
+                            mod_settings->capture_archive_format = format;
+                        }
+                    }
+
+                    igEndCombo();
+                }
+
+                if (mod_settings->archive_captures && mod_settings->capture_archive_directory.empty()) {
+                    igTextDisabled("Pick a folder to start archiving");
+                }
+
+                igTreePop();
+            }
+
+            if (igTreeNode_Str("Capture Memory")) {
+                igText("Budget (MB)");
+                igSameLine(0.0f, 5.0f);
+                igInputInt("##PixelBufferBudgetMB", &mod_settings->pixel_buffer_budget_mb, 64, 256, ImGuiInputTextFlags_None);
+                if (igIsItemHovered(ImGuiHoveredFlags_AllowWhenDisabled)) {
+                    igSetTooltip("Most memory the capture buffers can use, for the mod and for its ReShade add-on each. A capture that needs more fails instead.");
+                }
+
+                igText("Free After Idle (seconds)");
+                igSameLine(0.0f, 5.0f);
+                igInputInt("##PixelBufferIdleRelease", &mod_settings->pixel_buffer_idle_release_seconds, 5, 30, ImGuiInputTextFlags_None);
+                if (igIsItemHovered(ImGuiHoveredFlags_AllowWhenDisabled)) {
+                    igSetTooltip("The capture buffers are kept for the next capture, and freed once no capture used them for this long.");
+                }
+
+                igCheckbox("Use Large Pages##PixelBufferLargePages", &mod_settings->pixel_buffer_large_pages);
+                if (igIsItemHovered(ImGuiHoveredFlags_AllowWhenDisabled)) {
+                    igSetTooltip("Needs the \"Lock pages in memory\" Windows privilege, regular pages are used without it.");
+                }
+
+                draw_pixel_buffer_stats("Mod", PixelBufferArena::get().get_stats());
+
+                PixelBufferArenaStats addon_stats{};
+
+                if (reshade_addon_client && reshade_addon_client->get_addon_pixel_buffer_stats(addon_stats)) {
+                    draw_pixel_buffer_stats("ReShade Add-On", addon_stats);
+                } else {
+                    igTextDisabled("ReShade Add-On: not loaded or too old to report its buffers");
+                }
+
+                igTreePop();
+            }
+
             igCheckbox("Hide Chat Notification", &mod_settings->hide_chat_notification);
             if (igIsItemHovered(ImGuiHoveredFlags_AllowWhenDisabled)) {
                 igSetTooltip("Hide the chat icon on the top-right of your quest result screen");
@@ -459,7 +639,38 @@ void Plugin_QuestResult::draw_user_interface() {
                 igSetTooltip("This will dump the the PNG screenshot the mod captured to the game directory.");
             }
 
-            igText("Path to WebP: <GameDir>/reframework/data/MHWilds_HighQualityPhotoMod_HighQuality_QuestResult.png/webp");
+            igText("Path to WebP: <GameDir>/reframework/data/MHWilds_HighQualityPhotoMod_HighQuality_QuestResult.png/pam/webp");
+
+            igText("Dump Format");
+            igSameLine(0.0f, 5.0f);
+
+            static const DebugDumpFormat DEBUG_DUMP_FORMATS[] = { DebugDumpFormat_StoredPNG, DebugDumpFormat_PAM, DebugDumpFormat_CompressedPNG };
+
+            if (igBeginCombo("##DebugDumpFormatQR", DebugDumpWriter::get_format_name(mod_settings->debug_dump_format), ImGuiComboFlags_None)) {
+                for (auto format : DEBUG_DUMP_FORMATS) {
+                    bool selected = mod_settings->debug_dump_format == format;
+
+                    if (igSelectable_BoolPtr(DebugDumpWriter::get_format_name(format), &selected, ImGuiSelectableFlags_None, ImVec2(0, 0))) {
+                        mod_settings->debug_dump_format = format;
+                    }
+                }
+
+                igEndCombo();
+            }
+
+            igCheckbox("Compress PNG Dump After Capture##RecompressDumpQR", &mod_settings->recompress_debug_dumps_when_idle);
+            if (igIsItemHovered(ImGuiHoveredFlags_AllowWhenDisabled)) {
+                igSetTooltip("The uncompressed PNG dump is compressed in the background once the capture is done, so it does not change the capture timing.");
+            }
+
+            if (auto debug_dump_writer = DebugDumpWriter::get_instance()) {
+                auto dump_stats = debug_dump_writer->get_stats();
+
+                if (!dump_stats.last_path.empty()) {
+                    igText("Last Dump: %.0f ms, %zu waiting for compression, %llu compressed (last %.0f ms)", dump_stats.last_write_ms,
+                        dump_stats.pending_recompress_count, static_cast<unsigned long long>(dump_stats.recompressed_count), dump_stats.last_recompress_ms);
+                }
+            }
 
             igText("Debug Capture Delay");
             igSameLine(0.0f, 5.0f);
@@ -473,22 +684,123 @@ void Plugin_QuestResult::draw_user_interface() {
             igSameLine(0.0f, 5.0f);
             igCheckbox("##HeavyDebugLoggingQR", &mod_settings->heavy_debug_logging);
 
+            igText("Record Capture Trace");
+            igSameLine(0.0f, 5.0f);
+            igCheckbox("##RecordCaptureTraceQR", &mod_settings->record_capture_trace);
+            if (igIsItemHovered(ImGuiHoveredFlags_AllowWhenDisabled)) {
+                igSetTooltip("Records the freeze, UI hide and save capture steps frame by frame. Replay the saved trace with MHWildsCaptureReplay to see how many frames each step took.");
+            }
+
+            if (auto trace_recorder = CaptureTraceRecorder::get_instance()) {
+                auto trace_stats = trace_recorder->get_stats();
+
+                if (trace_stats.event_count != 0) {
+                    igText("Trace: %zu events over %llu frames, %zu dropped", trace_stats.event_count,
+                        static_cast<unsigned long long>(trace_stats.frame_count), trace_stats.dropped_count);
+
+                    if (igButton("Save Capture Trace", ImVec2(0, 0))) {
+                        save_capture_trace(*trace_recorder);
+                    }
+
+                    igText("Path to trace: <GameDir>/%s", CAPTURE_TRACE_FILE_NAME);
+                }
+            }
+
+            auto game_ui_controller = GameUIController::get_instance();
+
+            if (game_ui_controller && igTreeNode_Str("GUI Draw Filter")) {
+                const auto &draw_filter = game_ui_controller->get_draw_filter();
+
+                igText("Evaluated Last Frame: %u", draw_filter.get_last_evaluated_count());
+                igText("Suppressed Last Frame: %u", draw_filter.get_last_suppressed_count());
+                igText("Resolved Through VM Last Frame: %u", draw_filter.get_last_resolved_count());
+                igText("Cached Elements: %zu / %zu", draw_filter.get_cached_count(), GUIDrawFilter::CAPACITY);
+
+                igTreePop();
+            }
+
+            if (reshade_addon_client && igTreeNode_Str("Background Encoding")) {
+                auto &decode_budget_encoder = reshade_addon_client->get_decode_budget_encoder();
+                auto report = decode_budget_encoder.get_last_report();
+
+                if (!report.valid) {
+                    igText("No background encoded yet");
+                } else {
+                    igText("Last Capture: %dx%d, budget %.1f ms", report.width, report.height, report.budget_ms);
+
+                    for (std::size_t i = 0; i < DecodeBudgetEncoder::CANDIDATES.size(); i++) {
+                        const auto &measure = report.measures[i];
+
+                        if (!measure.encoded) {
+                            igTextDisabled("%s: not tried", DecodeBudgetEncoder::CANDIDATES[i].name);
+                            continue;
+                        }
+
+                        igText("%s%s: decode %.2f ms, encode %.0f ms, %zu KB", static_cast<int>(i) == report.selected ? "> " : "",
+                            DecodeBudgetEncoder::CANDIDATES[i].name, measure.decode_ms, measure.encode_ms, measure.size / 1024);
+                    }
+                }
+
+                if (igButton("Measure All Encodings Next Capture", ImVec2(0, 0))) {
+                    decode_budget_encoder.reset_calibration();
+                }
+
+                igTreePop();
+            }
+
+            auto capture_archiver = CaptureArchiver::get_instance();
+
+            if (capture_archiver && igTreeNode_Str("Capture Archive")) {
+                auto stats = capture_archiver->get_stats();
+
+                igText("Archived: %llu, skipped (queue full): %llu, failed: %llu", static_cast<unsigned long long>(stats.archived_count),
+                    static_cast<unsigned long long>(stats.dropped_count), static_cast<unsigned long long>(stats.failed_count));
+                igText("Queued: %zu, %zu / %zu MB", stats.pending_count, stats.pending_bytes / (1024 * 1024), CaptureArchiver::MAX_PENDING_BYTES / (1024 * 1024));
+
+                if (!stats.last_path.empty()) {
+                    igText("Last: %s, %.0f ms, %llu KB", stats.last_path.c_str(), stats.last_write_ms,
+                        static_cast<unsigned long long>(stats.last_file_size / 1024));
+                }
+
+                igTreePop();
+            }
+
+            draw_hook_debug_user_interface();
+
             igTreePop();
         }
 
         mod_settings->max_album_image_quality = std::clamp(mod_settings->max_album_image_quality, 10, 100);
         mod_settings->hdr_bits = std::clamp(mod_settings->hdr_bits, 10, 20);
+        mod_settings->capture_frame_merge_count = std::clamp(mod_settings->capture_frame_merge_count, ReShadeAddOnInjectClient::MIN_CAPTURE_FRAME_MERGE_COUNT,
+            ReShadeAddOnInjectClient::MAX_CAPTURE_FRAME_MERGE_COUNT);
+        mod_settings->quest_result_decode_budget_ms = std::clamp(mod_settings->quest_result_decode_budget_ms, 0.0f, 1000.0f);
         mod_settings->hide_ui_before_capture_frame_count = std::clamp(mod_settings->hide_ui_before_capture_frame_count, 3, 20);
         mod_settings->freeze_game_frames = std::clamp(mod_settings->freeze_game_frames, ReShadeAddOnInjectClient::MIN_FREEZE_TIMESCALE_FRAME_COUNT,
             ReShadeAddOnInjectClient::MAX_FREEZE_TIMESCALE_FRAME_COUNT);
+        mod_settings->pixel_buffer_budget_mb = std::clamp(mod_settings->pixel_buffer_budget_mb, 128, 8192);
+        mod_settings->pixel_buffer_idle_release_seconds = std::clamp(mod_settings->pixel_buffer_idle_release_seconds, 0, 600);
 
         if (mod_settings->data_changed(mod_settings_copy)) {
             mod_settings->save();
+            apply_pixel_buffer_limits(mod_settings);
+            update_configured_override_images();
         }
     }
 }
 
 Plugin_QuestResult::Plugin_QuestResult(const REFrameworkPluginInitializeParam *params) {
+    quest_success_force_client = std::make_unique<FileInjectClient>();
+    quest_failure_force_client = std::make_unique<FileInjectClient>();
+    quest_cancel_force_client = std::make_unique<FileInjectClient>();
+    null_capture_client = std::make_unique<NullCaptureInjectClient>();
+
+    quest_success_force_client->set_limit_size(false);
+    quest_failure_force_client->set_limit_size(false);
+    quest_cancel_force_client->set_limit_size(false);
+}
+
+void Plugin_QuestResult::install_hooks() {
     auto& api = reframework::API::get();
     auto tdb = api->tdb();
 
@@ -509,30 +821,55 @@ Plugin_QuestResult::Plugin_QuestResult(const REFrameworkPluginInitializeParam *p
 
     auto quest_result_end_method = api->tdb()->find_method("app.GUIFlowQuestResult.cContext", "onEndFlow");
     quest_result_end_method->add_hook(pre_close_quest_result_ui, null_post, false);
-
-    quest_success_force_client = std::make_unique<FileInjectClient>();
-    quest_failure_force_client = std::make_unique<FileInjectClient>();
-    quest_cancel_force_client = std::make_unique<FileInjectClient>();
-    null_capture_client = std::make_unique<NullCaptureInjectClient>();
-
-    quest_success_force_client->set_limit_size(false);
-    quest_failure_force_client->set_limit_size(false);
-    quest_cancel_force_client->set_limit_size(false);
 }
 
 void Plugin_QuestResult::initialize(const REFrameworkPluginInitializeParam *params) {
     static const char *SETTINGS_NAME = "mhwilds_high_quality_photos";
     static const char *DEBUG_FILE_POSTFIX = "QuestResult";
 
-    plugin_instance = std::make_unique<Plugin_QuestResult>(params);
+    DeferredStartup::initialize();
+    auto startup = DeferredStartup::get_instance();
+
+    startup->run_synchronous("Plugin", [params]() {
+        plugin_instance = std::make_unique<Plugin_QuestResult>(params);
+    });
+
     PluginBase::base_initialize(plugin_instance.get(), params, SETTINGS_NAME, DEBUG_FILE_POSTFIX);
 
-    auto& api = reframework::API::get();
+    auto api_instance = reframework::API::get().get();
+
+    // Only registers the GUI draw callback
+    startup->run_synchronous("Game UI controller", [params]() {
+        GameUIController::initialize(params);
+    });
+
+    startup->add_game_step("ReShade add-on client", []() {
+        ReShadeAddOnInjectClient::initialize();
+
+        if (auto mod_settings = ModSettings::get_instance()) {
+            apply_pixel_buffer_limits(mod_settings);
+        }
+    });
+
+    startup->add_game_step("Capture archiver and debug dumps", [api_instance]() {
+        CaptureArchiver::initialize(api_instance);
+        DebugDumpWriter::initialize(api_instance);
+    });
+
+    startup->add_game_step("Capture resolution inject", [api_instance]() {
+        CaptureResolutionInject::initialize(api_instance);
+    });
+
+    startup->add_game_step("Game produced capture client", [api_instance]() {
+        GameProducedMaxQualityInjectClient::initialize(api_instance);
+    });
+
+    // Last, the quest hooks use every client above
+    startup->add_game_step("Quest hooks", []() {
+        plugin_instance->install_hooks();
+    });
 
-    GameUIController::initialize(params);
-    ReShadeAddOnInjectClient::initialize();
-    CaptureResolutionInject::initialize(api.get());
-    GameProducedMaxQualityInjectClient::initialize(api.get());
+    startup->start();
 }
 
 Plugin_QuestResult *Plugin_QuestResult::get_instance() {
@@ -17,6 +17,11 @@ private:
     std::unique_ptr<FileInjectClient> quest_cancel_force_client;
     std::unique_ptr<NullCaptureInjectClient> null_capture_client;
 
+    void prefetch_capture_render_target(bool is_overriden);
+
+    // Deferred to the first game updates, see DeferredStartup
+    void install_hooks();
+
     void decide_and_set_screen_cap_or_override_inject(std::unique_ptr<FileInjectClient> &override_client,
         bool should_override,
         const std::string &override_path,
@@ -0,0 +1,106 @@
+#include "ReflectionBindings.hpp"
+
+#include <memory>
+
+std::unique_ptr<ReflectionBindings> reflection_bindings_instance = nullptr;
+
+namespace {
+    constexpr ReflectionBindingDescriptor make_descriptor(const char *type_name, const char *member_name) {
+        return ReflectionBindingDescriptor{ type_name, member_name, reflection_name_hash(type_name, member_name) };
+    }
+
+    constexpr std::array<ReflectionBindingDescriptor, static_cast<std::size_t>(FieldBinding::Count)> FIELD_DESCRIPTORS = {
+        make_descriptor("app.AlbumManager", "_SaveCaptureState"),
+        make_descriptor("app.AlbumManager", "_SerializedResult"),
+        make_descriptor("app.AlbumManager", "_Quality"),
+        make_descriptor("app.AlbumManager", "_Is16x9"),
+        make_descriptor("app.AlbumManager", "_HunterProfilePhotoDataCache"),
+        make_descriptor("app.savedata.cPhoto", "SerializeData"),
+        make_descriptor("app.savedata.cAlbumSaveParam", "_PhotoDatas"),
+        make_descriptor("app.savedata.cHunterProfilePhotoData", "_Data"),
+        make_descriptor("app.savedata.cHunterProfilePhotoParam", "_PhotoData"),
+    };
+
+    constexpr std::array<ReflectionBindingDescriptor, static_cast<std::size_t>(MethodBinding::Count)> METHOD_DESCRIPTORS = {
+        make_descriptor("System.Array", "GetLength"),
+        make_descriptor("via.render.SerializedResult", "get_Content"),
+        make_descriptor("via.render.SerializedResult", "get_Completed"),
+        make_descriptor("via.render.SerializedResult", "get_Valid"),
+        make_descriptor("app.AlbumManager", "updateSaveCapture"),
+    };
+
+    template <std::size_t N>
+    constexpr bool has_unique_hashes(const std::array<ReflectionBindingDescriptor, N> &descriptors) {
+        for (std::size_t i = 0; i < N; i++) {
+            for (std::size_t j = i + 1; j < N; j++) {
+                if (descriptors[i].name_hash == descriptors[j].name_hash) {
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    static_assert(has_unique_hashes(FIELD_DESCRIPTORS), "Duplicated (or colliding) field binding");
+    static_assert(has_unique_hashes(METHOD_DESCRIPTORS), "Duplicated (or colliding) method binding");
+}
+
+const ReflectionBindingDescriptor &ReflectionBindings::get_descriptor(FieldBinding binding) {
+    return FIELD_DESCRIPTORS[static_cast<std::size_t>(binding)];
+}
+
+const ReflectionBindingDescriptor &ReflectionBindings::get_descriptor(MethodBinding binding) {
+    return METHOD_DESCRIPTORS[static_cast<std::size_t>(binding)];
+}
+
+ReflectionBindings::ReflectionBindings(reframework::API *api) {
+    auto tdb = api->tdb();
+
+    for (std::size_t i = 0; i < FIELD_COUNT; i++) {
+        const auto &descriptor = FIELD_DESCRIPTORS[i];
+        auto field = tdb->find_field(descriptor.type_name, descriptor.member_name);
+
+        if (!field) {
+            api->log_error("Reflection binding missing: field %s::%s (0x%08X)", descriptor.type_name, descriptor.member_name,
+                descriptor.name_hash);
+            missing_count++;
+            continue;
+        }
+
+        if (field->is_static()) {
+            api->log_error("Reflection binding invalid: field %s::%s is static", descriptor.type_name, descriptor.member_name);
+            missing_count++;
+            continue;
+        }
+
+        field_offsets[i] = field->get_offset_from_base();
+    }
+
+    for (std::size_t i = 0; i < METHOD_COUNT; i++) {
+        const auto &descriptor = METHOD_DESCRIPTORS[i];
+        methods[i] = tdb->find_method(descriptor.type_name, descriptor.member_name);
+
+        if (!methods[i]) {
+            api->log_error("Reflection binding missing: method %s::%s (0x%08X)", descriptor.type_name, descriptor.member_name,
+                descriptor.name_hash);
+            missing_count++;
+        }
+    }
+
+    if (missing_count == 0) {
+        api->log_info("Resolved %zu field and %zu method bindings", FIELD_COUNT, METHOD_COUNT);
+    } else {
+        api->log_error("%zu reflection bindings failed to resolve, the mod may not work correctly with this game version", missing_count);
+    }
+}
+
+ReflectionBindings *ReflectionBindings::get_instance() {
+    return reflection_bindings_instance ? reflection_bindings_instance.get() : nullptr;
+}
+
+void ReflectionBindings::initialize(reframework::API *api) {
+    if (reflection_bindings_instance == nullptr) {
+        reflection_bindings_instance = std::unique_ptr<ReflectionBindings>(new ReflectionBindings(api));
+    }
+}
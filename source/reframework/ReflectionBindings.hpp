@@ -0,0 +1,102 @@
+#pragma once
+
+#include <reframework/API.hpp>
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+// Fields read from hooks that run every frame (or every capture state tick).
+// Keep in the same order as the descriptor table in ReflectionBindings.cpp.
+enum class FieldBinding : std::uint32_t {
+    AlbumManager_SaveCaptureState,
+    AlbumManager_SerializedResult,
+    AlbumManager_Quality,
+    AlbumManager_Is16x9,
+    AlbumManager_HunterProfilePhotoDataCache,
+    CPhoto_SerializeData,
+    CAlbumSaveParam_PhotoDatas,
+    CHunterProfilePhotoData_Data,
+    CHunterProfilePhotoParam_PhotoData,
+    Count
+};
+
+enum class MethodBinding : std::uint32_t {
+    Array_GetLength,
+    SerializedResult_get_Content,
+    SerializedResult_get_Completed,
+    SerializedResult_get_Valid,
+    AlbumManager_updateSaveCapture,
+    Count
+};
+
+struct ReflectionBindingDescriptor {
+    const char *type_name;
+    const char *member_name;
+    std::uint32_t name_hash;
+};
+
+constexpr std::uint32_t reflection_name_hash(std::string_view type_name, std::string_view member_name) {
+    std::uint32_t hash = 2166136261u;
+
+    auto feed = [&hash](std::string_view text) {
+        for (char c : text) {
+            hash ^= static_cast<std::uint8_t>(c);
+            hash *= 16777619u;
+        }
+    };
+
+    feed(type_name);
+    feed("::");
+    feed(member_name);
+
+    return hash;
+}
+
+// Resolves every field offset and method handle listed in the descriptor tables once, at plugin
+// initialization, and reports the ones that can't be found in a single place.
+// Hot paths then read fields as object + offset instead of looking the name up through the TDB each call.
+class ReflectionBindings {
+private:
+    static constexpr std::size_t FIELD_COUNT = static_cast<std::size_t>(FieldBinding::Count);
+    static constexpr std::size_t METHOD_COUNT = static_cast<std::size_t>(MethodBinding::Count);
+
+    // 0 means unresolved, an instance field is never at offset 0 (object header)
+    std::array<std::uint32_t, FIELD_COUNT> field_offsets{};
+    std::array<reframework::API::Method*, METHOD_COUNT> methods{};
+
+    std::size_t missing_count = 0;
+
+    explicit ReflectionBindings(reframework::API *api);
+
+public:
+    static const ReflectionBindingDescriptor &get_descriptor(FieldBinding binding);
+    static const ReflectionBindingDescriptor &get_descriptor(MethodBinding binding);
+
+    // Falls back to a lookup by name if the binding did not resolve, so a renamed field only costs speed
+    template <typename T>
+    T *get_field(reframework::API::ManagedObject *obj, FieldBinding binding) const {
+        if (!obj) {
+            return nullptr;
+        }
+
+        auto offset = field_offsets[static_cast<std::size_t>(binding)];
+
+        if (offset == 0) {
+            return obj->get_field<T>(get_descriptor(binding).member_name);
+        }
+
+        return reinterpret_cast<T*>(reinterpret_cast<std::uint8_t*>(obj) + offset);
+    }
+
+    reframework::API::Method *get_method(MethodBinding binding) const {
+        return methods[static_cast<std::size_t>(binding)];
+    }
+
+    std::size_t get_missing_count() const {
+        return missing_count;
+    }
+
+    static ReflectionBindings *get_instance();
+    static void initialize(reframework::API *api);
+};
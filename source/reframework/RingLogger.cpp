@@ -0,0 +1,158 @@
+#include "RingLogger.hpp"
+
+#include <algorithm>
+
+std::unique_ptr<RingLogger> ring_logger_instance = nullptr;
+
+namespace {
+    // Longer messages are cut, the REFramework log is line based anyway
+    constexpr std::size_t MAX_MESSAGE_LENGTH = 1024;
+
+    thread_local void *current_thread_ring = nullptr;
+}
+
+RingLogger::RingLogger(reframework::API *api)
+    : api(api) {
+    flush_thread = std::jthread([this](std::stop_token stop_token) {
+        flush_thread_main(stop_token);
+    });
+}
+
+RingLogger::~RingLogger() {
+    flush_thread.request_stop();
+    flush_cv.notify_all();
+}
+
+RingLogger::ThreadRing *RingLogger::get_thread_ring() {
+    if (current_thread_ring != nullptr) {
+        return static_cast<ThreadRing*>(current_thread_ring);
+    }
+
+    // Only taken on the first record of each thread
+    auto ring = std::make_unique<ThreadRing>();
+    auto ring_ptr = ring.get();
+
+    {
+        std::scoped_lock lock(rings_mutex);
+        rings.push_back(std::move(ring));
+    }
+
+    current_thread_ring = ring_ptr;
+    return ring_ptr;
+}
+
+void RingLogger::flush_thread_main(std::stop_token stop_token) {
+    while (!stop_token.stop_requested()) {
+        {
+            std::unique_lock lock(flush_mutex);
+            flush_cv.wait_for(lock, stop_token, FLUSH_INTERVAL, []() { return false; });
+        }
+
+        flush();
+    }
+
+    // What was recorded right before unloading is usually what explains it
+    flush();
+}
+
+void RingLogger::flush() {
+    struct PendingRecord {
+        ThreadRing *ring;
+        std::uint64_t index;
+    };
+
+    std::vector<ThreadRing*> current_rings;
+
+    {
+        std::scoped_lock lock(rings_mutex);
+        current_rings.reserve(rings.size());
+
+        for (const auto &ring : rings) {
+            current_rings.push_back(ring.get());
+        }
+    }
+
+    std::vector<PendingRecord> pending;
+    std::vector<std::pair<ThreadRing*, std::uint64_t>> new_tails;
+
+    for (auto ring : current_rings) {
+        auto tail = ring->tail.load(std::memory_order_relaxed);
+        auto head = ring->head.load(std::memory_order_acquire);
+
+        for (auto index = tail; index != head; index++) {
+            pending.push_back({ ring, index });
+        }
+
+        new_tails.emplace_back(ring, head);
+
+        auto dropped = ring->dropped.load(std::memory_order_relaxed);
+
+        if (dropped != ring->reported_dropped) {
+            api->log_error("Log ring of a thread was full, %llu messages were dropped", static_cast<unsigned long long>(dropped - ring->reported_dropped));
+            ring->reported_dropped = dropped;
+        }
+    }
+
+    // Each ring is already in order, merging them keeps the order between threads
+    std::stable_sort(pending.begin(), pending.end(), [](const PendingRecord &a, const PendingRecord &b) {
+        return a.ring->records[a.index & (RING_CAPACITY - 1)].timestamp_ns < b.ring->records[b.index & (RING_CAPACITY - 1)].timestamp_ns;
+    });
+
+    char message[MAX_MESSAGE_LENGTH];
+
+    for (const auto &[ring, index] : pending) {
+        const auto &record = ring->records[index & (RING_CAPACITY - 1)];
+
+        if (record.formatter(message, sizeof(message), record.format, record.payload) < 0) {
+            continue;
+        }
+
+        if (record.level == LogLevel::Error) {
+            api->log_error("%s", message);
+        } else {
+            api->log_info("%s", message);
+        }
+    }
+
+    // The slots are only given back to the producers once formatted
+    for (const auto &[ring, tail] : new_tails) {
+        ring->tail.store(tail, std::memory_order_release);
+    }
+}
+
+RingLogger::Stats RingLogger::get_stats() {
+    Stats result;
+
+    std::scoped_lock lock(rings_mutex);
+    result.thread_count = rings.size();
+
+    for (const auto &ring : rings) {
+        result.recorded_count += ring->head.load(std::memory_order_relaxed);
+        result.dropped_count += ring->dropped.load(std::memory_order_relaxed);
+    }
+
+    return result;
+}
+
+const char *RingLogger::get_level_name(LogLevel level) {
+    switch (level) {
+    case LogLevel::Debug:
+        return "Debug";
+    case LogLevel::Info:
+        return "Info";
+    case LogLevel::Error:
+        return "Error";
+    default:
+        return "Unknown";
+    }
+}
+
+RingLogger *RingLogger::get_instance() {
+    return ring_logger_instance ? ring_logger_instance.get() : nullptr;
+}
+
+void RingLogger::initialize(reframework::API *api) {
+    if (ring_logger_instance == nullptr) {
+        ring_logger_instance = std::unique_ptr<RingLogger>(new RingLogger(api));
+    }
+}
@@ -0,0 +1,198 @@
+#pragma once
+
+#include <reframework/API.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+enum class LogLevel : std::uint8_t {
+    Debug,
+    Info,
+    Error
+};
+
+// Logging for the hook and per-frame paths. The calling thread only stores the format string pointer, a formatter
+// instantiated for the argument types and the raw arguments into its own ring (single producer, single consumer).
+// A background thread formats the records and hands them to the REFramework log, in timestamp order.
+// Records below the minimum level cost a load and a compare. When a ring is full the record is dropped and counted.
+class RingLogger {
+public:
+    static constexpr std::size_t RING_CAPACITY = 1024;
+    static constexpr std::size_t MAX_PAYLOAD_SIZE = 48;
+    static constexpr std::chrono::milliseconds FLUSH_INTERVAL{ 20 };
+
+    struct Stats {
+        std::uint64_t recorded_count = 0;
+        std::uint64_t dropped_count = 0;
+        std::size_t thread_count = 0;
+    };
+
+private:
+    using FormatFunc = int (*)(char *buffer, std::size_t size, const char *format, const std::uint8_t *payload);
+
+    struct Record {
+        std::uint64_t timestamp_ns;
+        const char *format;
+        FormatFunc formatter;
+        LogLevel level;
+        alignas(8) std::uint8_t payload[MAX_PAYLOAD_SIZE];
+    };
+
+    static_assert(std::is_trivially_copyable_v<Record>, "Records are copied in and out of the rings as plain bytes");
+    static_assert((RING_CAPACITY & (RING_CAPACITY - 1)) == 0, "Ring indices wrap with a mask");
+
+    struct ThreadRing {
+        std::array<Record, RING_CAPACITY> records;
+
+        // Written by the producer thread only
+        alignas(64) std::atomic<std::uint64_t> head = 0;
+        std::atomic<std::uint64_t> dropped = 0;
+
+        // Written by the flush thread only
+        alignas(64) std::atomic<std::uint64_t> tail = 0;
+        std::uint64_t reported_dropped = 0;
+    };
+
+    reframework::API *api = nullptr;
+
+    std::atomic<LogLevel> min_level = LogLevel::Info;
+
+    // Rings live as long as the logger, a thread that exits leaves its ring behind to be drained
+    std::mutex rings_mutex;
+    std::vector<std::unique_ptr<ThreadRing>> rings;
+
+    std::mutex flush_mutex;
+    std::condition_variable_any flush_cv;
+    std::jthread flush_thread;
+
+    explicit RingLogger(reframework::API *api);
+
+    ThreadRing *get_thread_ring();
+    void flush_thread_main(std::stop_token stop_token);
+    void flush();
+
+    static std::uint64_t now_ns() {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    template <typename... Args>
+    static constexpr std::array<std::size_t, sizeof...(Args) + 1> payload_offsets() {
+        std::array<std::size_t, sizeof...(Args) + 1> offsets{};
+        std::size_t sizes[] = { sizeof(Args)..., 0 };
+
+        for (std::size_t i = 0; i < sizeof...(Args); i++) {
+            offsets[i + 1] = offsets[i] + sizes[i];
+        }
+
+        return offsets;
+    }
+
+    template <typename T>
+    static T load_argument(const std::uint8_t *payload) {
+        T value;
+        std::memcpy(&value, payload, sizeof(T));
+
+        return value;
+    }
+
+    template <typename... Args, std::size_t... I>
+    static int format_payload(char *buffer, std::size_t size, const char *format, const std::uint8_t *payload, std::index_sequence<I...>) {
+        constexpr auto offsets = payload_offsets<Args...>();
+
+        if constexpr (sizeof...(Args) == 0) {
+            return std::snprintf(buffer, size, "%s", format);
+        } else {
+            return std::snprintf(buffer, size, format, load_argument<Args>(payload + offsets[I])...);
+        }
+    }
+
+    template <typename... Args>
+    static int format_record(char *buffer, std::size_t size, const char *format, const std::uint8_t *payload) {
+        return format_payload<Args...>(buffer, size, format, payload, std::index_sequence_for<Args...>{});
+    }
+
+    template <typename... Args>
+    void push(LogLevel level, const char *format, const Args &... args) {
+        static_assert(payload_offsets<Args...>()[sizeof...(Args)] <= MAX_PAYLOAD_SIZE, "Too many log arguments for a record");
+        static_assert(((std::is_arithmetic_v<Args> || (std::is_pointer_v<Args> && !std::is_same_v<std::remove_cv_t<std::remove_pointer_t<Args>>, char>)) && ...),
+            "Only numbers and pointers can be logged, a string may be gone by the time the record is formatted");
+
+        auto ring = get_thread_ring();
+        auto head = ring->head.load(std::memory_order_relaxed);
+
+        if (head - ring->tail.load(std::memory_order_acquire) >= RING_CAPACITY) {
+            ring->dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        auto &record = ring->records[head & (RING_CAPACITY - 1)];
+        record.timestamp_ns = now_ns();
+        record.format = format;
+        record.formatter = &format_record<Args...>;
+        record.level = level;
+
+        [[maybe_unused]] constexpr auto offsets = payload_offsets<Args...>();
+        [[maybe_unused]] std::size_t index = 0;
+        ((std::memcpy(record.payload + offsets[index++], &args, sizeof(Args))), ...);
+
+        ring->head.store(head + 1, std::memory_order_release);
+    }
+
+public:
+    ~RingLogger();
+
+    // The format is a printf format, it has to outlive the logger (a string literal)
+    template <std::size_t N, typename... Args>
+    static void log(LogLevel level, const char (&format)[N], const Args &... args) {
+        auto logger = get_instance();
+
+        if (logger == nullptr || level < logger->min_level.load(std::memory_order_relaxed)) {
+            return;
+        }
+
+        logger->push<std::decay_t<Args>...>(level, format, args...);
+    }
+
+    template <std::size_t N, typename... Args>
+    static void debug(const char (&format)[N], const Args &... args) {
+        log(LogLevel::Debug, format, args...);
+    }
+
+    template <std::size_t N, typename... Args>
+    static void info(const char (&format)[N], const Args &... args) {
+        log(LogLevel::Info, format, args...);
+    }
+
+    template <std::size_t N, typename... Args>
+    static void error(const char (&format)[N], const Args &... args) {
+        log(LogLevel::Error, format, args...);
+    }
+
+    void set_min_level(LogLevel level) {
+        min_level.store(level, std::memory_order_relaxed);
+    }
+
+    LogLevel get_min_level() const {
+        return min_level.load(std::memory_order_relaxed);
+    }
+
+    Stats get_stats();
+
+    static const char *get_level_name(LogLevel level);
+
+    static RingLogger *get_instance();
+    static void initialize(reframework::API *api);
+};
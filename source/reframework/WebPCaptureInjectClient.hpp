@@ -1,9 +1,85 @@
 #pragma once
 
-#include <vector>
+#include <cstdint>
 #include <functional>
+#include <memory>
+#include <vector>
+
+// Move-only handle to an encoded WebP image. The bytes can live in a vector, in the buffer libwebp
+// allocated while encoding, or in a buffer shared with a cache. Producers hand it over without copying,
+// so the only copy left is the one the injector does into the game's managed array.
+class WebPDataBuffer {
+private:
+    std::shared_ptr<const std::uint8_t> storage;
+    std::size_t storage_size = 0;
+
+public:
+    WebPDataBuffer() = default;
+
+    WebPDataBuffer(WebPDataBuffer &&other) noexcept
+        : storage(std::move(other.storage))
+        , storage_size(other.storage_size) {
+        other.storage_size = 0;
+    }
+
+    WebPDataBuffer &operator=(WebPDataBuffer &&other) noexcept {
+        storage = std::move(other.storage);
+        storage_size = other.storage_size;
+        other.storage_size = 0;
+
+        return *this;
+    }
+
+    WebPDataBuffer(const WebPDataBuffer &) = delete;
+    WebPDataBuffer &operator=(const WebPDataBuffer &) = delete;
+
+    // Takes ownership of a buffer allocated by a C library (eg. the output of WebPEncodeRGBA), which
+    // is released with free_func (eg. WebPFree) once the last holder is gone.
+    static WebPDataBuffer adopt(std::uint8_t *data, std::size_t size, void (*free_func)(void*)) {
+        WebPDataBuffer buffer;
+        buffer.storage = std::shared_ptr<const std::uint8_t>(data, free_func);
+        buffer.storage_size = data ? size : 0;
+
+        return buffer;
+    }
+
+    static WebPDataBuffer from_vector(std::vector<std::uint8_t> &&data) {
+        auto owner = std::make_shared<std::vector<std::uint8_t>>(std::move(data));
+
+        WebPDataBuffer buffer;
+        buffer.storage_size = owner->size();
+        buffer.storage = std::shared_ptr<const std::uint8_t>(owner, owner->data());
+
+        return buffer;
+    }
+
+    // Hands out bytes owned by someone else (eg. a cache entry) without copying, the owner is kept alive
+    // until the last holder is gone.
+    static WebPDataBuffer share(const std::shared_ptr<const std::vector<std::uint8_t>> &owner) {
+        WebPDataBuffer buffer;
+
+        if (owner) {
+            buffer.storage_size = owner->size();
+            buffer.storage = std::shared_ptr<const std::uint8_t>(owner, owner->data());
+        }
+
+        return buffer;
+    }
+
+    const std::uint8_t *data() const {
+        return storage.get();
+    }
+
+    std::size_t size() const {
+        return storage_size;
+    }
+
+    bool empty() const {
+        return storage == nullptr || storage_size == 0;
+    }
+};
 
-using ProvideFinishedDataCallback = std::function<void(bool, std::vector<std::uint8_t>*)>;
+using ProvideFinishedDataCallback = std::function<void(bool, WebPDataBuffer)>;
 
 class WebPCaptureInjectClient {
 public:
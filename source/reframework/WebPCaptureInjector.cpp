@@ -1,23 +1,21 @@
 #include "WebPCaptureInjector.hpp"
 #include "WebPCaptureInjectClient.hpp"
+#include "CaptureSequencing.hpp"
+#include "CaptureTrace.hpp"
+#include "ManagedArray.hpp"
 #include "MHWildsTypes.h"
 #include "REFrameworkBorrowedAPI.hpp"
 #include "ModSettings.hpp"
+#include "ReflectionBindings.hpp"
+#include "HookManager.hpp"
+#include "RingLogger.hpp"
 
+#include <algorithm>
 #include <fstream>
 #include <format>
 
 std::unique_ptr<WebPCaptureInjector> webp_capture_injector_instance = nullptr;
 
-template <typename T>
-T *get_array_ptr(reframework::API::ManagedObject *array_obj) {
-    if (!array_obj) {
-        return nullptr;
-    }
-
-    return reinterpret_cast<T*>(reinterpret_cast<std::uint8_t*>(array_obj) + ArrayPtrOffset);
-}
-
 void set_serialize_result_array(reframework::API::ManagedObject *serialized_result, reframework::API::ManagedObject *new_array) {
     if (!serialized_result || !new_array) {
         return;
@@ -28,80 +26,66 @@ void set_serialize_result_array(reframework::API::ManagedObject *serialized_resu
 }
 
 int WebPCaptureInjector::pre_start_update_save_capture(int argc, void** argv, REFrameworkTypeDefinitionHandle* arg_tys, unsigned long long ret_addr) {
-    auto settings = ModSettings::get_instance();
+    ScopedHookTimer timer(webp_capture_injector_instance ? webp_capture_injector_instance->update_save_capture_pre_stats : nullptr);
 
     if (!webp_capture_injector_instance) {
-        if (settings->heavy_debug_logging) {
-            auto &api = reframework::API::get();
-            if (api) {
-                api->log_info("WebPCaptureInjector instance is null in pre_start_update_save_capture. This should not even happen");
-            }
-        }
+        RingLogger::debug("WebPCaptureInjector instance is null in pre_start_update_save_capture. This should not even happen");
         return REFRAMEWORK_HOOK_CALL_ORIGINAL;
     }
 
     auto album_manager = webp_capture_injector_instance->get_album_manager();
 
     if (!album_manager) {
-        if (settings->heavy_debug_logging) {
-            if (webp_capture_injector_instance->api) {
-                webp_capture_injector_instance->api->log_info("AlbumManager is empty while trying to pre_start_update_save_capture");
-            }
-        }
+        RingLogger::debug("AlbumManager is empty while trying to pre_start_update_save_capture");
 
         return REFRAMEWORK_HOOK_CALL_ORIGINAL;
     }
 
     auto api = webp_capture_injector_instance->api;
+    auto bindings = ReflectionBindings::get_instance();
 
-    auto capture_state_ptr = album_manager->get_field<int>("_SaveCaptureState");
+    auto capture_state_ptr = bindings->get_field<int>(album_manager, FieldBinding::AlbumManager_SaveCaptureState);
+    auto request = webp_capture_injector_instance->find_capture_request(CaptureRequestStatus::Capturing);
 
-    if (capture_state_ptr != nullptr) {
+    if (capture_state_ptr != nullptr && request != nullptr) {
         SaveCaptureState capture_state = static_cast<SaveCaptureState>(*capture_state_ptr);
 
-        if (webp_capture_injector_instance->has_request_capture) {
-            if (capture_state == SAVECAPTURESTATE_WAIT_SERIALIZE) {
-                auto serialized_result_ptr = album_manager->get_field<reframework::API::ManagedObject*>("_SerializedResult");
-                if (settings->heavy_debug_logging) {
-                    api->log_info("Current capture state is in wait serialize, serializer pointer 0x%p", (void*)serialized_result_ptr);
-                }
-                if (serialized_result_ptr && *serialized_result_ptr && !webp_capture_injector_instance->spoofed_result) {
-                    auto serialized_result = serialized_result_ptr;
-                    auto is_completed = webp_capture_injector_instance->get_serialized_field_completed_method->call<bool>(
-                        api->get_vm_context(), *serialized_result);
+        if (capture_state == SAVECAPTURESTATE_WAIT_SERIALIZE) {
+            auto serialized_result_ptr = bindings->get_field<reframework::API::ManagedObject*>(album_manager,
+                FieldBinding::AlbumManager_SerializedResult);
+            RingLogger::debug("Current capture state is in wait serialize, serializer pointer 0x%p", (void*)serialized_result_ptr);
+            if (serialized_result_ptr && *serialized_result_ptr && !request->spoofed_result) {
+                auto serialized_result = serialized_result_ptr;
+                auto is_completed = webp_capture_injector_instance->get_serialized_field_completed_method->call<bool>(
+                    api->get_vm_context(), *serialized_result);
 
-                    auto is_valid = webp_capture_injector_instance->get_serialized_field_valid_method->call<bool>(
-                        api->get_vm_context(), *serialized_result);
+                auto is_valid = webp_capture_injector_instance->get_serialized_field_valid_method->call<bool>(
+                    api->get_vm_context(), *serialized_result);
 
-                    if (settings->heavy_debug_logging) {
-                        api->log_info("SerializedResult is completed: %d, is valid: %d", is_completed, is_valid);
-                    }
+                RingLogger::debug("SerializedResult is completed: %d, is valid: %d", static_cast<int>(is_completed), static_cast<int>(is_valid));
 
-                    if (is_completed && is_valid) {
-                        // Spoof it with an always valid array to skip original serialization
-                        webp_capture_injector_instance->original_webp_array = webp_capture_injector_instance->get_serialized_field_content_method->call
-                            <reframework::API::ManagedObject*>(api->get_vm_context(), *serialized_result);
+                if (is_completed && is_valid) {
+                    // Spoof it with an always valid array to skip original serialization
+                    request->original_webp_array = webp_capture_injector_instance->get_serialized_field_content_method->call
+                        <reframework::API::ManagedObject*>(api->get_vm_context(), *serialized_result);
 
-                        webp_capture_injector_instance->always_valid_array->add_ref();
+                    webp_capture_injector_instance->always_valid_array->add_ref();
 
-                        set_serialize_result_array(*serialized_result, webp_capture_injector_instance->always_valid_array);
+                    set_serialize_result_array(*serialized_result, webp_capture_injector_instance->always_valid_array);
 
-                        api->log_info("Spoofed SerializedResult content array to skip original serialization");
-                        webp_capture_injector_instance->spoofed_result = true;
-                    }
+                    api->log_info("Spoofed SerializedResult content array to skip original serialization");
+                    request->spoofed_result = true;
                 }
+            }
 
-                if (webp_capture_injector_instance->spoofed_result && webp_capture_injector_instance->is_capture_done) {
-                    api->log_info("Capture already done and result already spoofed, proceed to next state");
-                    return REFRAMEWORK_HOOK_CALL_ORIGINAL;
-                }
-                
-                return REFRAMEWORK_HOOK_SKIP_ORIGINAL;
-            } else {
-                if (settings->heavy_debug_logging) {
-                    api->log_info("Current capture state (pre-update) is: %d", (int)capture_state);
-                }
+            if (request->spoofed_result && request->is_capture_done) {
+                api->log_info("Capture already done and result already spoofed, proceed to next state");
+                return REFRAMEWORK_HOOK_CALL_ORIGINAL;
             }
+            
+            return REFRAMEWORK_HOOK_SKIP_ORIGINAL;
+        } else {
+            RingLogger::debug("Current capture state (pre-update) is: %d", (int)capture_state);
         }
     }
 
@@ -109,13 +93,10 @@ int WebPCaptureInjector::pre_start_update_save_capture(int argc, void** argv, RE
 }
 
 void WebPCaptureInjector::post_start_update_save_capture(void** ret_val, REFrameworkTypeDefinitionHandle ret_ty, unsigned long long ret_addr) {
-    auto settings = ModSettings::get_instance();
+    ScopedHookTimer timer(webp_capture_injector_instance ? webp_capture_injector_instance->update_save_capture_post_stats : nullptr);
 
     if (!webp_capture_injector_instance) {
-        if (settings->heavy_debug_logging) {
-            auto &api = reframework::API::get();
-            api->log_info("WebPCaptureInjector instance is null in post_start_update_save_capture. This should not even happen");
-        }
+        RingLogger::debug("WebPCaptureInjector instance is null in post_start_update_save_capture. This should not even happen");
 
         return;
     }
@@ -123,136 +104,213 @@ void WebPCaptureInjector::post_start_update_save_capture(void** ret_val, REFrame
     auto album_manager = webp_capture_injector_instance->get_album_manager();
     auto api = webp_capture_injector_instance->api;
     auto vm_context = api->get_vm_context();
-    auto tdb = api->tdb();
+    auto bindings = ReflectionBindings::get_instance();
 
     if (!album_manager || !api || !vm_context) {
-        if (settings->heavy_debug_logging) {
-            if (!album_manager && api) {
-                api->log_info("AlbumManager is empty while trying to post_start_update_save_capture");
-            }
-            if (!api) {
-                api->log_info("API is empty while trying to post_start_update_save_capture");
-            }
-            if (!vm_context && api) {
-                api->log_info("VMContext is empty while trying to post_start_update_save_capture");
-            }
+        if (!album_manager) {
+            RingLogger::debug("AlbumManager is empty while trying to post_start_update_save_capture");
+        }
+        if (!api) {
+            RingLogger::debug("API is empty while trying to post_start_update_save_capture");
+        }
+        if (!vm_context) {
+            RingLogger::debug("VMContext is empty while trying to post_start_update_save_capture");
         }
 
         return;
     }
     
-    auto capture_state_ptr = album_manager->get_field<int>("_SaveCaptureState");
+    auto capture_state_ptr = bindings->get_field<int>(album_manager, FieldBinding::AlbumManager_SaveCaptureState);
 
     if (capture_state_ptr == nullptr) {
         api->log_info("Capture state null");
         return;
-    } else {
-        SaveCaptureState capture_state = static_cast<SaveCaptureState>(*capture_state_ptr);
+    }
 
-        if (capture_state >= SAVECAPTURESTATE_START && webp_capture_injector_instance->inject_pending && !webp_capture_injector_instance->has_request_capture) {
-            webp_capture_injector_instance->has_request_capture = true;
-            webp_capture_injector_instance->is_capture_done = false;
-            webp_capture_injector_instance->inject_pending = false;
-            webp_capture_injector_instance->spoofed_result = false;
+    SaveCaptureState capture_state = static_cast<SaveCaptureState>(*capture_state_ptr);
+    auto request = webp_capture_injector_instance->find_capture_request(CaptureRequestStatus::Capturing);
 
-            if (webp_capture_injector_instance->client) {
-                auto func = std::bind(&WebPCaptureInjector::on_client_provide_webp_data, webp_capture_injector_instance.get(), std::placeholders::_1,
-                    std::placeholders::_2);
+    auto &capture_requests = webp_capture_injector_instance->capture_requests;
 
-                auto is16x9_ptr = album_manager->get_field<bool>("_Is16x9");
+    bool had_capturing_request = request != nullptr;
+    bool had_pending_request = false;
+    auto request_count_before = capture_requests.size();
+    int is_capture_done_checked = -1;
+    int actions = 0;
 
-                if (!is16x9_ptr) {
-                    api->log_error("Can't determine if the capture should be 16x9 or not. Default to true");
-                }
+    if (SaveCaptureRouting::should_start_pending(capture_state, request != nullptr)) {
+        request = webp_capture_injector_instance->find_capture_request(CaptureRequestStatus::Pending);
+        had_pending_request = request != nullptr;
 
-                auto is16x9 = is16x9_ptr ? *is16x9_ptr : true;
-                bool client_accept_capture_request = webp_capture_injector_instance->client->provide_webp_data(is16x9, func);
-            
-                if (!client_accept_capture_request) {
-                    webp_capture_injector_instance->is_capture_done = true;
-                }
-            }
+        if (request != nullptr) {
+            webp_capture_injector_instance->start_capture_request(request, album_manager);
+            actions |= SaveCaptureRouting::Action_StartPending;
         }
+    }
 
-        if (capture_state == SAVECAPTURESTATE_SAVE_CAPTURE && !webp_capture_injector_instance->has_injected &&
-            webp_capture_injector_instance->is_capture_done &&
-            webp_capture_injector_instance->copied_buffer != nullptr) {
-            webp_capture_injector_instance->has_injected = true;
+    if (request != nullptr) {
+        is_capture_done_checked = request->is_capture_done ? 1 : 0;
+    }
 
-            auto serialized_result = album_manager->get_field<reframework::API::ManagedObject*>("_SerializedResult");
-            if (!serialized_result) {
-                api->log_info("Can't find SerializedResult field");
-                return;
-            }
+    if (SaveCaptureRouting::should_finish(capture_state, request != nullptr, is_capture_done_checked == 1)) {
+        webp_capture_injector_instance->finish_capture_request(std::move(request), album_manager);
+        request = nullptr;
+        actions |= SaveCaptureRouting::Action_Finish;
+    }
+
+    if (SaveCaptureRouting::should_drop(capture_state, request != nullptr)) {
+        api->log_info("Save capture went back to idle before the capture was injected, dropping it");
 
-            auto original_capture_data = webp_capture_injector_instance->get_serialized_field_content_method->call
-                <reframework::API::ManagedObject*>(vm_context, *serialized_result);
+        webp_capture_injector_instance->remove_capture_request(request);
+        request = nullptr;
+        actions |= SaveCaptureRouting::Action_Drop;
+    }
 
-            if (original_capture_data) {
-                auto mod_settings = ModSettings::get_instance();
-                if (mod_settings->dump_original_webp && webp_capture_injector_instance->original_webp_array) {
-                    auto actual_webp_array = webp_capture_injector_instance->original_webp_array;
-                    auto length = actual_webp_array->call<int>("GetLength", vm_context, actual_webp_array);
-                    auto array_content_ptr = get_array_ptr<std::uint8_t>(actual_webp_array);
+    if (SaveCaptureRouting::should_disarm(capture_state, capture_requests.size())) {
+        HookManager::get_instance()->request_disarm(HookGroup::SaveCaptureInject);
+        actions |= SaveCaptureRouting::Action_Disarm;
+    }
 
-                    static constexpr const char *DEBUG_FILE_NAME_FORMAT = "reframework/data/MHWilds_HighQualityPhotoMod_OriginalImage_{}.webp";
-                    std::string debug_file_name = std::format(DEBUG_FILE_NAME_FORMAT, mod_settings->debug_file_postfix);
+    // Idle with nothing queued is every frame outside of a save capture
+    if (capture_state != SAVECAPTURESTATE_IDLE || request_count_before != 0) {
+        CaptureTraceRecorder::record(CaptureTraceEventKind::SaveCaptureRoute, { static_cast<int>(capture_state), had_capturing_request ? 1 : 0,
+            had_pending_request ? 1 : 0, static_cast<int>(request_count_before), is_capture_done_checked, actions });
+    }
 
-                    auto persistent_dir = REFramework::get_persistent_dir();
+    if (request != nullptr) {
+        RingLogger::debug("Current capture state (post-update) is: %d", (int)capture_state);
+    }
+}
 
-                    if (!std::filesystem::exists(persistent_dir)) {
-                        std::filesystem::create_directories(persistent_dir);
-                    }
+std::shared_ptr<WebPCaptureInjector::CaptureRequest> WebPCaptureInjector::find_capture_request(CaptureRequestStatus status) const {
+    for (const auto &request : capture_requests) {
+        if (request->status == status) {
+            return request;
+        }
+    }
 
-                    auto debug_path = persistent_dir/ debug_file_name;
+    return nullptr;
+}
 
-                    std::ofstream original(debug_path.string(), std::istream::out | std::istream::binary);
-                    original.write(reinterpret_cast<const char*>(array_content_ptr), length);
-                    original.flush();
-                    original.close();
-                }
+void WebPCaptureInjector::remove_capture_request(const std::shared_ptr<CaptureRequest> &request) {
+    std::erase(capture_requests, request);
+}
 
-                original_capture_data->release();
+void WebPCaptureInjector::start_capture_request(const std::shared_ptr<CaptureRequest> &request, reframework::API::ManagedObject *album_manager) {
+    request->status = CaptureRequestStatus::Capturing;
 
-                if (webp_capture_injector_instance->original_webp_array)
-                    webp_capture_injector_instance->original_webp_array->release();
-            }
+    if (!request->client) {
+        request->is_capture_done = true;
+        return;
+    }
 
-            auto& capture_buffer_ref = *webp_capture_injector_instance->copied_buffer;
-            auto new_capture_data_array = api->create_managed_array(webp_capture_injector_instance->byte_type,
-                static_cast<std::uint32_t>(capture_buffer_ref.size()));
+    auto is16x9_ptr = ReflectionBindings::get_instance()->get_field<bool>(album_manager, FieldBinding::AlbumManager_Is16x9);
 
-            new_capture_data_array->add_ref();
+    if (!is16x9_ptr) {
+        api->log_error("Can't determine if the capture should be 16x9 or not. Default to true");
+    }
 
-            auto array_content_ptr = get_array_ptr<std::uint8_t>(new_capture_data_array);
-            std::memcpy(array_content_ptr, capture_buffer_ref.data(), capture_buffer_ref.size());
+    auto is16x9 = is16x9_ptr ? *is16x9_ptr : true;
 
-            api->log_info("Inject new WebP image finished!");
+    // The client may finish after the request left the queue (eg. the game dropped the capture), the callback keeps it alive
+    bool client_accept_capture_request = request->client->provide_webp_data(is16x9, [this, request](bool success, WebPDataBuffer provided_data) {
+        on_client_provide_webp_data(request, success, std::move(provided_data));
+    });
 
-            set_serialize_result_array(*serialized_result, new_capture_data_array);
-        }
+    if (!client_accept_capture_request) {
+        request->is_capture_done = true;
+    }
+}
+
+void WebPCaptureInjector::finish_capture_request(std::shared_ptr<CaptureRequest> request, reframework::API::ManagedObject *album_manager) {
+    auto vm_context = api->get_vm_context();
+    auto bindings = ReflectionBindings::get_instance();
+
+    auto serialized_result = bindings->get_field<reframework::API::ManagedObject*>(album_manager,
+        FieldBinding::AlbumManager_SerializedResult);
 
-        if (webp_capture_injector_instance->has_request_capture && capture_state == SAVECAPTURESTATE_IDLE) {
-            webp_capture_injector_instance->has_request_capture = false;
-            webp_capture_injector_instance->is_capture_done = false;
-            webp_capture_injector_instance->has_injected = false;
-            webp_capture_injector_instance->copied_buffer.reset();
+    remove_capture_request(request);
+
+    if (!serialized_result) {
+        api->log_info("Can't find SerializedResult field");
+        return;
+    }
+
+    if (request->provided_buffer.empty()) {
+        // Nothing to inject, give the game its own image back instead of the placeholder
+        if (request->spoofed_result && request->original_webp_array) {
+            set_serialize_result_array(*serialized_result, request->original_webp_array);
+            always_valid_array->release();
+
+            api->log_info("No image provided, restored the game's own capture");
         }
 
-        if (webp_capture_injector_instance->has_request_capture && settings->heavy_debug_logging) {
-            api->log_info("Current capture state (post-update) is: %d", (int)capture_state);
+        return;
+    }
+
+    auto original_capture_data = get_serialized_field_content_method->call<reframework::API::ManagedObject*>(vm_context, *serialized_result);
+
+    if (original_capture_data) {
+        auto mod_settings = ModSettings::get_instance();
+        if (mod_settings->dump_original_webp && request->original_webp_array) {
+            ManagedArrayView<std::uint8_t> original_webp(request->original_webp_array, vm_context);
+
+            static constexpr const char *DEBUG_FILE_NAME_FORMAT = "reframework/data/MHWilds_HighQualityPhotoMod_OriginalImage_{}.webp";
+            std::string debug_file_name = std::format(DEBUG_FILE_NAME_FORMAT, mod_settings->debug_file_postfix);
+
+            auto persistent_dir = REFramework::get_persistent_dir();
+
+            if (!std::filesystem::exists(persistent_dir)) {
+                std::filesystem::create_directories(persistent_dir);
+            }
+
+            auto debug_path = persistent_dir/ debug_file_name;
+
+            std::ofstream original(debug_path.string(), std::istream::out | std::istream::binary);
+            original.write(reinterpret_cast<const char*>(original_webp.data()), original_webp.size());
+            original.flush();
+            original.close();
         }
+
+        original_capture_data->release();
+
+        if (request->original_webp_array)
+            request->original_webp_array->release();
+    }
+
+    auto& capture_buffer_ref = request->provided_buffer;
+    auto new_capture_data = ManagedArrayView<std::uint8_t>::create(api, byte_type, capture_buffer_ref.size());
+
+    if (!new_capture_data.valid()) {
+        api->log_error("Failed to create managed array of %zu bytes for the new WebP image", capture_buffer_ref.size());
+        return;
     }
+
+    auto new_capture_data_array = new_capture_data.object();
+    new_capture_data_array->add_ref();
+
+    new_capture_data.copy_from(std::span<const std::uint8_t>(capture_buffer_ref.data(), capture_buffer_ref.size()));
+
+    // The managed array holds the image now, let the encoder's buffer go
+    request->provided_buffer = {};
+
+    api->log_info("Inject new WebP image finished! %zu capture requests left", capture_requests.size());
+
+    set_serialize_result_array(*serialized_result, new_capture_data_array);
 }
 
-void WebPCaptureInjector::on_client_provide_webp_data(bool success, std::vector<std::uint8_t>* provided_data) {
-    if (success && provided_data) {
-        webp_capture_injector_instance->copied_buffer = std::make_unique<std::vector<std::uint8_t>>(*provided_data);
+void WebPCaptureInjector::on_client_provide_webp_data(const std::shared_ptr<CaptureRequest> &request, bool success, WebPDataBuffer provided_data) {
+    if (!request) {
+        return;
+    }
+
+    if (success && !provided_data.empty()) {
+        request->provided_buffer = std::move(provided_data);
         api->log_info("Capture finished successfully! on capture injector");
     } else {
         api->log_info("Capture failed! on capture injector");
     }
-    webp_capture_injector_instance->is_capture_done = true;
+    request->is_capture_done = true;
 }
 
 int WebPCaptureInjector::pre_start_create_cphoto(int argc, void** argv, REFrameworkTypeDefinitionHandle* arg_tys, unsigned long long ret_addr) {
@@ -264,16 +322,17 @@ void WebPCaptureInjector::patch_cphoto(reframework::API::ManagedObject* cphoto)
         return;
     }
 
-    auto data_array_ptr = cphoto->get_field<reframework::API::ManagedObject*>("SerializeData");
+    auto data_array_ptr = ReflectionBindings::get_instance()->get_field<reframework::API::ManagedObject*>(cphoto,
+        FieldBinding::CPhoto_SerializeData);
 
     if (!data_array_ptr) {
         return;
     }
 
     auto data_array = *data_array_ptr;
-    auto array_length = data_array->call<int>("GetLength", webp_capture_injector_instance->api->get_vm_context(), data_array);
+    ManagedArrayView<std::uint8_t> data_array_view(data_array, webp_capture_injector_instance->api->get_vm_context());
 
-    if (array_length >= MaxSerializePhotoSize) {
+    if (data_array_view.size() >= MaxSerializePhotoSize) {
         return;
     }
 
@@ -290,14 +349,17 @@ void WebPCaptureInjector::patch_hunter_profile_photo_data(reframework::API::Mana
         return;
     }
 
-    auto cprofile_photo_save_param_obj_ptr = cprofile_photo_savedata->get_field<reframework::API::ManagedObject*>("_Data");
+    auto bindings = ReflectionBindings::get_instance();
+    auto cprofile_photo_save_param_obj_ptr = bindings->get_field<reframework::API::ManagedObject*>(cprofile_photo_savedata,
+        FieldBinding::CHunterProfilePhotoData_Data);
 
     if (!cprofile_photo_save_param_obj_ptr) {
         return;
     }
 
     auto cprofile_photo_save_param_obj = *cprofile_photo_save_param_obj_ptr;
-    auto cphoto_ptr = cprofile_photo_save_param_obj->get_field<reframework::API::ManagedObject*>("_PhotoData");
+    auto cphoto_ptr = bindings->get_field<reframework::API::ManagedObject*>(cprofile_photo_save_param_obj,
+        FieldBinding::CHunterProfilePhotoParam_PhotoData);
 
     if (!cphoto_ptr) {
         return;
@@ -342,7 +404,8 @@ void WebPCaptureInjector::post_start_hunter_profile_photo_param_create(void** re
     }
 
     auto cprofile_photo_save_param_obj = *cprofile_photo_save_param_obj_ptr;
-    auto cphoto_ptr = cprofile_photo_save_param_obj->get_field<reframework::API::ManagedObject*>("_PhotoData");
+    auto cphoto_ptr = ReflectionBindings::get_instance()->get_field<reframework::API::ManagedObject*>(cprofile_photo_save_param_obj,
+        FieldBinding::CHunterProfilePhotoParam_PhotoData);
 
     if (!cphoto_ptr) {
         return;
@@ -359,7 +422,8 @@ int WebPCaptureInjector::pre_album_manager_load_hunter_profile_photo(int argc, v
 void WebPCaptureInjector::post_album_manager_load_hunter_profile_photo(void** ret_val, REFrameworkTypeDefinitionHandle ret_ty, unsigned long long ret_addr) {
     // Luckly the save data manager has not managed to load the array (YET)
     auto album_manager = webp_capture_injector_instance->get_album_manager();
-    auto hunter_profile_photo_data_ptr = album_manager->get_field<reframework::API::ManagedObject*>("_HunterProfilePhotoDataCache");
+    auto hunter_profile_photo_data_ptr = ReflectionBindings::get_instance()->get_field<reframework::API::ManagedObject*>(album_manager,
+        FieldBinding::AlbumManager_HunterProfilePhotoDataCache);
 
     if (!hunter_profile_photo_data_ptr) {
         webp_capture_injector_instance->api->log_info("Hunter profile photo data field is null");
@@ -381,8 +445,9 @@ void WebPCaptureInjector::post_start_create_album_save_param(void** ret_val, REF
         return;
     }
 
+    auto bindings = ReflectionBindings::get_instance();
     auto album_save_param = *album_save_param_ptr;
-    auto photo_datas_ptr = album_save_param->get_field<reframework::API::ManagedObject*>("_PhotoDatas");
+    auto photo_datas_ptr = bindings->get_field<reframework::API::ManagedObject*>(album_save_param, FieldBinding::CAlbumSaveParam_PhotoDatas);
 
     if (!photo_datas_ptr) {
         webp_capture_injector_instance->api->log_info("Photo datas field is null");
@@ -392,10 +457,14 @@ void WebPCaptureInjector::post_start_create_album_save_param(void** ret_val, REF
     auto vm_context = webp_capture_injector_instance->api->get_vm_context();
     auto photo_datas = *photo_datas_ptr;
 
-    auto photo_data_length = photo_datas->call<int>("GetLength", vm_context, photo_datas);
-    for (int i = 0; i < photo_data_length; i++) {
-        auto photo_data = photo_datas->call<reframework::API::ManagedObject*>("Get", vm_context, photo_datas, i);
-        auto photo_data_ptr = photo_data->get_field<reframework::API::ManagedObject*>("SerializeData");
+    ManagedArrayView<reframework::API::ManagedObject*> photo_datas_view(photo_datas, vm_context);
+
+    for (auto photo_data : photo_datas_view.span()) {
+        if (!photo_data) {
+            continue;
+        }
+
+        auto photo_data_ptr = bindings->get_field<reframework::API::ManagedObject*>(photo_data, FieldBinding::CPhoto_SerializeData);
 
         if (!photo_data_ptr) {
             webp_capture_injector_instance->api->log_info("Serialize data field of cAlbumSaveParam.PhotoData is null");
@@ -486,26 +555,34 @@ WebPCaptureInjector::WebPCaptureInjector(reframework::API *api)
     : api(api)
     , album_manager(nullptr) {
     auto tdb = api->tdb();
+    auto bindings = ReflectionBindings::get_instance();
 
-    get_serialized_field_content_method = tdb->find_method("via.render.SerializedResult", "get_Content");
-    get_serialized_field_completed_method = tdb->find_method("via.render.SerializedResult", "get_Completed");
-    get_serialized_field_valid_method = tdb->find_method("via.render.SerializedResult", "get_Valid");
+    get_serialized_field_content_method = bindings->get_method(MethodBinding::SerializedResult_get_Content);
+    get_serialized_field_completed_method = bindings->get_method(MethodBinding::SerializedResult_get_Completed);
+    get_serialized_field_valid_method = bindings->get_method(MethodBinding::SerializedResult_get_Valid);
     byte_type = tdb->find_type("System.Byte");
     
-    update_save_capture_method = tdb->find_method("app.AlbumManager", "updateSaveCapture");
+    update_save_capture_method = bindings->get_method(MethodBinding::AlbumManager_updateSaveCapture);
     if (!update_save_capture_method) {
         api->log_info("Can't find updateSaveCapture method");
         return;
     }
 
-    update_save_capture_method->add_hook(pre_start_update_save_capture, post_start_update_save_capture, false);
+    // Only needed while a capture is being injected, see set_inject_pending
+    auto hook_manager = HookManager::get_instance();
+
+    update_save_capture_pre_stats = hook_manager->register_hook(HookGroup::SaveCaptureInject, "AlbumManager.updateSaveCapture (Inject)",
+        update_save_capture_method, pre_start_update_save_capture, post_start_update_save_capture, false);
+    update_save_capture_post_stats = hook_manager->get_stats_slot("AlbumManager.updateSaveCapture post (Inject)");
     //hook_to_extend_webp_max_size();
 
-    always_valid_array = api->create_managed_array(byte_type, 5);
-    always_valid_array->add_ref();
+    auto always_valid = ManagedArrayView<std::uint8_t>::create(api, byte_type, 5);
+    always_valid_array = always_valid.object();
 
-    std::uint8_t* array_ptr = get_array_ptr<std::uint8_t>(always_valid_array);
-    std::memset(array_ptr, 0x00, 5);
+    if (always_valid_array) {
+        always_valid_array->add_ref();
+        std::ranges::fill(always_valid.span(), 0x00);
+    }
 }
 
 WebPCaptureInjector::~WebPCaptureInjector() {
@@ -546,6 +623,26 @@ void WebPCaptureInjector::hook_to_extend_webp_max_size() {
     cphoto_set_photo_data_method->add_hook(pre_cphoto_set_photo_data, post_cphoto_set_photo_data, false);
 }
 
+void WebPCaptureInjector::set_inject_pending(bool queue) {
+    if (!queue) {
+        std::erase_if(capture_requests, [](const std::shared_ptr<CaptureRequest> &request) {
+            return request->status == CaptureRequestStatus::Pending;
+        });
+    }
+
+    if (capture_requests.size() >= MAX_QUEUED_CAPTURE_REQUESTS) {
+        api->log_error("%zu capture requests are already queued, dropping this one", capture_requests.size());
+        return;
+    }
+
+    auto request = std::make_shared<CaptureRequest>();
+    request->client = client;
+
+    capture_requests.push_back(std::move(request));
+
+    HookManager::get_instance()->request_arm(HookGroup::SaveCaptureInject);
+}
+
 WebPCaptureInjector *WebPCaptureInjector::get_instance() {
     return webp_capture_injector_instance ? webp_capture_injector_instance.get() : nullptr;
 }
@@ -2,9 +2,14 @@
 
 #include <reframework/API.hpp>
 #include <atomic>
+#include <cstddef>
+#include <deque>
 #include <functional>
+#include <memory>
 
-class WebPCaptureInjectClient;
+#include "WebPCaptureInjectClient.hpp"
+
+struct HookCallStats;
 
 class WebPCaptureInjector {
 private:
@@ -12,7 +17,6 @@ private:
     reframework::API *api = nullptr;
     reframework::API::ManagedObject *album_manager = nullptr;
     reframework::API::ManagedObject *always_valid_array = nullptr;
-    reframework::API::ManagedObject *original_webp_array = nullptr;
 
     reframework::API::Method *get_serialized_field_content_method = nullptr;
     reframework::API::Method *get_serialized_field_completed_method = nullptr;
@@ -20,20 +24,44 @@ private:
     reframework::API::TypeDefinition *byte_type = nullptr;
     reframework::API::Method *update_save_capture_method = nullptr;
 
+    HookCallStats *update_save_capture_pre_stats = nullptr;
+    HookCallStats *update_save_capture_post_stats = nullptr;
+
     // Hook states
 
-    bool has_request_capture = false;
-    std::atomic_bool is_capture_done = true;
-    bool has_injected = false;
+    enum class CaptureRequestStatus {
+        // Waiting for the game to start a save capture
+        Pending,
+
+        // The client was asked for the data, the game's capture is held at wait serialize until it is done.
+        // The request leaves the queue once injected, or when the game goes back to idle without it
+        Capturing,
+    };
+
+    // One save capture. Each carries its own client and buffer, so a save requested while another one is in flight
+    // is queued instead of overwriting its state
+    struct CaptureRequest {
+        WebPCaptureInjectClient *client = nullptr;
+        CaptureRequestStatus status = CaptureRequestStatus::Pending;
+
+        // Written by the client's worker, provided_buffer is set before is_capture_done
+        std::atomic_bool is_capture_done = false;
+        WebPDataBuffer provided_buffer;
+
+        bool spoofed_result = false;
+        reframework::API::ManagedObject *original_webp_array = nullptr;
+    };
+
+    // Saves requested faster than the game captures them are dropped beyond this
+    static constexpr std::size_t MAX_QUEUED_CAPTURE_REQUESTS = 8;
+
+    // Oldest first. At most one request is capturing, it is the one the game's save capture state belongs to
+    std::deque<std::shared_ptr<CaptureRequest>> capture_requests;
+
     bool is_requesting_photo_save = false;
-    bool request_processed = false;
-    bool inject_pending = false;
-    bool spoofed_result = false;
 
     reframework::API::ManagedObject *csave_obj = nullptr;
 
-    std::unique_ptr<std::vector<std::uint8_t>> copied_buffer = nullptr;
-
     explicit WebPCaptureInjector(reframework::API *api_instance);
 
     // Lazily resolves the app.AlbumManager singleton on first use.
@@ -75,10 +103,18 @@ private:
     static void patch_hunter_profile_photo_data(reframework::API::ManagedObject* cphoto);
 
 private:
-    // Client callback
-    void on_client_provide_webp_data(bool success, std::vector<std::uint8_t>* provided_data);
+    // Client callback, called from whatever thread the client finishes on
+    void on_client_provide_webp_data(const std::shared_ptr<CaptureRequest> &request, bool success, WebPDataBuffer provided_data);
     void hook_to_extend_webp_max_size();
 
+    std::shared_ptr<CaptureRequest> find_capture_request(CaptureRequestStatus status) const;
+    void remove_capture_request(const std::shared_ptr<CaptureRequest> &request);
+
+    void start_capture_request(const std::shared_ptr<CaptureRequest> &request, reframework::API::ManagedObject *album_manager);
+
+    // Injects the provided image and takes the request out of the queue
+    void finish_capture_request(std::shared_ptr<CaptureRequest> request, reframework::API::ManagedObject *album_manager);
+
 public:
     ~WebPCaptureInjector();
 
@@ -89,7 +125,12 @@ public:
         this->client = client;
     }
 
-    void set_inject_pending() {
-        this->inject_pending = true;
+    // Requests a capture from the client set last. By default it replaces the requests the game has not started yet,
+    // with queue the request is added after them (eg. photo mode saves fired back to back).
+    // Also arms the updateSaveCapture hook, which is disarmed again once the save capture is back to idle with nothing queued
+    void set_inject_pending(bool queue = false);
+
+    std::size_t get_capture_request_count() const {
+        return capture_requests.size();
     }
 };
\ No newline at end of file
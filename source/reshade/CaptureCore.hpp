@@ -0,0 +1,702 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <reshade_api_format.hpp>
+
+#include "CaptureTypes.h"
+#include "FrameAccumulator.hpp"
+#include "PixelBufferArena.hpp"
+#include "SceneSettle.hpp"
+
+// What a capture reads from the presenting runtime. The addon wraps the ReShade effect runtime and swapchain,
+// the throughput harness (tools/CaptureThroughput) feeds synthetic or recorded frames
+class CaptureFrameSource {
+public:
+    virtual ~CaptureFrameSource() = default;
+
+    // False until the runtime presented once, captures and settle samples wait for it
+    virtual bool is_available() = 0;
+
+    virtual reshade::api::format get_back_buffer_format() = 0;
+    virtual reshade::api::color_space get_color_space() = 0;
+    virtual void get_screenshot_width_and_height(std::uint32_t *width, std::uint32_t *height) = 0;
+
+    // Before ReShade 6.7 SDR frames come back as RGBA8, from 6.7 on in the back buffer format
+    virtual bool capture_screenshot(std::uint8_t *pixels) = 0;
+
+    // Copies the given rows of the back buffer, screenshot width and back buffer format, tightly packed.
+    // The rows may come from an earlier present so the present doesn't wait for the copy, false while none is ready
+    virtual bool capture_rows(const std::uint32_t *rows, std::uint32_t row_count, std::uint8_t *pixels) = 0;
+
+    // Frees what capture_rows keeps between presents
+    virtual void release_rows() {
+    }
+};
+
+enum class CaptureLogLevel {
+    Error,
+    Warning,
+    Debug
+};
+
+// An HDR frame handed to the HDR save thread, see CaptureCore::set_hdr_save_func
+struct HdrCaptureJob {
+    std::uint8_t *pixels;
+    std::uint32_t width;
+    std::uint32_t height;
+
+    // The back buffer format when the pixels are not quantized, the quantization format otherwise
+    reshade::api::format format;
+    reshade::api::color_space color_space;
+    int hdr_bit_depths;
+    bool quantized;
+};
+
+/**
+ * The capture requests, multi-frame merge and scene settle watch of the addon, called from the two present events.
+ * Only talks to the runtime through CaptureFrameSource, so the tools can drive it without ReShade.
+ * One capture at a time: requested, captured on the next present of its stage, then finished through the callback,
+ * from the present thread, the merge task or the HDR save thread.
+ */
+class CaptureCore {
+public:
+    using LogFunc = void (*)(CaptureLogLevel level, const char *message);
+
+    // Runs on its own thread, has to finish the capture and call end_hdr_conversion
+    using HdrSaveFunc = void (*)(CaptureCore &core, HdrCaptureJob job);
+
+    void set_log_func(LogFunc func) {
+        log_func = func;
+    }
+
+    void set_hdr_save_func(HdrSaveFunc func) {
+        hdr_save_func = func;
+    }
+
+    // From ReShade 6.7 onwards, the pixels have to be manually quantized
+    void set_quantize_in_addon(bool quantize) {
+        quantize_in_addon = quantize;
+    }
+
+    int request(ScreenCaptureFinishFunc finish_callback, int hdr_bit_depths, bool before_reshade, int frame_count, int merge_mode) {
+        if (this->finish_callback) {
+            return RESULT_SCREEN_CAPTURE_IN_PROGRESS;
+        }
+
+        capture_merge_mode = merge_mode;
+        capture_frame_total = (merge_mode == SCREEN_CAPTURE_MERGE_MEDIAN_OF_3) ? 3 : std::clamp(frame_count, 1, FrameAccumulator::MAX_MEAN_FRAMES);
+        capture_frame_index = 0;
+
+        this->finish_callback = finish_callback;
+        this->hdr_bit_depths = hdr_bit_depths;
+        screenshot_before_reshade = before_reshade;
+        screenshot_requested = true;
+
+        return RESULT_SCREEN_CAPTURE_SUBMITTED;
+    }
+
+    // Called on both present events, effects_applied on the one after the ReShade effects ran
+    void on_present(CaptureFrameSource &source, bool effects_applied) {
+        if (!effects_applied) {
+            release_idle_capture_buffers();
+            update_scene_settle_watch(source);
+        }
+
+        if (screenshot_requested) {
+            if (screenshot_before_reshade != effects_applied) {
+                capture_screenshot(source);
+            }
+        } else if (settle_watch_enabled && !settle_restart_requested && settle_watch_before_reshade != effects_applied) {
+            sample_scene_settle_frame(source);
+        }
+    }
+
+    // The present thread owns the sampling state, it picks the new settings up on its next present
+    void set_scene_settle_watch(bool enable, bool before_reshade, float settled_threshold) {
+        if (enable) {
+            settle_requested_before_reshade = before_reshade;
+            settle_requested_threshold = settled_threshold;
+            settle_restart_requested = true;
+        }
+
+        settle_watch_enabled = enable;
+    }
+
+    SceneSettleStatus get_scene_settle_status() const {
+        SceneSettleStatus status;
+
+        // The last watch may still be sampled until the present thread restarts it
+        if (settle_restart_requested) {
+            status.supported = true;
+            status.frames_compared = 0;
+            status.consecutive_settled_frames = 0;
+            status.last_mean_abs_diff = 0.0f;
+
+            return status;
+        }
+
+        status.supported = settle_supported;
+        status.frames_compared = settle_frames_compared;
+        status.consecutive_settled_frames = settle_consecutive_frames;
+        status.last_mean_abs_diff = settle_last_diff;
+
+        return status;
+    }
+
+    // Sends a result without ending the capture
+    void notify(int result, std::uint32_t width, std::uint32_t height, void *data) {
+        if (finish_callback) {
+            finish_callback(result, static_cast<int>(width), static_cast<int>(height), data);
+        }
+    }
+
+    // Sends the last result of the capture, a new one can be requested afterwards
+    void finish(int result, std::uint32_t width = 0, std::uint32_t height = 0, void *data = nullptr) {
+        notify(result, width, height, data);
+        finish_callback = nullptr;
+    }
+
+    void end_hdr_conversion() {
+        is_hdr_converting = false;
+    }
+
+    void log(CaptureLogLevel level, const char *message) const {
+        if (log_func) {
+            log_func(level, message);
+        }
+    }
+
+    // True when no capture is requested, being captured, merged or saved
+    bool is_idle() {
+        return !screenshot_requested && finish_callback == nullptr && !is_hdr_converting && !is_merging();
+    }
+
+    // Copied
+    // Returns null if the converted pixels don't fit the pixel buffer budget
+    static const std::uint8_t *quantize(reshade::api::format quantization_format, reshade::api::format source_format, PixelBufferArena::Buffer &pixels_buffer,
+        const std::uint8_t *mapped_pixels, int width, int height) {
+        if (quantization_format == source_format) {
+            return mapped_pixels;
+        }
+
+        const uint32_t pixels_row_pitch = reshade::api::format_row_pitch(quantization_format, width);
+        const uint32_t mapped_pixels_row_pitch = reshade::api::format_row_pitch(source_format, width);
+
+        auto result_size = static_cast<std::size_t>(height) * pixels_row_pitch;
+        if (!PixelBufferArena::get().ensure(pixels_buffer, result_size)) {
+            return nullptr;
+        }
+
+        auto pixels = pixels_buffer.data();
+
+        for (size_t y = 0; y < height; ++y, pixels += pixels_row_pitch, mapped_pixels += mapped_pixels_row_pitch) {
+            if (quantization_format == reshade::api::format::r8g8b8a8_unorm)
+            {
+                switch (source_format)
+                {
+                case reshade::api::format::r8_unorm:
+                    for (size_t x = 0; x < width; ++x)
+                    {
+                        pixels[x * 4 + 0] = mapped_pixels[x];
+                        pixels[x * 4 + 1] = 0;
+                        pixels[x * 4 + 2] = 0;
+                        pixels[x * 4 + 3] = 0xFF;
+                    }
+                    continue;
+                case reshade::api::format::r8g8_unorm:
+                    for (size_t x = 0; x < width; ++x)
+                    {
+                        pixels[x * 4 + 0] = mapped_pixels[x * 2 + 0];
+                        pixels[x * 4 + 1] = mapped_pixels[x * 2 + 1];
+                        pixels[x * 4 + 2] = 0;
+                        pixels[x * 4 + 3] = 0xFF;
+                    }
+                    continue;
+                case reshade::api::format::r8g8b8x8_unorm:
+                    for (size_t x = 0; x < pixels_row_pitch; x += 4)
+                    {
+                        pixels[x + 0] = mapped_pixels[x + 0];
+                        pixels[x + 1] = mapped_pixels[x + 1];
+                        pixels[x + 2] = mapped_pixels[x + 2];
+                        pixels[x + 3] = 0xFF;
+                    }
+                    continue;
+                case reshade::api::format::b8g8r8a8_unorm:
+                    // Format is BGRA, but output should be RGBA, so flip channels
+                    for (size_t x = 0; x < pixels_row_pitch; x += 4)
+                    {
+                        pixels[x + 0] = mapped_pixels[x + 2];
+                        pixels[x + 1] = mapped_pixels[x + 1];
+                        pixels[x + 2] = mapped_pixels[x + 0];
+                        pixels[x + 3] = mapped_pixels[x + 3];
+                    }
+                    continue;
+                case reshade::api::format::b8g8r8x8_unorm:
+                    for (size_t x = 0; x < pixels_row_pitch; x += 4)
+                    {
+                        pixels[x + 0] = mapped_pixels[x + 2];
+                        pixels[x + 1] = mapped_pixels[x + 1];
+                        pixels[x + 2] = mapped_pixels[x + 0];
+                        pixels[x + 3] = 0xFF;
+                    }
+                    continue;
+                case reshade::api::format::r10g10b10a2_unorm:
+                case reshade::api::format::b10g10r10a2_unorm:
+                    for (size_t x = 0; x < pixels_row_pitch; x += 4)
+                    {
+                        const auto offset_r = source_format == reshade::api::format::b10g10r10a2_unorm ? 2 : 0;
+                        const auto offset_g = 1;
+                        const auto offset_b = source_format == reshade::api::format::b10g10r10a2_unorm ? 0 : 2;
+                        const auto offset_a = 3;
+
+                        const uint32_t rgba = *reinterpret_cast<const uint32_t *>(mapped_pixels + x);
+                        // Divide by 4 to get 10-bit range (0-1023) into 8-bit range (0-255)
+                        pixels[x + offset_r] = (( rgba & 0x000003FFu)        /  4) & 0xFF;
+                        pixels[x + offset_g] = (((rgba & 0x000FFC00u) >> 10) /  4) & 0xFF;
+                        pixels[x + offset_b] = (((rgba & 0x3FF00000u) >> 20) /  4) & 0xFF;
+                        pixels[x + offset_a] = (((rgba & 0xC0000000u) >> 30) * 85) & 0xFF;
+                    }
+                    continue;
+                default:
+                    break;
+                }
+            }
+            else if (quantization_format == reshade::api::format::r16g16b16_unorm)
+            {
+                switch (source_format)
+                {
+                case reshade::api::format::r10g10b10a2_unorm:
+                case reshade::api::format::b10g10r10a2_unorm:
+                    for (size_t x = 0; x < pixels_row_pitch; x += sizeof(uint16_t) * 3)
+                    {
+                        const auto offset_r = source_format == reshade::api::format::b10g10r10a2_unorm ? 2 : 0;
+                        const auto offset_g = 1;
+                        const auto offset_b = source_format == reshade::api::format::b10g10r10a2_unorm ? 0 : 2;
+
+                        const uint32_t rgba = *reinterpret_cast<const uint32_t *>(mapped_pixels + (x / (sizeof(uint16_t) * 3)) * 4);
+                        // Multiply by 64 to get 10-bit range (0-1023) into 16-bit range (0-65535)
+                        reinterpret_cast<uint16_t *>(pixels + x)[offset_r] = ( (rgba & 0x000003FFu)        * 64) & 0xFFFF;
+                        reinterpret_cast<uint16_t *>(pixels + x)[offset_g] = (((rgba & 0x000FFC00u) >> 10) * 64) & 0xFFFF;
+                        reinterpret_cast<uint16_t *>(pixels + x)[offset_b] = (((rgba & 0x3FF00000u) >> 20) * 64) & 0xFFFF;
+                    }
+                    continue;
+                default:
+                    break;
+                }
+            }
+            else if (quantization_format == reshade::api::format::r16g16b16_float && source_format == reshade::api::format::r16g16b16a16_float)
+            {
+                for (size_t x = 0; x < pixels_row_pitch; x += sizeof(uint16_t) * 3)
+                {
+                    std::memcpy(pixels + x, mapped_pixels + (x / 3) * 4, sizeof(uint16_t) * 3);
+                }
+                continue;
+            }
+            else if (quantization_format == reshade::api::format::r10g10b10a2_unorm && source_format == reshade::api::format::b10g10r10a2_unorm)
+            {
+                // Format is BGRA, but output should be RGBA, so flip channels
+                for (size_t x = 0; x < pixels_row_pitch; x += sizeof(uint32_t))
+                {
+                    const uint32_t rgba = *reinterpret_cast<const uint32_t *>(mapped_pixels + x);
+                    *reinterpret_cast<uint32_t *>(pixels + x) = ((rgba & 0x000003FFu) << 20) | ((rgba & 0x3FF00000u) >> 20) | (rgba & 0xC00FFC00u);
+                }
+                continue;
+            }
+        }
+
+        return pixels_buffer.data();
+    }
+
+    static bool is_settle_comparable_format(reshade::api::format format) {
+        switch (format) {
+            case reshade::api::format::r8g8b8a8_unorm:
+            case reshade::api::format::r8g8b8a8_unorm_srgb:
+            case reshade::api::format::r8g8b8x8_unorm:
+            case reshade::api::format::r8g8b8x8_unorm_srgb:
+            case reshade::api::format::b8g8r8a8_unorm:
+            case reshade::api::format::b8g8r8a8_unorm_srgb:
+            case reshade::api::format::b8g8r8x8_unorm:
+            case reshade::api::format::b8g8r8x8_unorm_srgb:
+                return true;
+
+            default:
+                return false;
+        }
+    }
+
+private:
+    LogFunc log_func = nullptr;
+    HdrSaveFunc hdr_save_func = nullptr;
+    bool quantize_in_addon = false;
+
+    int hdr_bit_depths = 11; // Default to 11-bit depth for HDR
+    ScreenCaptureFinishFunc finish_callback = nullptr;
+    bool screenshot_requested = false;
+
+    std::atomic_bool is_hdr_converting = false;
+    bool screenshot_before_reshade = false;
+
+    // Given back to the arena once no capture uses them, see release_idle_capture_buffers
+    PixelBufferArena::Buffer cached_pixels;
+    PixelBufferArena::Buffer cached_converted_pixels;
+
+    // Multi-frame capture. A captured frame stays in the capture buffers until its merge task is done,
+    // the next capture waits for it before overwriting them
+    int capture_frame_total = 1;
+    int capture_frame_index = 0;
+    int capture_merge_mode = SCREEN_CAPTURE_MERGE_MEAN;
+    std::size_t capture_frame_size = 0;
+
+    std::future<void> merge_task;
+    PixelBufferArena::Buffer merge_accumulator;
+    PixelBufferArena::Buffer merge_kept_frames[2];
+    PixelBufferArena::Buffer merge_result;
+
+    // Created on the first merged capture, runs the merge task and its stripes without starting threads every frame.
+    // Declared after the buffers so it finishes its tasks before they go away
+    std::unique_ptr<BS::thread_pool<>> merge_thread_pool;
+
+    // Scene settle watch. The game thread only sets the requested settings and the flags, the present thread
+    // applies them and writes the status it reads
+    std::atomic_bool settle_watch_enabled = false;
+    std::atomic_bool settle_restart_requested = false;
+    std::atomic_bool settle_requested_before_reshade = false;
+    std::atomic<float> settle_requested_threshold = 0.0f;
+
+    bool settle_watch_before_reshade = false;
+    float settle_threshold = 0.0f;
+    bool settle_has_previous = false;
+
+    std::vector<std::uint8_t> settle_frame_pixels;
+    std::uint8_t settle_thumbnails[2][SceneSettle::THUMBNAIL_SIZE];
+    int settle_current_thumbnail = 0;
+
+    std::atomic_bool settle_supported = true;
+    std::atomic_int settle_frames_compared = 0;
+    std::atomic_int settle_consecutive_frames = 0;
+    std::atomic<float> settle_last_diff = 0.0f;
+
+    bool is_merging() {
+        return merge_task.valid() && (merge_task.wait_for(std::chrono::seconds(0)) != std::future_status::ready);
+    }
+
+    void wait_for_merge_task() {
+        if (!merge_task.valid()) {
+            return;
+        }
+
+        if (merge_task.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            log(CaptureLogLevel::Warning, "Frame merge is slower than the frame rate, waiting for it");
+        }
+
+        merge_task.get();
+    }
+
+    // Between captures the buffers go back to the arena, which frees them after its idle timeout unless
+    // the next capture reuses them first
+    void release_idle_capture_buffers() {
+        if (is_idle()) {
+            cached_pixels.reset();
+            cached_converted_pixels.reset();
+            merge_accumulator.reset();
+            merge_kept_frames[0].reset();
+            merge_kept_frames[1].reset();
+            merge_result.reset();
+        }
+
+        PixelBufferArena::get().trim();
+    }
+
+    void submit_merge_frame(const std::uint8_t *pixels, std::uint32_t width, std::uint32_t height) {
+        const std::size_t size = static_cast<std::size_t>(width) * height * 4;
+        const int frame_index = capture_frame_index++;
+        const bool is_last = capture_frame_index >= capture_frame_total;
+
+        if (frame_index == 0) {
+            capture_frame_size = size;
+        } else if (size != capture_frame_size) {
+            log(CaptureLogLevel::Error, "Back buffer size changed while merging frames");
+            finish(RESULT_SCREEN_RESHADE_CAPTURE_FAILURE);
+            return;
+        }
+
+        if (is_last) {
+            notify(RESULT_SCREEN_CAPTURE_DATA_DOWNLOADED, width, height, nullptr);
+        } else {
+            // Capture again on the next present, the merge of this one runs meanwhile
+            screenshot_requested = true;
+        }
+
+        if (merge_thread_pool == nullptr) {
+            merge_thread_pool = std::make_unique<BS::thread_pool<>>(FrameAccumulator::get_worker_count());
+        }
+
+        merge_task = merge_thread_pool->submit_task([this, pixels, width, height, size, frame_index, is_last,
+            frame_total = capture_frame_total, merge_mode = capture_merge_mode]() {
+            auto &arena = PixelBufferArena::get();
+
+            // The frames still to come are captured anyway, only the last one reports
+            const auto fail_merge = [this, is_last]() {
+                log(CaptureLogLevel::Error, "Not enough pixel buffer budget to merge the frames");
+
+                if (is_last) {
+                    finish(RESULT_SCREEN_RESHADE_CAPTURE_FAILURE);
+                }
+            };
+
+            if (merge_mode == SCREEN_CAPTURE_MERGE_MEDIAN_OF_3) {
+                if (!is_last) {
+                    auto &kept = merge_kept_frames[frame_index];
+
+                    if (!arena.ensure(kept, size)) {
+                        fail_merge();
+                        return;
+                    }
+
+                    FrameAccumulator::run_striped(*merge_thread_pool, size, [&kept, pixels](std::size_t begin, std::size_t end) {
+                        std::memcpy(kept.data() + begin, pixels + begin, end - begin);
+                    });
+
+                    return;
+                }
+
+                if (merge_kept_frames[0].empty() || merge_kept_frames[1].empty() || !arena.ensure(merge_result, size)) {
+                    fail_merge();
+                    return;
+                }
+
+                FrameAccumulator::run_striped(*merge_thread_pool, size, [this, pixels](std::size_t begin, std::size_t end) {
+                    FrameAccumulator::median_of_3(merge_kept_frames[0].data(), merge_kept_frames[1].data(), pixels, merge_result.data(), begin, end);
+                });
+            } else {
+                // One 16-bit sum per byte. Only acquired on the first frame, the later ones add to it
+                if (frame_index == 0 && !arena.ensure(merge_accumulator, size * sizeof(std::uint16_t))) {
+                    fail_merge();
+                    return;
+                }
+
+                if (merge_accumulator.empty()) {
+                    fail_merge();
+                    return;
+                }
+
+                auto accumulator = reinterpret_cast<std::uint16_t*>(merge_accumulator.data());
+
+                FrameAccumulator::run_striped(*merge_thread_pool, size, [accumulator, pixels, frame_index](std::size_t begin, std::size_t end) {
+                    if (frame_index == 0) {
+                        FrameAccumulator::widen(accumulator, pixels, begin, end);
+                    } else {
+                        FrameAccumulator::add(accumulator, pixels, begin, end);
+                    }
+                });
+
+                if (!is_last) {
+                    return;
+                }
+
+                if (!arena.ensure(merge_result, size)) {
+                    fail_merge();
+                    return;
+                }
+
+                FrameAccumulator::run_striped(*merge_thread_pool, size, [this, accumulator, frame_total](std::size_t begin, std::size_t end) {
+                    FrameAccumulator::resolve_mean(accumulator, merge_result.data(), frame_total, begin, end);
+                });
+            }
+
+#ifdef LOG_DEBUG_STEP
+            log(CaptureLogLevel::Debug, "Merged frames finished, sending them");
+#endif
+
+            finish(RESULT_SCREEN_CAPTURE_SUCCESS, width, height, merge_result.data());
+        });
+    }
+
+    void update_scene_settle_watch(CaptureFrameSource &source) {
+        if (settle_restart_requested) {
+            settle_watch_before_reshade = settle_requested_before_reshade;
+            settle_threshold = settle_requested_threshold;
+            settle_has_previous = false;
+
+            settle_supported = true;
+            settle_frames_compared = 0;
+            settle_consecutive_frames = 0;
+            settle_last_diff = 0.0f;
+
+            settle_restart_requested = false;
+        }
+
+        if (!settle_watch_enabled && !settle_frame_pixels.empty()) {
+            std::vector<std::uint8_t>().swap(settle_frame_pixels);
+
+            if (source.is_available()) {
+                source.release_rows();
+            }
+        }
+    }
+
+    void sample_scene_settle_frame(CaptureFrameSource &source) {
+        if (!source.is_available() || !settle_supported) {
+            return;
+        }
+
+        // HDR back buffers would need quantizing first, the fixed frame counts are good enough there
+        if (!is_settle_comparable_format(source.get_back_buffer_format())) {
+            settle_supported = false;
+            return;
+        }
+
+        std::uint32_t width, height;
+        source.get_screenshot_width_and_height(&width, &height);
+
+        std::uint32_t rows[SceneSettle::SAMPLE_ROW_COUNT];
+        SceneSettle::pick_sample_rows(height, rows);
+
+        settle_frame_pixels.resize(static_cast<std::size_t>(width) * SceneSettle::SAMPLE_ROW_COUNT * 4);
+
+        if (!source.capture_rows(rows, SceneSettle::SAMPLE_ROW_COUNT, settle_frame_pixels.data())) {
+            return;
+        }
+
+        auto current = settle_thumbnails[settle_current_thumbnail];
+        auto previous = settle_thumbnails[settle_current_thumbnail ^ 1];
+
+        SceneSettle::build_thumbnail(settle_frame_pixels.data(), width, SceneSettle::SAMPLE_ROW_COUNT, current);
+
+        if (settle_has_previous) {
+            float diff = SceneSettle::mean_abs_diff(current, previous);
+
+            settle_last_diff = diff;
+            settle_consecutive_frames = (diff <= settle_threshold) ? settle_consecutive_frames + 1 : 0;
+            settle_frames_compared++;
+        }
+
+        settle_has_previous = true;
+        settle_current_thumbnail ^= 1;
+    }
+
+    void capture_screenshot(CaptureFrameSource &source) {
+        if (is_hdr_converting || !source.is_available()) {
+            return;
+        }
+
+        // The previous frame of a multi-frame capture may still be read from the capture buffers
+        wait_for_merge_task();
+
+        screenshot_requested = false;
+
+        auto format = reshade::api::format_to_default_typed(source.get_back_buffer_format());
+        auto color_space = source.get_color_space();
+
+        bool is_hdr = false;
+
+        if (quantize_in_addon) {
+            is_hdr = (format == reshade::api::format::r16g16b16a16_float) || (color_space == reshade::api::color_space::hdr10_st2084) ||
+                     (color_space == reshade::api::color_space::hdr10_hlg);
+        } else {
+            is_hdr = (format == reshade::api::format::r16g16b16a16_float) ||
+                     ((format == reshade::api::format::b10g10r10a2_unorm) || (format == reshade::api::format::r10g10b10a2_unorm)) && (color_space == reshade::api::color_space::hdr10_st2084);
+        }
+
+        std::uint32_t width, height;
+        source.get_screenshot_width_and_height(&width, &height);
+
+        auto bytes_per_pixel = (format == reshade::api::format::r16g16b16a16_float) ? 8 : 4; // 4 bytes for RGBA, 8 bytes for HDR scRGB
+        std::size_t required_size = static_cast<std::size_t>(width) * height * bytes_per_pixel;
+
+        // Reuse cached buffer or reallocate if needed. Page aligned, as sk_hdr_png requires
+        if (!PixelBufferArena::get().ensure(cached_pixels, required_size)) {
+            log(CaptureLogLevel::Error, "Not enough pixel buffer budget to capture the screenshot");
+            finish(RESULT_SCREEN_RESHADE_CAPTURE_FAILURE);
+            return;
+        }
+
+        auto pixels = cached_pixels.data();
+
+#ifdef LOG_DEBUG_STEP
+        log(CaptureLogLevel::Debug, quantize_in_addon ? "Start capturing screenshot (v6.7+)" : "Start capturing screenshot (v6.7-)");
+#endif
+
+        if (!source.capture_screenshot(pixels)) {
+            finish(RESULT_SCREEN_RESHADE_CAPTURE_FAILURE);
+            return;
+        }
+
+        const std::uint8_t *captured_pixels = pixels;
+        auto hdr_format = format;
+
+        if (quantize_in_addon) {
+            auto quantization_format = reshade::api::format::r8g8b8a8_unorm;
+
+            if (is_hdr) {
+                if (format == reshade::api::format::r16g16b16a16_float) {
+                    quantization_format = reshade::api::format::r16g16b16_float;
+                } else {
+                    quantization_format = reshade::api::format::r16g16b16_unorm;
+                }
+            }
+
+            captured_pixels = quantize(quantization_format, format, cached_converted_pixels, pixels, width, height);
+            hdr_format = quantization_format;
+
+            if (captured_pixels == nullptr) {
+                log(CaptureLogLevel::Error, "Not enough pixel buffer budget to convert the screenshot");
+                finish(RESULT_SCREEN_RESHADE_CAPTURE_FAILURE);
+                return;
+            }
+        }
+
+#ifdef LOG_DEBUG_STEP
+        log(CaptureLogLevel::Debug, "Capturing screenshot finished");
+#endif
+
+        if (!is_hdr && capture_frame_total > 1) {
+            submit_merge_frame(captured_pixels, width, height);
+            return;
+        }
+
+        notify(RESULT_SCREEN_CAPTURE_DATA_DOWNLOADED, width, height, nullptr);
+
+        if (!is_hdr) {
+#ifdef LOG_DEBUG_STEP
+            log(CaptureLogLevel::Debug, "Screenshot is not HDR, sending it directly");
+#endif
+
+            finish(RESULT_SCREEN_CAPTURE_SUCCESS, width, height, const_cast<std::uint8_t*>(captured_pixels));
+            return;
+        }
+
+        if (hdr_save_func == nullptr) {
+            finish(RESULT_SCREEN_CAPTURE_HDR_FAILED);
+            return;
+        }
+
+#ifdef LOG_DEBUG_STEP
+        log(CaptureLogLevel::Debug, "Screenshot is HDR, launching HDR save");
+#endif
+
+        HdrCaptureJob job;
+        job.pixels = const_cast<std::uint8_t*>(captured_pixels);
+        job.width = width;
+        job.height = height;
+        job.format = hdr_format;
+        job.color_space = color_space;
+        job.hdr_bit_depths = hdr_bit_depths;
+        job.quantized = quantize_in_addon;
+
+        // Launch a thread to save the HDR image, then convert it to SDR
+        is_hdr_converting = true;
+        std::thread(hdr_save_func, std::ref(*this), job).detach();
+    }
+};
@@ -0,0 +1,31 @@
+#pragma once
+
+typedef void (*ScreenCaptureFinishFunc)(int result, int width, int height, void *data);
+
+const int RESULT_SCREEN_CAPTURE_IN_PROGRESS = -2;
+const int RESULT_SCREEN_RESHADE_CAPTURE_FAILURE = -1;
+const int RESULT_SCREEN_CAPTURE_NO_RESHADE_RUNTIME = -3;
+const int RESULT_SCREEN_CAPTURE_HDR_NOT_SAVEABLE = -4;
+const int RESULT_SCREEN_CAPTURE_HDR_TO_SDR_FAILED = -5;
+const int RESULT_SCREEN_CAPTURE_HDR_FAILED = -6;
+const int RESULT_SCREEN_CAPTURE_SUCCESS = 0;
+const int RESULT_SCREEN_CAPTURE_SUBMITTED = 1;
+const int RESULT_SCREEN_CAPTURE_DATA_DOWNLOADED = 2;
+
+const int SCREEN_CAPTURE_MERGE_MEAN = 0;
+const int SCREEN_CAPTURE_MERGE_MEDIAN_OF_3 = 1;
+
+// Progress of the scene settle watch, see set_scene_settle_watch
+struct SceneSettleStatus {
+    // False if the back buffer format can't be compared, the caller should fall back to fixed frame counts
+    bool supported;
+
+    // Frames compared to their previous one since the watch started
+    int frames_compared;
+
+    // How many comparisons in a row stayed below the threshold
+    int consecutive_settled_frames;
+
+    // Mean absolute difference of the last comparison, in 8-bit levels
+    float last_mean_abs_diff;
+};
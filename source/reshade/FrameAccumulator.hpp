@@ -0,0 +1,137 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <emmintrin.h>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include <BS_thread_pool.hpp>
+
+namespace FrameAccumulator {
+
+// The 16-bit sums would stay exact far beyond this, more frames just don't fit in the freeze window
+constexpr int MAX_MEAN_FRAMES = 8;
+
+// Threads of the merge pool, see CaptureCore. A 4K accumulation has to fit in a frame time, a single core is not enough for that
+inline std::size_t get_worker_count() {
+    return std::clamp<std::size_t>(std::thread::hardware_concurrency() / 2, 1, 8);
+}
+
+/**
+ * Run fn(begin, end) over [0, size) split into 16 byte aligned stripes, one per pool thread.
+ * Called from a task of the same pool, the calling thread takes the first stripe so the pool is never waiting on itself
+ */
+template <typename Func>
+inline void run_striped(BS::thread_pool<> &thread_pool, std::size_t size, Func fn) {
+    const std::size_t worker_count = std::max<std::size_t>(thread_pool.get_thread_count(), 1);
+    const std::size_t stripe_size = std::max<std::size_t>(16, ((size / worker_count) + 15) & ~static_cast<std::size_t>(15));
+
+    std::vector<std::future<void>> stripes;
+    stripes.reserve(worker_count);
+
+    for (std::size_t begin = stripe_size; begin < size; begin += stripe_size) {
+        std::size_t end = std::min(size, begin + stripe_size);
+        stripes.emplace_back(thread_pool.submit_task([&fn, begin, end]() { fn(begin, end); }));
+    }
+
+    fn(0, std::min(size, stripe_size));
+
+    for (auto &stripe : stripes) {
+        stripe.wait();
+    }
+}
+
+/**
+ * accumulator[i] = frame[i], widened to 16 bits
+ */
+inline void widen(std::uint16_t *accumulator, const std::uint8_t *frame, std::size_t begin, std::size_t end) {
+    const __m128i zero = _mm_setzero_si128();
+    std::size_t i = begin;
+
+    for (; i + 16 <= end; i += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(frame + i));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(accumulator + i), _mm_unpacklo_epi8(block, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(accumulator + i + 8), _mm_unpackhi_epi8(block, zero));
+    }
+
+    for (; i < end; i++) {
+        accumulator[i] = frame[i];
+    }
+}
+
+/**
+ * accumulator[i] += frame[i]
+ */
+inline void add(std::uint16_t *accumulator, const std::uint8_t *frame, std::size_t begin, std::size_t end) {
+    const __m128i zero = _mm_setzero_si128();
+    std::size_t i = begin;
+
+    for (; i + 16 <= end; i += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(frame + i));
+        __m128i *low = reinterpret_cast<__m128i *>(accumulator + i);
+        __m128i *high = reinterpret_cast<__m128i *>(accumulator + i + 8);
+
+        _mm_storeu_si128(low, _mm_add_epi16(_mm_loadu_si128(low), _mm_unpacklo_epi8(block, zero)));
+        _mm_storeu_si128(high, _mm_add_epi16(_mm_loadu_si128(high), _mm_unpackhi_epi8(block, zero)));
+    }
+
+    for (; i < end; i++) {
+        accumulator[i] = static_cast<std::uint16_t>(accumulator[i] + frame[i]);
+    }
+}
+
+/**
+ * out[i] = round(accumulator[i] / frame_count), with a fixed point reciprocal instead of a division
+ */
+inline void resolve_mean(const std::uint16_t *accumulator, std::uint8_t *out, int frame_count, std::size_t begin, std::size_t end) {
+    const std::uint16_t reciprocal = static_cast<std::uint16_t>((65536 + frame_count - 1) / frame_count);
+    const __m128i rounding = _mm_set1_epi16(static_cast<short>(frame_count / 2));
+    const __m128i multiplier = _mm_set1_epi16(static_cast<short>(reciprocal));
+
+    std::size_t i = begin;
+
+    for (; i + 16 <= end; i += 16) {
+        __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i *>(accumulator + i));
+        __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i *>(accumulator + i + 8));
+
+        low = _mm_mulhi_epu16(_mm_add_epi16(low, rounding), multiplier);
+        high = _mm_mulhi_epu16(_mm_add_epi16(high, rounding), multiplier);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_packus_epi16(low, high));
+    }
+
+    for (; i < end; i++) {
+        out[i] = static_cast<std::uint8_t>(((accumulator[i] + frame_count / 2) * reciprocal) >> 16);
+    }
+}
+
+/**
+ * out[i] = median(a[i], b[i], c[i]), drops a value that only one of the three frames has (eg. a frame generation artifact)
+ */
+inline void median_of_3(const std::uint8_t *a, const std::uint8_t *b, const std::uint8_t *c, std::uint8_t *out, std::size_t begin, std::size_t end) {
+    std::size_t i = begin;
+
+    for (; i + 16 <= end; i += 16) {
+        __m128i block_a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+        __m128i block_b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i));
+        __m128i block_c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(c + i));
+
+        __m128i low = _mm_min_epu8(block_a, block_b);
+        __m128i high = _mm_max_epu8(block_a, block_b);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_max_epu8(low, _mm_min_epu8(high, block_c)));
+    }
+
+    for (; i < end; i++) {
+        std::uint8_t low = std::min(a[i], b[i]);
+        std::uint8_t high = std::max(a[i], b[i]);
+
+        out[i] = std::max(low, std::min(high, c[i]));
+    }
+}
+
+} // namespace FrameAccumulator
@@ -0,0 +1,373 @@
+#pragma once
+
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <cstdlib>
+#endif
+
+// Plain data so it can cross the addon boundary, see get_pixel_buffer_arena_stats
+struct PixelBufferArenaStats {
+    std::size_t in_use_bytes;
+    std::size_t cached_bytes;
+    std::size_t peak_bytes;
+    std::size_t budget_bytes;
+
+    std::uint32_t slab_count;
+    std::uint32_t large_page_slab_count;
+
+    std::uint64_t allocation_count;
+    std::uint64_t reuse_count;
+    std::uint64_t rejected_count;
+    std::uint64_t released_count;
+};
+
+/**
+ * Memory for the capture stages (ReShade copy, quantization, crop, resize, merge). Slabs come straight from VirtualAlloc,
+ * so they are page aligned (well above the 64 bytes SIMD loads and sk_hdr_png want) and can use large pages.
+ * Off Windows (the tools) they are page aligned heap blocks and never use large pages.
+ * A buffer given back is kept for the next capture, sizes are rounded up to quarter steps between powers of two so the
+ * stages of the next capture find a slab of their class. Kept slabs are freed once unused for the idle timeout.
+ * Slabs in use and kept never exceed the budget, an acquire that can't fit returns an empty buffer.
+ * Each module has its own arena.
+ */
+class PixelBufferArena {
+public:
+    static constexpr std::size_t MIN_CLASS_SIZE = 64 * 1024;
+    static constexpr std::size_t SLAB_ALIGNMENT = 4096;
+
+    static constexpr std::size_t DEFAULT_BUDGET = 512ull * 1024 * 1024;
+    static constexpr std::chrono::milliseconds DEFAULT_IDLE_TIMEOUT{ 30000 };
+
+    class Buffer {
+    public:
+        Buffer() = default;
+
+        Buffer(const Buffer &) = delete;
+        Buffer &operator=(const Buffer &) = delete;
+
+        Buffer(Buffer &&other) noexcept {
+            *this = std::move(other);
+        }
+
+        Buffer &operator=(Buffer &&other) noexcept {
+            if (this != &other) {
+                reset();
+
+                arena = std::exchange(other.arena, nullptr);
+                pixels = std::exchange(other.pixels, nullptr);
+                capacity = std::exchange(other.capacity, 0);
+                requested_size = std::exchange(other.requested_size, 0);
+                large_page = std::exchange(other.large_page, false);
+            }
+
+            return *this;
+        }
+
+        ~Buffer() {
+            reset();
+        }
+
+        std::uint8_t *data() const {
+            return pixels;
+        }
+
+        std::size_t size() const {
+            return requested_size;
+        }
+
+        bool empty() const {
+            return pixels == nullptr;
+        }
+
+        // Gives the slab back to the arena, kept there for the next acquire until the idle timeout
+        void reset() {
+            if (arena != nullptr && pixels != nullptr) {
+                arena->give_back(pixels, capacity, large_page);
+            }
+
+            arena = nullptr;
+            pixels = nullptr;
+            capacity = 0;
+            requested_size = 0;
+            large_page = false;
+        }
+
+    private:
+        friend class PixelBufferArena;
+
+        PixelBufferArena *arena = nullptr;
+        std::uint8_t *pixels = nullptr;
+        std::size_t capacity = 0;
+        std::size_t requested_size = 0;
+        bool large_page = false;
+    };
+
+    PixelBufferArena() = default;
+
+    PixelBufferArena(const PixelBufferArena &) = delete;
+    PixelBufferArena &operator=(const PixelBufferArena &) = delete;
+
+    // The content of the buffer is undefined
+    Buffer acquire(std::size_t size) {
+        Buffer buffer;
+
+        if (size == 0) {
+            return buffer;
+        }
+
+        const std::size_t class_size = get_class_size(size);
+
+        std::scoped_lock lock(mutex);
+
+        // The smallest kept slab that is at least of the class. Up to twice as large, a crop may reuse the full frame slab
+        auto best = cached_slabs.end();
+
+        for (auto it = cached_slabs.begin(); it != cached_slabs.end(); ++it) {
+            if (it->capacity >= class_size && it->capacity < class_size * 2 && (best == cached_slabs.end() || it->capacity < best->capacity)) {
+                best = it;
+            }
+        }
+
+        if (best != cached_slabs.end()) {
+            buffer.pixels = best->pixels;
+            buffer.capacity = best->capacity;
+            buffer.large_page = best->large_page;
+
+            cached_bytes -= best->capacity;
+            cached_slabs.erase(best);
+
+            stats.reuse_count++;
+        } else {
+            bool large_page = use_large_pages && enable_large_pages();
+            std::size_t capacity = large_page ? align_up(class_size, large_page_size) : class_size;
+
+            // Kept slabs go first, the oldest ones, before giving up on the budget
+            while (in_use_bytes + cached_bytes + capacity > budget_bytes && !cached_slabs.empty()) {
+                free_cached_slab(cached_slabs.begin());
+            }
+
+            if (in_use_bytes + capacity > budget_bytes) {
+                stats.rejected_count++;
+                return buffer;
+            }
+
+            void *pixels = nullptr;
+
+            if (large_page) {
+                pixels = allocate_slab(capacity, true);
+            }
+
+            // Large pages also fail when physical memory is too fragmented to find contiguous ones
+            if (pixels == nullptr) {
+                large_page = false;
+                capacity = class_size;
+                pixels = allocate_slab(capacity, false);
+            }
+
+            if (pixels == nullptr) {
+                stats.rejected_count++;
+                return buffer;
+            }
+
+            buffer.pixels = static_cast<std::uint8_t*>(pixels);
+            buffer.capacity = capacity;
+            buffer.large_page = large_page;
+
+            slab_count++;
+            large_page_slab_count += large_page ? 1 : 0;
+
+            stats.allocation_count++;
+        }
+
+        buffer.arena = this;
+        buffer.requested_size = size;
+
+        in_use_bytes += buffer.capacity;
+        // Not std::max, Windows.h may be included without NOMINMAX
+        if (in_use_bytes + cached_bytes > stats.peak_bytes) {
+            stats.peak_bytes = in_use_bytes + cached_bytes;
+        }
+
+        return buffer;
+    }
+
+    // Keeps the buffer if its slab already fits size, otherwise swaps it for one that does. Returns false if none fits the budget,
+    // the buffer is then empty
+    bool ensure(Buffer &buffer, std::size_t size) {
+        if (!buffer.empty() && buffer.capacity >= size) {
+            buffer.requested_size = size;
+            return true;
+        }
+
+        // Given back first, the old slab may be what makes the new one fit the budget
+        buffer.reset();
+        buffer = acquire(size);
+
+        return !buffer.empty();
+    }
+
+    // Frees the kept slabs that were not reused within the idle timeout. Cheap enough to call every frame
+    void trim() {
+        std::scoped_lock lock(mutex);
+
+        if (cached_slabs.empty()) {
+            return;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+
+        // Given back in order, the oldest are first
+        while (!cached_slabs.empty() && now - cached_slabs.front().released_at >= idle_timeout) {
+            free_cached_slab(cached_slabs.begin());
+        }
+    }
+
+    void configure(std::size_t budget, std::chrono::milliseconds timeout, bool large_pages) {
+        std::scoped_lock lock(mutex);
+
+        budget_bytes = budget;
+        idle_timeout = timeout;
+        use_large_pages = large_pages;
+
+        while (in_use_bytes + cached_bytes > budget_bytes && !cached_slabs.empty()) {
+            free_cached_slab(cached_slabs.begin());
+        }
+    }
+
+    PixelBufferArenaStats get_stats() const {
+        std::scoped_lock lock(mutex);
+
+        PixelBufferArenaStats result = stats;
+        result.in_use_bytes = in_use_bytes;
+        result.cached_bytes = cached_bytes;
+        result.budget_bytes = budget_bytes;
+        result.slab_count = slab_count;
+        result.large_page_slab_count = large_page_slab_count;
+
+        return result;
+    }
+
+    // Never destroyed, buffers held by globals still give their slab back during static destruction
+    static PixelBufferArena &get() {
+        static PixelBufferArena *arena = new PixelBufferArena();
+        return *arena;
+    }
+
+    // Quarter steps between powers of two, a slab is at most 25% larger than asked
+    static std::size_t get_class_size(std::size_t size) {
+        if (size <= MIN_CLASS_SIZE) {
+            return MIN_CLASS_SIZE;
+        }
+
+        const std::size_t power = std::bit_floor(size);
+        const std::size_t step = power / 4;
+
+        return align_up(size, step);
+    }
+
+private:
+    struct CachedSlab {
+        std::uint8_t *pixels;
+        std::size_t capacity;
+        bool large_page;
+        std::chrono::steady_clock::time_point released_at;
+    };
+
+    mutable std::mutex mutex;
+
+    std::vector<CachedSlab> cached_slabs;
+    std::size_t in_use_bytes = 0;
+    std::size_t cached_bytes = 0;
+    std::uint32_t slab_count = 0;
+    std::uint32_t large_page_slab_count = 0;
+
+    std::size_t budget_bytes = DEFAULT_BUDGET;
+    std::chrono::milliseconds idle_timeout = DEFAULT_IDLE_TIMEOUT;
+    bool use_large_pages = false;
+
+    // Zero until the privilege was tried, then the large page size or SIZE_MAX when they can't be used
+    std::size_t large_page_size = 0;
+
+    PixelBufferArenaStats stats{};
+
+    static std::size_t align_up(std::size_t value, std::size_t alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    static void *allocate_slab(std::size_t capacity, [[maybe_unused]] bool large_page) {
+#ifdef _WIN32
+        return VirtualAlloc(nullptr, capacity, MEM_COMMIT | MEM_RESERVE | (large_page ? MEM_LARGE_PAGES : 0), PAGE_READWRITE);
+#else
+        // Class sizes are multiples of MIN_CLASS_SIZE, so of the alignment too
+        return std::aligned_alloc(SLAB_ALIGNMENT, capacity);
+#endif
+    }
+
+    static void free_slab(std::uint8_t *pixels) {
+#ifdef _WIN32
+        VirtualFree(pixels, 0, MEM_RELEASE);
+#else
+        std::free(pixels);
+#endif
+    }
+
+    void give_back(std::uint8_t *pixels, std::size_t capacity, bool large_page) {
+        std::scoped_lock lock(mutex);
+
+        in_use_bytes -= capacity;
+        cached_bytes += capacity;
+        cached_slabs.push_back({ pixels, capacity, large_page, std::chrono::steady_clock::now() });
+
+        // Shrunk budget while the buffer was in use
+        while (in_use_bytes + cached_bytes > budget_bytes && !cached_slabs.empty()) {
+            free_cached_slab(cached_slabs.begin());
+        }
+    }
+
+    void free_cached_slab(std::vector<CachedSlab>::iterator slab) {
+        free_slab(slab->pixels);
+
+        cached_bytes -= slab->capacity;
+        slab_count--;
+        large_page_slab_count -= slab->large_page ? 1 : 0;
+
+        stats.released_count++;
+        cached_slabs.erase(slab);
+    }
+
+    // Large pages need the lock pages in memory privilege, which the user has to be granted. Only tried once
+    bool enable_large_pages() {
+        if (large_page_size == 0) {
+            large_page_size = SIZE_MAX;
+
+#ifdef _WIN32
+            HANDLE token = nullptr;
+
+            if (GetLargePageMinimum() != 0 && OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token)) {
+                TOKEN_PRIVILEGES privileges{};
+                privileges.PrivilegeCount = 1;
+                privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+
+                // AdjustTokenPrivileges succeeds without the privilege, only GetLastError tells
+                if (LookupPrivilegeValueW(nullptr, SE_LOCK_MEMORY_NAME, &privileges.Privileges[0].Luid) &&
+                    AdjustTokenPrivileges(token, FALSE, &privileges, 0, nullptr, nullptr) && GetLastError() == ERROR_SUCCESS) {
+                    large_page_size = GetLargePageMinimum();
+                }
+
+                CloseHandle(token);
+            }
+#endif
+        }
+
+        return large_page_size != SIZE_MAX;
+    }
+};
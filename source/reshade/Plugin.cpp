@@ -1,5 +1,6 @@
 #include <reshade.hpp>
 #include <sk_hdr_png.hpp>
+#include <ctime>
 #include <filesystem>
 #include <format>
 #include <subprocess.h>
@@ -9,12 +10,15 @@
 #include <stb_image_write.h>
 #include <stb_image_write_hdr_png.h>
 #include <fstream>
+#include <mutex>
 #include <thread>
 #include <vector>
 
 #include "Plugin.h"
+#include "CaptureCore.hpp"
 #include "HDRProcessing.hpp"
 #include "JXLDef.hpp"
+#include "PixelBufferArena.hpp"
  
 extern "C" __declspec(dllexport) const char *NAME = "High Quality Kill Screen Capturer";
 extern "C" __declspec(dllexport) const char *DESCRIPTION = "Take a screenshot when you finish a quest, then send it to the game for displaying";
@@ -22,15 +26,180 @@ extern "C" __declspec(dllexport) const char *DESCRIPTION = "Take a screenshot wh
 reshade::api::effect_runtime *current_reshade_runtime = nullptr;
 reshade::api::swapchain *current_swapchain = nullptr;
 
-int g_hdr_bit_depths = 11; // Default to 11-bit depth for HDR
-ScreenCaptureFinishFunc g_finish_callback = nullptr;
-bool screenshot_requested = false;
+// Reads the back buffer of the runtime that presented last, see CaptureFrameSource
+class ReShadeFrameSource : public CaptureFrameSource {
+public:
+    bool is_available() override {
+        return current_reshade_runtime != nullptr && current_swapchain != nullptr;
+    }
+
+    reshade::api::format get_back_buffer_format() override {
+        auto back_buffer = current_reshade_runtime->get_current_back_buffer();
+        return current_reshade_runtime->get_device()->get_resource_desc(back_buffer).texture.format;
+    }
+
+    reshade::api::color_space get_color_space() override {
+        return current_swapchain->get_color_space();
+    }
+
+    void get_screenshot_width_and_height(std::uint32_t *width, std::uint32_t *height) override {
+        current_reshade_runtime->get_screenshot_width_and_height(width, height);
+    }
+
+    bool capture_screenshot(std::uint8_t *pixels) override {
+        return current_reshade_runtime->capture_screenshot(pixels);
+    }
+
+    bool capture_rows(const std::uint32_t *rows, std::uint32_t row_count, std::uint8_t *pixels) override {
+        auto device = current_reshade_runtime->get_device();
+        auto back_buffer = current_reshade_runtime->get_current_back_buffer();
+        auto format = reshade::api::format_to_default_typed(device->get_resource_desc(back_buffer).texture.format);
+
+        std::uint32_t width, height;
+        current_reshade_runtime->get_screenshot_width_and_height(&width, &height);
+
+        if (device != row_device || width != row_width || row_count != row_readback_height || format != row_format) {
+            release_rows();
+
+            if (!create_row_readbacks(device, width, row_count, format)) {
+                return false;
+            }
+        }
+
+        bool has_rows = false;
+
+        // The oldest copy is read once the GPU is done with it
+        if (row_pending_count > 0) {
+            auto &oldest = row_readbacks[row_read_index];
+
+            if (device->get_completed_fence_value(row_fence) >= oldest.fence_value) {
+                reshade::api::subresource_data mapped;
+
+                if (device->map_texture_region(oldest.texture, 0, nullptr, reshade::api::map_access::read_only, &mapped)) {
+                    const std::size_t row_size = static_cast<std::size_t>(width) * 4;
+
+                    for (std::uint32_t i = 0; i < row_count; i++) {
+                        std::memcpy(pixels + i * row_size, static_cast<const std::uint8_t *>(mapped.data) + i * mapped.row_pitch, row_size);
+                    }
+
+                    device->unmap_texture_region(oldest.texture, 0);
+                    has_rows = true;
+                }
+
+                row_read_index ^= 1;
+                row_pending_count--;
+            }
+        }
+
+        // Both copies still in flight means the GPU is behind, this present isn't sampled
+        if (row_pending_count < 2) {
+            auto &target = row_readbacks[row_write_index];
+            auto queue = current_reshade_runtime->get_command_queue();
+            auto cmd_list = queue->get_immediate_command_list();
+
+            cmd_list->barrier(back_buffer, reshade::api::resource_usage::present, reshade::api::resource_usage::copy_source);
+
+            for (std::uint32_t i = 0; i < row_count; i++) {
+                reshade::api::subresource_box source_box = { 0, rows[i], 0, width, rows[i] + 1, 1 };
+                reshade::api::subresource_box dest_box = { 0, i, 0, width, i + 1, 1 };
+
+                cmd_list->copy_texture_region(back_buffer, 0, &source_box, target.texture, 0, &dest_box);
+            }
+
+            cmd_list->barrier(back_buffer, reshade::api::resource_usage::copy_source, reshade::api::resource_usage::present);
+
+            queue->flush_immediate_command_list();
+            queue->signal(row_fence, ++row_fence_value);
+
+            target.fence_value = row_fence_value;
+            row_write_index ^= 1;
+            row_pending_count++;
+        }
+
+        return has_rows;
+    }
+
+    void release_rows() override {
+        if (row_device == nullptr) {
+            return;
+        }
+
+        // The copies still in flight write to the readback textures
+        if (row_pending_count > 0) {
+            row_device->wait(row_fence, row_fence_value);
+        }
+
+        for (auto &readback : row_readbacks) {
+            if (readback.texture.handle != 0) {
+                row_device->destroy_resource(readback.texture);
+            }
+
+            readback = {};
+        }
 
-std::atomic_bool is_hdr_converting = false;
-bool g_screenshot_before_reshade = false;
+        if (row_fence.handle != 0) {
+            row_device->destroy_fence(row_fence);
+        }
+
+        row_fence = {};
+        row_fence_value = 0;
+        row_read_index = 0;
+        row_write_index = 0;
+        row_pending_count = 0;
+        row_device = nullptr;
+    }
+
+private:
+    // Scene settle rows, copied on the GPU into one of two small readback textures and read a present later
+    struct RowReadback {
+        reshade::api::resource texture = {};
+        std::uint64_t fence_value = 0;
+    };
+
+    reshade::api::device *row_device = nullptr;
+    std::uint32_t row_width = 0;
+    std::uint32_t row_readback_height = 0;
+    reshade::api::format row_format = reshade::api::format::unknown;
+
+    RowReadback row_readbacks[2];
+    reshade::api::fence row_fence = {};
+    std::uint64_t row_fence_value = 0;
+    int row_read_index = 0;
+    int row_write_index = 0;
+    int row_pending_count = 0;
+
+    bool create_row_readbacks(reshade::api::device *device, std::uint32_t width, std::uint32_t row_count, reshade::api::format format) {
+        row_device = device;
+        row_width = width;
+        row_readback_height = row_count;
+        row_format = format;
+
+        if (!device->create_fence(0, reshade::api::fence_flags::none, &row_fence)) {
+            reshade::log::message(reshade::log::level::error, "Failed to create the scene settle fence");
+            release_rows();
+            return false;
+        }
+
+        const reshade::api::resource_desc desc(width, row_count, 1, 1, format, 1, reshade::api::memory_heap::gpu_to_cpu, reshade::api::resource_usage::copy_dest);
+
+        for (auto &readback : row_readbacks) {
+            if (!device->create_resource(desc, nullptr, reshade::api::resource_usage::copy_dest, &readback.texture)) {
+                reshade::log::message(reshade::log::level::error, "Failed to create the scene settle readback texture");
+                release_rows();
+                return false;
+            }
+        }
+
+        return true;
+    }
+};
+
+ReShadeFrameSource g_frame_source;
+CaptureCore g_capture_core;
 
-std::vector<std::uint8_t> g_cached_pixels;
-std::vector<std::uint8_t> g_cached_converted_pixels;
+// Set from the game thread, read by the HDR save threads
+std::mutex g_hdr_archive_mutex;
+std::string g_hdr_archive_directory;
 
 struct ReshadeVersion {
     int major;
@@ -82,7 +251,7 @@ std::string get_current_dll_path() {
     return std::string(path);
 }
 
-static void convert_hdr_to_sdr_with_hdrfix(const std::string &input_path, std::chrono::system_clock::rep unique_id) {
+static void convert_hdr_to_sdr_with_hdrfix(CaptureCore &core, const std::string &input_path, std::chrono::system_clock::rep unique_id) {
     // Call hdrfix to convert HDR to SDR
     auto original_dll_containing_path = std::filesystem::path(get_current_dll_path()).parent_path().parent_path();
 
@@ -106,11 +275,7 @@ static void convert_hdr_to_sdr_with_hdrfix(const std::string &input_path, std::c
         auto msg = std::format("Failed to launch hdrfix.exe, subprocess_create returned error code {}", result);
         reshade::log::message(reshade::log::level::error, msg.c_str());
 
-        if (g_finish_callback) {
-            g_finish_callback(RESULT_SCREEN_CAPTURE_HDR_TO_SDR_FAILED, 0, 0, nullptr);
-        }
-
-        g_finish_callback = nullptr;
+        core.finish(RESULT_SCREEN_CAPTURE_HDR_TO_SDR_FAILED);
         return;
     }
 
@@ -126,10 +291,7 @@ static void convert_hdr_to_sdr_with_hdrfix(const std::string &input_path, std::c
         reshade::log::message(reshade::log::level::warning, msg.c_str());
 
         /*
-        if (g_finish_callback) {
-            g_finish_callback(RESULT_SCREEN_CAPTURE_HDR_TO_SDR_FAILED, 0, 0, nullptr);
-        }
-        g_finish_callback = nullptr;
+        core.finish(RESULT_SCREEN_CAPTURE_HDR_TO_SDR_FAILED);
         return;
         */
     }
@@ -138,10 +300,7 @@ static void convert_hdr_to_sdr_with_hdrfix(const std::string &input_path, std::c
         auto msg = std::format("hdrfix.exe did not produce output file at expected location: {}", path_output);
         reshade::log::message(reshade::log::level::error, msg.c_str());
 
-        if (g_finish_callback) {
-            g_finish_callback(RESULT_SCREEN_CAPTURE_HDR_TO_SDR_FAILED, 0, 0, nullptr);
-        }
-        g_finish_callback = nullptr;
+        core.finish(RESULT_SCREEN_CAPTURE_HDR_TO_SDR_FAILED);
         return;
     }
 
@@ -164,22 +323,79 @@ static void convert_hdr_to_sdr_with_hdrfix(const std::string &input_path, std::c
         reshade::log::message(reshade::log::level::debug, "Reading HDR convert OK, sending to callback");
 #endif
 
-        if (g_finish_callback) {
-            g_finish_callback(RESULT_SCREEN_CAPTURE_SUCCESS, loaded_width, loaded_height, data_result);
-        }
+        core.finish(RESULT_SCREEN_CAPTURE_SUCCESS, loaded_width, loaded_height, data_result);
         stbi_image_free(data_result);
     } else {
         reshade::log::message(reshade::log::level::error, "Failed to read converted SDR image from hdrfix output");
+        core.finish(RESULT_SCREEN_CAPTURE_HDR_NOT_SAVEABLE);
+    }
+}
+
+// Same naming as the archives of the plugin (see CaptureArchiver), with an _HDR suffix
+static std::filesystem::path make_hdr_archive_path(const std::filesystem::path &directory, std::chrono::system_clock::time_point captured_at) {
+    // More captures in the same second than that is not something the game can do
+    static constexpr int MAX_NAME_ATTEMPTS = 100;
+
+    std::time_t captured_time = std::chrono::system_clock::to_time_t(captured_at);
+    std::tm local_time{};
+    localtime_s(&local_time, &captured_time);
+
+    auto stem = std::format("MHWilds_QuestResult_{:04}{:02}{:02}_{:02}{:02}{:02}", local_time.tm_year + 1900, local_time.tm_mon + 1,
+        local_time.tm_mday, local_time.tm_hour, local_time.tm_min, local_time.tm_sec);
+
+    std::error_code ec;
+
+    for (int attempt = 1; attempt <= MAX_NAME_ATTEMPTS; attempt++) {
+        auto name = (attempt == 1) ? std::format("{}_HDR.png", stem) : std::format("{}_{}_HDR.png", stem, attempt);
+        auto path = directory / name;
 
-        if (g_finish_callback) {
-            g_finish_callback(RESULT_SCREEN_CAPTURE_HDR_NOT_SAVEABLE, 0, 0, nullptr);
+        if (!std::filesystem::exists(path, ec)) {
+            return path;
         }
     }
 
-    g_finish_callback = nullptr;
+    return {};
 }
 
-static void hdr_convert_thread(std::uint8_t * pixels, std::uint32_t width, std::uint32_t height, reshade::api::format format, int hdr_bit_depths) {
+static void archive_hdr_capture(const std::filesystem::path &hdr_png_path, std::chrono::system_clock::rep unique_id) {
+    std::string directory;
+
+    {
+        std::scoped_lock lock(g_hdr_archive_mutex);
+        directory = g_hdr_archive_directory;
+    }
+
+    if (directory.empty()) {
+        return;
+    }
+
+    // The SDR image is already sent, the copy only has to stay out of the game's way
+    SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+
+    auto archive_directory = std::filesystem::path(reinterpret_cast<const char8_t*>(directory.c_str()));
+    auto captured_at = std::chrono::system_clock::time_point(std::chrono::system_clock::duration(unique_id));
+
+    std::error_code ec;
+    std::filesystem::create_directories(archive_directory, ec);
+
+    auto archive_path = make_hdr_archive_path(archive_directory, captured_at);
+
+    if (archive_path.empty()) {
+        auto msg = std::format("No free name left to archive HDR screenshot in {}", archive_directory.string());
+        reshade::log::message(reshade::log::level::error, msg.c_str());
+    } else {
+        std::filesystem::copy_file(hdr_png_path, archive_path, std::filesystem::copy_options::skip_existing, ec);
+    }
+
+    if (ec) {
+        auto msg = std::format("Failed to archive HDR screenshot to {}: {}", archive_path.string(), ec.message());
+        reshade::log::message(reshade::log::level::error, msg.c_str());
+    }
+
+    SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_END);
+}
+
+static void hdr_convert_thread(CaptureCore &core, const HdrCaptureJob &job) {
     // Launch this in a separate thread
     // Write to PNG and use tool to convert to SDR
     auto unique_id = std::chrono::system_clock::now().time_since_epoch().count();
@@ -195,15 +411,12 @@ static void hdr_convert_thread(std::uint8_t * pixels, std::uint32_t width, std::
 #endif
 
     if (!sk_hdr_png::write_image_to_disk(temp_path_wstring.c_str(),
-        width, height,
-        reinterpret_cast<void*>(pixels),
-        g_hdr_bit_depths,
-        format)) {
-        if (g_finish_callback) {
-            g_finish_callback(RESULT_SCREEN_CAPTURE_HDR_NOT_SAVEABLE, 0, 0, nullptr);
-        }
-        g_finish_callback = nullptr; // Reset the callback to allow new requests
-        is_hdr_converting = false;
+        job.width, job.height,
+        reinterpret_cast<void*>(job.pixels),
+        job.hdr_bit_depths,
+        job.format)) {
+        core.finish(RESULT_SCREEN_CAPTURE_HDR_NOT_SAVEABLE);
+        core.end_hdr_conversion();
         return;
     }
 
@@ -218,11 +431,13 @@ static void hdr_convert_thread(std::uint8_t * pixels, std::uint32_t width, std::
     reshade::log::message(reshade::log::level::debug, msg_copy.c_str());
 
     // Use shared function to convert HDR to SDR
-    convert_hdr_to_sdr_with_hdrfix(temp_path_string, unique_id);
-    is_hdr_converting = false;
+    convert_hdr_to_sdr_with_hdrfix(core, temp_path_string, unique_id);
+    core.end_hdr_conversion();
+
+    archive_hdr_capture(temp_path, unique_id);
 }
 
-static void hdr_save_thread_v67(std::uint8_t *pixels, std::uint32_t width, std::uint32_t height, reshade::api::format quantization_format, reshade::api::color_space color_space) {
+static void hdr_save_thread_v67(CaptureCore &core, const HdrCaptureJob &job) {
     // New HDR processing for ReShade 6.7+ - saves directly to PNG with proper color space handling
     auto unique_id = std::chrono::system_clock::now().time_since_epoch().count();
     auto temp_path = std::filesystem::temp_directory_path() / std::format("reshade_hdr_screenshot{0}.png", unique_id);
@@ -233,7 +448,7 @@ static void hdr_save_thread_v67(std::uint8_t *pixels, std::uint32_t width, std::
 #endif
 
     // Post-process HDR pixels if needed (color space conversion, tone mapping, etc.)
-    HDRProcessing::post_process_hdr(pixels, width, height, quantization_format);
+    HDRProcessing::post_process_hdr(job.pixels, job.width, job.height, job.format);
 
     bool save_success = false;
 
@@ -249,13 +464,13 @@ static void hdr_save_thread_v67(std::uint8_t *pixels, std::uint32_t width, std::
         save_success = stbi_write_hdr_png_to_func(
             write_callback,
             file,
-            width,
-            height,
+            job.width,
+            job.height,
             comp,
-            reinterpret_cast<uint16_t *>(pixels),
+            reinterpret_cast<uint16_t *>(job.pixels),
             0,
             static_cast<unsigned char>(JXL_PRIMARIES_2100),
-            static_cast<unsigned char>(color_space == reshade::api::color_space::hdr10_hlg ? JXL_TRANSFER_FUNCTION_HLG : JXL_TRANSFER_FUNCTION_PQ)) != 0;
+            static_cast<unsigned char>(job.color_space == reshade::api::color_space::hdr10_hlg ? JXL_TRANSFER_FUNCTION_HLG : JXL_TRANSFER_FUNCTION_PQ)) != 0;
 
         if (ferror(file))
             save_success = false;
@@ -269,362 +484,92 @@ static void hdr_save_thread_v67(std::uint8_t *pixels, std::uint32_t width, std::
 #endif
 
         // Use shared function to convert HDR to SDR
-        convert_hdr_to_sdr_with_hdrfix(temp_path_string, unique_id);
+        convert_hdr_to_sdr_with_hdrfix(core, temp_path_string, unique_id);
     } else {
 #ifdef LOG_DEBUG_STEP
         reshade::log::message(reshade::log::level::debug, "HDR PNG save failed");
 #endif
 
-        if (g_finish_callback) {
-            g_finish_callback(RESULT_SCREEN_CAPTURE_HDR_NOT_SAVEABLE, 0, 0, nullptr);
-        }
-        g_finish_callback = nullptr;
+        core.finish(RESULT_SCREEN_CAPTURE_HDR_NOT_SAVEABLE);
     }
 
-    is_hdr_converting = false;
+    core.end_hdr_conversion();
+
+    if (save_success) {
+        archive_hdr_capture(temp_path, unique_id);
+    }
 }
 
-static bool is_screenshot_requested() {
-    return screenshot_requested;
+static void hdr_save_thread(CaptureCore &core, HdrCaptureJob job) {
+    if (job.quantized) {
+        hdr_save_thread_v67(core, job);
+    } else {
+        hdr_convert_thread(core, job);
+    }
 }
 
-static void capture_screenshot_impl();
+static void log_capture_message(CaptureLogLevel level, const char *message) {
+    switch (level) {
+    case CaptureLogLevel::Error:
+        reshade::log::message(reshade::log::level::error, message);
+        break;
+    case CaptureLogLevel::Warning:
+        reshade::log::message(reshade::log::level::warning, message);
+        break;
+    default:
+        reshade::log::message(reshade::log::level::debug, message);
+        break;
+    }
+}
 
 static void on_present_without_effects_applied(reshade::api::command_queue *queue, reshade::api::swapchain *swapchain, const reshade::api::rect *source_rect,
     const reshade::api::rect *dest_rect, uint32_t dirty_rect_count, const reshade::api::rect *dirty_rect) {
     current_swapchain = swapchain;
-
-    if (is_screenshot_requested()) {
-        if (g_screenshot_before_reshade) {
-            capture_screenshot_impl();
-        }
-    }
+    g_capture_core.on_present(g_frame_source, false);
 }
 
 static void on_present_with_effects_applied(reshade::api::effect_runtime *runtime)
 {
     current_reshade_runtime = runtime;
-
-    if (is_screenshot_requested()) {
-        if (!g_screenshot_before_reshade) {
-            capture_screenshot_impl();
-        }
-    }
+    g_capture_core.on_present(g_frame_source, true);
 }
 
-// Copied
-const std::uint8_t *do_quanitization(reshade::api::format quantization_format, reshade::api::format source_format, std::vector<std::uint8_t> &pixels_vector, const std::uint8_t *mapped_pixels, int width, int height) {
-    if (quantization_format == source_format) {
-        return mapped_pixels;
-    }
-    
-    const uint32_t pixels_row_pitch = reshade::api::format_row_pitch(quantization_format, width);
-    const uint32_t mapped_pixels_row_pitch = reshade::api::format_row_pitch(source_format, width);
-
-    auto result_size = static_cast<std::size_t>(height) * pixels_row_pitch;
-    if (pixels_vector.size() < result_size) {
-        pixels_vector.resize(result_size);
-    }
-
-    auto pixels = pixels_vector.data();
-
-    for (size_t y = 0; y < height; ++y, pixels += pixels_row_pitch, mapped_pixels += mapped_pixels_row_pitch) {
-        if (quantization_format == reshade::api::format::r8g8b8a8_unorm)
-        {
-            switch (source_format)
-            {
-            case reshade::api::format::r8_unorm:
-                for (size_t x = 0; x < width; ++x)
-                {
-                    pixels[x * 4 + 0] = mapped_pixels[x];
-                    pixels[x * 4 + 1] = 0;
-                    pixels[x * 4 + 2] = 0;
-                    pixels[x * 4 + 3] = 0xFF;
-                }
-                continue;
-            case reshade::api::format::r8g8_unorm:
-                for (size_t x = 0; x < width; ++x)
-                {
-                    pixels[x * 4 + 0] = mapped_pixels[x * 2 + 0];
-                    pixels[x * 4 + 1] = mapped_pixels[x * 2 + 1];
-                    pixels[x * 4 + 2] = 0;
-                    pixels[x * 4 + 3] = 0xFF;
-                }
-                continue;
-            case reshade::api::format::r8g8b8x8_unorm:
-                for (size_t x = 0; x < pixels_row_pitch; x += 4)
-                {
-                    pixels[x + 0] = mapped_pixels[x + 0];
-                    pixels[x + 1] = mapped_pixels[x + 1];
-                    pixels[x + 2] = mapped_pixels[x + 2];
-                    pixels[x + 3] = 0xFF;
-                }
-                continue;
-            case reshade::api::format::b8g8r8a8_unorm:
-                // Format is BGRA, but output should be RGBA, so flip channels
-                for (size_t x = 0; x < pixels_row_pitch; x += 4)
-                {
-                    pixels[x + 0] = mapped_pixels[x + 2];
-                    pixels[x + 1] = mapped_pixels[x + 1];
-                    pixels[x + 2] = mapped_pixels[x + 0];
-                    pixels[x + 3] = mapped_pixels[x + 3];
-                }
-                continue;
-            case reshade::api::format::b8g8r8x8_unorm:
-                for (size_t x = 0; x < pixels_row_pitch; x += 4)
-                {
-                    pixels[x + 0] = mapped_pixels[x + 2];
-                    pixels[x + 1] = mapped_pixels[x + 1];
-                    pixels[x + 2] = mapped_pixels[x + 0];
-                    pixels[x + 3] = 0xFF;
-                }
-                continue;
-            case reshade::api::format::r10g10b10a2_unorm:
-            case reshade::api::format::b10g10r10a2_unorm:
-                for (size_t x = 0; x < pixels_row_pitch; x += 4)
-                {
-                    const auto offset_r = source_format == reshade::api::format::b10g10r10a2_unorm ? 2 : 0;
-                    const auto offset_g = 1;
-                    const auto offset_b = source_format == reshade::api::format::b10g10r10a2_unorm ? 0 : 2;
-                    const auto offset_a = 3;
-
-                    const uint32_t rgba = *reinterpret_cast<const uint32_t *>(mapped_pixels + x);
-                    // Divide by 4 to get 10-bit range (0-1023) into 8-bit range (0-255)
-                    pixels[x + offset_r] = (( rgba & 0x000003FFu)        /  4) & 0xFF;
-                    pixels[x + offset_g] = (((rgba & 0x000FFC00u) >> 10) /  4) & 0xFF;
-                    pixels[x + offset_b] = (((rgba & 0x3FF00000u) >> 20) /  4) & 0xFF;
-                    pixels[x + offset_a] = (((rgba & 0xC0000000u) >> 30) * 85) & 0xFF;
-                }
-                continue;
-            }
-        }
-        else if (quantization_format == reshade::api::format::r16g16b16_unorm)
-        {
-            switch (source_format)
-            {
-            case reshade::api::format::r10g10b10a2_unorm:
-            case reshade::api::format::b10g10r10a2_unorm:
-                for (size_t x = 0; x < pixels_row_pitch; x += sizeof(uint16_t) * 3)
-                {
-                    const auto offset_r = source_format == reshade::api::format::b10g10r10a2_unorm ? 2 : 0;
-                    const auto offset_g = 1;
-                    const auto offset_b = source_format == reshade::api::format::b10g10r10a2_unorm ? 0 : 2;
-
-                    const uint32_t rgba = *reinterpret_cast<const uint32_t *>(mapped_pixels + (x / (sizeof(uint16_t) * 3)) * 4);
-                    // Multiply by 64 to get 10-bit range (0-1023) into 16-bit range (0-65535)
-                    reinterpret_cast<uint16_t *>(pixels + x)[offset_r] = ( (rgba & 0x000003FFu)        * 64) & 0xFFFF;
-                    reinterpret_cast<uint16_t *>(pixels + x)[offset_g] = (((rgba & 0x000FFC00u) >> 10) * 64) & 0xFFFF;
-                    reinterpret_cast<uint16_t *>(pixels + x)[offset_b] = (((rgba & 0x3FF00000u) >> 20) * 64) & 0xFFFF;
-                }
-                continue;
-            }
-        }
-        else if (quantization_format == reshade::api::format::r16g16b16_float && source_format == reshade::api::format::r16g16b16a16_float)
-        {
-            for (size_t x = 0; x < pixels_row_pitch; x += sizeof(uint16_t) * 3)
-            {
-                std::memcpy(pixels + x, mapped_pixels + (x / 3) * 4, sizeof(uint16_t) * 3);
-            }
-            continue;
-        }
-        else if (quantization_format == reshade::api::format::r10g10b10a2_unorm && source_format == reshade::api::format::b10g10r10a2_unorm)
-        {
-            // Format is BGRA, but output should be RGBA, so flip channels
-            for (size_t x = 0; x < pixels_row_pitch; x += sizeof(uint32_t))
-            {
-                const uint32_t rgba = *reinterpret_cast<const uint32_t *>(mapped_pixels + x);
-                *reinterpret_cast<uint32_t *>(pixels + x) = ((rgba & 0x000003FFu) << 20) | ((rgba & 0x3FF00000u) >> 20) | (rgba & 0xC00FFC00u);
-            }
-            continue;
-        }
-    }
+extern "C" int request_screen_capture(ScreenCaptureFinishFunc finish_callback, int hdr_bit_depths, bool screenshot_before_reshade) {
+    return request_screen_capture_multi_frame(finish_callback, hdr_bit_depths, screenshot_before_reshade, 1, SCREEN_CAPTURE_MERGE_MEAN);
+}
 
-    return pixels_vector.data();
+extern "C" int request_screen_capture_multi_frame(ScreenCaptureFinishFunc finish_callback, int hdr_bit_depths,
+    bool screenshot_before_reshade, int frame_count, int merge_mode) {
+    return g_capture_core.request(finish_callback, hdr_bit_depths, screenshot_before_reshade, frame_count, merge_mode);
 }
 
-static void capture_screenshot_impl() {
-    if (!is_screenshot_requested()) {
-        return;
-    }
+extern "C" void set_scene_settle_watch(bool enable, bool screenshot_before_reshade, float settled_threshold) {
+    g_capture_core.set_scene_settle_watch(enable, screenshot_before_reshade, settled_threshold);
+}
 
-    if (is_hdr_converting) {
+extern "C" void get_scene_settle_status(SceneSettleStatus *status) {
+    if (status == nullptr) {
         return;
     }
 
-    screenshot_requested = false;
-
-    auto back_buffer = current_reshade_runtime->get_current_back_buffer();
-    auto resource_description = current_reshade_runtime->get_device()->get_resource_desc(back_buffer);
-
-    auto format = reshade::api::format_to_default_typed(resource_description.texture.format);
-    auto color_space = current_swapchain->get_color_space();
-
-    if (version_info.major >= 6 && version_info.minor >= 7) {
-        // From ReShade 6.7 onwards, the pixels have to be manually quantized
-        bool is_hdr = (format == reshade::api::format::r16g16b16a16_float) || (color_space == reshade::api::color_space::hdr10_st2084) ||
-                      (color_space == reshade::api::color_space::hdr10_hlg);
-
-        std::uint32_t width, height;
-        current_reshade_runtime->get_screenshot_width_and_height(&width, &height);
-        
-        auto bytes_per_pixel = (format == reshade::api::format::r16g16b16a16_float) ? 8 : 4; // 4 bytes for RGBA, 8 bytes for HDR scRGB
-        std::size_t required_size = width * height * bytes_per_pixel;
-        
-        // Reuse cached buffer or reallocate if needed
-        if (g_cached_pixels.size() < required_size) {
-            g_cached_pixels.resize(required_size);
-        }
-        
-        auto pixels = g_cached_pixels.data();
-
-    #ifdef LOG_DEBUG_STEP
-        reshade::log::message(reshade::log::level::debug, "Start capturing screenshot (v6.7+)");
-    #endif
-
-        if (!current_reshade_runtime->capture_screenshot(pixels)) {
-            if (g_finish_callback) {
-                g_finish_callback(RESULT_SCREEN_RESHADE_CAPTURE_FAILURE, 0, 0, nullptr);
-            }
-            g_finish_callback = nullptr; // Reset the callback to allow new requests
-            return;
-        }
-
-        auto quantization_format = reshade::api::format::r8g8b8a8_unorm;
-
-        if (is_hdr) {
-            if (format == reshade::api::format::r16g16b16a16_float) {
-                quantization_format = reshade::api::format::r16g16b16_float;
-            } else {
-                quantization_format = reshade::api::format::r16g16b16_unorm;
-            }
-        }
-
-        // Perform quantization
-        const auto quantized_pixels = do_quanitization(quantization_format, format, g_cached_converted_pixels, pixels, width, height);
-
-    #ifdef LOG_DEBUG_STEP
-        reshade::log::message(reshade::log::level::debug, "Capturing screenshot finished");
-    #endif
-
-        if (g_finish_callback != nullptr) {
-            g_finish_callback(RESULT_SCREEN_CAPTURE_DATA_DOWNLOADED, width, height, nullptr);
-        }
-
-        // Create a thread that dump qnauntized pixels to PNG
-        /*
-        auto dump_to_png_quantized = [=]() {
-            auto original_dll_containing_path = std::filesystem::path(get_current_dll_path()).parent_path().parent_path();
-            auto path_output = (original_dll_containing_path / "test.png").string();
-
-            stbi_write_png_to_func(
-                [](void *context, void *data, int size) {
-                    fwrite(data, 1, size, static_cast<FILE *>(context));
-                },
-                fopen(path_output.c_str(), "wb"),
-                width,
-                height,
-                (quantization_format == reshade::api::format::r8g8b8a8_unorm) ? 4 : 3,
-                quantized_pixels,
-                0);
-
-                reshade::log::message(reshade::log::level::debug, "Dumped quantized PNG for debugging to test.png");
-        };
-
-        std::thread(dump_to_png_quantized).detach();*/
-
-        if (!is_hdr) {
-    #ifdef LOG_DEBUG_STEP
-            reshade::log::message(reshade::log::level::debug, "Screenshot is not HDR, sending it directly");
-    #endif
-
-            if (g_finish_callback) {
-                g_finish_callback(RESULT_SCREEN_CAPTURE_SUCCESS, width, height, const_cast<std::uint8_t*>(quantized_pixels));
-            }
-
-            g_finish_callback = nullptr; // Reset the callback to allow new requests
-            return;
-        } else {
-    #ifdef LOG_DEBUG_STEP
-            reshade::log::message(reshade::log::level::debug, "Screenshot is HDR, launching HDR PNG save");
-    #endif
-
-            // Launch a thread to save the HDR image directly to PNG with proper color space
-            is_hdr_converting = true;
-            std::thread(hdr_save_thread_v67, const_cast<std::uint8_t*>(quantized_pixels), width, height, quantization_format, color_space).detach();
-            return;
-        }
-    }
-    else {
-        bool is_hdr = (format == reshade::api::format::r16g16b16a16_float) ||
-                    ((format == reshade::api::format::b10g10r10a2_unorm) || (format == reshade::api::format::r10g10b10a2_unorm)) && (color_space == reshade::api::color_space::hdr10_st2084);
-
-        std::uint32_t width, height;
-        current_reshade_runtime->get_screenshot_width_and_height(&width, &height);
-        
-        auto bytes_per_pixel = (format == reshade::api::format::r16g16b16a16_float) ? 8 : 4; // 4 bytes for RGBA, 8 bytes for HDR scRGB
-        std::size_t required_size = width * height * bytes_per_pixel;
-        
-        // Reuse cached buffer or reallocate if needed
-        if (g_cached_pixels.size() < required_size) {
-            g_cached_pixels.resize(required_size);
-        }
-        
-        auto pixels = g_cached_pixels.data();
-
-    #ifdef LOG_DEBUG_STEP
-        reshade::log::message(reshade::log::level::debug, "Start capturing screenshot (v6.7-)");
-    #endif
-
-        if (!current_reshade_runtime->capture_screenshot(pixels)) {
-            if (g_finish_callback) {
-                g_finish_callback(RESULT_SCREEN_RESHADE_CAPTURE_FAILURE, 0, 0, nullptr);
-            }
-            g_finish_callback = nullptr; // Reset the callback to allow new requests
-            return;
-        }
-
-    #ifdef LOG_DEBUG_STEP
-        reshade::log::message(reshade::log::level::debug, "Capturing screenshot finished");
-    #endif
-
-        if (g_finish_callback != nullptr) {
-            g_finish_callback(RESULT_SCREEN_CAPTURE_DATA_DOWNLOADED, width, height, nullptr);
-        }
+    *status = g_capture_core.get_scene_settle_status();
+}
 
-        if (!is_hdr) {
-    #ifdef LOG_DEBUG_STEP
-            reshade::log::message(reshade::log::level::debug, "Screenshot is not HDR, sending it directly");
-    #endif
+extern "C" void set_hdr_capture_archive_directory(const char *directory) {
+    std::scoped_lock lock(g_hdr_archive_mutex);
+    g_hdr_archive_directory = (directory != nullptr) ? directory : "";
+}
 
-            if (g_finish_callback) {
-                g_finish_callback(RESULT_SCREEN_CAPTURE_SUCCESS, width, height, pixels);
-            }
-            g_finish_callback = nullptr; // Reset the callback to allow new requests
-            return;
-        } else {
-    #ifdef LOG_DEBUG_STEP
-            reshade::log::message(reshade::log::level::debug, "Screenshot is HDR, launching conversion to SDR");
-    #endif
-
-            // Launch a thread to convert the HDR image to SDR
-            is_hdr_converting = true;
-            std::thread(hdr_convert_thread, pixels, width, height, format, g_hdr_bit_depths).detach();
-            return;
-        }
-    }
+extern "C" void set_pixel_buffer_arena_config(std::uint64_t budget_bytes, int idle_timeout_ms, bool use_large_pages) {
+    PixelBufferArena::get().configure(static_cast<std::size_t>(budget_bytes), std::chrono::milliseconds(idle_timeout_ms), use_large_pages);
 }
 
-extern "C" int request_screen_capture(ScreenCaptureFinishFunc finish_callback, int hdr_bit_depths, bool screenshot_before_reshade) {
-    if (g_finish_callback) {
-        return RESULT_SCREEN_CAPTURE_IN_PROGRESS;
+extern "C" void get_pixel_buffer_arena_stats(PixelBufferArenaStats *stats) {
+    if (stats == nullptr) {
+        return;
     }
 
-    g_finish_callback = finish_callback;
-    g_hdr_bit_depths = hdr_bit_depths;
-    g_screenshot_before_reshade = screenshot_before_reshade;
-    screenshot_requested = true;
-
-    return RESULT_SCREEN_CAPTURE_SUBMITTED;
+    *stats = PixelBufferArena::get().get_stats();
 }
 
 extern "C" void set_reshade_filters_enable(bool should_enable) {
@@ -657,6 +602,10 @@ BOOL WINAPI DllMain(HINSTANCE hinstDLL, DWORD fdwReason, LPVOID)
             }
         }
 
+        g_capture_core.set_log_func(&log_capture_message);
+        g_capture_core.set_hdr_save_func(&hdr_save_thread);
+        g_capture_core.set_quantize_in_addon(version_info.major >= 6 && version_info.minor >= 7);
+
         // This registers a callback for the 'present' event, which occurs every time a new frame is presented to the screen.
         // The function signature has to match the type defined by 'reshade::addon_event_traits<reshade::addon_event::present>::decl'.
         // For more details check the inline documentation for each event in 'reshade_events.hpp'.
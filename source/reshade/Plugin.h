@@ -1,16 +1,25 @@
 #pragma once
 
-typedef void (*ScreenCaptureFinishFunc)(int result, int width, int height, void *data);
-
-const int RESULT_SCREEN_CAPTURE_IN_PROGRESS = -2;
-const int RESULT_SCREEN_RESHADE_CAPTURE_FAILURE = -1;
-const int RESULT_SCREEN_CAPTURE_NO_RESHADE_RUNTIME = -3;
-const int RESULT_SCREEN_CAPTURE_HDR_NOT_SAVEABLE = -4;
-const int RESULT_SCREEN_CAPTURE_HDR_TO_SDR_FAILED = -5;
-const int RESULT_SCREEN_CAPTURE_HDR_FAILED = -6;
-const int RESULT_SCREEN_CAPTURE_SUCCESS = 0;
-const int RESULT_SCREEN_CAPTURE_SUBMITTED = 1;
-const int RESULT_SCREEN_CAPTURE_DATA_DOWNLOADED = 2;
+#include "CaptureTypes.h"
+#include "PixelBufferArena.hpp"
 
 extern "C" __declspec(dllexport) int request_screen_capture(ScreenCaptureFinishFunc finish_callback, int hdr_bit_depths, bool screenshot_before_reshade);
-extern "C" __declspec(dllexport) void set_reshade_filters_enable(bool should_enable);
\ No newline at end of file
+
+// Same as request_screen_capture, but merges frame_count consecutive frames into one to average out frame generation and TAA noise.
+// Median of 3 always takes 3 frames. HDR captures take a single frame. RESULT_SCREEN_CAPTURE_DATA_DOWNLOADED is sent after the last frame.
+extern "C" __declspec(dllexport) int request_screen_capture_multi_frame(ScreenCaptureFinishFunc finish_callback, int hdr_bit_depths,
+    bool screenshot_before_reshade, int frame_count, int merge_mode);
+extern "C" __declspec(dllexport) void set_reshade_filters_enable(bool should_enable);
+
+// HDR captures also keep their 16-bit PNG in this directory (UTF-8) under a unique name, once the SDR image was sent.
+// Null or empty turns it off
+extern "C" __declspec(dllexport) void set_hdr_capture_archive_directory(const char *directory);
+
+// While enabled, every presented frame is reduced to a tiny brightness thumbnail and compared to the previous one,
+// so the caller can tell when the UI fade and motion blur have converged. Enabling again restarts the watch.
+extern "C" __declspec(dllexport) void set_scene_settle_watch(bool enable, bool screenshot_before_reshade, float settled_threshold);
+extern "C" __declspec(dllexport) void get_scene_settle_status(SceneSettleStatus *status);
+
+// Limits of the addon's capture buffers, see PixelBufferArena. Buffers already in use are kept until their capture is done
+extern "C" __declspec(dllexport) void set_pixel_buffer_arena_config(std::uint64_t budget_bytes, int idle_timeout_ms, bool use_large_pages);
+extern "C" __declspec(dllexport) void get_pixel_buffer_arena_stats(PixelBufferArenaStats *stats);
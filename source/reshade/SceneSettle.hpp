@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <emmintrin.h>
+
+namespace SceneSettle {
+
+constexpr std::uint32_t THUMBNAIL_WIDTH = 64;
+constexpr std::uint32_t THUMBNAIL_HEIGHT = 36;
+constexpr std::size_t THUMBNAIL_SIZE = THUMBNAIL_WIDTH * THUMBNAIL_HEIGHT;
+
+// Only this many rows of each thumbnail cell are read back, the cells are dozens of rows tall
+constexpr std::uint32_t SAMPLE_ROWS_PER_CELL = 4;
+constexpr std::uint32_t SAMPLE_ROW_COUNT = THUMBNAIL_HEIGHT * SAMPLE_ROWS_PER_CELL;
+
+static_assert(THUMBNAIL_SIZE % 16 == 0, "Thumbnail diff works on whole 16 byte blocks");
+
+/**
+ * Sum of the R, G and B bytes of 8-bit 4 channel pixels, alpha is masked out.
+ * The channel order does not matter, so both RGBA and BGRA back buffers work
+ */
+inline std::uint64_t sum_rgb_8bit(const std::uint8_t *pixels, std::uint32_t count) {
+    const __m128i rgb_mask = _mm_set1_epi32(0x00FFFFFF);
+    const __m128i zero = _mm_setzero_si128();
+
+    __m128i accumulator = _mm_setzero_si128();
+    std::uint32_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        __m128i block = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + i * 4)), rgb_mask);
+
+        // Two 64-bit lanes, each the sum of 8 bytes
+        accumulator = _mm_add_epi64(accumulator, _mm_sad_epu8(block, zero));
+    }
+
+    alignas(16) std::uint64_t lanes[2];
+    _mm_store_si128(reinterpret_cast<__m128i *>(lanes), accumulator);
+
+    std::uint64_t sum = lanes[0] + lanes[1];
+
+    for (; i < count; i++) {
+        sum += pixels[i * 4 + 0] + pixels[i * 4 + 1] + pixels[i * 4 + 2];
+    }
+
+    return sum;
+}
+
+/**
+ * The frame rows a thumbnail is built from, SAMPLE_ROWS_PER_CELL evenly spread over each cell row
+ *
+ * @param rows Output, SAMPLE_ROW_COUNT row indices
+ */
+inline void pick_sample_rows(std::uint32_t height, std::uint32_t *rows) {
+    for (std::uint32_t cell_y = 0; cell_y < THUMBNAIL_HEIGHT; cell_y++) {
+        std::uint32_t y_begin = cell_y * height / THUMBNAIL_HEIGHT;
+        std::uint32_t y_end = (cell_y + 1) * height / THUMBNAIL_HEIGHT;
+
+        for (std::uint32_t i = 0; i < SAMPLE_ROWS_PER_CELL; i++) {
+            std::uint32_t y = y_begin + (2 * i + 1) * (y_end - y_begin) / (2 * SAMPLE_ROWS_PER_CELL);
+            rows[cell_y * SAMPLE_ROWS_PER_CELL + i] = (y < height) ? y : height - 1;
+        }
+    }
+}
+
+/**
+ * Box-downsample 8-bit 4 channel pixels to a THUMBNAIL_WIDTH x THUMBNAIL_HEIGHT brightness thumbnail
+ *
+ * @param pixels The frame or its sample rows (see pick_sample_rows), tightly packed rows
+ * @param thumbnail Output, THUMBNAIL_SIZE bytes
+ */
+inline void build_thumbnail(const std::uint8_t *pixels, std::uint32_t width, std::uint32_t height, std::uint8_t *thumbnail) {
+    std::uint64_t cell_sums[THUMBNAIL_WIDTH];
+
+    for (std::uint32_t cell_y = 0; cell_y < THUMBNAIL_HEIGHT; cell_y++) {
+        std::uint32_t y_begin = cell_y * height / THUMBNAIL_HEIGHT;
+        std::uint32_t y_end = (cell_y + 1) * height / THUMBNAIL_HEIGHT;
+        std::uint32_t rows_sampled = 0;
+
+        for (auto &cell_sum : cell_sums) {
+            cell_sum = 0;
+        }
+
+        for (std::uint32_t y = y_begin; y < y_end; y++) {
+            const std::uint8_t *row = pixels + static_cast<std::size_t>(y) * width * 4;
+
+            for (std::uint32_t cell_x = 0; cell_x < THUMBNAIL_WIDTH; cell_x++) {
+                std::uint32_t x_begin = cell_x * width / THUMBNAIL_WIDTH;
+                std::uint32_t x_end = (cell_x + 1) * width / THUMBNAIL_WIDTH;
+
+                cell_sums[cell_x] += sum_rgb_8bit(row + static_cast<std::size_t>(x_begin) * 4, x_end - x_begin);
+            }
+
+            rows_sampled++;
+        }
+
+        for (std::uint32_t cell_x = 0; cell_x < THUMBNAIL_WIDTH; cell_x++) {
+            std::uint64_t samples = static_cast<std::uint64_t>(rows_sampled) * (((cell_x + 1) * width / THUMBNAIL_WIDTH) - (cell_x * width / THUMBNAIL_WIDTH)) * 3;
+            thumbnail[cell_y * THUMBNAIL_WIDTH + cell_x] = samples ? static_cast<std::uint8_t>(cell_sums[cell_x] / samples) : 0;
+        }
+    }
+}
+
+/**
+ * Mean absolute difference between two thumbnails, in 8-bit levels
+ */
+inline float mean_abs_diff(const std::uint8_t *a, const std::uint8_t *b) {
+    __m128i accumulator = _mm_setzero_si128();
+
+    for (std::size_t i = 0; i < THUMBNAIL_SIZE; i += 16) {
+        __m128i block_a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+        __m128i block_b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i));
+
+        accumulator = _mm_add_epi64(accumulator, _mm_sad_epu8(block_a, block_b));
+    }
+
+    alignas(16) std::uint64_t lanes[2];
+    _mm_store_si128(reinterpret_cast<__m128i *>(lanes), accumulator);
+
+    return static_cast<float>(lanes[0] + lanes[1]) / static_cast<float>(THUMBNAIL_SIZE);
+}
+
+} // namespace SceneSettle
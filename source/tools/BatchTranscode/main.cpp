@@ -0,0 +1,389 @@
+// Converts a folder of screenshots to WebP images the game accepts as album/profile/override images,
+// with the same resize and quality search the plugin uses for override images.
+//
+// Usage: MHWildsBatchTranscode <input_dir> <output_dir> [options]
+//   --width <px>          Target width (default 1920)
+//   --height <px>         Target height (default 1080)
+//   --max-kb <KB>         Encoded size must stay below this (default 256)
+//   --max-quality <q>     Highest quality tried (default 100)
+//   --min-quality <q>     Lowest quality accepted (default 10)
+//   --threads <n>         Worker threads (default: all cores)
+//   --force               Ignore the manifest and convert everything again
+
+#include "ImageTranscoder.hpp"
+
+#include <BS_thread_pool.hpp>
+#include <glaze/glaze.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+    static const char *MANIFEST_FILE_NAME = ".mhwilds_transcode_manifest.json";
+
+    struct ManifestEntry {
+        std::uint64_t source_size = 0;
+        std::int64_t source_last_write_time = 0;
+        std::uint64_t target_hash = 0;
+
+        std::string output;
+        std::uint64_t output_size = 0;
+        int quality = 0;
+    };
+
+    struct Manifest {
+        int version = 1;
+
+        // By source path, relative to the input directory
+        std::map<std::string, ManifestEntry> files;
+    };
+
+    struct Options {
+        fs::path input_dir;
+        fs::path output_dir;
+
+        TranscodeTarget target;
+        unsigned int thread_count = 0;
+        bool force = false;
+    };
+
+    struct FileJob {
+        fs::path source_path;
+        std::string relative_path;
+        std::string output_relative_path;
+        std::uint64_t source_size;
+        std::int64_t source_last_write_time;
+    };
+
+    struct FileResult {
+        std::string relative_path;
+        bool success = false;
+        std::string error;
+
+        ManifestEntry entry;
+
+        int source_width = 0;
+        int source_height = 0;
+        int encode_attempts = 0;
+        double milliseconds = 0.0;
+    };
+
+    void print_usage() {
+        std::fputs("Usage: MHWildsBatchTranscode <input_dir> <output_dir> [--width px] [--height px] [--max-kb KB]\n"
+            "                             [--max-quality q] [--min-quality q] [--threads n] [--force]\n", stderr);
+    }
+
+    bool parse_int_option(int argc, char **argv, int &index, int &value) {
+        if (index + 1 >= argc) {
+            std::fprintf(stderr, "Missing value for %s\n", argv[index]);
+            return false;
+        }
+
+        char *end = nullptr;
+        long parsed = std::strtol(argv[++index], &end, 10);
+
+        if (end == argv[index] || *end != '\0' || parsed <= 0) {
+            std::fprintf(stderr, "Invalid value for %s: %s\n", argv[index - 1], argv[index]);
+            return false;
+        }
+
+        value = static_cast<int>(parsed);
+        return true;
+    }
+
+    bool parse_options(int argc, char **argv, Options &options) {
+        std::vector<std::string> positional;
+
+        options.target.width = 1920;
+        options.target.height = 1080;
+        options.target.max_bytes = 256 * 1024;
+
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            int value = 0;
+
+            if (arg == "--help" || arg == "-h") {
+                return false;
+            } else if (arg == "--force") {
+                options.force = true;
+            } else if (arg == "--width" || arg == "--height" || arg == "--max-kb" || arg == "--max-quality" ||
+                arg == "--min-quality" || arg == "--threads") {
+                if (!parse_int_option(argc, argv, i, value)) {
+                    return false;
+                }
+
+                if (arg == "--width") {
+                    options.target.width = value;
+                } else if (arg == "--height") {
+                    options.target.height = value;
+                } else if (arg == "--max-kb") {
+                    options.target.max_bytes = static_cast<std::size_t>(value) * 1024;
+                } else if (arg == "--max-quality") {
+                    options.target.max_quality = std::min(value, 100);
+                } else if (arg == "--min-quality") {
+                    options.target.min_quality = std::min(value, 100);
+                } else {
+                    options.thread_count = static_cast<unsigned int>(value);
+                }
+            } else if (arg.starts_with("--")) {
+                std::fprintf(stderr, "Unknown option: %s\n", arg.c_str());
+                return false;
+            } else {
+                positional.push_back(arg);
+            }
+        }
+
+        if (positional.size() != 2) {
+            return false;
+        }
+
+        if (options.target.min_quality > options.target.max_quality) {
+            std::fputs("--min-quality can't be above --max-quality\n", stderr);
+            return false;
+        }
+
+        options.input_dir = positional[0];
+        options.output_dir = positional[1];
+
+        return true;
+    }
+
+    bool is_supported_extension(const fs::path &path) {
+        auto extension = path.extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+        return extension == ".webp" || extension == ".png" || extension == ".jpg" || extension == ".jpeg";
+    }
+
+    // Case folded, two sources only differing in case would still write the same file on Windows
+    std::string output_collision_key(const std::string &relative_path) {
+        auto key = fs::path(relative_path).replace_extension(".webp").generic_string();
+        std::transform(key.begin(), key.end(), key.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+        return key;
+    }
+
+    // a.png and a.jpg would both become a.webp, sources sharing a name keep their extension in the output name instead
+    void assign_output_paths(std::vector<FileJob> &candidates) {
+        std::map<std::string, std::size_t> source_count_by_output;
+
+        for (const auto &job : candidates) {
+            source_count_by_output[output_collision_key(job.relative_path)]++;
+        }
+
+        for (auto &job : candidates) {
+            if (source_count_by_output[output_collision_key(job.relative_path)] > 1) {
+                job.output_relative_path = job.relative_path + ".webp";
+                std::printf("%s: shares its name with another source, written as %s\n", job.relative_path.c_str(),
+                    job.output_relative_path.c_str());
+            } else {
+                job.output_relative_path = fs::path(job.relative_path).replace_extension(".webp").generic_string();
+            }
+        }
+    }
+
+    bool read_whole_file(const fs::path &path, std::vector<std::uint8_t> &data) {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+
+        if (!file) {
+            return false;
+        }
+
+        data.resize(static_cast<std::size_t>(file.tellg()));
+        file.seekg(0);
+
+        return static_cast<bool>(file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size())));
+    }
+
+    FileResult process_file(const FileJob &job, const Options &options, std::uint64_t target_hash) {
+        auto start = std::chrono::steady_clock::now();
+
+        FileResult result;
+        result.relative_path = job.relative_path;
+
+        std::vector<std::uint8_t> source;
+
+        if (!read_whole_file(job.source_path, source)) {
+            result.error = "Can't read the file";
+            return result;
+        }
+
+        // The avir resize stays single threaded, files are already spread over every core
+        auto transcode_result = ImageTranscoder::transcode(source.data(), source.size(), options.target);
+
+        result.source_width = transcode_result.source_width;
+        result.source_height = transcode_result.source_height;
+        result.encode_attempts = transcode_result.encode_attempts;
+
+        if (!transcode_result.success) {
+            result.error = transcode_result.error;
+            return result;
+        }
+
+        auto output_path = options.output_dir / job.output_relative_path;
+
+        std::error_code ec;
+        fs::create_directories(output_path.parent_path(), ec);
+
+        std::ofstream output(output_path, std::ios::binary | std::ios::trunc);
+
+        if (!output.write(reinterpret_cast<const char*>(transcode_result.webp.data()), static_cast<std::streamsize>(transcode_result.webp.size()))) {
+            result.error = "Can't write " + output_path.string();
+            return result;
+        }
+
+        result.success = true;
+        result.entry = ManifestEntry{ job.source_size, job.source_last_write_time, target_hash, job.output_relative_path,
+            transcode_result.webp.size(), transcode_result.quality };
+        result.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        return result;
+    }
+}
+
+int main(int argc, char **argv) {
+    Options options;
+
+    if (!parse_options(argc, argv, options)) {
+        print_usage();
+        return 2;
+    }
+
+    std::error_code ec;
+
+    if (!fs::is_directory(options.input_dir, ec)) {
+        std::fprintf(stderr, "Input directory does not exist: %s\n", options.input_dir.string().c_str());
+        return 2;
+    }
+
+    fs::create_directories(options.output_dir, ec);
+
+    auto manifest_path = options.output_dir / MANIFEST_FILE_NAME;
+    Manifest manifest;
+
+    if (!options.force && fs::exists(manifest_path, ec)) {
+        auto error_context = glz::read_file_json(manifest, manifest_path.string().c_str(), std::string{});
+
+        if (error_context) {
+            std::fprintf(stderr, "Manifest is unreadable, converting everything again: %s\n", glz::format_error(error_context).c_str());
+            manifest = Manifest{};
+        }
+    }
+
+    // Only depends on the target, a source converted with other options is converted again
+    auto target_hash = ImageTranscoder::content_hash(nullptr, 0, options.target);
+
+    // The output directory may sit inside the input directory, its own WebP files must not be converted again
+    auto output_dir_canonical = fs::weakly_canonical(options.output_dir, ec);
+    std::vector<FileJob> candidates;
+    std::error_code scan_ec;
+
+    for (auto it = fs::recursive_directory_iterator(options.input_dir, scan_ec); !scan_ec && it != fs::recursive_directory_iterator();
+        it.increment(scan_ec)) {
+        const auto &dir_entry = *it;
+
+        if (dir_entry.is_directory(ec)) {
+            if (fs::weakly_canonical(dir_entry.path(), ec) == output_dir_canonical) {
+                it.disable_recursion_pending();
+            }
+
+            continue;
+        }
+
+        if (!dir_entry.is_regular_file(ec) || !is_supported_extension(dir_entry.path())) {
+            continue;
+        }
+
+        FileJob job;
+        job.source_path = dir_entry.path();
+        job.relative_path = fs::relative(dir_entry.path(), options.input_dir, ec).generic_string();
+        job.source_size = dir_entry.file_size(ec);
+        job.source_last_write_time = static_cast<std::int64_t>(dir_entry.last_write_time(ec).time_since_epoch().count());
+
+        candidates.push_back(std::move(job));
+    }
+
+    if (scan_ec) {
+        std::fprintf(stderr, "Failed to scan the input directory: %s\n", scan_ec.message().c_str());
+        return 1;
+    }
+
+    assign_output_paths(candidates);
+
+    std::vector<FileJob> jobs;
+    std::size_t skipped_count = 0;
+
+    for (auto &job : candidates) {
+        auto it = manifest.files.find(job.relative_path);
+
+        if (it != manifest.files.end() && it->second.source_size == job.source_size &&
+            it->second.source_last_write_time == job.source_last_write_time && it->second.target_hash == target_hash &&
+            it->second.output == job.output_relative_path && fs::exists(options.output_dir / it->second.output, ec)) {
+            skipped_count++;
+            continue;
+        }
+
+        jobs.push_back(std::move(job));
+    }
+
+    auto thread_count = options.thread_count ? options.thread_count : std::max(1u, std::thread::hardware_concurrency());
+
+    std::printf("%zu files to convert, %zu unchanged, %u threads, target %dx%d below %zu KB\n", jobs.size(), skipped_count,
+        thread_count, options.target.width, options.target.height, options.target.max_bytes / 1024);
+
+    BS::thread_pool<> thread_pool(thread_count);
+    std::mutex report_mutex;
+
+    std::size_t failed_count = 0;
+    auto batch_start = std::chrono::steady_clock::now();
+
+    for (const auto &job : jobs) {
+        thread_pool.detach_task([&job, &options, target_hash, &manifest, &report_mutex, &failed_count]() {
+            auto result = process_file(job, options, target_hash);
+
+            // Reported as they finish, the manifest is only touched under the same lock
+            std::scoped_lock lock(report_mutex);
+
+            if (result.success) {
+                std::printf("%s: %dx%d -> %dx%d, %llu KB, quality %d, %d encodes, %.0f ms\n", result.relative_path.c_str(),
+                    result.source_width, result.source_height, options.target.width, options.target.height,
+                    static_cast<unsigned long long>(result.entry.output_size / 1024), result.entry.quality, result.encode_attempts,
+                    result.milliseconds);
+
+                manifest.files[result.relative_path] = result.entry;
+            } else {
+                std::printf("%s: FAILED, %s\n", result.relative_path.c_str(), result.error.c_str());
+
+                manifest.files.erase(result.relative_path);
+                failed_count++;
+            }
+        });
+    }
+
+    thread_pool.wait();
+
+    auto batch_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - batch_start).count();
+
+    auto error_context = glz::write_file_json(manifest, manifest_path.string().c_str(), std::string{});
+
+    if (error_context) {
+        std::fprintf(stderr, "Failed to save the manifest: %s\n", glz::format_error(error_context).c_str());
+    }
+
+    std::printf("Done in %.2f s: %zu converted, %zu failed, %zu unchanged\n", batch_seconds, jobs.size() - failed_count, failed_count,
+        skipped_count);
+
+    return failed_count == 0 ? 0 : 1;
+}
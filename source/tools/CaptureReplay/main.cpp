@@ -0,0 +1,442 @@
+// Replays a capture trace recorded in game (Debug > Record Capture Trace) through the same capture state machines the plugin uses,
+// reports how many frames each step took and checks that every decision comes out the same as it did in game.
+//
+// Usage: MHWildsCaptureReplay <trace.csv> [options]
+//   --max-launch-frames <n>   Fail if a ReShade capture took more than n game updates from the request to its launch
+//   --max-inject-frames <n>   Fail if a save capture took more than n game updates from taking a request to injecting it
+//   --max-mismatches <n>      Mismatches printed before only counting them (default 20)
+//
+// Exits with 1 when a decision differs from the recording or a limit is exceeded, 2 when the trace can't be read.
+
+#include "CaptureSequencing.hpp"
+#include "CaptureTrace.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace {
+    struct Options {
+        std::string trace_path;
+
+        std::uint64_t max_launch_frames = std::numeric_limits<std::uint64_t>::max();
+        std::uint64_t max_inject_frames = std::numeric_limits<std::uint64_t>::max();
+        std::size_t max_printed_mismatches = 20;
+    };
+
+    // One freeze and UI hide, from the request to the timescale release
+    struct PrepareCapture {
+        const CaptureTraceEvent *start = nullptr;
+        const CaptureTraceEvent *launch = nullptr;
+        const CaptureTraceEvent *release = nullptr;
+        bool settled_early = false;
+    };
+
+    // One save capture of the game, from taking a pending request to injecting or dropping it
+    struct SaveCapture {
+        const CaptureTraceEvent *start = nullptr;
+        const CaptureTraceEvent *end = nullptr;
+        bool dropped = false;
+        int delayed_updates = 0;
+    };
+
+    struct Latency {
+        std::uint64_t frames = 0;
+        double milliseconds = 0.0;
+    };
+
+    class TraceReplayer {
+    public:
+        explicit TraceReplayer(const Options &options)
+            : options(options) {
+        }
+
+        void replay(const std::vector<CaptureTraceEvent> &events) {
+            for (std::size_t i = 0; i < events.size(); i++) {
+                const auto &event = events[i];
+
+                switch (event.kind) {
+                case CaptureTraceEventKind::PrepareStart:
+                    prepare_sequencer.start(event.values[0], event.values[1]);
+                    prepare_captures.push_back({ &event });
+                    break;
+
+                case CaptureTraceEventKind::PrepareUpdate:
+                    // Always recorded right before its result
+                    if (i + 1 >= events.size() || events[i + 1].kind != CaptureTraceEventKind::PrepareResult) {
+                        report_mismatch(event, "prepare update without its result, the trace is truncated");
+                        break;
+                    }
+
+                    replay_prepare_update(event, events[i + 1]);
+                    i++;
+                    break;
+
+                case CaptureTraceEventKind::PrepareResult:
+                    report_mismatch(event, "prepare result without its update");
+                    break;
+
+                case CaptureTraceEventKind::Timescale:
+                    replay_timescale(event);
+                    break;
+
+                case CaptureTraceEventKind::EndRendering:
+                    if (!prepare_sequencer.end_rendering() || prepare_sequencer.get_frame_left() != event.values[0]) {
+                        report_mismatch(event, "frame left after rendering %d, recorded %d", prepare_sequencer.get_frame_left(), event.values[0]);
+                    }
+                    break;
+
+                case CaptureTraceEventKind::SaveCaptureDelay:
+                    replay_save_capture_delay(event);
+                    break;
+
+                case CaptureTraceEventKind::SaveCaptureRoute:
+                    replay_save_capture_route(event);
+                    break;
+
+                default:
+                    report_mismatch(event, "unknown event");
+                    break;
+                }
+            }
+        }
+
+        std::size_t get_mismatch_count() const {
+            return mismatch_count;
+        }
+
+        const std::vector<PrepareCapture> &get_prepare_captures() const {
+            return prepare_captures;
+        }
+
+        const std::vector<SaveCapture> &get_save_captures() const {
+            return save_captures;
+        }
+
+    private:
+        const Options &options;
+
+        CapturePrepareSequencer prepare_sequencer;
+        SaveCaptureDelay save_capture_delay;
+
+        std::vector<PrepareCapture> prepare_captures;
+        std::vector<SaveCapture> save_captures;
+
+        std::size_t mismatch_count = 0;
+
+        template <typename... Args>
+        void report_mismatch(const CaptureTraceEvent &event, const char *format, Args... args) {
+            if (mismatch_count++ >= options.max_printed_mismatches) {
+                return;
+            }
+
+            std::printf("MISMATCH frame %llu, %s: ", static_cast<unsigned long long>(event.frame), CaptureTraceRecorder::get_kind_name(event.kind));
+
+            if constexpr (sizeof...(Args) == 0) {
+                std::fputs(format, stdout);
+            } else {
+                std::printf(format, args...);
+            }
+
+            std::fputc('\n', stdout);
+        }
+
+        void replay_prepare_update(const CaptureTraceEvent &update, const CaptureTraceEvent &result) {
+            if (static_cast<int>(prepare_sequencer.get_state()) != update.values[0] || prepare_sequencer.get_frame_left() != update.values[1]) {
+                report_mismatch(update, "state %d with %d frames left, recorded %d with %d", static_cast<int>(prepare_sequencer.get_state()),
+                    prepare_sequencer.get_frame_left(), update.values[0], update.values[1]);
+            }
+
+            // The recorded answers are given back, asking for one the game was not asked for is a different decision path
+            bool asked_settled = false;
+            bool asked_hide_progress = false;
+
+            bool launched = prepare_sequencer.update([&](int) {
+                asked_settled = true;
+                return update.values[2] == 1;
+            }, [&]() {
+                asked_hide_progress = true;
+                return update.progress;
+            });
+
+            if (asked_settled != (update.values[2] >= 0) || asked_hide_progress != (update.progress >= 0.0f)) {
+                report_mismatch(update, "asked for scene settle %d and hide progress %d, recorded %d and %d", asked_settled ? 1 : 0,
+                    asked_hide_progress ? 1 : 0, update.values[2] >= 0 ? 1 : 0, update.progress >= 0.0f ? 1 : 0);
+            }
+
+            if (static_cast<int>(prepare_sequencer.get_state()) != result.values[0] || prepare_sequencer.get_frame_left() != result.values[1] ||
+                (launched ? 1 : 0) != result.values[2]) {
+                report_mismatch(result, "state %d with %d frames left, launched %d, recorded %d with %d, launched %d",
+                    static_cast<int>(prepare_sequencer.get_state()), prepare_sequencer.get_frame_left(), launched ? 1 : 0, result.values[0],
+                    result.values[1], result.values[2]);
+            }
+
+            // Measured on what happened in game, a mismatch is already reported
+            if (result.values[2] == 1 && !prepare_captures.empty() && prepare_captures.back().launch == nullptr) {
+                prepare_captures.back().launch = &result;
+                prepare_captures.back().settled_early = update.values[2] == 1;
+            }
+        }
+
+        void replay_timescale(const CaptureTraceEvent &event) {
+            bool is_releasing = prepare_sequencer.is_releasing_timescale();
+
+            if (!prepare_sequencer.is_holding_timescale() || prepare_sequencer.get_frame_left() != event.values[0] ||
+                (is_releasing ? 1 : 0) != event.values[1]) {
+                report_mismatch(event, "holding %d with %d frames left, releasing %d, recorded %d frames left, releasing %d",
+                    prepare_sequencer.is_holding_timescale() ? 1 : 0, prepare_sequencer.get_frame_left(), is_releasing ? 1 : 0, event.values[0],
+                    event.values[1]);
+            }
+
+            if (event.values[1] == 1 && !prepare_captures.empty() && prepare_captures.back().release == nullptr) {
+                prepare_captures.back().release = &event;
+            }
+        }
+
+        void replay_save_capture_delay(const CaptureTraceEvent &event) {
+            bool should_delay = save_capture_delay.update(static_cast<SaveCaptureState>(event.values[0]), event.values[1]);
+
+            if ((should_delay ? 1 : 0) != event.values[2]) {
+                report_mismatch(event, "state %d, delayed %d, recorded %d", event.values[0], should_delay ? 1 : 0, event.values[2]);
+            }
+
+            // The delay runs in COPY_TO_STAGING, after the request was taken
+            if (event.values[2] == 1 && !save_captures.empty() && save_captures.back().end == nullptr) {
+                save_captures.back().delayed_updates++;
+            }
+        }
+
+        // Same order as WebPCaptureInjector::post_start_update_save_capture
+        void replay_save_capture_route(const CaptureTraceEvent &event) {
+            auto state = static_cast<SaveCaptureState>(event.values[0]);
+            bool has_request = event.values[1] == 1;
+            bool had_pending_request = event.values[2] == 1;
+            std::size_t request_count = static_cast<std::size_t>(event.values[3]);
+            bool is_capture_done = event.values[4] == 1;
+
+            int actions = 0;
+
+            if (SaveCaptureRouting::should_start_pending(state, has_request) && had_pending_request) {
+                actions |= SaveCaptureRouting::Action_StartPending;
+                has_request = true;
+            }
+
+            if (SaveCaptureRouting::should_finish(state, has_request, is_capture_done)) {
+                actions |= SaveCaptureRouting::Action_Finish;
+                has_request = false;
+                request_count--;
+            }
+
+            if (SaveCaptureRouting::should_drop(state, has_request)) {
+                actions |= SaveCaptureRouting::Action_Drop;
+                has_request = false;
+                request_count--;
+            }
+
+            if (SaveCaptureRouting::should_disarm(state, request_count)) {
+                actions |= SaveCaptureRouting::Action_Disarm;
+            }
+
+            if (actions != event.values[5]) {
+                report_mismatch(event, "state %d, actions 0x%x, recorded 0x%x", event.values[0], actions, event.values[5]);
+            }
+
+            // Measured on what happened in game, a mismatch is already reported
+            int recorded_actions = event.values[5];
+
+            if (recorded_actions & SaveCaptureRouting::Action_StartPending) {
+                save_captures.push_back({ &event });
+            }
+
+            if ((recorded_actions & (SaveCaptureRouting::Action_Finish | SaveCaptureRouting::Action_Drop)) && !save_captures.empty() &&
+                save_captures.back().end == nullptr) {
+                save_captures.back().end = &event;
+                save_captures.back().dropped = (recorded_actions & SaveCaptureRouting::Action_Drop) != 0;
+            }
+        }
+    };
+
+    Latency get_latency(const CaptureTraceEvent &from, const CaptureTraceEvent &to) {
+        return { to.frame - from.frame, static_cast<double>(to.time_us - from.time_us) / 1000.0 };
+    }
+
+    class LatencySummary {
+    public:
+        void add(const Latency &latency) {
+            count++;
+            min_frames = std::min(min_frames, latency.frames);
+            max_frames = std::max(max_frames, latency.frames);
+            total_frames += latency.frames;
+            total_milliseconds += latency.milliseconds;
+        }
+
+        void print(const char *name) const {
+            if (count == 0) {
+                std::printf("%s: none\n", name);
+                return;
+            }
+
+            std::printf("%s: %zu, frames min %llu / avg %.1f / max %llu, avg %.1f ms\n", name, count, static_cast<unsigned long long>(min_frames),
+                static_cast<double>(total_frames) / static_cast<double>(count), static_cast<unsigned long long>(max_frames),
+                total_milliseconds / static_cast<double>(count));
+        }
+
+        std::uint64_t get_max_frames() const {
+            return count == 0 ? 0 : max_frames;
+        }
+
+    private:
+        std::size_t count = 0;
+        std::uint64_t min_frames = std::numeric_limits<std::uint64_t>::max();
+        std::uint64_t max_frames = 0;
+        std::uint64_t total_frames = 0;
+        double total_milliseconds = 0.0;
+    };
+
+    void print_usage() {
+        std::fputs("Usage: MHWildsCaptureReplay <trace.csv> [--max-launch-frames n] [--max-inject-frames n] [--max-mismatches n]\n", stderr);
+    }
+
+    bool parse_count_option(int argc, char **argv, int &index, std::uint64_t &value) {
+        if (index + 1 >= argc) {
+            std::fprintf(stderr, "Missing value for %s\n", argv[index]);
+            return false;
+        }
+
+        char *end = nullptr;
+        unsigned long long parsed = std::strtoull(argv[++index], &end, 10);
+
+        if (end == argv[index] || *end != '\0') {
+            std::fprintf(stderr, "Invalid value for %s: %s\n", argv[index - 1], argv[index]);
+            return false;
+        }
+
+        value = parsed;
+        return true;
+    }
+
+    bool parse_options(int argc, char **argv, Options &options) {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            std::uint64_t value = 0;
+
+            if (arg == "--help" || arg == "-h") {
+                return false;
+            } else if (arg == "--max-launch-frames" || arg == "--max-inject-frames" || arg == "--max-mismatches") {
+                if (!parse_count_option(argc, argv, i, value)) {
+                    return false;
+                }
+
+                if (arg == "--max-launch-frames") {
+                    options.max_launch_frames = value;
+                } else if (arg == "--max-inject-frames") {
+                    options.max_inject_frames = value;
+                } else {
+                    options.max_printed_mismatches = static_cast<std::size_t>(value);
+                }
+            } else if (arg.starts_with("--")) {
+                std::fprintf(stderr, "Unknown option: %s\n", arg.c_str());
+                return false;
+            } else if (options.trace_path.empty()) {
+                options.trace_path = arg;
+            } else {
+                return false;
+            }
+        }
+
+        return !options.trace_path.empty();
+    }
+}
+
+int main(int argc, char **argv) {
+    Options options;
+
+    if (!parse_options(argc, argv, options)) {
+        print_usage();
+        return 2;
+    }
+
+    std::vector<CaptureTraceEvent> events;
+    std::string error;
+
+    if (!CaptureTraceRecorder::load(options.trace_path, events, error)) {
+        std::fprintf(stderr, "Can't read %s: %s\n", options.trace_path.c_str(), error.c_str());
+        return 2;
+    }
+
+    std::printf("%zu events over %llu frames\n", events.size(), events.empty() ? 0ull : static_cast<unsigned long long>(events.back().frame));
+
+    TraceReplayer replayer(options);
+    replayer.replay(events);
+
+    LatencySummary launch_summary;
+    LatencySummary release_summary;
+    LatencySummary inject_summary;
+
+    for (const auto &capture : replayer.get_prepare_captures()) {
+        if (capture.launch == nullptr) {
+            std::printf("Capture at frame %llu: never launched\n", static_cast<unsigned long long>(capture.start->frame));
+            continue;
+        }
+
+        auto launch = get_latency(*capture.start, *capture.launch);
+        launch_summary.add(launch);
+
+        std::printf("Capture at frame %llu: freeze %d + %d frames, launched after %llu frames (%.1f ms)%s", static_cast<unsigned long long>(capture.start->frame),
+            capture.start->values[0], capture.start->values[1], static_cast<unsigned long long>(launch.frames), launch.milliseconds,
+            capture.settled_early ? ", scene settled early" : "");
+
+        if (capture.release != nullptr) {
+            auto release = get_latency(*capture.start, *capture.release);
+            release_summary.add(release);
+
+            std::printf(", timescale released after %llu frames (%.1f ms)", static_cast<unsigned long long>(release.frames), release.milliseconds);
+        }
+
+        std::fputc('\n', stdout);
+    }
+
+    for (const auto &capture : replayer.get_save_captures()) {
+        if (capture.end == nullptr) {
+            std::printf("Save capture at frame %llu: never injected\n", static_cast<unsigned long long>(capture.start->frame));
+            continue;
+        }
+
+        auto inject = get_latency(*capture.start, *capture.end);
+
+        std::printf("Save capture at frame %llu: %s after %llu frames (%.1f ms), %d delayed updates\n", static_cast<unsigned long long>(capture.start->frame),
+            capture.dropped ? "dropped" : "injected", static_cast<unsigned long long>(inject.frames), inject.milliseconds, capture.delayed_updates);
+
+        if (!capture.dropped) {
+            inject_summary.add(inject);
+        }
+    }
+
+    launch_summary.print("Request to launch");
+    release_summary.print("Request to timescale release");
+    inject_summary.print("Save capture to injection");
+
+    bool failed = false;
+
+    if (replayer.get_mismatch_count() != 0) {
+        std::printf("FAILED: %zu decisions differ from the recording\n", replayer.get_mismatch_count());
+        failed = true;
+    }
+
+    if (launch_summary.get_max_frames() > options.max_launch_frames) {
+        std::printf("FAILED: a capture took %llu frames to launch, limit %llu\n", static_cast<unsigned long long>(launch_summary.get_max_frames()),
+            static_cast<unsigned long long>(options.max_launch_frames));
+        failed = true;
+    }
+
+    if (inject_summary.get_max_frames() > options.max_inject_frames) {
+        std::printf("FAILED: a save capture took %llu frames to inject, limit %llu\n", static_cast<unsigned long long>(inject_summary.get_max_frames()),
+            static_cast<unsigned long long>(options.max_inject_frames));
+        failed = true;
+    }
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,713 @@
+// Drives the addon's capture core (CaptureCore.hpp) with a stand-in for the ReShade runtime, presenting synthetic or recorded frames
+// at a fixed frame rate in every back buffer format, and reports per format how many captures per second it sustains, how long a
+// capture takes from the request to its result, how long the present events block the frame and how long HDR frames take to
+// be saved. From ReShade 6.7 the save thread stand-in post-processes and writes the 16-bit HDR PNG like the addon, into memory
+// instead of a file. hdrfix is not run. Before ReShade 6.7 the addon writes through sk_hdr_png, which needs WIC, so --legacy only
+// times HDR frames up to the save thread.
+//
+// Usage: MHWildsCaptureThroughput [options]
+//   --formats <list>          Comma separated, format[:color space] (default all). Formats: rgba8, bgra8, rgbx8, bgrx8,
+//                             rgb10a2, bgr10a2, rgba16f. Color spaces: srgb, scrgb, hdr10, hlg
+//   --size <w>x<h>            Back buffer size (default 3840x2160)
+//   --fps <n>                 Presents per second (default 60)
+//   --seconds <n>             Presents per format, in seconds (default 5)
+//   --capture-every <n>       Request a capture every n presents instead of as soon as the last one finished
+//   --frames <n>              Frames merged per capture (default 1)
+//   --median                  Median of 3 instead of the mean
+//   --before-reshade          Capture on the present before the ReShade effects
+//   --legacy                  ReShade before 6.7: SDR frames come back as RGBA8 and nothing is quantized in the addon
+//   --settle-watch            Sample the scene settle watch on the presents without a capture
+//   --recorded <dir>          Present <dir>/<format>*.raw (raw back buffer dumps of the back buffer size) instead of synthetic frames
+//   --min-captures <n>        Fail if a format sustains less than n captures per second
+//   --max-blocking-ms <n>     Fail if the 99th percentile of the present blocking time of a format is above n milliseconds
+//
+// Exits with 1 when a capture fails or a limit is exceeded, 2 on invalid options or recordings.
+
+#include "CaptureCore.hpp"
+#include "HDRProcessing.hpp"
+#include "JXLDef.hpp"
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image.h>
+#include <stb_image_write.h>
+#include <stb_image_write_hdr_png.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <immintrin.h>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    struct FormatCase {
+        const char *name;
+        reshade::api::format format;
+        reshade::api::color_space color_space;
+    };
+
+    const FormatCase FORMAT_NAMES[] = {
+        { "rgba8", reshade::api::format::r8g8b8a8_unorm, reshade::api::color_space::srgb_nonlinear },
+        { "bgra8", reshade::api::format::b8g8r8a8_unorm, reshade::api::color_space::srgb_nonlinear },
+        { "rgbx8", reshade::api::format::r8g8b8x8_unorm, reshade::api::color_space::srgb_nonlinear },
+        { "bgrx8", reshade::api::format::b8g8r8x8_unorm, reshade::api::color_space::srgb_nonlinear },
+        { "rgb10a2", reshade::api::format::r10g10b10a2_unorm, reshade::api::color_space::srgb_nonlinear },
+        { "bgr10a2", reshade::api::format::b10g10r10a2_unorm, reshade::api::color_space::srgb_nonlinear },
+        { "rgba16f", reshade::api::format::r16g16b16a16_float, reshade::api::color_space::extended_srgb_linear }
+    };
+
+    const struct {
+        const char *name;
+        reshade::api::color_space color_space;
+    } COLOR_SPACE_NAMES[] = {
+        { "srgb", reshade::api::color_space::srgb_nonlinear },
+        { "scrgb", reshade::api::color_space::extended_srgb_linear },
+        { "hdr10", reshade::api::color_space::hdr10_st2084 },
+        { "hlg", reshade::api::color_space::hdr10_hlg }
+    };
+
+    // Every format, and the 10-bit ones once more as HDR10 and HLG
+    const char *DEFAULT_FORMATS = "rgba8,bgra8,rgbx8,bgrx8,rgb10a2,bgr10a2,rgb10a2:hdr10,bgr10a2:hlg,rgba16f:scrgb";
+
+    // Synthetic frames cycled through, so consecutive frames differ like a moving scene
+    constexpr int SYNTHETIC_FRAME_COUNT = 4;
+
+    struct Options {
+        std::vector<FormatCase> formats;
+        std::uint32_t width = 3840;
+        std::uint32_t height = 2160;
+        double fps = 60.0;
+        double seconds = 5.0;
+        int capture_every = 0;
+        int frame_count = 1;
+        int merge_mode = SCREEN_CAPTURE_MERGE_MEAN;
+        bool before_reshade = false;
+        bool legacy = false;
+        bool settle_watch = false;
+        std::string recorded_directory;
+
+        double min_captures_per_second = 0.0;
+        double max_blocking_ms = 0.0;
+    };
+
+    class Samples {
+    public:
+        void add(double milliseconds) {
+            values.push_back(milliseconds);
+        }
+
+        std::size_t size() const {
+            return values.size();
+        }
+
+        double percentile(double fraction) const {
+            if (values.empty()) {
+                return 0.0;
+            }
+
+            auto sorted = values;
+            std::sort(sorted.begin(), sorted.end());
+
+            auto index = static_cast<std::size_t>(std::ceil(fraction * sorted.size())) - 1;
+            return sorted[std::min(index, sorted.size() - 1)];
+        }
+
+        void print(const char *name) const {
+            if (values.empty()) {
+                std::printf("  %s: none\n", name);
+                return;
+            }
+
+            double sum = 0.0;
+
+            for (double value : values) {
+                sum += value;
+            }
+
+            std::printf("  %s: avg %.2f / p50 %.2f / p99 %.2f / max %.2f ms\n", name, sum / values.size(), percentile(0.5), percentile(0.99),
+                percentile(1.0));
+        }
+
+    private:
+        std::vector<double> values;
+    };
+
+    // Filled from the present thread, the merge task and the HDR save thread. One capture runs at a time
+    struct CaptureResults {
+        std::mutex mutex;
+
+        Clock::time_point request_time;
+        std::uint32_t expected_width = 0;
+        std::uint32_t expected_height = 0;
+
+        std::size_t succeeded = 0;
+        std::size_t failed = 0;
+        int last_error = 0;
+
+        Samples downloaded_latency;
+        Samples success_latency;
+        Samples hdr_handoff_latency;
+        Samples hdr_post_process;
+        Samples hdr_png_write;
+        Samples hdr_saved_latency;
+
+        void reset(std::uint32_t width, std::uint32_t height) {
+            std::scoped_lock lock(mutex);
+
+            expected_width = width;
+            expected_height = height;
+            succeeded = 0;
+            failed = 0;
+            last_error = 0;
+
+            downloaded_latency = {};
+            success_latency = {};
+            hdr_handoff_latency = {};
+            hdr_post_process = {};
+            hdr_png_write = {};
+            hdr_saved_latency = {};
+        }
+    } g_results;
+
+    void on_capture_result(int result, int width, int height, void *data) {
+        auto now = Clock::now();
+
+        std::scoped_lock lock(g_results.mutex);
+        double latency = std::chrono::duration<double, std::milli>(now - g_results.request_time).count();
+
+        if (result == RESULT_SCREEN_CAPTURE_DATA_DOWNLOADED) {
+            g_results.downloaded_latency.add(latency);
+        } else if (result == RESULT_SCREEN_CAPTURE_SUCCESS && data != nullptr && static_cast<std::uint32_t>(width) == g_results.expected_width &&
+            static_cast<std::uint32_t>(height) == g_results.expected_height) {
+            g_results.success_latency.add(latency);
+            g_results.succeeded++;
+        } else {
+            g_results.last_error = result;
+            g_results.failed++;
+        }
+    }
+
+    // Only touched by the HDR save thread, kept between captures so the PNG is not timed growing a new buffer
+    std::vector<std::uint8_t> g_hdr_png;
+
+    void write_hdr_png_to_memory(void *context, void *data, int size) {
+        auto png = static_cast<std::vector<std::uint8_t>*>(context);
+        png->insert(png->end(), static_cast<const std::uint8_t*>(data), static_cast<const std::uint8_t*>(data) + size);
+    }
+
+    // Stands in for the addon's HDR save thread up to hdrfix (hdr_save_thread_v67), the PNG goes to memory instead of a file
+    void save_hdr_capture(CaptureCore &core, HdrCaptureJob job) {
+        auto start = Clock::now();
+        auto post_processed = start;
+        auto end = start;
+        bool success = true;
+
+        if (job.quantized) {
+            HDRProcessing::post_process_hdr(job.pixels, job.width, job.height, job.format);
+            post_processed = Clock::now();
+
+            g_hdr_png.clear();
+            success = stbi_write_hdr_png_to_func(write_hdr_png_to_memory, &g_hdr_png, job.width, job.height, 3,
+                reinterpret_cast<const stbi_us*>(job.pixels), 0, static_cast<unsigned char>(JXL_PRIMARIES_2100),
+                static_cast<unsigned char>(job.color_space == reshade::api::color_space::hdr10_hlg ? JXL_TRANSFER_FUNCTION_HLG : JXL_TRANSFER_FUNCTION_PQ)) != 0;
+
+            end = Clock::now();
+        }
+
+        {
+            std::scoped_lock lock(g_results.mutex);
+            g_results.hdr_handoff_latency.add(std::chrono::duration<double, std::milli>(start - g_results.request_time).count());
+
+            if (job.quantized && success) {
+                g_results.hdr_post_process.add(std::chrono::duration<double, std::milli>(post_processed - start).count());
+                g_results.hdr_png_write.add(std::chrono::duration<double, std::milli>(end - post_processed).count());
+                g_results.hdr_saved_latency.add(std::chrono::duration<double, std::milli>(end - g_results.request_time).count());
+            }
+        }
+
+        if (success) {
+            core.finish(RESULT_SCREEN_CAPTURE_SUCCESS, job.width, job.height, job.pixels);
+        } else {
+            core.finish(RESULT_SCREEN_CAPTURE_HDR_NOT_SAVEABLE);
+        }
+
+        core.end_hdr_conversion();
+    }
+
+    void log_capture_message(CaptureLogLevel level, const char *message) {
+        if (level != CaptureLogLevel::Debug) {
+            std::fprintf(stderr, "%s: %s\n", level == CaptureLogLevel::Error ? "error" : "warning", message);
+        }
+    }
+
+    std::uint32_t get_bytes_per_pixel(reshade::api::format format) {
+        return (format == reshade::api::format::r16g16b16a16_float) ? 8 : 4;
+    }
+
+    // Same rule as CaptureCore for ReShade before 6.7, which hands out everything else as RGBA8
+    bool is_legacy_hdr(const FormatCase &format_case) {
+        return (format_case.format == reshade::api::format::r16g16b16a16_float) ||
+            ((format_case.format == reshade::api::format::r10g10b10a2_unorm || format_case.format == reshade::api::format::b10g10r10a2_unorm) &&
+             format_case.color_space == reshade::api::color_space::hdr10_st2084);
+    }
+
+    void fill_synthetic_frame(const FormatCase &format_case, std::uint32_t width, std::uint32_t height, int frame, std::uint8_t *pixels) {
+        for (std::uint32_t y = 0; y < height; y++) {
+            for (std::uint32_t x = 0; x < width; x++) {
+                // A gradient scrolling a bit every frame
+                float r = static_cast<float>((x + frame * 16) % width) / width;
+                float g = static_cast<float>(y) / height;
+                float b = static_cast<float>((x + y + frame * 8) % 256) / 255.0f;
+
+                std::size_t index = static_cast<std::size_t>(y) * width + x;
+
+                switch (format_case.format) {
+                case reshade::api::format::r10g10b10a2_unorm:
+                case reshade::api::format::b10g10r10a2_unorm: {
+                    bool is_bgr = format_case.format == reshade::api::format::b10g10r10a2_unorm;
+                    std::uint32_t red = static_cast<std::uint32_t>(r * 1023.0f);
+                    std::uint32_t blue = static_cast<std::uint32_t>(b * 1023.0f);
+                    std::uint32_t packed = (is_bgr ? blue : red) | (static_cast<std::uint32_t>(g * 1023.0f) << 10) | ((is_bgr ? red : blue) << 20) | (3u << 30);
+
+                    std::memcpy(pixels + index * 4, &packed, sizeof(packed));
+                    break;
+                }
+                case reshade::api::format::r16g16b16a16_float: {
+                    // scRGB, up to 4 times the SDR white
+                    auto half = _mm_cvtps_ph(_mm_setr_ps(r * 4.0f, g * 4.0f, b * 4.0f, 1.0f), _MM_FROUND_TO_NEAREST_INT);
+                    _mm_storel_epi64(reinterpret_cast<__m128i *>(pixels + index * 8), half);
+                    break;
+                }
+                default: {
+                    bool is_bgr = format_case.format == reshade::api::format::b8g8r8a8_unorm || format_case.format == reshade::api::format::b8g8r8x8_unorm;
+                    auto pixel = pixels + index * 4;
+
+                    pixel[is_bgr ? 2 : 0] = static_cast<std::uint8_t>(r * 255.0f);
+                    pixel[1] = static_cast<std::uint8_t>(g * 255.0f);
+                    pixel[is_bgr ? 0 : 2] = static_cast<std::uint8_t>(b * 255.0f);
+                    pixel[3] = 0xFF;
+                    break;
+                }
+                }
+            }
+        }
+    }
+
+    bool load_recorded_frames(const std::string &directory, const FormatCase &format_case, std::size_t frame_size, std::vector<std::vector<std::uint8_t>> &frames) {
+        std::vector<std::filesystem::path> paths;
+        std::error_code ec;
+
+        for (const auto &entry : std::filesystem::directory_iterator(directory, ec)) {
+            auto file_name = entry.path().filename().string();
+
+            if (entry.path().extension() == ".raw" && file_name.starts_with(format_case.name)) {
+                paths.push_back(entry.path());
+            }
+        }
+
+        std::sort(paths.begin(), paths.end());
+
+        for (const auto &path : paths) {
+            std::ifstream file(path, std::ios::binary | std::ios::ate);
+
+            if (!file || static_cast<std::size_t>(file.tellg()) != frame_size) {
+                std::fprintf(stderr, "%s is not a %s back buffer of the given size (%zu bytes)\n", path.string().c_str(), format_case.name, frame_size);
+                return false;
+            }
+
+            file.seekg(0, std::ios::beg);
+
+            auto &frame = frames.emplace_back(frame_size);
+            file.read(reinterpret_cast<char *>(frame.data()), static_cast<std::streamsize>(frame_size));
+        }
+
+        if (frames.empty()) {
+            std::fprintf(stderr, "No %s*.raw recording in %s\n", format_case.name, directory.c_str());
+            return false;
+        }
+
+        return true;
+    }
+
+    // Copies the current frame like ReShade copies the back buffer, in its format or as RGBA8 for ReShade before 6.7
+    class StandInFrameSource : public CaptureFrameSource {
+    public:
+        StandInFrameSource(const FormatCase &format_case, std::uint32_t width, std::uint32_t height, std::vector<std::vector<std::uint8_t>> frames)
+            : format_case(format_case), width(width), height(height), frames(std::move(frames)) {
+        }
+
+        void set_frame(std::size_t index) {
+            current_frame = index % frames.size();
+        }
+
+        bool is_available() override {
+            return true;
+        }
+
+        reshade::api::format get_back_buffer_format() override {
+            return format_case.format;
+        }
+
+        reshade::api::color_space get_color_space() override {
+            return format_case.color_space;
+        }
+
+        void get_screenshot_width_and_height(std::uint32_t *width, std::uint32_t *height) override {
+            *width = this->width;
+            *height = this->height;
+        }
+
+        bool capture_screenshot(std::uint8_t *pixels) override {
+            const auto &frame = frames[current_frame];
+            std::memcpy(pixels, frame.data(), frame.size());
+            return true;
+        }
+
+        // Read back right away, the runtime's GPU copy would only be ready a present later
+        bool capture_rows(const std::uint32_t *rows, std::uint32_t row_count, std::uint8_t *pixels) override {
+            const auto &frame = frames[current_frame];
+            const std::size_t row_size = static_cast<std::size_t>(width) * 4;
+
+            for (std::uint32_t i = 0; i < row_count; i++) {
+                std::memcpy(pixels + i * row_size, frame.data() + rows[i] * row_size, row_size);
+            }
+
+            return true;
+        }
+
+    private:
+        FormatCase format_case;
+        std::uint32_t width;
+        std::uint32_t height;
+        std::vector<std::vector<std::uint8_t>> frames;
+        std::size_t current_frame = 0;
+    };
+
+    struct FormatReport {
+        std::size_t presents = 0;
+        double seconds = 0.0;
+        Samples blocking;
+    };
+
+    // The frames presented for a format, as ReShade would copy them out of the back buffer
+    bool prepare_frames(const Options &options, const FormatCase &format_case, std::vector<std::vector<std::uint8_t>> &frames) {
+        std::size_t frame_size = static_cast<std::size_t>(options.width) * options.height * get_bytes_per_pixel(format_case.format);
+        if (!options.recorded_directory.empty()) {
+            if (!load_recorded_frames(options.recorded_directory, format_case, frame_size, frames)) {
+                return false;
+            }
+        } else {
+            for (int i = 0; i < SYNTHETIC_FRAME_COUNT; i++) {
+                fill_synthetic_frame(format_case, options.width, options.height, i, frames.emplace_back(frame_size).data());
+            }
+        }
+
+        if (options.legacy && !is_legacy_hdr(format_case)) {
+            for (auto &frame : frames) {
+                PixelBufferArena::Buffer converted;
+                auto rgba = CaptureCore::quantize(reshade::api::format::r8g8b8a8_unorm, format_case.format, converted, frame.data(), options.width, options.height);
+
+                if (rgba == nullptr) {
+                    std::fprintf(stderr, "Not enough pixel buffer budget to convert the recording to RGBA8\n");
+                    return false;
+                }
+
+                frame.assign(rgba, rgba + static_cast<std::size_t>(options.width) * options.height * 4);
+            }
+        }
+
+        return true;
+    }
+
+    // Returns false if the last capture did not finish
+    bool run_format(CaptureCore &core, const Options &options, const FormatCase &format_case, std::vector<std::vector<std::uint8_t>> frames,
+        FormatReport &report) {
+        StandInFrameSource source(format_case, options.width, options.height, std::move(frames));
+        g_results.reset(options.width, options.height);
+
+        core.set_scene_settle_watch(options.settle_watch, options.before_reshade, 1.0f);
+
+        const auto frame_interval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / options.fps));
+        const auto presents = static_cast<std::size_t>(options.seconds * options.fps);
+
+        auto start = Clock::now();
+        auto next_present = start;
+
+        for (std::size_t present = 0; present < presents; present++) {
+            bool should_request = (options.capture_every > 0) ? (present % options.capture_every == 0) : true;
+
+            if (should_request) {
+                std::scoped_lock lock(g_results.mutex);
+                auto request_time = Clock::now();
+
+                if (core.request(&on_capture_result, 11, options.before_reshade, options.frame_count, options.merge_mode) == RESULT_SCREEN_CAPTURE_SUBMITTED) {
+                    g_results.request_time = request_time;
+                }
+            }
+
+            source.set_frame(present);
+
+            auto present_start = Clock::now();
+            core.on_present(source, false);
+            core.on_present(source, true);
+            report.blocking.add(std::chrono::duration<double, std::milli>(Clock::now() - present_start).count());
+
+            // A late frame is not caught up, like a game dropping below its frame rate
+            next_present = std::max(next_present + frame_interval, Clock::now());
+            std::this_thread::sleep_until(next_present);
+        }
+
+        report.presents = presents;
+        report.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        core.set_scene_settle_watch(false, false, 0.0f);
+
+        // The last capture may still be merged or saved, it reads the frames of the source
+        auto wait_until = Clock::now() + std::chrono::seconds(10);
+
+        while (!core.is_idle() && Clock::now() < wait_until) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        return core.is_idle();
+    }
+
+    bool parse_format_case(const std::string &text, FormatCase &format_case) {
+        auto separator = text.find(':');
+        auto format_name = text.substr(0, separator);
+
+        bool found = false;
+
+        for (const auto &known : FORMAT_NAMES) {
+            if (format_name == known.name) {
+                format_case = known;
+                found = true;
+            }
+        }
+
+        if (!found) {
+            return false;
+        }
+
+        if (separator == std::string::npos) {
+            return true;
+        }
+
+        auto color_space_name = text.substr(separator + 1);
+
+        for (const auto &known : COLOR_SPACE_NAMES) {
+            if (color_space_name == known.name) {
+                format_case.color_space = known.color_space;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    const char *get_color_space_name(reshade::api::color_space color_space) {
+        for (const auto &known : COLOR_SPACE_NAMES) {
+            if (color_space == known.color_space) {
+                return known.name;
+            }
+        }
+
+        return "unknown";
+    }
+
+    bool parse_formats(const std::string &list, std::vector<FormatCase> &formats) {
+        std::size_t begin = 0;
+
+        while (begin <= list.size()) {
+            auto end = std::min(list.find(',', begin), list.size());
+            FormatCase format_case;
+
+            if (!parse_format_case(list.substr(begin, end - begin), format_case)) {
+                std::fprintf(stderr, "Unknown format: %s\n", list.substr(begin, end - begin).c_str());
+                return false;
+            }
+
+            formats.push_back(format_case);
+            begin = end + 1;
+        }
+
+        return true;
+    }
+
+    void print_usage() {
+        std::fprintf(stderr, "Usage: MHWildsCaptureThroughput [--formats <list>] [--size <w>x<h>] [--fps <n>] [--seconds <n>] [--capture-every <n>] "
+            "[--frames <n>] [--median] [--before-reshade] [--legacy] [--settle-watch] [--recorded <dir>] [--min-captures <n>] [--max-blocking-ms <n>]\n");
+    }
+
+    bool parse_number_option(int argc, char **argv, int &index, double &value) {
+        if (index + 1 >= argc) {
+            std::fprintf(stderr, "Missing value for %s\n", argv[index]);
+            return false;
+        }
+
+        char *end = nullptr;
+        value = std::strtod(argv[++index], &end);
+
+        if (end == argv[index] || *end != '\0' || value < 0.0) {
+            std::fprintf(stderr, "Invalid value for %s: %s\n", argv[index - 1], argv[index]);
+            return false;
+        }
+
+        return true;
+    }
+
+    bool parse_options(int argc, char **argv, Options &options) {
+        std::string format_list = DEFAULT_FORMATS;
+
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            double value = 0.0;
+
+            if (arg == "--formats" || arg == "--recorded" || arg == "--size") {
+                if (i + 1 >= argc) {
+                    std::fprintf(stderr, "Missing value for %s\n", arg.c_str());
+                    return false;
+                }
+
+                std::string text = argv[++i];
+
+                if (arg == "--formats") {
+                    format_list = text;
+                } else if (arg == "--recorded") {
+                    options.recorded_directory = text;
+                } else if (std::sscanf(text.c_str(), "%ux%u", &options.width, &options.height) != 2 || options.width == 0 || options.height == 0) {
+                    std::fprintf(stderr, "Invalid size: %s\n", text.c_str());
+                    return false;
+                }
+            } else if (arg == "--median") {
+                options.merge_mode = SCREEN_CAPTURE_MERGE_MEDIAN_OF_3;
+            } else if (arg == "--before-reshade") {
+                options.before_reshade = true;
+            } else if (arg == "--legacy") {
+                options.legacy = true;
+            } else if (arg == "--settle-watch") {
+                options.settle_watch = true;
+            } else if (arg == "--fps" || arg == "--seconds" || arg == "--capture-every" || arg == "--frames" || arg == "--min-captures" ||
+                arg == "--max-blocking-ms") {
+                if (!parse_number_option(argc, argv, i, value)) {
+                    return false;
+                }
+
+                if (arg == "--fps") {
+                    options.fps = std::max(value, 1.0);
+                } else if (arg == "--seconds") {
+                    options.seconds = value;
+                } else if (arg == "--capture-every") {
+                    options.capture_every = static_cast<int>(value);
+                } else if (arg == "--frames") {
+                    options.frame_count = std::max(static_cast<int>(value), 1);
+                } else if (arg == "--min-captures") {
+                    options.min_captures_per_second = value;
+                } else {
+                    options.max_blocking_ms = value;
+                }
+            } else {
+                std::fprintf(stderr, "Unknown option: %s\n", arg.c_str());
+                return false;
+            }
+        }
+
+        return parse_formats(format_list, options.formats);
+    }
+}
+
+int main(int argc, char **argv) {
+    Options options;
+
+    if (!parse_options(argc, argv, options)) {
+        print_usage();
+        return 2;
+    }
+
+    CaptureCore core;
+    core.set_log_func(&log_capture_message);
+    core.set_hdr_save_func(&save_hdr_capture);
+    core.set_quantize_in_addon(!options.legacy);
+
+    std::printf("%ux%u at %.0f fps, %.1f s per format, %s%d frame%s per capture (%s), captured %s ReShade\n", options.width, options.height, options.fps,
+        options.seconds, options.legacy ? "ReShade before 6.7, " : "", options.frame_count, options.frame_count > 1 ? "s" : "",
+        options.merge_mode == SCREEN_CAPTURE_MERGE_MEDIAN_OF_3 ? "median of 3" : "mean", options.before_reshade ? "before" : "after");
+
+    bool failed = false;
+
+    for (const auto &format_case : options.formats) {
+        std::vector<std::vector<std::uint8_t>> frames;
+
+        if (!prepare_frames(options, format_case, frames)) {
+            return 2;
+        }
+
+        FormatReport report;
+        bool finished = run_format(core, options, format_case, std::move(frames), report);
+
+        std::scoped_lock lock(g_results.mutex);
+        double captures_per_second = g_results.succeeded / std::max(report.seconds, 1e-9);
+
+        std::printf("%s (%s): %zu captures in %.2f s, %.1f captures/s, %zu failed, %zu presents (%.1f fps)\n", format_case.name,
+            get_color_space_name(format_case.color_space), g_results.succeeded, report.seconds, captures_per_second, g_results.failed, report.presents,
+            report.presents / std::max(report.seconds, 1e-9));
+
+        g_results.downloaded_latency.print("Request to data downloaded");
+        g_results.success_latency.print("Request to success");
+        report.blocking.print("Present blocking");
+
+        if (options.settle_watch) {
+            auto settle = core.get_scene_settle_status();
+            std::printf("  Scene settle watch: %s, %d frames compared, last diff %.2f\n", settle.supported ? "supported" : "not supported",
+                settle.frames_compared, settle.last_mean_abs_diff);
+        }
+
+        if (g_results.hdr_handoff_latency.size() != 0) {
+            g_results.hdr_handoff_latency.print("Request to HDR save thread");
+        }
+
+        // hdrfix, the SDR conversion that follows in the addon, is not run
+        if (g_results.hdr_saved_latency.size() != 0) {
+            g_results.hdr_post_process.print("HDR post-processing (half float to PQ, nothing for 10-bit HDR10 and HLG)");
+            g_results.hdr_png_write.print("HDR 16-bit PNG write");
+            g_results.hdr_saved_latency.print("Request to HDR PNG written");
+        }
+
+        if (!finished) {
+            std::printf("FAILED: %s, the last capture did not finish\n", format_case.name);
+            failed = true;
+        }
+
+        if (g_results.failed != 0) {
+            std::printf("FAILED: %s, %zu captures failed, last result %d\n", format_case.name, g_results.failed, g_results.last_error);
+            failed = true;
+        }
+
+        if (captures_per_second < options.min_captures_per_second) {
+            std::printf("FAILED: %s, %.1f captures/s, limit %.1f\n", format_case.name, captures_per_second, options.min_captures_per_second);
+            failed = true;
+        }
+
+        if (options.max_blocking_ms > 0.0 && report.blocking.percentile(0.99) > options.max_blocking_ms) {
+            std::printf("FAILED: %s, present blocking p99 %.2f ms, limit %.2f ms\n", format_case.name, report.blocking.percentile(0.99), options.max_blocking_ms);
+            failed = true;
+        }
+    }
+
+    auto arena_stats = PixelBufferArena::get().get_stats();
+    std::printf("Pixel buffers: peak %.1f MiB, %llu allocations, %llu reuses, %llu rejected\n", arena_stats.peak_bytes / (1024.0 * 1024.0),
+        static_cast<unsigned long long>(arena_stats.allocation_count), static_cast<unsigned long long>(arena_stats.reuse_count),
+        static_cast<unsigned long long>(arena_stats.rejected_count));
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,225 @@
+// Checks the exact capture render target logic without the game: the render target picked for each screen and slot,
+// and the template clone and patch, through a resource loader that keeps the files in memory.
+//
+// Usage: MHWildsExactRenderTargetTest
+// Prints every failed check, exits with 1 if there was one.
+
+#include "ExactRenderTarget.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace {
+    using Resolution = ExactRenderTarget::Resolution;
+
+    // Same as CaptureResolutionInject
+    const ExactRenderTarget::TemplatePathMap TEMPLATES_16x9 = {
+        {{1920, 1080}, "RenderTexture/16x9/Quest_Background_16x9_1080p.rtex"},
+        {{2560, 1440}, "RenderTexture/16x9/Quest_Background_16x9_2K.rtex"},
+        {{3840, 2160}, "RenderTexture/16x9/Quest_Background_16x9_4K.rtex"},
+    };
+
+    const ExactRenderTarget::TemplatePathMap TEMPLATES_21x9 = {
+        {{2560, 1080}, "RenderTexture/21x9/Quest_Background_21x9_1080p.rtex"},
+        {{3440, 1440}, "RenderTexture/21x9/Quest_Background_21x9_3440x1440.rtex"},
+        {{5120, 2160}, "RenderTexture/21x9/Quest_Background_21x9_4K.rtex"},
+    };
+
+    int failed_count = 0;
+
+    void check(bool condition, const char *what) {
+        if (!condition) {
+            std::printf("FAILED: %s\n", what);
+            failed_count++;
+        }
+    }
+
+    // Files by resource path, resources are fake pointers that are only compared
+    class FakeRenderTargetResourceLoader : public RenderTargetResourceLoader {
+    public:
+        std::map<std::string, std::vector<std::uint8_t>> files;
+        std::vector<std::string> written_paths;
+        std::vector<std::string> created_paths;
+        bool fail_writes = false;
+
+        bool read_file(const std::string &path, std::vector<std::uint8_t> &data) override {
+            auto it = files.find(path);
+
+            if (it == files.end()) {
+                return false;
+            }
+
+            data = it->second;
+            return true;
+        }
+
+        bool write_file(const std::string &path, const std::vector<std::uint8_t> &data) override {
+            if (fail_writes) {
+                return false;
+            }
+
+            files[path] = data;
+            written_paths.push_back(path);
+
+            return true;
+        }
+
+        reframework::API::Resource *create_resource(const std::string &path) override {
+            created_paths.push_back(path);
+            return reinterpret_cast<reframework::API::Resource *>(created_paths.size());
+        }
+    };
+
+    // A .rtex header with a marker byte after the size, so a clone of another template can be told apart
+    std::vector<std::uint8_t> make_template(const Resolution &resolution, std::uint8_t marker) {
+        std::vector<std::uint8_t> data(0x40, 0);
+        std::memcpy(data.data(), "RTEX", 4);
+
+        std::uint32_t width = static_cast<std::uint32_t>(resolution.first);
+        std::uint32_t height = static_cast<std::uint32_t>(resolution.second);
+
+        std::memcpy(data.data() + ExactRenderTarget::RTEX_WIDTH_OFFSET, &width, sizeof(width));
+        std::memcpy(data.data() + ExactRenderTarget::RTEX_HEIGHT_OFFSET, &height, sizeof(height));
+        data[0x20] = marker;
+
+        return data;
+    }
+
+    Resolution read_size(const std::vector<std::uint8_t> &data) {
+        std::uint32_t width = 0;
+        std::uint32_t height = 0;
+
+        std::memcpy(&width, data.data() + ExactRenderTarget::RTEX_WIDTH_OFFSET, sizeof(width));
+        std::memcpy(&height, data.data() + ExactRenderTarget::RTEX_HEIGHT_OFFSET, sizeof(height));
+
+        return { static_cast<int>(width), static_cast<int>(height) };
+    }
+
+    void test_choose() {
+        ExactRenderTarget::Choice choice;
+
+        // 16:9 screen, 16:9 slot: the screen itself
+        check(ExactRenderTarget::choose({ 1920, 1080 }, TEMPLATES_16x9, choice), "16:9 screen in the 16:9 slot is chosen");
+        check(choice.exact_resolution == Resolution(1920, 1080), "16:9 screen keeps its size in the 16:9 slot");
+        check(choice.nearest_resolution == Resolution(1920, 1080), "1080p picks the 1080p template");
+
+        check(ExactRenderTarget::choose({ 3200, 1800 }, TEMPLATES_16x9, choice), "3200x1800 is chosen");
+        check(choice.exact_resolution == Resolution(3200, 1800), "3200x1800 keeps its size");
+        check(choice.nearest_resolution == Resolution(3840, 2160), "3200x1800 picks the next bigger template");
+        check(!choice.template_paths.empty() && choice.template_paths.front() == TEMPLATES_16x9.at({ 3840, 2160 }),
+            "The nearest template is cloned first");
+
+        // 21:9 enabled on a 16:9 screen: the letterboxed picture, not a 16:9 target in the 21:9 slot
+        check(ExactRenderTarget::choose({ 1920, 1080 }, TEMPLATES_21x9, choice), "16:9 screen in the 21:9 slot is chosen");
+        check(choice.exact_resolution == Resolution(1920, 810), "16:9 screen in the 21:9 slot is letterboxed to 1920x810");
+        check(choice.nearest_resolution == Resolution(2560, 1080), "1920x810 picks the 2560x1080 template");
+
+        // 16:10 screen in the 16:9 slot
+        check(ExactRenderTarget::choose({ 1920, 1200 }, TEMPLATES_16x9, choice), "16:10 screen in the 16:9 slot is chosen");
+        check(choice.exact_resolution == Resolution(1920, 1080), "16:10 screen in the 16:9 slot is letterboxed to 1920x1080");
+        check(choice.nearest_resolution == Resolution(1920, 1080), "1920x1080 picks its own template");
+
+        check(ExactRenderTarget::choose({ 2560, 1600 }, TEMPLATES_16x9, choice), "2560x1600 is chosen");
+        check(choice.exact_resolution == Resolution(2560, 1440), "2560x1600 in the 16:9 slot is letterboxed to 2560x1440");
+
+        // 21:9 screens close to the slot's ratio fill it
+        check(ExactRenderTarget::choose({ 3440, 1440 }, TEMPLATES_21x9, choice), "3440x1440 is chosen");
+        check(choice.exact_resolution == Resolution(3440, 1440), "3440x1440 keeps its size in the 21:9 slot");
+        check(choice.nearest_resolution == Resolution(3440, 1440), "3440x1440 picks its own template");
+
+        check(ExactRenderTarget::choose({ 3840, 1600 }, TEMPLATES_21x9, choice), "3840x1600 is chosen");
+        check(choice.exact_resolution == Resolution(3840, 1600), "3840x1600 keeps its size in the 21:9 slot");
+
+        // 32:9 is pillarboxed to the slot's ratio
+        check(ExactRenderTarget::choose({ 5120, 1440 }, TEMPLATES_21x9, choice), "5120x1440 is chosen");
+        check(choice.exact_resolution == Resolution(3412, 1440), "5120x1440 in the 21:9 slot is pillarboxed to 3412x1440");
+
+        check(!ExactRenderTarget::choose({ 1920, 1080 }, {}, choice), "Nothing is chosen without templates");
+    }
+
+    void test_create() {
+        const Resolution exact = { 3200, 1800 };
+        ExactRenderTarget::Choice choice;
+        ExactRenderTarget::choose(exact, TEMPLATES_16x9, choice);
+
+        auto exact_path = ExactRenderTarget::get_resource_path(exact);
+
+        {
+            FakeRenderTargetResourceLoader loader;
+            loader.files[TEMPLATES_16x9.at({ 3840, 2160 })] = make_template({ 3840, 2160 }, 4);
+            loader.files[TEMPLATES_16x9.at({ 2560, 1440 })] = make_template({ 2560, 1440 }, 2);
+
+            auto resource = ExactRenderTarget::create(loader, choice.template_paths, exact);
+
+            check(resource != nullptr, "Exact render target is created from an installed template");
+            check(loader.written_paths.size() == 1 && loader.written_paths[0] == exact_path, "The clone is written to the exact path");
+            check(loader.created_paths.size() == 1 && loader.created_paths[0] == exact_path, "The clone is loaded from the exact path");
+
+            const auto &clone = loader.files[exact_path];
+            check(read_size(clone) == exact, "The clone is patched to the exact size");
+            check(clone.size() == 0x40 && clone[0x20] == 4, "The nearest template is the one cloned");
+
+            // Same file already there from an earlier quest: not written again
+            check(ExactRenderTarget::create(loader, choice.template_paths, exact) != nullptr, "Exact render target is created again");
+            check(loader.written_paths.size() == 1, "An unchanged clone is not written again");
+        }
+
+        {
+            // Only a farther template is installed
+            FakeRenderTargetResourceLoader loader;
+            loader.files[TEMPLATES_16x9.at({ 1920, 1080 })] = make_template({ 1920, 1080 }, 1);
+
+            check(ExactRenderTarget::create(loader, choice.template_paths, exact) != nullptr, "A farther installed template is cloned");
+            check(loader.files[exact_path][0x20] == 1 && read_size(loader.files[exact_path]) == exact, "The farther template is patched");
+        }
+
+        {
+            // Packed HD capture pack: nothing to clone, nothing written
+            FakeRenderTargetResourceLoader loader;
+
+            check(ExactRenderTarget::create(loader, choice.template_paths, exact) == nullptr, "No render target without an installed template");
+            check(loader.written_paths.empty() && loader.created_paths.empty(), "Nothing is written or loaded without a template");
+        }
+
+        {
+            FakeRenderTargetResourceLoader loader;
+            loader.files[TEMPLATES_16x9.at({ 3840, 2160 })] = { 'N', 'O', 'P', 'E' };
+
+            check(ExactRenderTarget::create(loader, choice.template_paths, exact) == nullptr, "A file that is not a .rtex is not cloned");
+        }
+
+        {
+            FakeRenderTargetResourceLoader loader;
+            loader.files[TEMPLATES_16x9.at({ 3840, 2160 })] = make_template({ 3840, 2160 }, 4);
+            loader.fail_writes = true;
+
+            check(ExactRenderTarget::create(loader, choice.template_paths, exact) == nullptr, "No render target when the clone can't be written");
+            check(loader.created_paths.empty(), "Nothing is loaded when the clone can't be written");
+        }
+
+        {
+            FakeRenderTargetResourceLoader loader;
+            loader.files[TEMPLATES_16x9.at({ 3840, 2160 })] = make_template({ 3840, 2160 }, 4);
+
+            check(ExactRenderTarget::create(loader, choice.template_paths, { ExactRenderTarget::MAX_DIMENSION + 2, 1080 }) == nullptr,
+                "No render target over the texture size limit");
+        }
+    }
+}
+
+int main() {
+    test_choose();
+    test_create();
+
+    if (failed_count != 0) {
+        std::printf("%d checks failed\n", failed_count);
+        return 1;
+    }
+
+    std::printf("All checks passed\n");
+    return 0;
+}